@@ -2,6 +2,7 @@
 #define DEFERRED_LIBRARY_INCLUDED
 
 #include "DeferredGBuffer.inc.shader"
+#include "MeshVertex.inc.shader"
 
 
 // The default vertex shader for full screen shaders
@@ -13,7 +14,7 @@
     void main()
     {
         // Always ensure the full screen quad is at max depth
-        gl_Position = vec4(_position.xy, 1.0, 1.0);
+        gl_Position = vec4(meshPosition(_position).xy, 1.0, 1.0);
     }
 
 #endif
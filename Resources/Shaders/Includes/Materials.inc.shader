@@ -0,0 +1,20 @@
+#ifndef MATERIALS_INCLUDED
+#define MATERIALS_INCLUDED
+
+// One entry in the material table.
+// Must match MaterialData in MaterialTable.h
+struct MaterialData
+{
+    vec4 color; // rgb = color, a = smoothness
+    sampler2D albedoTexture;
+    sampler2D normalMapTexture;
+};
+
+// Every material that has been drawn.
+// Draws and instances find their material with a material index.
+layout(std430, binding = 4) readonly buffer material_table
+{
+    MaterialData _Materials[];
+};
+
+#endif // MATERIALS_INCLUDED
\ No newline at end of file
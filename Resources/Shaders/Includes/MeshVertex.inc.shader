@@ -0,0 +1,30 @@
+#ifndef MESH_VERTEX_INCLUDED
+#define MESH_VERTEX_INCLUDED
+
+#include "UniformBuffers.inc.shader"
+
+// Decodes the quantised vertex attributes of a mesh.
+// Must match the packing in MeshVertexFormat.cpp
+
+// Gets the mesh space position of a vertex from its stored position
+vec4 meshPosition(vec4 position)
+{
+    return vec4(_MeshPositionOffset.xyz + position.xyz * _MeshPositionScale.xyz, 1.0);
+}
+
+// Gets a unit vector back from its octahedral encoding
+vec3 meshDirection(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+    // Unfold the lower half of the octahedron
+    if (direction.z < 0.0)
+    {
+        vec2 signs = vec2(encoded.x >= 0.0 ? 1.0 : -1.0, encoded.y >= 0.0 ? 1.0 : -1.0);
+        direction.xy = (1.0 - abs(encoded.yx)) * signs;
+    }
+
+    return normalize(direction);
+}
+
+#endif // MESH_VERTEX_INCLUDED
\ No newline at end of file
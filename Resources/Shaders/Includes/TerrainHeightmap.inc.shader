@@ -0,0 +1,42 @@
+#ifndef TERRAIN_HEIGHTMAP_INCLUDED
+#define TERRAIN_HEIGHTMAP_INCLUDED
+
+// Low detail heightmap covering the whole terrain.
+// Always resident, and used wherever no full detail tile is resident.
+layout(binding = 8) uniform sampler2D _TerrainHeightmap;
+
+// Full detail heightfield tiles that are currently resident on the gpu.
+// Each tile stores an extra row and column shared with the next tile.
+layout(binding = 11) uniform sampler2DArray _TerrainHeightmapTiles;
+
+// One texel per heightfield tile.
+// Stores the tile array layer holding the tile, or -1 when it is not resident.
+layout(binding = 12) uniform sampler2D _TerrainHeightmapTileIndirection;
+
+/*
+ * Samples the normalized terrain height at a normalized terrain position.
+ * Uses the full detail tile when resident, and the overview heightmap otherwise.
+ */
+float sampleTerrainHeight(vec2 normalizedPosition)
+{
+    float tilesPerSide = _TerrainHeightfieldInfo.y;
+    float texelsPerTile = _TerrainHeightfieldInfo.z;
+
+    // Find the texel position, and the tile containing it
+    vec2 texel = clamp(normalizedPosition, 0.0, 1.0) * _TerrainHeightfieldInfo.x - 0.5;
+    ivec2 tile = clamp(ivec2(floor(texel / texelsPerTile)), ivec2(0), ivec2(tilesPerSide - 1.0));
+
+    // Fall back to the overview when the tile is not resident
+    float layer = texelFetch(_TerrainHeightmapTileIndirection, tile, 0).r;
+    if (layer < 0.0)
+    {
+        return texture(_TerrainHeightmap, normalizedPosition).r;
+    }
+
+    // Sample the tile. The shared edge means bilinear filtering never crosses tiles.
+    vec2 tileTexel = texel - vec2(tile) * texelsPerTile;
+    vec2 tileUV = (tileTexel + 0.5) / (texelsPerTile + 1.0);
+    return texture(_TerrainHeightmapTiles, vec3(tileUV, layer)).r;
+}
+
+#endif // TERRAIN_HEIGHTMAP_INCLUDED
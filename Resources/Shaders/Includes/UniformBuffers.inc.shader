@@ -46,9 +46,7 @@ layout(std140, binding = 2) uniform shadows_data
 layout(std140, binding = 3) uniform per_draw_data
 {
     uniform mat4x4 _LocalToWorld;
-    uniform vec4 _Color; // rgb = color, a = smoothness
-    sampler2D _AlbedoTexture;
-    sampler2D _NormalMapTexture;
+    uniform uint _MaterialIndex; // The draw's material in the material table
 };
 
 //Terrain uniform buffer
@@ -60,6 +58,11 @@ layout(std140, binding = 5) uniform terrain_data
     // rgb = base color
     // a = max depth, m
     uniform vec4 _WaterColorDepth;
+
+    // x = full heightfield resolution
+    // y = heightfield tiles per side
+    // z = heightfield texels per tile
+    uniform vec4 _TerrainHeightfieldInfo;
 	
     // The blending settings for each terrain layer
     // x = altitude border, y = altitude transition
@@ -79,13 +82,14 @@ layout(std140, binding = 5) uniform terrain_data
     sampler2D _TerrainNormalMapTextures[MAX_TERRAIN_LAYERS];
 };
 
-// Terrain details uniform buffer.
-// The buffer is updated once per details batch.
-layout(std140, binding = 6) uniform terrain_details_data
+// Mesh uniform buffer, bound with each mesh.
+// Must match MeshUniformData in UniformBuffer.h
+layout(std140, binding = 6) uniform mesh_data
 {
-    // World-space offsets for each terrain detail.
-    // Once per detail mesh instance, up to 1024 in total.
-    uniform vec4 _TerrainDetailPositions[1024];
+    // Moves stored vertex positions into mesh space.
+    // Quantised positions are 0..1 across the mesh bounds, and float positions have no offset and a scale of 1.
+    uniform vec4 _MeshPositionOffset;
+    uniform vec4 _MeshPositionScale;
 };
 
 #endif // UNIFORM_BUFFERS_INCLUDED
\ No newline at end of file
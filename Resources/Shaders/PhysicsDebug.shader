@@ -1,5 +1,6 @@
 
 #include "UniformBuffers.inc.shader"
+#include "MeshVertex.inc.shader"
 
 
 
@@ -10,7 +11,7 @@ layout(location = 0) in vec4 _position;
 
 void main()
 {
-    gl_Position = _ViewProjectionMatrix * (_LocalToWorld * _position);
+    gl_Position = _ViewProjectionMatrix * (_LocalToWorld * meshPosition(_position));
 }
 
 #endif // VERTEX_SHADER
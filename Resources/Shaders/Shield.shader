@@ -1,12 +1,13 @@
 
 #include "Common.inc.shader"
 #include "UniformBuffers.inc.shader"
+#include "MeshVertex.inc.shader"
 
 #ifdef VERTEX_SHADER
 
 layout(location = 0) in vec4 _position;
-layout(location = 1) in vec3 _normal;
-layout(location = 2) in vec4 _tangent;
+layout(location = 1) in vec2 _normal;
+layout(location = 2) in vec2 _tangent;
 layout(location = 3) in vec2 _texcoord;
 
 out vec4 worldPosition;
@@ -15,8 +16,8 @@ out vec2 texcoord;
 
 void main()
 {
-    worldPosition = _LocalToWorld * _position;
-    worldNormal = normalize(mat3(_LocalToWorld) * _normal);
+    worldPosition = _LocalToWorld * meshPosition(_position);
+    worldNormal = normalize(mat3(_LocalToWorld) * meshDirection(_normal));
     texcoord = _texcoord * 4.0;
 
     gl_Position = _ViewProjectionMatrix * worldPosition;
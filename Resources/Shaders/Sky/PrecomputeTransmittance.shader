@@ -1,3 +1,4 @@
+#include "MeshVertex.inc.shader"
 
 #ifdef VERTEX_SHADER
 
@@ -6,10 +7,11 @@ out vec2 texcoord;
 
 void main()
 {
-    gl_Position = _position;
+    vec4 position = meshPosition(_position);
+    gl_Position = position;
 
-    // _position ranges from -1 to 1
-    texcoord = _position.xy * 0.5 + 0.5;
+    // The position ranges from -1 to 1
+    texcoord = position.xy * 0.5 + 0.5;
 }
 
 #endif // VERTEX_SHADER
@@ -1,6 +1,7 @@
 
 #include "Common.inc.shader"
 #include "UniformBuffers.inc.shader"
+#include "MeshVertex.inc.shader"
 
 #ifdef VERTEX_SHADER
 
@@ -10,8 +11,9 @@ out vec3 viewDirUnnormalized;
 
 void main()
 {
-    gl_Position = _ViewProjectionMatrix * (_LocalToWorld * _position);
-    viewDirUnnormalized = _position.xyz;
+    vec4 position = meshPosition(_position);
+    gl_Position = _ViewProjectionMatrix * (_LocalToWorld * position);
+    viewDirUnnormalized = position.xyz;
     viewDirUnnormalized.y = max(0.0, viewDirUnnormalized.y);
 }
 
@@ -1,5 +1,10 @@
+#if defined(VERTEX_SHADER) && defined(INSTANCING_ON)
+// Used to find the instance being drawn from the base instance
+#extension GL_ARB_shader_draw_parameters : require
+#endif
 
 #include "UniformBuffers.inc.shader"
+#include "MeshVertex.inc.shader"
 
 #define USE_GBUFFER_WRITE
 #include "Deferred.inc.shader"
@@ -8,29 +13,61 @@
 
 // Vertex attributes
 layout(location = 0) in vec4 _position;
-layout(location = 1) in vec3 _normal;
-layout(location = 2) in vec4 _tangent;
+layout(location = 1) in vec2 _normal;
+layout(location = 2) in vec2 _tangent;
 layout(location = 3) in vec2 _texcoord;
 
+#ifdef INSTANCING_ON
+// The top 3 rows of each instance's local to world matrix.
+// Must match ObjectInstanceData in InstanceBatcher.h
+layout(std430, binding = 2) readonly buffer object_instances
+{
+    vec4 _ObjectInstances[];
+};
+#endif
+
+#if defined(INSTANCING_ON) && defined(INSTANCED_MATERIALS) && !defined(DEPTH_ONLY)
+// The index of each instance's material in the material table
+layout(std430, binding = 3) readonly buffer instance_material_indices
+{
+    uint _InstanceMaterialIndices[];
+};
+#endif
+
+#ifndef DEPTH_ONLY
 // Interpolated values to fragment shader
 out vec2 texcoord;
 
+#ifdef INSTANCED_MATERIALS
+flat out uint materialIndex;
+#endif
+
 // Tangent to world space matrix used for normal mapping
 #ifdef NORMAL_MAP_ON
 out vec3 tangentToWorld[3];
 #else
 out vec3 worldNormal;
 #endif
+#endif // DEPTH_ONLY
 
 void main()
 {
+#ifdef INSTANCING_ON
+	// Read the instance transform from the instance buffer
+	int instance = (gl_BaseInstanceARB + gl_InstanceID) * 3;
+	mat4x4 localToWorld = transpose(mat4x4(_ObjectInstances[instance], _ObjectInstances[instance + 1], _ObjectInstances[instance + 2], vec4(0.0, 0.0, 0.0, 1.0)));
+#else
+	mat4x4 localToWorld = _LocalToWorld;
+#endif
+
 	// Project the vertex position to clip space
-	gl_Position = _ViewProjectionMatrix * (_LocalToWorld * _position);
+	gl_Position = _ViewProjectionMatrix * (localToWorld * meshPosition(_position));
 
+#ifndef DEPTH_ONLY
 #ifdef NORMAL_MAP_ON
 	// Get the normal, tangent and bitangent in world space
-	vec3 worldNormal = normalize(mat3(_LocalToWorld) * _normal);
-	vec3 worldTangent = normalize(mat3(_LocalToWorld) * _tangent.xyz);
+	vec3 worldNormal = normalize(mat3(localToWorld) * meshDirection(_normal));
+	vec3 worldTangent = normalize(mat3(localToWorld) * meshDirection(_tangent));
 	vec3 worldBitangent = cross(worldNormal, worldTangent);
 
 	// Construct a (worldtangent, worldnormal, worldbitangent) basis
@@ -40,20 +77,49 @@ void main()
 	tangentToWorld[2] = vec3(worldTangent.z, worldBitangent.z, worldNormal.z);
 #else
 	// No normal mapping. Send the world space normal directly to the fragment shader.
-	worldNormal = normalize(mat3(_LocalToWorld) * _normal);
+	worldNormal = normalize(mat3(localToWorld) * meshDirection(_normal));
 #endif
 
 	// Texcoord does not need to be modified.
 	texcoord = _texcoord;
+
+#if defined(INSTANCING_ON) && defined(INSTANCED_MATERIALS)
+	// Every instance in a draw command shares a material
+	materialIndex = _InstanceMaterialIndices[gl_BaseInstanceARB + gl_InstanceID];
+#endif
+#endif // DEPTH_ONLY
 }
 
 #endif // VERTEX_SHADER
 
 #ifdef FRAGMENT_SHADER
 
+#ifdef DEPTH_ONLY
+
+// Depth only passes have no outputs, as depth is written automatically.
+void main()
+{
+}
+
+#else
+
 // Interpolated values from vertex shader
 in vec2 texcoord;
 
+// The material comes from the material table, using the instance's material index or the draw's material index
+#include "Materials.inc.shader"
+
+#ifdef INSTANCED_MATERIALS
+flat in uint materialIndex;
+#define MATERIAL_INDEX materialIndex
+#else
+#define MATERIAL_INDEX _MaterialIndex
+#endif
+
+#define MATERIAL_COLOR _Materials[MATERIAL_INDEX].color
+#define MATERIAL_ALBEDO_TEXTURE _Materials[MATERIAL_INDEX].albedoTexture
+#define MATERIAL_NORMAL_MAP_TEXTURE _Materials[MATERIAL_INDEX].normalMapTexture
+
 // Tangent to world space matrix used for normal mapping
 #ifdef NORMAL_MAP_ON
 in vec3 tangentToWorld[3];
@@ -69,17 +135,17 @@ void main()
 
     // Sample the albedo texture for the diffuse color
 #ifdef TEXTURE_ON
-    vec4 diffuseGloss = texture(_AlbedoTexture, texcoord);
-    surface.diffuseColor = diffuseGloss.rgb * _Color.rgb;
+    vec4 diffuseGloss = texture(MATERIAL_ALBEDO_TEXTURE, texcoord);
+    surface.diffuseColor = diffuseGloss.rgb * MATERIAL_COLOR.rgb;
     surface.gloss = diffuseGloss.a;
 #else
-    surface.diffuseColor = _Color.rgb;
-    surface.gloss = _Color.a;
+    surface.diffuseColor = MATERIAL_COLOR.rgb;
+    surface.gloss = MATERIAL_COLOR.a;
 #endif
 
 	// Sample the normal map and convert to world space
 #ifdef NORMAL_MAP_ON
-	vec3 tangentNormal = unpackDXT5nm(texture(_NormalMapTexture, texcoord));
+	vec3 tangentNormal = unpackDXT5nm(texture(MATERIAL_NORMAL_MAP_TEXTURE, texcoord));
     surface.worldNormal.x = dot(tangentNormal, tangentToWorld[0]);
     surface.worldNormal.y = dot(tangentNormal, tangentToWorld[1]);
     surface.worldNormal.z = dot(tangentNormal, tangentToWorld[2]);
@@ -91,4 +157,6 @@ void main()
 	writeToGBuffer(surface);
 }
 
+#endif // DEPTH_ONLY
+
 #endif // FRAGMENT_SHADER
\ No newline at end of file
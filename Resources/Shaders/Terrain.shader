@@ -1,4 +1,5 @@
 #include "UniformBuffers.inc.shader"
+#include "MeshVertex.inc.shader"
 
 #define USE_GBUFFER_WRITE
 #include "Deferred.inc.shader"
@@ -10,7 +11,7 @@ layout(location = 0) in vec4 _position;
 
 void main()
 {
-    gl_Position = _position;
+    gl_Position = meshPosition(_position);
 }
 
 #endif // VERTEX_SHADER
@@ -48,6 +49,7 @@ void main()
 
 layout(triangles, fractional_odd_spacing, ccw) in;
 
+#ifndef DEPTH_ONLY
 // Interpolated values to fragment shader
 out vec4 worldPosition;
 out vec3 worldNormal;
@@ -57,8 +59,9 @@ out vec2 texcoord;
 #ifdef NORMAL_MAP_ON
 out vec3 tangentToWorld[3];
 #endif
+#endif // DEPTH_ONLY
 
-layout(binding = 8) uniform sampler2D _TerrainHeightmap;
+#include "TerrainHeightmap.inc.shader"
 
 void main()
 {
@@ -67,7 +70,7 @@ void main()
     vec4 normalizedPosition = gl_in[0].gl_Position * gl_TessCoord.x
         + gl_in[1].gl_Position * gl_TessCoord.y
         + gl_in[2].gl_Position * gl_TessCoord.z;;
-    normalizedPosition.y = texture(_TerrainHeightmap, normalizedPosition.xz).r;
+    normalizedPosition.y = sampleTerrainHeight(normalizedPosition.xz);
 
 	// The normalized position is only in the range 0 to 1.
 	// This causes the underwater terrain to abruptly stop a few m away from the shore.
@@ -80,23 +83,29 @@ void main()
 
     // Scale by the terrain size to get the world position
     // We also need to offset the terrain downwards to take account of the water depth
+#ifdef DEPTH_ONLY
+    vec4 worldPosition = vec4(normalizedPosition.xyz * _TerrainSize.xyz + vec3(0.0, -_WaterColorDepth.a, 0.0), 1.0);
+#else
     worldPosition = vec4(normalizedPosition.xyz * _TerrainSize.xyz + vec3(0.0, -_WaterColorDepth.a, 0.0), 1.0);
+#endif
 
     // Project the vertex position to clip space
     gl_Position = _ViewProjectionMatrix * worldPosition;
 
+    // Depth only passes do not need the texture coordinates or normals
+#ifndef DEPTH_ONLY
+
     // Compute the Texture coordinates from the normalized position
     texcoord = normalizedPosition.xz;
 
-    // Compute the offset from the normalized position to get the adjacent heightmap pixels
-    ivec2 heightmapRes = textureSize(_TerrainHeightmap, 0);
-    vec2 heightmapTexelSize = 1.0 / heightmapRes;
+    // Compute the offset from the normalized position to get the adjacent heightfield texels
+    vec2 heightmapTexelSize = vec2(1.0 / _TerrainHeightfieldInfo.x);
 
     // Determine the gradient along x and z at the vertex position
-    float x1 = texture(_TerrainHeightmap, normalizedPosition.xz + heightmapTexelSize * vec2(-1.0, 0.0)).r;
-    float x2 = texture(_TerrainHeightmap, normalizedPosition.xz + heightmapTexelSize * vec2(1.0, 0.0)).r;
-    float z1 = texture(_TerrainHeightmap, normalizedPosition.xz + heightmapTexelSize * vec2(0.0, -1.0)).r;
-    float z2 = texture(_TerrainHeightmap, normalizedPosition.xz + heightmapTexelSize * vec2(0.0, 1.0)).r;
+    float x1 = sampleTerrainHeight(normalizedPosition.xz + heightmapTexelSize * vec2(-1.0, 0.0));
+    float x2 = sampleTerrainHeight(normalizedPosition.xz + heightmapTexelSize * vec2(1.0, 0.0));
+    float z1 = sampleTerrainHeight(normalizedPosition.xz + heightmapTexelSize * vec2(0.0, -1.0));
+    float z2 = sampleTerrainHeight(normalizedPosition.xz + heightmapTexelSize * vec2(0.0, 1.0));
     float dydx = x2 - x1;
     float dydz = z2 - z1;
     dydx *= _TerrainSize.y;
@@ -117,12 +126,22 @@ void main()
     tangentToWorld[1] = vec3(worldTangent.y, worldBitangent.y, worldNormal.y);
     tangentToWorld[2] = vec3(worldTangent.z, worldBitangent.z, worldNormal.z);
 #endif
+#endif // DEPTH_ONLY
 }
 
 #endif // TESS_EVALUATION_SHADER
 
 #ifdef FRAGMENT_SHADER
 
+#ifdef DEPTH_ONLY
+
+// Depth only passes have no outputs, as depth is written automatically.
+void main()
+{
+}
+
+#else
+
 // Interpolated values from vertex shader
 in vec4 worldPosition;
 in vec3 worldNormal;
@@ -216,4 +235,6 @@ void main()
     writeToGBuffer(surface);
 }
 
+#endif // DEPTH_ONLY
+
 #endif // FRAGMENT_SHADER
\ No newline at end of file
@@ -1,5 +1,11 @@
 
+#ifdef VERTEX_SHADER
+// Used to find the batch being drawn from the base instance
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+
 #include "UniformBuffers.inc.shader"
+#include "MeshVertex.inc.shader"
 
 #define USE_GBUFFER_WRITE
 #include "Deferred.inc.shader"
@@ -8,8 +14,31 @@
 
 layout(binding = 8) uniform sampler2D _TerrainHeightmap;
 
+// The detail batch data. Must match DetailBatchData in Terrain.h
+struct DetailBatch
+{
+    vec4 boundsMinScale; // xyz = bounds min, w = min scale
+    vec4 boundsSizeScale; // xyz = bounds size, w = scale range
+    int firstInstance;
+    int count;
+};
+
+// The instances of every detail batch, packed together.
+// Each instance is 4 uint16 values: x, z, y and scale,
+// quantised relative to the batch bounds and scale range.
+layout(std430, binding = 0) readonly buffer terrain_detail_instances
+{
+    uvec2 _TerrainDetailInstances[];
+};
+
+// Every detail batch. The base instance of each draw is the batch index.
+layout(std430, binding = 1) readonly buffer terrain_detail_batches
+{
+    DetailBatch _TerrainDetailBatches[];
+};
+
 layout(location = 0) in vec4 _position;
-layout(location = 1) in vec3 _normal;
+layout(location = 1) in vec2 _normal;
 layout(location = 3) in vec2 _texcoord;
 
 out vec3 worldNormal;
@@ -23,20 +52,26 @@ void main()
     float rotationRad = float(gl_InstanceID) * 0.1;
     float sinRotation = sin(rotationRad);
     float cosRotation = cos(rotationRad);
+    vec4 position = meshPosition(_position);
     vec3 localPosition = vec3(
-        _position.x * cosRotation - _position.z * sinRotation,
-        _position.y,
-        _position.x * sinRotation + _position.z * cosRotation
+        position.x * cosRotation - position.z * sinRotation,
+        position.y,
+        position.x * sinRotation + position.z * cosRotation
     );
 
+    // Decode the instance offset and scale
+    DetailBatch batch = _TerrainDetailBatches[gl_BaseInstanceARB];
+    uvec2 packedInstance = _TerrainDetailInstances[batch.firstInstance + gl_InstanceID];
+    vec3 quantisedOffset = vec3(packedInstance.x & 0xFFFFu, packedInstance.y & 0xFFFFu, packedInstance.x >> 16) / 65535.0;
+    float quantisedScale = float(packedInstance.y >> 16) / 65535.0;
+    vec3 offset = batch.boundsMinScale.xyz + quantisedOffset * batch.boundsSizeScale.xyz;
+    float scale = batch.boundsMinScale.w + quantisedScale * batch.boundsSizeScale.w;
+
     // Apply the scale and offset to the local-space position
-    vec4 instanceOffsetScale = _TerrainDetailPositions[gl_InstanceID];
-    vec3 offset = instanceOffsetScale.xyz;
-    float scale = instanceOffsetScale.a;
     vec3 worldPosition = (localPosition * scale) + offset;
 
     // Apply a wind offset to the world position
-    float offsetMagnitude = sin(_Time.x * 1.5 + dot(worldPosition, vec3(0.2))) * _position.y;
+    float offsetMagnitude = sin(_Time.x * 1.5 + dot(worldPosition, vec3(0.2))) * position.y;
     vec2 offsetDir = vec2(0.45, 0.2);
     worldPosition.xz += offsetDir * offsetMagnitude;
 
@@ -44,23 +79,26 @@ void main()
     gl_Position = _ViewProjectionMatrix * vec4(worldPosition, 1.0);
 
     // Cross product to get the world normal
+    vec3 normal = meshDirection(_normal);
     worldNormal = vec3(
-        _normal.x * cosRotation - _normal.z * sinRotation,
-        _normal.y,
-        _normal.x * sinRotation + _normal.z * cosRotation
+        normal.x * cosRotation - normal.z * sinRotation,
+        normal.y,
+        normal.x * sinRotation + normal.z * cosRotation
     );
 
     // Texcoord does not need to be modified.
     texcoord = _texcoord;
 
     // The top should be non-occluded, the bottom should be occluded
-    occlusion = _position.y;
+    occlusion = position.y;
 }
 
 #endif // VERTEX_SHADER
 
 #ifdef FRAGMENT_SHADER
 
+#include "Materials.inc.shader"
+
 in vec3 worldNormal;
 in vec2 texcoord;
 in float occlusion;
@@ -71,8 +109,8 @@ void main()
 
     // Sample the albedo texture for the diffuse color
 #ifdef TEXTURE_ON
-    vec4 diffuseAlpha = texture(_AlbedoTexture, texcoord);
-    surface.diffuseColor = diffuseAlpha.rgb * _Color.rgb;
+    vec4 diffuseAlpha = texture(_Materials[_MaterialIndex].albedoTexture, texcoord);
+    surface.diffuseColor = diffuseAlpha.rgb * _Materials[_MaterialIndex].color.rgb;
 
 #ifdef ALPHA_TEST_ON
     // Use alpha test rendering
@@ -83,11 +121,11 @@ void main()
 #endif
 
 #else
-    surface.diffuseColor = _Color.rgb;
+    surface.diffuseColor = _Materials[_MaterialIndex].color.rgb;
 #endif
 
     // The a channel is used for opacity, so always use a constant gloss term.
-    surface.gloss = _Color.a;
+    surface.gloss = _Materials[_MaterialIndex].color.a;
 
     // Make grass partially translucent
 #ifdef TEXTURE_ON
@@ -1,6 +1,7 @@
 
 #include "Common.inc.shader"
 #include "UniformBuffers.inc.shader"
+#include "MeshVertex.inc.shader"
 #include "PhysicallyBasedShading.inc.shader"
 
 #undef SOFT_SHADOWS
@@ -16,7 +17,7 @@ layout(location = 0) in vec4 _position;
 
 void main()
 {
-    gl_Position = _position;
+    gl_Position = meshPosition(_position);
 }
 
 #endif // VERTEX_SHADER
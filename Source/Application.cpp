@@ -196,6 +196,15 @@ void Application::drawFrame()
             createFullScreenRenderer();
         }
 
+        // Show a blank screen until the shader variants used by the scene are ready
+        if (!fullScreenRenderer_->warmUpShaders())
+        {
+            Framebuffer::backbuffer()->use();
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            return;
+        }
+
         // OpenGL doesn't like us grabbing the default framebuffer's depth texture
         // As a workaround, render to a separate framebuffer and blit to the default fbo.
         fullScreenRenderer_->renderFrame(SceneManager::instance()->mainCamera());
@@ -215,23 +224,48 @@ void Application::drawFrame()
 
 void Application::createFullScreenRenderer()
 {
-    if(fullScreenRenderer_ != nullptr)
+    RenderTargetPool& pool = RenderManager::instance()->renderTargetPool();
+
+    // Return any existing textures to the pool
+    if (fullScreenFramebuffer_ != nullptr)
     {
-        destroyFullScreenRenderer();
+        pool.releaseTexture(fullScreenDepthTexture_);
+        pool.releaseTexture(fullScreenColorTexture_);
+    }
+    else
+    {
+        fullScreenFramebuffer_ = new Framebuffer();
     }
 
-    fullScreenDepthTexture_ = new Texture(TextureFormat::Depth, Framebuffer::backbuffer()->width(), Framebuffer::backbuffer()->height());
-    fullScreenColorTexture_ = new Texture(TextureFormat::RGBA8_SRGB, Framebuffer::backbuffer()->width(), Framebuffer::backbuffer()->height());
-    fullScreenFramebuffer_ = new Framebuffer();
+    // Get textures matching the backbuffer from the shared pool
+    fullScreenDepthTexture_ = pool.acquireTexture({ TextureFormat::Depth, Framebuffer::backbuffer()->width(), Framebuffer::backbuffer()->height() });
+    fullScreenColorTexture_ = pool.acquireTexture({ TextureFormat::RGBA8_SRGB, Framebuffer::backbuffer()->width(), Framebuffer::backbuffer()->height() });
     fullScreenFramebuffer_->attachDepthTexture(fullScreenDepthTexture_);
     fullScreenFramebuffer_->attachColorTexture(fullScreenColorTexture_);
-    fullScreenRenderer_ = new Renderer(fullScreenFramebuffer_);
+
+    // The renderer only needs to be rebound to the new textures after a resize
+    if (fullScreenRenderer_ == nullptr)
+    {
+        fullScreenRenderer_ = new Renderer(fullScreenFramebuffer_);
+    }
+    else
+    {
+        fullScreenRenderer_->setTargetFramebuffers({ fullScreenFramebuffer_ });
+    }
 }
 
 void Application::destroyFullScreenRenderer()
 {
+    if (fullScreenFramebuffer_ != nullptr)
+    {
+        RenderManager::instance()->renderTargetPool().releaseTexture(fullScreenDepthTexture_);
+        RenderManager::instance()->renderTargetPool().releaseTexture(fullScreenColorTexture_);
+    }
+
     delete fullScreenRenderer_;
     delete fullScreenFramebuffer_;
-    delete fullScreenDepthTexture_;
-    delete fullScreenColorTexture_;
+    fullScreenRenderer_ = nullptr;
+    fullScreenFramebuffer_ = nullptr;
+    fullScreenDepthTexture_ = nullptr;
+    fullScreenColorTexture_ = nullptr;
 }
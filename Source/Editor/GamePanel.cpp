@@ -8,6 +8,7 @@
 #include "Scene/Freecam.h"
 #include "Editor/MainWindowMenu.h"
 #include "PhysicsManager.h"
+#include "RenderManager.h"
 
 GamePanel::GamePanel()
     : frameBuffer_(nullptr)
@@ -25,13 +26,13 @@ GamePanel::GamePanel()
 
 GamePanel::~GamePanel()
 {
-    // Delete any existing framebuffer
+    // Delete any existing framebuffer, and return its textures to the pool
     if (frameBuffer_ != nullptr)
     {
-        delete frameBuffer_;
-        delete depthBuffer_;
-        delete colorBuffer_;
         delete renderer_;
+        delete frameBuffer_;
+        RenderManager::instance()->renderTargetPool().releaseTexture(depthBuffer_);
+        RenderManager::instance()->renderTargetPool().releaseTexture(colorBuffer_);
     }
 }
 
@@ -68,6 +69,16 @@ void GamePanel::draw()
     // Make sure the game camera only moves in edit mode
     camera_->gameObject()->findComponent<Freecam>()->setUpdateEnabled(usingSceneCamera);
 
+    // Create the shader variants used by the scene before drawing it.
+    // Show the progress instead of the scene until they are ready.
+    if (!renderer_->warmUpShaders())
+    {
+        const ShaderWarmup& warmup = RenderManager::instance()->shaderWarmup();
+        const std::string label = "Compiling shaders (" + std::to_string(warmup.completed()) + " / " + std::to_string(warmup.total()) + ")";
+        ImGui::ProgressBar(warmup.progress(), ImVec2(-1.0f, 0.0f), label.c_str());
+        return;
+    }
+
     // Re-render the framebuffer on each draw
     // Use the game panel camera in edit mode, and the scene main camera in play mode
     renderer_->renderFrame(usingSceneCamera ? camera_ : SceneManager::instance()->mainCamera());
@@ -79,31 +90,51 @@ void GamePanel::draw()
     }
 
     // Draw the texture
+    const ImVec2 imagePosition = ImGui::GetCursorPos();
     ImGui::Image((ImTextureID)(uint64_t)colorBuffer_->glid(), ImGui::GetContentRegionAvail(), ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
+
+    // Show the render stats on top of the scene
+    if (RenderManager::instance()->statsOverlayEnabled())
+    {
+        ImGui::SetCursorPos(imagePosition);
+        drawStatsOverlay();
+    }
 }
 
 void GamePanel::createFramebuffer(int width, int height)
 {
-    // Delete any existing framebuffer
+    RenderTargetPool& pool = RenderManager::instance()->renderTargetPool();
+
+    // Return the existing textures to the pool.
+    // They are kept for a while, so resizing back to a previous size reuses them.
     if (frameBuffer_ != nullptr)
     {
-        delete frameBuffer_;
-        delete depthBuffer_;
-        delete colorBuffer_;
-        delete renderer_;
+        pool.releaseTexture(depthBuffer_);
+        pool.releaseTexture(colorBuffer_);
+    }
+    else
+    {
+        frameBuffer_ = new Framebuffer();
     }
 
-    // Create new framebuffer and textures with new panel dimensions
-    frameBuffer_ = new Framebuffer();
-    depthBuffer_ = new Texture(TextureFormat::Depth, width, height);
-    colorBuffer_ = new Texture(TextureFormat::RGB8_SRGB, width, height);
+    // Get textures with the new panel dimensions from the shared pool
+    depthBuffer_ = pool.acquireTexture({ TextureFormat::Depth, width, height });
+    colorBuffer_ = pool.acquireTexture({ TextureFormat::RGB8_SRGB, width, height });
 
-    // Attach new textures to new framebuffer
+    // Attach the textures to the framebuffer
     frameBuffer_->attachDepthTexture(depthBuffer_);
     frameBuffer_->attachColorTexture(colorBuffer_);
 
-    // Then create a renderer for the framebuffer.
-    renderer_ = new Renderer(frameBuffer_);
+    // Then point the renderer at the framebuffer.
+    // The renderer's shared resources do not depend on the size, so it is only created once.
+    if (renderer_ == nullptr)
+    {
+        renderer_ = new Renderer(frameBuffer_);
+    }
+    else
+    {
+        renderer_->setTargetFramebuffers({ frameBuffer_ });
+    }
 }
 
 void GamePanel::drawFeatureToggle(ShaderFeature feature, const char* label) const
@@ -122,4 +153,65 @@ void GamePanel::drawDebugModeToggle(RenderDebugMode mode, const char* label) con
     {
         RenderManager::instance()->setDebugMode(on ? RenderDebugMode::None : mode);
     }
+}
+
+void GamePanel::drawStatsOverlay() const
+{
+    // The stats are a few frames behind, as they wait for the gpu timings to be read back
+    const RenderFrameStats* stats = renderer_->frameStats();
+    if (stats == nullptr)
+    {
+        return;
+    }
+
+    // Darken the scene behind the stats so that they can be read.
+    // There is a row for the headings, one for each pass and one for the totals.
+    const int rows = (int)stats->passes.size() + 2;
+    const ImVec2 min = ImGui::GetCursorScreenPos();
+    const ImVec2 max(min.x + ImGui::GetContentRegionAvail().x, min.y + rows * ImGui::GetTextLineHeightWithSpacing());
+    ImGui::GetWindowDrawList()->AddRectFilled(min, max, IM_COL32(0, 0, 0, 160));
+
+    ImGui::Columns(8, "RenderStats", false);
+    for (const char* heading : { "Pass", "View", "Draws", "Triangles", "Binds", "Uploads", "CPU ms", "GPU ms" })
+    {
+        ImGui::Text("%s", heading);
+        ImGui::NextColumn();
+    }
+
+    for (const RenderPassStats& pass : stats->passes)
+    {
+        drawStatsRow(pass.name, (pass.view < 0) ? "All" : std::to_string(pass.view), pass.counters, pass.cpuMilliseconds, pass.gpuMilliseconds);
+    }
+
+    drawStatsRow("Total", "", stats->total(), stats->cpuMilliseconds(), stats->gpuMilliseconds());
+    ImGui::Columns(1);
+}
+
+void GamePanel::drawStatsRow(const std::string &name, const std::string &view, const RenderDeviceStats &counters, float cpuMilliseconds, float gpuMilliseconds)
+{
+    ImGui::Text("%s", name.c_str());
+    ImGui::NextColumn();
+    ImGui::Text("%s", view.c_str());
+    ImGui::NextColumn();
+    ImGui::Text("%d", counters.draws);
+    ImGui::NextColumn();
+    ImGui::Text("%llu", (unsigned long long)counters.triangles);
+    ImGui::NextColumn();
+    ImGui::Text("%d", counters.shaderBinds);
+    ImGui::NextColumn();
+    ImGui::Text("%d (%.1f KB)", counters.bufferUploads, counters.bytesUploaded / 1024.0f);
+    ImGui::NextColumn();
+    ImGui::Text("%.2f", cpuMilliseconds);
+    ImGui::NextColumn();
+
+    // Passes without a gpu timing show a dash
+    if (gpuMilliseconds < 0.0f)
+    {
+        ImGui::Text("-");
+    }
+    else
+    {
+        ImGui::Text("%.2f", gpuMilliseconds);
+    }
+    ImGui::NextColumn();
 }
\ No newline at end of file
@@ -37,4 +37,10 @@ private:
 
     // Draws a toggle for picking the current debugging mode
     void drawDebugModeToggle(RenderDebugMode mode, const char* label) const;
+
+    // Draws the renderer's stats for each pass on top of the scene
+    void drawStatsOverlay() const;
+
+    // Draws one row of the stats overlay
+    static void drawStatsRow(const std::string &name, const std::string &view, const RenderDeviceStats &counters, float cpuMilliseconds, float gpuMilliseconds);
 };
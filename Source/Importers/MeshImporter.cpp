@@ -1,19 +1,29 @@
 #include "MeshImporter.h"
 
+#include "Importers\MeshIndexOptimizer.h"
+#include "Importers\MeshSimplifier.h"
 #include "Math\Vector3.h"
 #include "Math\Point3.h"
 #include "Math\Point2.h"
 #include "Renderer\Mesh.h"
+#include "Renderer\MeshVertexFormat.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <tuple>
 
 #include <filesystem>
 namespace fs = std::experimental::filesystem::v1;
 
+const float MeshImporter::LOD_TRIANGLE_RATIO = 0.5f;
+const float MeshImporter::MIN_LOD_REDUCTION = 0.85f;
+const float MeshImporter::MAX_LOD_ERROR = 0.25f;
+
 bool MeshImporter::importFile(const std::string& sourceFile, const std::string& outputFile) const
 {
     // Determine the file extension that we are importing.
@@ -35,23 +45,6 @@ bool MeshImporter::importFile(const std::string& sourceFile, const std::string&
     return false;
 }
 
-int attributeSearch(const std::vector<Point3> &positionAttributes, const std::vector<Vector3> &normalAttributes,
-    const std::vector<Point2> &texCoordAttributes, const Point3 &position, const Vector3 &normal, const Point2 &texCoord)
-{
-    assert(positionAttributes.size() == normalAttributes.size());
-    assert(positionAttributes.size() == texCoordAttributes.size());
-
-    for (unsigned int i = 0; i < positionAttributes.size(); i++)
-    {
-        if (position == positionAttributes[i] && normal == normalAttributes[i] && texCoord == texCoordAttributes[i])
-        {
-            return i;
-        }
-    }
-
-    return -1;
-}
-
 struct objVertex
 {
     int position;
@@ -173,32 +166,30 @@ bool MeshImporter::importObjFile(const std::string& sourceFile, const std::strin
     std::vector<Vector4> tangentAttributes;
     std::vector<Point2> texCoordAttributes;
 
-    // Count through data indices and assign to arrays in desired order
+    // Count through data indices and assign to arrays in desired order.
+    // Faces that share a combination of position, texcoord and normal share a vertex.
+    std::map<std::tuple<int, int, int>, int> attributeIndices;
     assert(vertices.size() % 3 == 0);
     for (unsigned int i = 0; i < vertices.size(); i++)
     {
         objVertex vertex = vertices[i];
 
-        // Get attributes for next vertex
-        Point3 position = positions[vertex.position - 1];
-        Vector3 normal = normals[vertex.normal - 1];
-        Point2 texCoord = texCoords[vertex.texCoord - 1];
-
         // Determine which location in the attributes list has those values
-        int attributeIndex = attributeSearch(positionAttributes, normalAttributes, texCoordAttributes, position, normal, texCoord);
+        const std::tuple<int, int, int> key(vertex.position, vertex.texCoord, vertex.normal);
+        auto found = attributeIndices.find(key);
 
-        if (attributeIndex == -1)
+        if (found == attributeIndices.end())
         {
             // Not found, insert the values
-            positionAttributes.push_back(position);
-            normalAttributes.push_back(normal);
-            texCoordAttributes.push_back(texCoord);
+            positionAttributes.push_back(positions[vertex.position - 1]);
+            normalAttributes.push_back(normals[vertex.normal - 1]);
+            texCoordAttributes.push_back(texCoords[vertex.texCoord - 1]);
 
             // Use the index of the new attributes
-            attributeIndex = (int)positionAttributes.size() - 1;
+            found = attributeIndices.insert(std::make_pair(key, (int)positionAttributes.size() - 1)).first;
         }
 
-        vertexIndices.push_back((MeshElementIndex)attributeIndex);
+        vertexIndices.push_back((MeshElementIndex)found->second);
     }
 
     // Apply obj file scale.
@@ -316,6 +307,43 @@ void MeshImporter::preProcessTangents(std::vector<Point3> &positionAttributes,
 	}
 }
 
+std::vector<MeshLod> MeshImporter::generateLods(const std::vector<Point3> &positionAttributes,
+    std::vector<MeshElementIndex> &elementIndices, float boundingRadius) const
+{
+    std::vector<MeshLod> lods;
+    lods.push_back(MeshLod { 0, (int)elementIndices.size(), 0.0f });
+    if (boundingRadius <= 0.0f)
+    {
+        return lods;
+    }
+
+    // Each level is simplified from the one before it, which is much quicker than starting from
+    // the full detail mesh each time. The errors add up, so each level's error includes the levels before it.
+    const MeshSimplifier simplifier(positionAttributes.data(), (int)positionAttributes.size());
+    std::vector<uint32_t> previous(elementIndices.begin(), elementIndices.end());
+    float totalError = 0.0f;
+    while ((int)lods.size() < MAX_LODS && (int)previous.size() / 3 > MIN_LOD_TRIANGLES)
+    {
+        const int targetIndexCount = std::max((int)(previous.size() / 3 * LOD_TRIANGLE_RATIO), MIN_LOD_TRIANGLES) * 3;
+        const float maxError = boundingRadius * MAX_LOD_ERROR - totalError;
+        float error;
+        std::vector<uint32_t> simplified = simplifier.simplify(previous, targetIndexCount, maxError, error);
+
+        // Stop once a level saves too little to be worth its elements
+        if (simplified.empty() || simplified.size() > previous.size() * MIN_LOD_REDUCTION)
+        {
+            break;
+        }
+
+        totalError += error;
+        lods.push_back(MeshLod { (int)elementIndices.size(), (int)simplified.size(), totalError / boundingRadius });
+        elementIndices.insert(elementIndices.end(), simplified.begin(), simplified.end());
+        previous.swap(simplified);
+    }
+
+    return lods;
+}
+
 void MeshImporter::writeBinaryMesh(const std::string &outputFile,
     const std::vector<Point3> &positionAttributes,
     const std::vector<Vector3> &normalAttributes,
@@ -323,21 +351,62 @@ void MeshImporter::writeBinaryMesh(const std::string &outputFile,
     const std::vector<Point2> &texcoordAttributes,
     const std::vector<MeshElementIndex> &elementIndices) const
 {
+    // Generate the levels of detail, which share the vertices and add their elements after the full detail elements
+    const MeshBounds bounds = MeshBounds::covering(positionAttributes.data(), (int)positionAttributes.size());
+    std::vector<MeshElementIndex> lodElementIndices(elementIndices);
+    const std::vector<MeshLod> lods = generateLods(positionAttributes, lodElementIndices, bounds.sphereRadius);
+
+    // Reorder the triangles of each level so that transformed vertices are reused from the cache,
+    // and then so that the outside of the mesh is drawn first to reduce overdraw
+    for (const MeshLod& lod : lods)
+    {
+        std::vector<uint32_t> lodIndices(lodElementIndices.begin() + lod.firstElement, lodElementIndices.begin() + lod.firstElement + lod.elementsCount);
+        MeshIndexOptimizer::optimizeVertexCache(lodIndices, (int)positionAttributes.size());
+        MeshIndexOptimizer::optimizeOverdraw(lodIndices, positionAttributes.data(), (int)positionAttributes.size());
+        std::copy(lodIndices.begin(), lodIndices.end(), lodElementIndices.begin() + lod.firstElement);
+    }
+
     // Populate mesh settings object with appropriate data
     MeshSettings settings;
     settings.vertexCount = (int)positionAttributes.size();
-    settings.elementsCount = (int)elementIndices.size();
+    settings.elementsCount = (int)lodElementIndices.size();
     settings.hasNormals = (normalAttributes.size() == positionAttributes.size());
     settings.hasTangents = (tangentAttributes.size() == positionAttributes.size());
     settings.hasTexcoords = (texcoordAttributes.size() == positionAttributes.size());
 
-    // Pack mesh settings and vertex data into binary file
+    // Interleave and quantise the vertices, using the smallest formats that keep enough precision
+    const int vertexFlags = MeshVertexFormat::chooseFlags(bounds.box, texcoordAttributes.data(), settings.hasTexcoords ? settings.vertexCount : 0);
+    const MeshVertexLayout layout = MeshVertexLayout::create(vertexFlags, settings.hasNormals, settings.hasTangents, settings.hasTexcoords);
+    const std::vector<unsigned char> vertices = MeshVertexFormat::pack(layout, bounds.box, settings.vertexCount, positionAttributes.data(),
+        settings.hasNormals ? normalAttributes.data() : nullptr,
+        settings.hasTangents ? tangentAttributes.data() : nullptr,
+        settings.hasTexcoords ? texcoordAttributes.data() : nullptr);
+
+    // Pack the file marker, mesh settings and vertex data into binary file
     std::ofstream outputStream(outputFile.c_str(), std::ofstream::binary);
+    const int marker = Mesh::FILE_MARKER;
+    outputStream.write((const char*)&marker, sizeof(int));
     outputStream.write((const char*)&settings, sizeof(MeshSettings));
-    outputStream.write((const char*)&positionAttributes[0], sizeof(Point3) * positionAttributes.size());
-    if (settings.hasNormals) outputStream.write((const char*)&normalAttributes[0], sizeof(Vector3) * normalAttributes.size());
-    if (settings.hasTangents) outputStream.write((const char*)&tangentAttributes[0], sizeof(Vector4) * tangentAttributes.size());
-    if (settings.hasTexcoords)outputStream.write((const char*)&texcoordAttributes[0], sizeof(Point2) * texcoordAttributes.size());
-    outputStream.write((const char*)&elementIndices[0], sizeof(MeshElementIndex) * elementIndices.size());
+    outputStream.write((const char*)&vertexFlags, sizeof(int));
+    outputStream.write((const char*)vertices.data(), vertices.size());
+
+    // Indices are stored as 16 bit when every vertex can be reached with 16 bits
+    if (Mesh::needsWideIndices(settings.vertexCount))
+    {
+        outputStream.write((const char*)&lodElementIndices[0], sizeof(uint32_t) * lodElementIndices.size());
+    }
+    else
+    {
+        const std::vector<uint16_t> shortElementIndices(lodElementIndices.begin(), lodElementIndices.end());
+        outputStream.write((const char*)&shortElementIndices[0], sizeof(uint16_t) * shortElementIndices.size());
+    }
+
+    // Store the bounding volumes, so they do not need computing at load time
+    outputStream.write((const char*)&bounds, sizeof(MeshBounds));
+
+    // Store the range of elements and the error of each level of detail
+    const int lodCount = (int)lods.size();
+    outputStream.write((const char*)&lodCount, sizeof(int));
+    outputStream.write((const char*)lods.data(), sizeof(MeshLod) * lods.size());
     outputStream.close();
 }
\ No newline at end of file
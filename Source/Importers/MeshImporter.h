@@ -14,6 +14,21 @@
 class MeshImporter : public ResourceImporter
 {
 public:
+    // The most levels of detail generated for a mesh, including the full detail level
+    const static int MAX_LODS = 4;
+
+    // Each level of detail aims for this fraction of the triangles in the level before it.
+    // Levels that cannot get below MIN_LOD_REDUCTION of the previous level are not kept.
+    const static float LOD_TRIANGLE_RATIO;
+    const static float MIN_LOD_REDUCTION;
+
+    // Meshes with fewer triangles than this are not simplified any further
+    const static int MIN_LOD_TRIANGLES = 32;
+
+    // The largest error allowed in a level of detail, as a fraction of the mesh bounding radius
+    const static float MAX_LOD_ERROR;
+
+
     // Imports a source file and saves the binary mesh to the specified output file.
     // Returns true if successful.
 	bool importFile(const std::string &sourceFile, const std::string &outputFile) const override;
@@ -29,7 +44,12 @@ private:
 		std::vector<Vector4> &tangentAttributes,
 		std::vector<MeshElementIndex> &elementIndices) const;
 
-    // Writes the mesh attributes to an output file.
+    // Simplifies the full detail triangles into a chain of levels of detail, and appends their
+    // elements to the elements list. Returns every level, starting with the full detail level.
+    std::vector<MeshLod> generateLods(const std::vector<Point3> &positionAttributes,
+        std::vector<MeshElementIndex> &elementIndices, float boundingRadius) const;
+
+    // Writes the mesh attributes and levels of detail to an output file.
     void writeBinaryMesh(const std::string &outputFile,
         const std::vector<Point3> &positionAttributes,
         const std::vector<Vector3> &normalAttributes,
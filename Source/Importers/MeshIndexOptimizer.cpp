@@ -0,0 +1,290 @@
+#include "MeshIndexOptimizer.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include "Math/Vector3.h"
+
+namespace
+{
+    // The scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    // Clusters are only split where the cache misses two vertices once they have this many triangles,
+    // which keeps the extra cache misses from splitting small
+    const int MIN_CLUSTER_TRIANGLES = 64;
+
+    // Scores a vertex by its position in the cache and the number of triangles still to draw that use it
+    float vertexScore(int cachePosition, int remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // The last triangle's vertices get a fixed score, so that the next triangle does not
+            // favour them over vertices that are about to leave the cache
+            if (cachePosition < 3)
+            {
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                const float scale = 1.0f / (MeshIndexOptimizer::CACHE_SIZE - 3);
+                score = powf(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+
+        // Vertices with few triangles left are finished off, so they do not need transforming again later
+        score += VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+        return score;
+    }
+}
+
+void MeshIndexOptimizer::optimizeVertexCache(std::vector<uint32_t> &indices, int vertexCount)
+{
+    const int triangleCount = (int)indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Find the triangles that use each vertex
+    std::vector<int> triangleOffsets(vertexCount + 1, 0);
+    for (uint32_t index : indices)
+    {
+        triangleOffsets[index + 1]++;
+    }
+
+    for (int vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        triangleOffsets[vertex + 1] += triangleOffsets[vertex];
+    }
+
+    std::vector<int> vertexTriangles(indices.size());
+    std::vector<int> remainingTriangles(vertexCount, 0);
+    for (int triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t vertex = indices[triangle * 3 + corner];
+            vertexTriangles[triangleOffsets[vertex] + remainingTriangles[vertex]++] = triangle;
+        }
+    }
+
+    // Score every vertex and triangle
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (int vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        vertexScores[vertex] = vertexScore(-1, remainingTriangles[vertex]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    for (int triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+    }
+
+    // Emit the best scoring triangle, update the cache, and rescore the vertices in it.
+    // The next triangle is the best one using a vertex in the cache. When there is none,
+    // the next triangle that has not been emitted is used instead.
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(CACHE_SIZE + 3);
+    nextCache.reserve(CACHE_SIZE + 3);
+    int bestTriangle = 0;
+    int nextUnemitted = 0;
+    for (int emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        if (bestTriangle < 0)
+        {
+            while (emitted[nextUnemitted] != 0)
+            {
+                nextUnemitted++;
+            }
+
+            bestTriangle = nextUnemitted;
+        }
+
+        const uint32_t* corners = &indices[bestTriangle * 3];
+        result.insert(result.end(), corners, corners + 3);
+        emitted[bestTriangle] = 1;
+
+        // Remove the triangle from the lists of its vertices
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t vertex = corners[corner];
+            int* first = &vertexTriangles[triangleOffsets[vertex]];
+            int* last = first + remainingTriangles[vertex];
+            std::swap(*std::find(first, last, bestTriangle), *(last - 1));
+            remainingTriangles[vertex]--;
+        }
+
+        // Move the triangle's vertices to the front of the cache
+        nextCache.assign(corners, corners + 3);
+        for (uint32_t vertex : cache)
+        {
+            if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+            {
+                nextCache.push_back(vertex);
+            }
+        }
+
+        // Vertices pushed out of the cache lose their cache score
+        for (size_t i = CACHE_SIZE; i < nextCache.size(); ++i)
+        {
+            cachePositions[nextCache[i]] = -1;
+            vertexScores[nextCache[i]] = vertexScore(-1, remainingTriangles[nextCache[i]]);
+        }
+
+        nextCache.resize(std::min((int)nextCache.size(), CACHE_SIZE));
+        cache.swap(nextCache);
+
+        // Rescore the cached vertices and their triangles, and find the best triangle to emit next
+        for (int position = 0; position < (int)cache.size(); ++position)
+        {
+            cachePositions[cache[position]] = position;
+            vertexScores[cache[position]] = vertexScore(position, remainingTriangles[cache[position]]);
+        }
+
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (uint32_t vertex : cache)
+        {
+            for (int i = 0; i < remainingTriangles[vertex]; ++i)
+            {
+                const int triangle = vertexTriangles[triangleOffsets[vertex] + i];
+                const float score = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+                triangleScores[triangle] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = triangle;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void MeshIndexOptimizer::optimizeOverdraw(std::vector<uint32_t> &indices, const Point3* positions, int vertexCount)
+{
+    const int triangleCount = (int)indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Split the triangles into clusters where a fifo cache would have to load most of the next triangle,
+    // as moving the clusters around then costs few extra cache misses
+    std::vector<int> clusterStarts;
+    std::vector<int> cacheTimes(vertexCount, -CACHE_SIZE - 1);
+    int time = 0;
+    for (int triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        int misses = 0;
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t vertex = indices[triangle * 3 + corner];
+            if (time - cacheTimes[vertex] > CACHE_SIZE)
+            {
+                cacheTimes[vertex] = time++;
+                misses++;
+            }
+        }
+
+        const int clusterSize = clusterStarts.empty() ? 0 : triangle - clusterStarts.back();
+        if (clusterStarts.empty() || misses == 3 || (misses == 2 && clusterSize >= MIN_CLUSTER_TRIANGLES))
+        {
+            clusterStarts.push_back(triangle);
+        }
+    }
+
+    clusterStarts.push_back(triangleCount);
+    const int clusterCount = (int)clusterStarts.size() - 1;
+
+    // Find the area weighted centre and normal of each cluster, and of the whole mesh
+    std::vector<Point3> clusterCentres(clusterCount);
+    std::vector<Vector3> clusterNormals(clusterCount);
+    Vector3 meshCentreSum = Vector3::zero();
+    float meshArea = 0.0f;
+    for (int cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        Vector3 centreSum = Vector3::zero();
+        Vector3 normalSum = Vector3::zero();
+        float area = 0.0f;
+        for (int triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; ++triangle)
+        {
+            const Point3& p0 = positions[indices[triangle * 3]];
+            const Point3& p1 = positions[indices[triangle * 3 + 1]];
+            const Point3& p2 = positions[indices[triangle * 3 + 2]];
+            const Vector3 normal = Vector3::cross(p1 - p0, p2 - p0);
+            const float triangleArea = normal.magnitude() * 0.5f;
+            const Vector3 centre = ((p0 - Point3::origin()) + (p1 - Point3::origin()) + (p2 - Point3::origin())) / 3.0f;
+            centreSum += centre * triangleArea;
+            normalSum += normal;
+            area += triangleArea;
+        }
+
+        clusterCentres[cluster] = Point3::origin() + ((area > 0.0f) ? centreSum / area : Vector3::zero());
+        clusterNormals[cluster] = normalSum;
+        meshCentreSum += centreSum;
+        meshArea += area;
+    }
+
+    // Sort the clusters so the ones furthest out along their normal are drawn first.
+    // The triangles are wound clockwise, so the cross product points inwards.
+    const Point3 meshCentre = Point3::origin() + ((meshArea > 0.0f) ? meshCentreSum / meshArea : Vector3::zero());
+    std::vector<float> outwardness(clusterCount);
+    std::vector<int> order(clusterCount);
+    for (int cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        const float normalLength = clusterNormals[cluster].magnitude();
+        outwardness[cluster] = (normalLength > 0.0f) ? -Vector3::dot(clusterCentres[cluster] - meshCentre, clusterNormals[cluster] / normalLength) : 0.0f;
+        order[cluster] = cluster;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return outwardness[a] > outwardness[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (int cluster : order)
+    {
+        result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+    }
+
+    indices.swap(result);
+}
+
+float MeshIndexOptimizer::averageCacheMissRatio(const std::vector<uint32_t> &indices, int vertexCount, int cacheSize)
+{
+    const int triangleCount = (int)indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return 0.0f;
+    }
+
+    // Each vertex remembers when it entered the fifo, and has left it once cacheSize more vertices have entered
+    std::vector<int> cacheTimes(vertexCount, -cacheSize - 1);
+    int time = 0;
+    for (uint32_t vertex : indices)
+    {
+        if (time - cacheTimes[vertex] > cacheSize)
+        {
+            cacheTimes[vertex] = time++;
+        }
+    }
+
+    return time / (float)triangleCount;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math/Point3.h"
+
+// Reorders the triangles of a mesh so that the gpu does less work drawing them, without changing the mesh.
+// Does not use the gpu, so can be used and tested headlessly.
+class MeshIndexOptimizer
+{
+public:
+    // The size of the post transform vertex cache that orders are tuned for and measured with
+    const static int CACHE_SIZE = 32;
+
+    // Reorders triangles so that vertices are reused while they are still in the post transform cache,
+    // using Forsyth's linear speed vertex cache optimisation.
+    static void optimizeVertexCache(std::vector<uint32_t> &indices, int vertexCount);
+
+    // Reorders clusters of triangles so that the outer, outward facing parts of the mesh are drawn first
+    // and hide the parts behind them, as in Tipsify. Clusters are split where the vertex cache has
+    // nothing left to reuse, so the vertex cache order is kept. Run after optimizeVertexCache.
+    static void optimizeOverdraw(std::vector<uint32_t> &indices, const Point3* positions, int vertexCount);
+
+    // Measures the average number of vertices transformed per triangle, with a fifo cache of cacheSize.
+    // Lower is better. The best possible is about 0.5 and the worst is 3.
+    static float averageCacheMissRatio(const std::vector<uint32_t> &indices, int vertexCount, int cacheSize = CACHE_SIZE);
+};
\ No newline at end of file
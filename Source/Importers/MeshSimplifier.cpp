@@ -0,0 +1,485 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <math.h>
+#include <unordered_map>
+
+namespace
+{
+    // The weight of the planes that keep border vertices on the border, relative to the triangle planes
+    const double BORDER_WEIGHT = 10.0;
+
+    // Collapses that turn a triangle by more than about 75 degrees are rejected, as they fold the surface over
+    const double MIN_NORMAL_COSINE = 0.25;
+
+    // The largest number of passes made over the candidate collapses
+    const int MAX_PASSES = 64;
+
+    // The kinds of vertex, which restrict the collapses that can move them
+    enum class VertexKind : uint8_t
+    {
+        Manifold,   // Inside the surface, with one set of attributes
+        Border,     // On an open edge of the surface
+        Seam,       // On an attribute seam, with two sets of attributes
+        Locked,     // Anything more complex, which is never moved
+    };
+
+    // A symmetric 4x4 error quadric, and the total weight of the planes summed into it
+    struct Quadric
+    {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+        double weight;
+
+        static Quadric zero()
+        {
+            return Quadric { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        }
+
+        // The quadric of a plane ax + by + cz + d = 0, where (a, b, c) is a unit normal
+        static Quadric fromPlane(double a, double b, double c, double d, double weight)
+        {
+            return Quadric {
+                a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+                b * b * weight, b * c * weight, b * d * weight,
+                c * c * weight, c * d * weight,
+                d * d * weight,
+                weight
+            };
+        }
+
+        void add(const Quadric &q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+            weight += q.weight;
+        }
+
+        // The weighted mean squared distance of a point from the planes
+        double error(const Point3 &p) const
+        {
+            if (weight <= 0.0)
+            {
+                return 0.0;
+            }
+
+            const double x = p.x, y = p.y, z = p.z;
+            const double sum = a2 * x * x + b2 * y * y + c2 * z * z
+                + 2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z)
+                + d2;
+            return std::max(sum / weight, 0.0);
+        }
+    };
+
+    // Moving a vertex onto a neighbour, and the error it adds
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double error;
+    };
+
+    // The unnormalised normal of a triangle, whose length is twice its area
+    void triangleNormal(const Point3 &p0, const Point3 &p1, const Point3 &p2, double normal[3])
+    {
+        const double e1[3] = { (double)p1.x - p0.x, (double)p1.y - p0.y, (double)p1.z - p0.z };
+        const double e2[3] = { (double)p2.x - p0.x, (double)p2.y - p0.y, (double)p2.z - p0.z };
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    double dot(const double a[3], const double b[3])
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // A key for an undirected edge
+    uint64_t edgeKey(uint32_t a, uint32_t b)
+    {
+        return (a < b) ? (((uint64_t)a << 32) | b) : (((uint64_t)b << 32) | a);
+    }
+}
+
+MeshSimplifier::MeshSimplifier(const Point3* positions, int vertexCount)
+    : positions_(positions, positions + vertexCount),
+    remap_(vertexCount)
+{
+    // Sort the vertices by position, so that vertices in the same place are next to each other
+    std::vector<uint32_t> order(vertexCount);
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+    {
+        const Point3& pa = positions_[a];
+        const Point3& pb = positions_[b];
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        if (pa.z != pb.z) return pa.z < pb.z;
+        return a < b;
+    });
+
+    // Map each vertex to the lowest numbered vertex in the same place
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        const uint32_t vertex = order[i];
+        const bool samePosition = (i > 0) && (positions_[order[i - 1]] == positions_[vertex]);
+        remap_[vertex] = samePosition ? remap_[order[i - 1]] : vertex;
+    }
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<uint32_t> &indices, int targetIndexCount, float maxError, float &error) const
+{
+    error = 0.0f;
+    std::vector<uint32_t> result(indices);
+    if ((int)result.size() <= targetIndexCount)
+    {
+        return result;
+    }
+
+    const uint32_t vertexCount = (uint32_t)positions_.size();
+
+    // Count the triangles on each edge, to find the open borders and non-manifold edges
+    std::unordered_map<uint64_t, int> edgeTriangles;
+    for (size_t first = 0; first + 2 < result.size(); first += 3)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            edgeTriangles[edgeKey(remap_[result[first + corner]], remap_[result[first + (corner + 1) % 3]])]++;
+        }
+    }
+
+    std::vector<uint8_t> onBorder(vertexCount, 0);
+    std::vector<uint8_t> nonManifold(vertexCount, 0);
+    for (const auto& edge : edgeTriangles)
+    {
+        const uint32_t a = (uint32_t)(edge.first >> 32);
+        const uint32_t b = (uint32_t)edge.first;
+        if (edge.second == 1)
+        {
+            onBorder[a] = onBorder[b] = 1;
+        }
+        else if (edge.second > 2)
+        {
+            nonManifold[a] = nonManifold[b] = 1;
+        }
+    }
+
+    // Count the sets of attributes used at each position
+    std::vector<uint8_t> used(vertexCount, 0);
+    std::vector<int> wedges(vertexCount, 0);
+    for (uint32_t index : result)
+    {
+        if (used[index] == 0)
+        {
+            used[index] = 1;
+            wedges[remap_[index]]++;
+        }
+    }
+
+    // Classify the vertices
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::Locked);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        if (remap_[vertex] != vertex || nonManifold[vertex] != 0)
+        {
+            continue;
+        }
+
+        if (wedges[vertex] == 1)
+        {
+            kinds[vertex] = (onBorder[vertex] != 0) ? VertexKind::Border : VertexKind::Manifold;
+        }
+        else if (wedges[vertex] == 2 && onBorder[vertex] == 0)
+        {
+            kinds[vertex] = VertexKind::Seam;
+        }
+    }
+
+    // Sum the planes of the triangles around each vertex, weighted by their area.
+    // Border edges add a plane at right angles to the triangle, which keeps border vertices on the border.
+    std::vector<Quadric> quadrics(vertexCount, Quadric::zero());
+    for (size_t first = 0; first + 2 < result.size(); first += 3)
+    {
+        const uint32_t corners[3] = { remap_[result[first]], remap_[result[first + 1]], remap_[result[first + 2]] };
+        double normal[3];
+        triangleNormal(positions_[corners[0]], positions_[corners[1]], positions_[corners[2]], normal);
+        const double length = sqrt(dot(normal, normal));
+        if (length == 0.0)
+        {
+            continue;
+        }
+
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+
+        const Point3& p0 = positions_[corners[0]];
+        const Quadric plane = Quadric::fromPlane(normal[0], normal[1], normal[2], -(normal[0] * p0.x + normal[1] * p0.y + normal[2] * p0.z), length * 0.5);
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            quadrics[corners[corner]].add(plane);
+        }
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t a = corners[corner];
+            const uint32_t b = corners[(corner + 1) % 3];
+            if (edgeTriangles[edgeKey(a, b)] != 1)
+            {
+                continue;
+            }
+
+            const Point3& pa = positions_[a];
+            const Point3& pb = positions_[b];
+            const double edge[3] = { (double)pb.x - pa.x, (double)pb.y - pa.y, (double)pb.z - pa.z };
+            double side[3] = {
+                edge[1] * normal[2] - edge[2] * normal[1],
+                edge[2] * normal[0] - edge[0] * normal[2],
+                edge[0] * normal[1] - edge[1] * normal[0]
+            };
+            const double sideLength = sqrt(dot(side, side));
+            if (sideLength == 0.0)
+            {
+                continue;
+            }
+
+            side[0] /= sideLength;
+            side[1] /= sideLength;
+            side[2] /= sideLength;
+            const Quadric borderPlane = Quadric::fromPlane(side[0], side[1], side[2], -(side[0] * pa.x + side[1] * pa.y + side[2] * pa.z), dot(edge, edge) * BORDER_WEIGHT);
+            quadrics[a].add(borderPlane);
+            quadrics[b].add(borderPlane);
+        }
+    }
+
+    // Collapse edges in passes. Each pass collapses the cheapest edges first, and locks the vertices
+    // around each collapse until the next pass, so that every check is made against the current surface.
+    const double errorLimit = (double)maxError * (double)maxError;
+    const int targetTriangles = targetIndexCount / 3;
+    double largestError = 0.0;
+
+    std::vector<int> adjacencyOffsets(vertexCount + 1);
+    std::vector<int> adjacencyFill(vertexCount);
+    std::vector<int> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> collapseRemap(vertexCount);
+    std::vector<uint8_t> locked(vertexCount);
+
+    for (int pass = 0; pass < MAX_PASSES && (int)result.size() > targetIndexCount; ++pass)
+    {
+        const int triangleCount = (int)result.size() / 3;
+
+        // Find the triangles around each vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result)
+        {
+            adjacencyOffsets[remap_[index] + 1]++;
+        }
+
+        for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+            adjacencyFill[vertex] = adjacencyOffsets[vertex];
+        }
+
+        adjacency.resize(result.size());
+        for (int triangle = 0; triangle < triangleCount; ++triangle)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                adjacency[adjacencyFill[remap_[result[triangle * 3 + corner]]]++] = triangle;
+            }
+        }
+
+        // Find the cost of moving each vertex onto each of its neighbours
+        collapses.clear();
+        for (int triangle = 0; triangle < triangleCount; ++triangle)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const uint32_t a = remap_[result[triangle * 3 + corner]];
+                const uint32_t b = remap_[result[triangle * 3 + (corner + 1) % 3]];
+                for (int direction = 0; direction < 2; ++direction)
+                {
+                    const uint32_t from = (direction == 0) ? a : b;
+                    const uint32_t to = (direction == 0) ? b : a;
+                    if (kinds[from] == VertexKind::Locked)
+                    {
+                        continue;
+                    }
+
+                    Quadric combined = quadrics[from];
+                    combined.add(quadrics[to]);
+                    const double cost = combined.error(positions_[to]);
+                    if (cost <= errorLimit)
+                    {
+                        collapses.push_back(Collapse { from, to, cost });
+                    }
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.error < b.error; });
+
+        // Make the cheapest collapses that are still valid
+        for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            collapseRemap[vertex] = vertex;
+        }
+
+        std::fill(locked.begin(), locked.end(), 0);
+        int remainingTriangles = triangleCount;
+        int collapsed = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (remainingTriangles <= targetTriangles)
+            {
+                break;
+            }
+
+            if (locked[collapse.from] != 0 || locked[collapse.to] != 0)
+            {
+                continue;
+            }
+
+            // Match each set of attributes at the vertex being moved with the set at the target
+            // that it shares an edge with. The triangles on the edge are the ones that are removed.
+            uint32_t fromWedges[2];
+            uint32_t toWedges[2];
+            int wedgeCount = 0;
+            int edgeCount = 0;
+            bool valid = true;
+            for (int i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1] && valid; ++i)
+            {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                int fromCorner = -1;
+                int toCorner = -1;
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    if (remap_[triangle[corner]] == collapse.from) fromCorner = corner;
+                    if (remap_[triangle[corner]] == collapse.to) toCorner = corner;
+                }
+
+                if (toCorner < 0)
+                {
+                    continue;
+                }
+
+                edgeCount++;
+                int wedge = 0;
+                while (wedge < wedgeCount && fromWedges[wedge] != triangle[fromCorner])
+                {
+                    wedge++;
+                }
+
+                if (wedge == wedgeCount)
+                {
+                    valid = (wedgeCount < 2);
+                    fromWedges[wedge % 2] = triangle[fromCorner];
+                    toWedges[wedge % 2] = triangle[toCorner];
+                    wedgeCount++;
+                }
+                else
+                {
+                    valid = (toWedges[wedge] == triangle[toCorner]);
+                }
+            }
+
+            // Every set of attributes must have somewhere to go.
+            // Border vertices may only slide along the border, and seam vertices along the seam.
+            if (!valid || edgeCount == 0 || wedgeCount != wedges[collapse.from])
+            {
+                continue;
+            }
+
+            if ((kinds[collapse.from] == VertexKind::Border && edgeCount != 1) ||
+                (kinds[collapse.from] == VertexKind::Seam && edgeCount != 2))
+            {
+                continue;
+            }
+
+            // Reject collapses that flip or fold the triangles that remain
+            for (int i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1] && valid; ++i)
+            {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                Point3 before[3];
+                Point3 after[3];
+                bool onEdge = false;
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    const uint32_t vertex = remap_[triangle[corner]];
+                    onEdge = onEdge || (vertex == collapse.to);
+                    before[corner] = positions_[vertex];
+                    after[corner] = (vertex == collapse.from) ? positions_[collapse.to] : before[corner];
+                }
+
+                if (onEdge)
+                {
+                    continue;
+                }
+
+                double normalBefore[3];
+                double normalAfter[3];
+                triangleNormal(before[0], before[1], before[2], normalBefore);
+                triangleNormal(after[0], after[1], after[2], normalAfter);
+                valid = dot(normalBefore, normalAfter) >= MIN_NORMAL_COSINE * sqrt(dot(normalBefore, normalBefore) * dot(normalAfter, normalAfter));
+            }
+
+            if (!valid)
+            {
+                continue;
+            }
+
+            // Make the collapse, and lock the vertices whose triangles changed
+            for (int wedge = 0; wedge < wedgeCount; ++wedge)
+            {
+                collapseRemap[fromWedges[wedge]] = toWedges[wedge];
+            }
+
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            for (int i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; ++i)
+            {
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    locked[remap_[result[adjacency[i] * 3 + corner]]] = 1;
+                }
+            }
+
+            remainingTriangles -= edgeCount;
+            largestError = std::max(largestError, collapse.error);
+            collapsed++;
+        }
+
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        // Move the collapsed vertices, and remove the triangles that now have no area
+        size_t written = 0;
+        for (size_t first = 0; first + 2 < result.size(); first += 3)
+        {
+            const uint32_t a = collapseRemap[result[first]];
+            const uint32_t b = collapseRemap[result[first + 1]];
+            const uint32_t c = collapseRemap[result[first + 2]];
+            if (remap_[a] == remap_[b] || remap_[b] == remap_[c] || remap_[c] == remap_[a])
+            {
+                continue;
+            }
+
+            result[written++] = a;
+            result[written++] = b;
+            result[written++] = c;
+        }
+
+        result.resize(written);
+    }
+
+    error = (float)sqrt(largestError);
+    return result;
+}
\ No newline at end of file
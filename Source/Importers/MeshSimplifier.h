@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math/Point3.h"
+
+// Reduces the triangle count of a mesh by collapsing edges, cheapest first.
+// The cost of a collapse is the quadric error metric: the mean squared distance from the new
+// vertex position to the planes of the original triangles around both vertices.
+// Vertices are only ever moved onto one of their neighbours, so simplified triangles reuse the
+// original vertices and each level of detail only needs its own list of indices.
+// Vertices on open borders and attribute seams may only slide along their border or seam,
+// so that silhouettes and texture seams are kept.
+// Does not use the gpu, so can be used and tested headlessly.
+class MeshSimplifier
+{
+public:
+    MeshSimplifier(const Point3* positions, int vertexCount);
+
+    // Simplifies a triangle list until it has at most targetIndexCount indices, or until no
+    // collapse is left with an error below maxError. Errors are distances in mesh space.
+    // Returns the simplified triangle list, and sets error to the largest error of any collapse made.
+    std::vector<uint32_t> simplify(const std::vector<uint32_t> &indices, int targetIndexCount, float maxError, float &error) const;
+
+private:
+    std::vector<Point3> positions_;
+
+    // The first vertex with the same position as each vertex.
+    // Vertices that only differ in their other attributes are treated as one vertex when measuring errors.
+    std::vector<uint32_t> remap_;
+};
\ No newline at end of file
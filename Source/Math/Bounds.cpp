@@ -51,4 +51,29 @@ Bounds Bounds::covering(const Point3* points, int count)
     }
 
     return b;
+}
+
+Bounds Bounds::transformed(const Matrix4x4 &matrix) const
+{
+    // Start from the translation, then add on the contribution of each axis.
+    // For each matrix element, the smaller and larger of the products with min and max
+    // give the range that the axis can add to the result. (Arvo, Graphics Gems 1990)
+    Point3 newMin(matrix.get(0, 3), matrix.get(1, 3), matrix.get(2, 3));
+    Point3 newMax = newMin;
+    const float oldMin[3] = { min_.x, min_.y, min_.z };
+    const float oldMax[3] = { max_.x, max_.y, max_.z };
+    float* resultMin[3] = { &newMin.x, &newMin.y, &newMin.z };
+    float* resultMax[3] = { &newMax.x, &newMax.y, &newMax.z };
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 3; ++column)
+        {
+            const float a = matrix.get(row, column) * oldMin[column];
+            const float b = matrix.get(row, column) * oldMax[column];
+            *resultMin[row] += std::min(a, b);
+            *resultMax[row] += std::max(a, b);
+        }
+    }
+
+    return Bounds(newMin, newMax);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Matrix4x4.h"
 #include "Point3.h"
 #include "Vector3.h"
 
@@ -23,6 +24,9 @@ public:
     // Creates a Bounds instance covering the given points
     static Bounds covering(const Point3* points, int count);
 
+    // Creates a Bounds instance covering these bounds after they are transformed by the matrix.
+    Bounds transformed(const Matrix4x4 &matrix) const;
+
 private:
     Point3 min_;
     Point3 max_;
@@ -0,0 +1,96 @@
+#include "Frustum.h"
+
+#include <math.h>
+
+Frustum::Frustum()
+{
+    // Default to a frustum that contains everything
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        planes_[i] = Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+Frustum Frustum::fromMatrix(const Matrix4x4 &worldToClip)
+{
+    // A point is inside the clip volume when -w <= x, y, z <= w.
+    // Each of those 6 conditions is a plane, made by adding or subtracting rows of the matrix.
+    const Vector4 row0(worldToClip.get(0, 0), worldToClip.get(0, 1), worldToClip.get(0, 2), worldToClip.get(0, 3));
+    const Vector4 row1(worldToClip.get(1, 0), worldToClip.get(1, 1), worldToClip.get(1, 2), worldToClip.get(1, 3));
+    const Vector4 row2(worldToClip.get(2, 0), worldToClip.get(2, 1), worldToClip.get(2, 2), worldToClip.get(2, 3));
+    const Vector4 row3(worldToClip.get(3, 0), worldToClip.get(3, 1), worldToClip.get(3, 2), worldToClip.get(3, 3));
+
+    Frustum frustum;
+    frustum.planes_[0] = Vector4(row3.x + row0.x, row3.y + row0.y, row3.z + row0.z, row3.w + row0.w); // Left
+    frustum.planes_[1] = Vector4(row3.x - row0.x, row3.y - row0.y, row3.z - row0.z, row3.w - row0.w); // Right
+    frustum.planes_[2] = Vector4(row3.x + row1.x, row3.y + row1.y, row3.z + row1.z, row3.w + row1.w); // Bottom
+    frustum.planes_[3] = Vector4(row3.x - row1.x, row3.y - row1.y, row3.z - row1.z, row3.w - row1.w); // Top
+    frustum.planes_[4] = Vector4(row3.x + row2.x, row3.y + row2.y, row3.z + row2.z, row3.w + row2.w); // Near
+    frustum.planes_[5] = Vector4(row3.x - row2.x, row3.y - row2.y, row3.z - row2.z, row3.w - row2.w); // Far
+
+    // Normalize the planes so that distances are in world units
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        const Vector4 p = frustum.planes_[i];
+        const float length = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+        if (length > 0.0f)
+        {
+            frustum.planes_[i] = p / length;
+        }
+    }
+
+    return frustum;
+}
+
+bool Frustum::contains(const Point3 &point) const
+{
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        const Vector4& p = planes_[i];
+        if (p.x * point.x + p.y * point.y + p.z * point.z + p.w < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Frustum::intersects(const Bounds &bounds) const
+{
+    return classify(bounds) != FrustumIntersection::Outside;
+}
+
+FrustumIntersection Frustum::classify(const Bounds &bounds) const
+{
+    const Point3 min = bounds.min();
+    const Point3 max = bounds.max();
+
+    FrustumIntersection result = FrustumIntersection::Inside;
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        const Vector4& p = planes_[i];
+
+        // Test the corner furthest along the plane normal.
+        // If it is behind the plane, the whole box is outside.
+        const float furthestX = p.x >= 0.0f ? max.x : min.x;
+        const float furthestY = p.y >= 0.0f ? max.y : min.y;
+        const float furthestZ = p.z >= 0.0f ? max.z : min.z;
+        if (p.x * furthestX + p.y * furthestY + p.z * furthestZ + p.w < 0.0f)
+        {
+            return FrustumIntersection::Outside;
+        }
+
+        // Test the opposite corner.
+        // If it is behind the plane, the box crosses it.
+        const float nearestX = p.x >= 0.0f ? min.x : max.x;
+        const float nearestY = p.y >= 0.0f ? min.y : max.y;
+        const float nearestZ = p.z >= 0.0f ? min.z : max.z;
+        if (p.x * nearestX + p.y * nearestY + p.z * nearestZ + p.w < 0.0f)
+        {
+            result = FrustumIntersection::Intersecting;
+        }
+    }
+
+    return result;
+}
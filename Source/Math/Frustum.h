@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Matrix4x4.h"
+#include "Point3.h"
+#include "Vector4.h"
+
+// The result of testing a volume against a frustum
+enum class FrustumIntersection
+{
+    Outside,
+    Intersecting,
+    Inside
+};
+
+// A convex volume bounded by 6 planes, such as the region visible to a camera.
+class Frustum
+{
+public:
+    const static int PLANE_COUNT = 6;
+
+    Frustum();
+
+    // Extracts the frustum planes from a world to clip space matrix.
+    // Works for both perspective and orthographic projections.
+    static Frustum fromMatrix(const Matrix4x4 &worldToClip);
+
+    // Gets a plane as (normal, distance), with the normal pointing inwards.
+    Vector4 plane(int index) const { return planes_[index]; }
+
+    // Checks if a point is inside the frustum
+    bool contains(const Point3 &point) const;
+
+    // Checks if a bounding box is at least partially inside the frustum.
+    // This is conservative - boxes near the frustum corners may pass.
+    bool intersects(const Bounds &bounds) const;
+
+    // Checks if a bounding box is outside, partially inside or fully inside the frustum.
+    FrustumIntersection classify(const Bounds &bounds) const;
+
+private:
+    Vector4 planes_[PLANE_COUNT];
+};
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "PoissonDisk.h"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+
+namespace
+{
+    // A filled Poisson disk pattern has roughly 0.63 points per r^2 with the
+    // default attempt count. Slightly overestimate it so that filled areas
+    // rarely hold more points than were asked for.
+    const float PackingDensity = 0.64f;
+}
+
+std::vector<Point2> poisson_disk_points(const Rect &area, float minDistance, uint32_t seed, int maxPoints, int attemptsPerPoint)
+{
+    std::vector<Point2> points;
+    if (minDistance <= 0.0f || area.width <= 0.0f || area.height <= 0.0f || maxPoints <= 0)
+    {
+        return points;
+    }
+
+    // Use a local generator rather than rand(), so that
+    // multiple threads can generate points at once.
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // Use a grid with cells small enough that each can contain at most one point.
+    // Grid cells store the index of the point inside them, or -1.
+    const float cellSize = minDistance / sqrtf(2.0f);
+    const int gridWidth = std::max(1, (int)ceilf(area.width / cellSize));
+    const int gridHeight = std::max(1, (int)ceilf(area.height / cellSize));
+    std::vector<int> grid(gridWidth * gridHeight, -1);
+
+    // Adds a point to the output, the grid and the active list.
+    std::vector<int> active;
+    auto addPoint = [&](const Point2 &p)
+    {
+        const int cellX = std::min((int)((p.x - area.minx) / cellSize), gridWidth - 1);
+        const int cellY = std::min((int)((p.y - area.miny) / cellSize), gridHeight - 1);
+        grid[cellX + cellY * gridWidth] = (int)points.size();
+        active.push_back((int)points.size());
+        points.push_back(p);
+    };
+
+    // Checks if a candidate point is inside the rect and far enough from every other point.
+    // Only the 5x5 block of cells around the candidate can contain a point that is too close.
+    const float minDistanceSqr = minDistance * minDistance;
+    auto isValid = [&](const Point2 &p)
+    {
+        if (p.x < area.minx || p.y < area.miny || p.x >= area.minx + area.width || p.y >= area.miny + area.height)
+        {
+            return false;
+        }
+
+        const int cellX = std::min((int)((p.x - area.minx) / cellSize), gridWidth - 1);
+        const int cellY = std::min((int)((p.y - area.miny) / cellSize), gridHeight - 1);
+        for (int y = std::max(cellY - 2, 0); y <= std::min(cellY + 2, gridHeight - 1); ++y)
+        {
+            for (int x = std::max(cellX - 2, 0); x <= std::min(cellX + 2, gridWidth - 1); ++x)
+            {
+                const int other = grid[x + y * gridWidth];
+                if (other != -1)
+                {
+                    const float dx = points[other].x - p.x;
+                    const float dy = points[other].y - p.y;
+                    if (dx * dx + dy * dy < minDistanceSqr)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    };
+
+    // Start from a random point
+    addPoint(Point2(area.minx + unit(generator) * area.width, area.miny + unit(generator) * area.height));
+
+    // Repeatedly try to spawn new points around a random active point.
+    // Points that fail to spawn anything are no longer active.
+    while (!active.empty() && (int)points.size() < maxPoints)
+    {
+        const int activeIndex = std::min((int)(unit(generator) * active.size()), (int)active.size() - 1);
+        const Point2 centre = points[active[activeIndex]];
+
+        bool spawned = false;
+        for (int attempt = 0; attempt < attemptsPerPoint; ++attempt)
+        {
+            // Pick a point in the annulus between minDistance and 2 * minDistance
+            const float angle = unit(generator) * 6.28318530718f;
+            const float distance = minDistance * (1.0f + unit(generator));
+            const Point2 candidate(centre.x + cosf(angle) * distance, centre.y + sinf(angle) * distance);
+
+            if (isValid(candidate))
+            {
+                addPoint(candidate);
+                spawned = true;
+                break;
+            }
+        }
+
+        if (!spawned)
+        {
+            active[activeIndex] = active.back();
+            active.pop_back();
+        }
+    }
+
+    return points;
+}
+
+float poisson_disk_distance(float area, float points)
+{
+    return sqrtf(PackingDensity * area / points);
+}
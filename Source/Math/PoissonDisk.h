@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Point2.h"
+#include "Rect.h"
+
+// Generates a blue noise set of points inside a rect, where no two points are
+// closer together than minDistance, using Bridson's Poisson disk algorithm.
+// The rect is filled until no more points fit, or maxPoints is reached.
+// The points only depend on the arguments, so this is deterministic and
+// is safe to call from multiple threads at once.
+std::vector<Point2> poisson_disk_points(const Rect &area, float minDistance, uint32_t seed, int maxPoints, int attemptsPerPoint = 30);
+
+// The minimum distance that fits slightly fewer than the given number of
+// points inside an area when it is filled with a Poisson disk pattern.
+float poisson_disk_distance(float area, float points);
\ No newline at end of file
@@ -21,6 +21,13 @@ bool TerrainCollider::checkForCollision(const Point3 &point) const
 	const float heightmapHeight = terrain->sampleHeightmap(point.x, point.z);
 
 	// Check if the point is below the heightmap
-	return (point.y < heightmapHeight);
+	if (point.y < heightmapHeight)
+	{
+		return true;
+	}
+
+	// Check the static objects placed on the terrain.
+	// These do not have their own collider components.
+	return terrain->checkForObjectCollision(point);
 }
 
@@ -8,6 +8,6 @@ class TerrainCollider : public Collider
 public:
 	explicit TerrainCollider(GameObject* gameObject);
 
-	// Checks if the terrain is intersecting with a point
+	// Checks if the terrain, or a static object placed on it, is intersecting with a point
 	bool checkForCollision(const Point3 &point) const override;
 };
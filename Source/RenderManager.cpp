@@ -5,10 +5,62 @@
 
 #include "Editor/MainWindowMenu.h"
 
+namespace
+{
+    // Identifies the gpu and driver, as program binaries are only valid for the driver that made them
+    std::string driverString()
+    {
+        std::string driver;
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            const GLubyte* value = glGetString(name);
+            driver += (value == nullptr) ? "" : (const char*)value;
+            driver += "|";
+        }
+
+        return driver;
+    }
+
+    // Checks if the driver supports an extension
+    bool hasExtension(const std::string &name)
+    {
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; ++i)
+        {
+            if (name == (const char*)glGetStringi(GL_EXTENSIONS, i))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Checks if a stats file should be written as json rather than csv
+    bool isJsonPath(const std::string &path)
+    {
+        return path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    }
+}
+
 RenderManager::RenderManager()
     : vsyncEnabled_(true),
+    occlusionCullingEnabled_(true),
+    lodBias_(0.0f),
+    shadowLodBias_(1.0f),
+    dynamicResolutionEnabled_(false),
+    statsOverlayEnabled_(false),
+    statsFile_(),
+    statsFileJson_(false),
     allowedShaderFeatures_(~0u),
-    debugMode_(RenderDebugMode::None)
+    debugMode_(RenderDebugMode::None),
+    workerPool_(),
+    shaderBinaryCache_("Build/ShaderCache", driverString()),
+    shaderWarmup_(),
+    parallelShaderCompile_(hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile")),
+    renderTargetPool_(),
+    rendererContext_(nullptr)
 {
     // Set default opengl settings
     glEnable(GL_CULL_FACE);
@@ -19,6 +71,11 @@ RenderManager::RenderManager()
     // Default to vsync on
     glfwSwapInterval(1);
 
+    // Program binaries can only be stored if the driver supports at least one format
+    GLint binaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+    shaderBinaryCache_.setEnabled(binaryFormats > 0);
+
     // Set up menu items for toggling render features
     addShaderFeatureMenuItem(SF_Texture, "Textures");
     addShaderFeatureMenuItem(SF_NormalMap, "Normal Maps");
@@ -53,6 +110,40 @@ RenderManager::RenderManager()
         [&] { glfwSwapInterval(vsyncEnabled_ ? 0 : 1); vsyncEnabled_ = !vsyncEnabled_; },
         [&] { return vsyncEnabled_; }
     );
+
+    // Set up a menu item for toggling occlusion culling
+    MainWindowMenu::instance()->addMenuItem(
+        "View/Occlusion Culling",
+        [&] { occlusionCullingEnabled_ = !occlusionCullingEnabled_; },
+        [&] { return occlusionCullingEnabled_; }
+    );
+
+    // Set up a menu item for toggling dynamic resolution
+    MainWindowMenu::instance()->addMenuItem(
+        "View/Dynamic Resolution",
+        [&] { dynamicResolutionEnabled_ = !dynamicResolutionEnabled_; },
+        [&] { return dynamicResolutionEnabled_; }
+    );
+
+    // Set up menu items for showing and recording the render stats
+    MainWindowMenu::instance()->addMenuItem(
+        "View/Render Stats/Overlay",
+        [&] { statsOverlayEnabled_ = !statsOverlayEnabled_; },
+        [&] { return statsOverlayEnabled_; }
+    );
+    addRecordStatsMenuItem("Build/RenderStats.csv", "Record CSV");
+    addRecordStatsMenuItem("Build/RenderStats.json", "Record JSON");
+
+    // Set up menu items for choosing the level of detail bias
+    addLodBiasMenuItem(-1.0f, "Finer (-1)");
+    addLodBiasMenuItem(0.0f, "Default (0)");
+    addLodBiasMenuItem(1.0f, "Coarser (+1)");
+    addLodBiasMenuItem(2.0f, "Coarsest (+2)");
+}
+
+RenderManager::~RenderManager()
+{
+    delete rendererContext_;
 }
 
 bool RenderManager::isFeatureGloballyEnabled(ShaderFeature feature) const
@@ -87,11 +178,67 @@ ShaderFeatureList RenderManager::filterFeatureList(ShaderFeatureList list) const
     return list & allowedShaderFeatures_;
 }
 
+void RenderManager::startRecordingStats(const std::string &path)
+{
+    stopRecordingStats();
+
+    statsFile_.open(path, std::ofstream::trunc);
+    if (!statsFile_.is_open())
+    {
+        printf("Could not open render stats file %s\n", path.c_str());
+        return;
+    }
+
+    // Csv files start with a header naming the columns
+    statsFileJson_ = isJsonPath(path);
+    if (!statsFileJson_)
+    {
+        RenderFrameStats::writeCsvHeader(statsFile_);
+    }
+}
+
+void RenderManager::stopRecordingStats()
+{
+    if (statsFile_.is_open())
+    {
+        statsFile_.close();
+    }
+}
+
+void RenderManager::recordFrameStats(const RenderFrameStats &stats)
+{
+    if (!statsFile_.is_open())
+    {
+        return;
+    }
+
+    if (statsFileJson_)
+    {
+        stats.writeJson(statsFile_);
+    }
+    else
+    {
+        stats.writeCsv(statsFile_);
+    }
+}
+
 void RenderManager::render()
 {
     // Individual renderers are currently rendered on-demand.
 }
 
+RendererContext& RenderManager::rendererContext()
+{
+    // The context loads shaders and creates the shadow atlas,
+    // so it is only created once the first renderer needs it.
+    if (rendererContext_ == nullptr)
+    {
+        rendererContext_ = new RendererContext();
+    }
+
+    return *rendererContext_;
+}
+
 void RenderManager::addShaderFeatureMenuItem(ShaderFeature feature, const std::string &name)
 {
     MainWindowMenu::instance()->addMenuItem(
@@ -108,4 +255,23 @@ void RenderManager::addDebugModeMenuItem(RenderDebugMode mode, const std::string
         [=] { setDebugMode(mode); },
         [=] { return debugMode() == mode; }
     );
+}
+
+void RenderManager::addRecordStatsMenuItem(const std::string &path, const std::string &name)
+{
+    const bool json = isJsonPath(path);
+    MainWindowMenu::instance()->addMenuItem(
+        "View/Render Stats/" + name,
+        [=] { if (recordingStats() && statsFileJson_ == json) { stopRecordingStats(); } else { startRecordingStats(path); } },
+        [=] { return recordingStats() && statsFileJson_ == json; }
+    );
+}
+
+void RenderManager::addLodBiasMenuItem(float bias, const std::string &name)
+{
+    MainWindowMenu::instance()->addMenuItem(
+        "View/LOD Bias/" + name,
+        [=] { setLodBias(bias); },
+        [=] { return lodBias() == bias; }
+    );
 }
\ No newline at end of file
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <fstream>
+#include <string>
+
 #include "Application.h"
 
+#include "Renderer/RenderStats.h"
+#include "Renderer/RenderTargetPool.h"
+#include "Renderer/RendererContext.h"
 #include "Renderer/Shader.h"
+#include "Renderer/ShaderBinaryCache.h"
+#include "Renderer/ShaderWarmup.h"
 #include "Utils/Singleton.h"
+#include "Utils/WorkerPool.h"
 
 enum class RenderDebugMode
 {
@@ -23,6 +32,7 @@ class RenderManager : public Singleton<RenderManager>
 {
 public:
     RenderManager();
+    ~RenderManager();
                                                                                                                                                                                                                    
     // Enables and disables shader features globally.
     // Shader features will not be used unless enabled globally.
@@ -39,11 +49,71 @@ public:
     RenderDebugMode debugMode() const { return debugMode_; }
     void setDebugMode(RenderDebugMode mode) { debugMode_ = mode; }
 
+    // Gets or sets whether objects hidden behind the terrain and occluder meshes are culled
+    bool occlusionCullingEnabled() const { return occlusionCullingEnabled_; }
+    void setOcclusionCullingEnabled(bool enabled) { occlusionCullingEnabled_ = enabled; }
+
+    // Gets or sets the level of detail bias. Each step of bias doubles the error allowed on screen,
+    // so positive biases use coarser levels of detail and negative biases use finer ones.
+    float lodBias() const { return lodBias_; }
+    void setLodBias(float bias) { lodBias_ = bias; }
+
+    // Gets or sets the extra bias added for shadow casters, which are only seen through their shadows
+    float shadowLodBias() const { return shadowLodBias_; }
+    void setShadowLodBias(float bias) { shadowLodBias_ = bias; }
+
+    // Gets or sets whether renderers lower their resolution to keep within their frame budget.
+    // The budget and range of scales are set on each renderer's DynamicResolution.
+    bool dynamicResolutionEnabled() const { return dynamicResolutionEnabled_; }
+    void setDynamicResolutionEnabled(bool enabled) { dynamicResolutionEnabled_ = enabled; }
+
+    // Gets or sets whether the game panel shows each pass's render stats on top of the scene
+    bool statsOverlayEnabled() const { return statsOverlayEnabled_; }
+    void setStatsOverlayEnabled(bool enabled) { statsOverlayEnabled_ = enabled; }
+
+    // Starts writing the stats of every frame drawn by every renderer to a file, for regression tracking.
+    // Files ending in .json get one json object per frame on each line, and other files get csv.
+    // Frames are written a few frames late, once their gpu timings have been read back.
+    void startRecordingStats(const std::string &path);
+    void stopRecordingStats();
+    bool recordingStats() const { return statsFile_.is_open(); }
+
+    // Writes the stats of a frame to the stats file, if one is being recorded
+    void recordFrameStats(const RenderFrameStats &stats);
+
     // Called each frame to perform per-frame rendering tasks.
     void render();
 
+    // The worker threads shared by every renderer, for recording views in parallel
+    WorkerPool& workerPool() { return workerPool_; }
+
+    // Linked shader programs stored on disk, shared by every shader
+    ShaderBinaryCache& shaderBinaryCache() { return shaderBinaryCache_; }
+
+    // Shader variants being created ahead of time, and their progress
+    ShaderWarmup& shaderWarmup() { return shaderWarmup_; }
+
+    // True if the driver compiles shaders in the background (KHR_parallel_shader_compile)
+    bool parallelShaderCompile() const { return parallelShaderCompile_; }
+
+    // Transient render targets shared by every renderer's frame graph
+    RenderTargetPool& renderTargetPool() { return renderTargetPool_; }
+
+    // The shaders, meshes, lookup textures and shadow map shared by every renderer.
+    // Created when the first renderer is, so that scenes and resources already exist.
+    RendererContext& rendererContext();
+
 private:
     bool vsyncEnabled_;
+    bool occlusionCullingEnabled_;
+    float lodBias_;
+    float shadowLodBias_;
+    bool dynamicResolutionEnabled_;
+    bool statsOverlayEnabled_;
+
+    // The file frame stats are being recorded to, and whether it is written as json
+    std::ofstream statsFile_;
+    bool statsFileJson_;
 
     // Globally enabled shader features.
     // Features that are not globally enabled cannot be used.
@@ -52,9 +122,31 @@ private:
     // The current deferred debugging mode.
     RenderDebugMode debugMode_;
 
+    // Threads used for the cpu side of rendering
+    WorkerPool workerPool_;
+
+    // Program binaries from previous runs, so warm starts do not compile glsl
+    ShaderBinaryCache shaderBinaryCache_;
+
+    // Variants queued for creation before they are drawn
+    ShaderWarmup shaderWarmup_;
+    bool parallelShaderCompile_;
+
+    // Textures handed out to render graphs, reused across passes, eyes and renderers
+    RenderTargetPool renderTargetPool_;
+
+    // The resources shared by every renderer
+    RendererContext* rendererContext_;
+
     // Adds a menu item for toggling a global shader feature.
     void addShaderFeatureMenuItem(ShaderFeature feature, const std::string &name);
 
     // Adds a menu item for switching to a debugging mode.
     void addDebugModeMenuItem(RenderDebugMode mode, const std::string &name);
+
+    // Adds a menu item for recording the frame stats to a file.
+    void addRecordStatsMenuItem(const std::string &path, const std::string &name);
+
+    // Adds a menu item for choosing a level of detail bias.
+    void addLodBiasMenuItem(float bias, const std::string &name);
 };
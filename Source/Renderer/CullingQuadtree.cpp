@@ -0,0 +1,183 @@
+#include "CullingQuadtree.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Gets the squared distance from a point to the nearest point in a bounding box
+    float sqrDistanceToBounds(const Point3 &point, const Bounds &bounds)
+    {
+        const float dx = std::max(std::max(bounds.min().x - point.x, 0.0f), point.x - bounds.max().x);
+        const float dy = std::max(std::max(bounds.min().y - point.y, 0.0f), point.y - bounds.max().y);
+        const float dz = std::max(std::max(bounds.min().z - point.z, 0.0f), point.z - bounds.max().z);
+        return dx * dx + dy * dy + dz * dz;
+    }
+}
+
+CullingQuadtree::CullingQuadtree()
+{
+
+}
+
+void CullingQuadtree::build(const std::vector<CullingItem> &items)
+{
+    items_ = items;
+    nodes_.clear();
+    itemOrder_.resize(items.size());
+    for (unsigned int i = 0; i < items.size(); ++i)
+    {
+        itemOrder_[i] = i;
+    }
+
+    if (!items_.empty())
+    {
+        nodes_.resize(1);
+        buildNode(0, 0, (int)items_.size(), 0);
+    }
+}
+
+void CullingQuadtree::buildNode(int nodeIndex, int firstItem, int itemCount, int depth)
+{
+    // Cover every item in the range
+    Node node;
+    node.bounds = items_[itemOrder_[firstItem]].bounds;
+    node.maxDrawDistance = 0.0f;
+    node.firstChild = -1;
+    node.childCount = 0;
+    node.firstItem = firstItem;
+    node.itemCount = itemCount;
+    for (int i = firstItem; i < firstItem + itemCount; ++i)
+    {
+        const CullingItem& item = items_[itemOrder_[i]];
+        node.bounds.expandToCover(item.bounds.min());
+        node.bounds.expandToCover(item.bounds.max());
+        node.maxDrawDistance = std::max(node.maxDrawDistance, item.drawDistance);
+    }
+
+    nodes_[nodeIndex] = node;
+
+    // Small nodes become leaves
+    if (itemCount <= MAX_LEAF_ITEMS || depth >= MAX_DEPTH)
+    {
+        return;
+    }
+
+    // Sort the items into quadrants around the node centre, using the item centres.
+    const Point3 centre = node.bounds.centre();
+    auto quadrant = [&](int item)
+    {
+        const Point3 itemCentre = items_[item].bounds.centre();
+        return (itemCentre.x < centre.x ? 0 : 1) + (itemCentre.z < centre.z ? 0 : 2);
+    };
+
+    int* begin = itemOrder_.data() + firstItem;
+    std::stable_sort(begin, begin + itemCount, [&](int a, int b) { return quadrant(a) < quadrant(b); });
+
+    // Count the items in each quadrant
+    int quadrantCount[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < itemCount; ++i)
+    {
+        quadrantCount[quadrant(begin[i])]++;
+    }
+
+    int nonEmptyQuadrants = 0;
+    for (int q = 0; q < 4; ++q)
+    {
+        nonEmptyQuadrants += quadrantCount[q] > 0 ? 1 : 0;
+    }
+
+    // If every item is in the same quadrant, splitting would not help
+    if (nonEmptyQuadrants < 2)
+    {
+        return;
+    }
+
+    // Allocate the children together so that they are contiguous.
+    // Nodes are referenced by index, as the node list grows while building.
+    const int firstChild = (int)nodes_.size();
+    nodes_.resize(nodes_.size() + nonEmptyQuadrants);
+    nodes_[nodeIndex].firstChild = firstChild;
+    nodes_[nodeIndex].childCount = nonEmptyQuadrants;
+
+    int child = firstChild;
+    int childFirstItem = firstItem;
+    for (int q = 0; q < 4; ++q)
+    {
+        if (quadrantCount[q] > 0)
+        {
+            buildNode(child, childFirstItem, quadrantCount[q], depth + 1);
+            childFirstItem += quadrantCount[q];
+            child++;
+        }
+    }
+}
+
+void CullingQuadtree::cull(const Frustum &frustum, const Point3 &viewPosition, float drawDistanceSqrScale, std::vector<int> &visibleItems) const
+{
+    visibleItems.clear();
+    if (nodes_.empty())
+    {
+        return;
+    }
+
+    // Walk the tree with an explicit stack.
+    // Each entry is a node index, and whether it is already known to be inside the frustum.
+    std::pair<int, bool> stack[MAX_DEPTH * 4 + 4];
+    int stackSize = 0;
+    stack[stackSize++] = std::make_pair(0, false);
+
+    while (stackSize > 0)
+    {
+        const std::pair<int, bool> entry = stack[--stackSize];
+        const Node& node = nodes_[entry.first];
+
+        // Reject the node if every item in it is beyond its draw distance.
+        // The item centres are inside the node, so the node is always closer.
+        if (sqrDistanceToBounds(viewPosition, node.bounds) > node.maxDrawDistance * node.maxDrawDistance * drawDistanceSqrScale)
+        {
+            continue;
+        }
+
+        // Reject the node if it is outside the frustum.
+        // Nodes fully inside the frustum don't need to test their items.
+        bool insideFrustum = entry.second;
+        if (!insideFrustum)
+        {
+            const FrustumIntersection intersection = frustum.classify(node.bounds);
+            if (intersection == FrustumIntersection::Outside)
+            {
+                continue;
+            }
+
+            insideFrustum = (intersection == FrustumIntersection::Inside);
+        }
+
+        // Visit the children, or test the items in leaf nodes
+        if (node.childCount > 0)
+        {
+            for (int c = node.childCount - 1; c >= 0; --c)
+            {
+                stack[stackSize++] = std::make_pair(node.firstChild + c, insideFrustum);
+            }
+
+            continue;
+        }
+
+        for (int i = node.firstItem; i < node.firstItem + node.itemCount; ++i)
+        {
+            const int itemIndex = itemOrder_[i];
+            const CullingItem& item = items_[itemIndex];
+
+            // Skip items that are further than the draw distance
+            if ((item.bounds.centre() - viewPosition).sqrMagnitude() > item.drawDistance * item.drawDistance * drawDistanceSqrScale)
+            {
+                continue;
+            }
+
+            if (insideFrustum || frustum.intersects(item.bounds))
+            {
+                visibleItems.push_back(itemIndex);
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include "Math/Bounds.h"
+#include "Math/Frustum.h"
+#include "Math/Point3.h"
+
+// An object that can be culled by a CullingQuadtree
+struct CullingItem
+{
+    Bounds bounds;
+
+    // The item is culled when its centre is further than this from the viewer
+    float drawDistance;
+};
+
+// A quadtree over the xz plane used to cull large numbers of static items.
+// Whole branches are rejected at once when they are outside the view
+// frustum or beyond the draw distance of every item inside them.
+// Does not use the gpu, so can be used and tested headlessly.
+class CullingQuadtree
+{
+public:
+    // The maximum number of items stored in a leaf node
+    const static int MAX_LEAF_ITEMS = 8;
+
+    // The maximum depth of the tree
+    const static int MAX_DEPTH = 8;
+
+    CullingQuadtree();
+
+    // Rebuilds the tree to contain the given items
+    void build(const std::vector<CullingItem> &items);
+
+    // The number of items and nodes in the tree
+    int itemCount() const { return (int)items_.size(); }
+    int nodeCount() const { return (int)nodes_.size(); }
+
+    // Finds the items that are inside the frustum and within their draw distance
+    // of the view position. The squared draw distances are multiplied by drawDistanceSqrScale.
+    // The indices of the visible items are written to visibleItems, in tree order.
+    void cull(const Frustum &frustum, const Point3 &viewPosition, float drawDistanceSqrScale, std::vector<int> &visibleItems) const;
+
+private:
+    struct Node
+    {
+        // The bounds covering every item in the node
+        Bounds bounds;
+
+        // The largest draw distance of any item in the node
+        float maxDrawDistance;
+
+        // The children are stored contiguously. -1 for leaf nodes.
+        int firstChild;
+        int childCount;
+
+        // The items in the node and its children, as a range of itemOrder_.
+        int firstItem;
+        int itemCount;
+    };
+
+    std::vector<CullingItem> items_;
+    std::vector<Node> nodes_;
+
+    // Item indices, sorted so that each node covers a contiguous range.
+    std::vector<int> itemOrder_;
+
+    // Fills in an allocated node to cover the given range of itemOrder_,
+    // and builds its children.
+    void buildNode(int nodeIndex, int firstItem, int itemCount, int depth);
+};
\ No newline at end of file
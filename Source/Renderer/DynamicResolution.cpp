@@ -0,0 +1,115 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+const float DynamicResolution::SCALE_GRANULARITY = 0.05f;
+const float DynamicResolution::SMOOTHING = 0.1f;
+
+DynamicResolution::DynamicResolution()
+    : frameBudget_(1000.0f / 60.0f),
+    minScale_(0.5f),
+    maxScale_(1.0f),
+    lowerThreshold_(0.8f),
+    upperThreshold_(0.95f),
+    settleFrames_(15),
+    scale_(1.0f),
+    smoothedFrameTime_(0.0f),
+    currentFrame_(0),
+    scaleFirstFrame_(0),
+    framesSinceChange_(0)
+{
+
+}
+
+void DynamicResolution::setFrameBudget(float milliseconds)
+{
+    assert(milliseconds > 0.0f);
+    frameBudget_ = milliseconds;
+}
+
+void DynamicResolution::setScaleRange(float minScale, float maxScale)
+{
+    assert(minScale > 0.0f && minScale <= maxScale);
+    minScale_ = minScale;
+    maxScale_ = maxScale;
+    scale_ = quantise(scale_);
+}
+
+void DynamicResolution::setThresholds(float lower, float upper)
+{
+    assert(lower > 0.0f && lower < upper);
+    lowerThreshold_ = lower;
+    upperThreshold_ = upper;
+}
+
+void DynamicResolution::setSettleFrames(int frames)
+{
+    settleFrames_ = std::max(frames, 1);
+}
+
+void DynamicResolution::beginFrame(uint64_t frame)
+{
+    currentFrame_ = frame;
+}
+
+void DynamicResolution::addFrame(uint64_t frame, float milliseconds)
+{
+    // Times of frames rendered before the last change were measured at a different scale, so are not used
+    if (frame < scaleFirstFrame_)
+    {
+        return;
+    }
+
+    // Smooth the frame times since the last change
+    smoothedFrameTime_ = (framesSinceChange_ == 0) ? milliseconds : smoothedFrameTime_ + (milliseconds - smoothedFrameTime_) * SMOOTHING;
+    ++framesSinceChange_;
+
+    // Wait for the frame times to settle after a change
+    if (framesSinceChange_ < settleFrames_)
+    {
+        return;
+    }
+
+    // Only act when the frame time leaves the band around the budget
+    const bool overBudget = smoothedFrameTime_ > frameBudget_ * upperThreshold_;
+    const bool underBudget = smoothedFrameTime_ < frameBudget_ * lowerThreshold_;
+    if (!overBudget && !underBudget)
+    {
+        return;
+    }
+
+    // Aim for the middle of the band. The cost of the scaled passes grows with
+    // the number of pixels, which is the square of the scale. The rest of the frame
+    // does not get cheaper, so a few steps may be needed to reach the band.
+    const float aim = frameBudget_ * 0.5f * (lowerThreshold_ + upperThreshold_);
+    const float newScale = quantise(scale_ * std::sqrt(aim / std::max(smoothedFrameTime_, 0.001f)));
+    if (newScale != scale_)
+    {
+        scale_ = newScale;
+        scaleFirstFrame_ = currentFrame_;
+        framesSinceChange_ = 0;
+    }
+}
+
+void DynamicResolution::reset()
+{
+    scale_ = maxScale_;
+    scaleFirstFrame_ = currentFrame_;
+    smoothedFrameTime_ = 0.0f;
+    framesSinceChange_ = 0;
+}
+
+void DynamicResolution::scaledSize(int width, int height, float scale, int &scaledWidth, int &scaledHeight)
+{
+    scaledWidth = std::max(1, (int)(width * scale + 0.5f));
+    scaledHeight = std::max(1, (int)(height * scale + 0.5f));
+}
+
+float DynamicResolution::quantise(float scale) const
+{
+    // The small offset stops scales that are already on a step from being rounded down by float error
+    const float rounded = std::floor(scale / SCALE_GRANULARITY + 0.001f) * SCALE_GRANULARITY;
+    return std::min(std::max(rounded, minScale_), maxScale_);
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+
+// Chooses the scale that the scene is rendered at, so that frames fit inside a time budget.
+// Frame times are smoothed, and the scale only changes when they leave a band around the budget,
+// so that noisy frame times do not make the resolution flicker. Gpu times arrive a few frames late,
+// so each time is tagged with the frame it measured, and times of frames rendered before the scale
+// last changed are dropped. After each change the controller waits for a few frames measured at
+// the new scale before it acts again.
+// Does not use the gpu, so can be used and tested headlessly.
+class DynamicResolution
+{
+public:
+    // Scales are rounded down to a multiple of this, so that the render target pool only sees a few sizes
+    static const float SCALE_GRANULARITY;
+
+    // The weight of the newest frame time in the smoothed frame time
+    static const float SMOOTHING;
+
+public:
+    DynamicResolution();
+
+    // The time each frame should take, in milliseconds.
+    // Defaults to 60 Hz. VR targets should use 90 Hz or more.
+    float frameBudget() const { return frameBudget_; }
+    void setFrameBudget(float milliseconds);
+
+    // The range of scales that can be chosen
+    float minScale() const { return minScale_; }
+    float maxScale() const { return maxScale_; }
+    void setScaleRange(float minScale, float maxScale);
+
+    // The band around the budget that frame times can stay in without changing the scale, as fractions of the budget.
+    // The scale drops when the smoothed time is above budget * upper, and rises when it is below budget * lower.
+    float lowerThreshold() const { return lowerThreshold_; }
+    float upperThreshold() const { return upperThreshold_; }
+    void setThresholds(float lower, float upper);
+
+    // The number of frames measured at a new scale to wait for before the scale can change again
+    int settleFrames() const { return settleFrames_; }
+    void setSettleFrames(int frames);
+
+    // Starts a new frame, which is rendered at the current scale
+    void beginFrame(uint64_t frame);
+
+    // Adds the time taken by an earlier frame, in milliseconds, and updates the scale.
+    // Each frame should only be added once. Frames from before the scale last changed are ignored.
+    void addFrame(uint64_t frame, float milliseconds);
+
+    // Returns to the maximum scale, and forgets the previous frame times
+    void reset();
+
+    // The scale to render at, between the minimum and maximum scales
+    float scale() const { return scale_; }
+
+    // The smoothed frame time since the scale last changed, in milliseconds
+    float smoothedFrameTime() const { return smoothedFrameTime_; }
+
+    // The size to render a target at, for a scale. Never smaller than one pixel.
+    static void scaledSize(int width, int height, float scale, int &scaledWidth, int &scaledHeight);
+
+private:
+    float frameBudget_;
+    float minScale_;
+    float maxScale_;
+    float lowerThreshold_;
+    float upperThreshold_;
+    int settleFrames_;
+
+    float scale_;
+    float smoothedFrameTime_;
+
+    // The frame being rendered, and the first frame rendered at the current scale
+    uint64_t currentFrame_;
+    uint64_t scaleFirstFrame_;
+
+    // The frames added since the scale last changed
+    int framesSinceChange_;
+
+    // Rounds a scale down to the granularity, and clamps it to the range
+    float quantise(float scale) const;
+};
\ No newline at end of file
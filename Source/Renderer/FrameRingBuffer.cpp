@@ -0,0 +1,202 @@
+#include "FrameRingBuffer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+FrameRingBuffer::FrameRingBuffer(GLsizeiptr frameSize)
+    : bufferID_(0),
+    frameSize_(frameSize),
+    alignment_(256),
+    mapped_(nullptr),
+    frame_(0),
+    offset_(0),
+    fences_(),
+    regionsUsed_(),
+    orphans_(),
+    lastFrameOrphans_(),
+    warnedOverflow_(false)
+{
+    // Uniform and storage buffer bindings must start on a multiple of their offset alignments
+    GLint uniformAlignment = 256;
+    GLint storageAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    alignment_ = (uniformAlignment > storageAlignment) ? uniformAlignment : storageAlignment;
+    frameSize_ = ((frameSize_ + alignment_ - 1) / alignment_) * alignment_;
+
+    // Create immutable storage that stays mapped for the lifetime of the buffer.
+    // Coherent mapping means writes are visible to the gpu without explicit flushes.
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &bufferID_);
+    glNamedBufferStorage(bufferID_, frameSize_ * FRAME_COUNT, nullptr, flags);
+    mapped_ = (unsigned char*)glMapNamedBufferRange(bufferID_, 0, frameSize_ * FRAME_COUNT, flags);
+    assert(mapped_ != nullptr);
+
+    regionsUsed_[frame_] = true;
+}
+
+FrameRingBuffer::~FrameRingBuffer()
+{
+    deleteOrphans(orphans_);
+    deleteOrphans(lastFrameOrphans_);
+
+    for (int i = 0; i < FRAME_COUNT; ++i)
+    {
+        if (fences_[i] != nullptr)
+        {
+            glDeleteSync(fences_[i]);
+        }
+    }
+
+    if (bufferID_ != 0)
+    {
+        glUnmapNamedBuffer(bufferID_);
+        glDeleteBuffers(1, &bufferID_);
+    }
+}
+
+void FrameRingBuffer::beginFrame()
+{
+    // Mark the end of the gpu commands reading the regions written in the last frame
+    for (int i = 0; i < FRAME_COUNT; ++i)
+    {
+        if (regionsUsed_[i])
+        {
+            if (fences_[i] != nullptr)
+            {
+                glDeleteSync(fences_[i]);
+            }
+
+            fences_[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            regionsUsed_[i] = false;
+        }
+    }
+
+    // Orphaned buffers are kept for a frame after they were used
+    deleteOrphans(lastFrameOrphans_);
+    lastFrameOrphans_.swap(orphans_);
+
+    nextRegion();
+}
+
+RingAllocation FrameRingBuffer::allocate(GLsizeiptr size)
+{
+    // Running out of space is recovered from by continuing in the next region, which waits
+    // for the fence of the frame that last used it. The data already written this
+    // frame may still be bound, so regions used earlier in the frame cannot be reused.
+    // Once every region has been used, or when the data is larger than a region,
+    // the allocation gets a buffer of its own instead.
+    if (offset_ + size > frameSize_)
+    {
+        if (!warnedOverflow_)
+        {
+            printf("Frame ring buffer is full (%d bytes per frame). Increase the frame size.\n", (int)frameSize_);
+            warnedOverflow_ = true;
+        }
+
+        if (size > frameSize_ || regionsUsed_[(frame_ + 1) % FRAME_COUNT])
+        {
+            return allocateOrphan(size);
+        }
+
+        nextRegion();
+    }
+
+    RingAllocation allocation;
+    allocation.buffer = bufferID_;
+    allocation.data = mapped_ + frame_ * frameSize_ + offset_;
+    allocation.offset = frame_ * frameSize_ + offset_;
+    allocation.size = size;
+
+    // Keep the next allocation aligned
+    offset_ += ((size + alignment_ - 1) / alignment_) * alignment_;
+    return allocation;
+}
+
+RingAllocation FrameRingBuffer::upload(const void* data, GLsizeiptr size)
+{
+    const RingAllocation allocation = allocate(size);
+    if (size > 0)
+    {
+        memcpy(allocation.data, data, size);
+    }
+
+    return allocation;
+}
+
+void FrameRingBuffer::bindUniformRange(GLuint binding, const RingAllocation &allocation) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, allocation.buffer, allocation.offset, allocation.size);
+}
+
+void FrameRingBuffer::bindStorageRange(GLuint binding, const RingAllocation &allocation) const
+{
+    // Empty ranges cannot be bound, but are never read either
+    if (allocation.size > 0)
+    {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, allocation.buffer, allocation.offset, allocation.size);
+    }
+}
+
+void FrameRingBuffer::useForIndirectDraws(const RingAllocation &allocation) const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, allocation.buffer);
+}
+
+void FrameRingBuffer::nextRegion()
+{
+    frame_ = (frame_ + 1) % FRAME_COUNT;
+    offset_ = 0;
+    regionsUsed_[frame_] = true;
+
+    if (fences_[frame_] == nullptr)
+    {
+        return;
+    }
+
+    // Wait for the fence, flushing the command queue so that it is guaranteed to signal.
+    // The wait is repeated as each call gives up after the timeout.
+    const GLuint64 timeout = 1000000000; // 1 second, in nanoseconds
+    GLenum result = glClientWaitSync(fences_[frame_], GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    while (result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(fences_[frame_], GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    }
+
+    if (result == GL_WAIT_FAILED)
+    {
+        printf("Failed to wait for frame ring buffer fence.\n");
+    }
+
+    glDeleteSync(fences_[frame_]);
+    fences_[frame_] = nullptr;
+}
+
+RingAllocation FrameRingBuffer::allocateOrphan(GLsizeiptr size)
+{
+    // Zero sized buffers are not allowed, so always allocate at least one byte
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr bufferSize = (size > 0) ? size : 1;
+
+    RingAllocation allocation;
+    glCreateBuffers(1, &allocation.buffer);
+    glNamedBufferStorage(allocation.buffer, bufferSize, nullptr, flags);
+    allocation.data = glMapNamedBufferRange(allocation.buffer, 0, bufferSize, flags);
+    allocation.offset = 0;
+    allocation.size = size;
+    assert(allocation.data != nullptr);
+
+    orphans_.push_back(allocation.buffer);
+    return allocation;
+}
+
+void FrameRingBuffer::deleteOrphans(std::vector<GLuint> &orphans)
+{
+    // Deleting a mapped buffer also unmaps it
+    if (!orphans.empty())
+    {
+        glDeleteBuffers((GLsizei)orphans.size(), orphans.data());
+        orphans.clear();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/gl3w.h>
+
+#include "Renderer/UniformBuffer.h"
+
+// A region of a frame ring buffer, written by the cpu during the current frame
+struct RingAllocation
+{
+    // The buffer holding the data. This is the ring buffer itself, unless the frame ran out of space.
+    GLuint buffer;
+
+    void* data;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+// A persistently mapped buffer that per-frame uniform, storage and indirect data is sub-allocated from.
+// The buffer is split into one region per frame in flight. Each frame writes to the next
+// region, after waiting on a fence to ensure the gpu has finished reading from it, so
+// updating uniforms is a plain memory copy rather than a buffer reallocation.
+class FrameRingBuffer
+{
+public:
+    // The number of frames the cpu can write ahead of the gpu
+    static const int FRAME_COUNT = 3;
+
+    // The default space available to each frame
+    static const GLsizeiptr DEFAULT_FRAME_SIZE = 16 * 1024 * 1024;
+
+public:
+    explicit FrameRingBuffer(GLsizeiptr frameSize = DEFAULT_FRAME_SIZE);
+    ~FrameRingBuffer();
+
+    // Prevent the buffer being copied
+    FrameRingBuffer(const FrameRingBuffer&) = delete;
+    FrameRingBuffer& operator=(const FrameRingBuffer&) = delete;
+
+    // Fences the data written in the previous frame, and moves on to the next region.
+    // Waits if the gpu is still reading from that region.
+    void beginFrame();
+
+    // Allocates space in the current frame's region.
+    // The offset is aligned so that it can be bound as a uniform or storage buffer.
+    RingAllocation allocate(GLsizeiptr size);
+
+    // Allocates space in the current frame's region, and copies data into it
+    RingAllocation upload(const void* data, GLsizeiptr size);
+
+    // Binds an allocation to a uniform or storage buffer binding point
+    void bindUniformRange(GLuint binding, const RingAllocation &allocation) const;
+    void bindStorageRange(GLuint binding, const RingAllocation &allocation) const;
+
+    // Uses the buffer holding an allocation as the source of indirect draw commands.
+    // Indirect draws then use offsets into that buffer, starting from the allocation's offset.
+    void useForIndirectDraws(const RingAllocation &allocation) const;
+
+    // Copies data into the current frame's region and binds it to the binding point for the buffer type
+    template <typename T>
+    void upload(UniformBufferType type, const T &data)
+    {
+        bindUniformRange(static_cast<GLuint>(type), upload(&data, sizeof(T)));
+    }
+
+    // The number of bytes allocated in the current frame
+    GLsizeiptr frameBytesUsed() const { return offset_; }
+
+private:
+    GLuint bufferID_;
+    GLsizeiptr frameSize_;
+    GLint alignment_;
+    unsigned char* mapped_;
+
+    // The current region and the position in it
+    int frame_;
+    GLsizeiptr offset_;
+
+    // Signalled when the gpu finishes with each region
+    GLsync fences_[FRAME_COUNT];
+
+    // The regions written during the current frame.
+    // This is usually only the current region, unless the frame ran out of space.
+    bool regionsUsed_[FRAME_COUNT];
+
+    // Separate buffers for allocations that did not fit in any region, in the current and last frame.
+    // Deleting a buffer only frees its memory once the gpu has finished with it.
+    std::vector<GLuint> orphans_;
+    std::vector<GLuint> lastFrameOrphans_;
+
+    // Only warn about running out of space once
+    bool warnedOverflow_;
+
+    // Moves on to the next region, once the gpu has finished reading from it
+    void nextRegion();
+
+    // Allocates a separate buffer, for when every region has been used in the current frame
+    RingAllocation allocateOrphan(GLsizeiptr size);
+
+    // Deletes a list of orphaned buffers
+    static void deleteOrphans(std::vector<GLuint> &orphans);
+};
\ No newline at end of file
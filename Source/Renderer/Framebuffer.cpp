@@ -146,3 +146,13 @@ void Framebuffer::use() const
     glBindFramebuffer(GL_FRAMEBUFFER, id_);
     glViewport(0, 0, width_, height_);
 }
+
+void Framebuffer::bindDepthTexture(int slot) const
+{
+    // Get the name of the depth texture attached to this framebuffer
+    GLint depthTexture;
+    glGetNamedFramebufferAttachmentParameteriv(id_, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &depthTexture);
+
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+}
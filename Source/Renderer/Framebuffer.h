@@ -61,6 +61,10 @@ public:
     // Sets this framebuffer as the active framebuffer.
     void use() const;
 
+    // Binds the depth texture attached to this framebuffer to a texture slot, for sampling.
+    // Used for framebuffers whose depth texture is not a Texture, such as the targets.
+    void bindDepthTexture(int slot) const;
+
 private:
     GLuint id_;
     int width_;
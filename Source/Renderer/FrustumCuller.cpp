@@ -0,0 +1,95 @@
+#include "FrustumCuller.h"
+
+#include <xmmintrin.h>
+
+FrustumCuller::FrustumCuller()
+    : count_(0)
+{
+
+}
+
+void FrustumCuller::clear()
+{
+    count_ = 0;
+    minX_.clear();
+    minY_.clear();
+    minZ_.clear();
+    maxX_.clear();
+    maxY_.clear();
+    maxZ_.clear();
+}
+
+int FrustumCuller::add(const Bounds &bounds)
+{
+    // Grow the arrays 4 boxes at a time, so that the last group is always complete.
+    if (count_ % 4 == 0)
+    {
+        const size_t paddedCount = count_ + 4;
+        minX_.resize(paddedCount, 0.0f);
+        minY_.resize(paddedCount, 0.0f);
+        minZ_.resize(paddedCount, 0.0f);
+        maxX_.resize(paddedCount, 0.0f);
+        maxY_.resize(paddedCount, 0.0f);
+        maxZ_.resize(paddedCount, 0.0f);
+    }
+
+    const Point3 min = bounds.min();
+    const Point3 max = bounds.max();
+    minX_[count_] = min.x;
+    minY_[count_] = min.y;
+    minZ_[count_] = min.z;
+    maxX_[count_] = max.x;
+    maxY_[count_] = max.y;
+    maxZ_[count_] = max.z;
+    return count_++;
+}
+
+void FrustumCuller::cull(const Frustum &frustum, std::vector<int> &visible) const
+{
+    visible.clear();
+
+    // For each plane, the corner furthest along the plane normal is picked from either the min or
+    // max arrays. Which array is used only depends on the plane, so is chosen once per plane.
+    const float* cornerX[Frustum::PLANE_COUNT];
+    const float* cornerY[Frustum::PLANE_COUNT];
+    const float* cornerZ[Frustum::PLANE_COUNT];
+    __m128 planeX[Frustum::PLANE_COUNT], planeY[Frustum::PLANE_COUNT], planeZ[Frustum::PLANE_COUNT], planeW[Frustum::PLANE_COUNT];
+    for (int i = 0; i < Frustum::PLANE_COUNT; ++i)
+    {
+        const Vector4 p = frustum.plane(i);
+        cornerX[i] = p.x >= 0.0f ? maxX_.data() : minX_.data();
+        cornerY[i] = p.y >= 0.0f ? maxY_.data() : minY_.data();
+        cornerZ[i] = p.z >= 0.0f ? maxZ_.data() : minZ_.data();
+        planeX[i] = _mm_set1_ps(p.x);
+        planeY[i] = _mm_set1_ps(p.y);
+        planeZ[i] = _mm_set1_ps(p.z);
+        planeW[i] = _mm_set1_ps(p.w);
+    }
+
+    // Test 4 boxes at a time.
+    // A box is outside when its furthest corner is behind any plane.
+    const __m128 zero = _mm_setzero_ps();
+    for (int first = 0; first < count_; first += 4)
+    {
+        __m128 outside = zero;
+        for (int i = 0; i < Frustum::PLANE_COUNT; ++i)
+        {
+            // Evaluated in the same order as Frustum::classify, so the results match exactly.
+            __m128 distance = _mm_mul_ps(planeX[i], _mm_loadu_ps(cornerX[i] + first));
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeY[i], _mm_loadu_ps(cornerY[i] + first)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[i], _mm_loadu_ps(cornerZ[i] + first)));
+            distance = _mm_add_ps(distance, planeW[i]);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+        }
+
+        // Output the visible boxes, ignoring the padding at the end
+        const int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4 && first + lane < count_; ++lane)
+        {
+            if ((mask & (1 << lane)) == 0)
+            {
+                visible.push_back(first + lane);
+            }
+        }
+    }
+}
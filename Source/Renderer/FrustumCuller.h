@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "Math/Bounds.h"
+#include "Math/Frustum.h"
+
+// Culls large numbers of bounding boxes against frustums.
+// The boxes are stored as a structure of arrays, so that four boxes
+// are tested against each frustum plane at once with SSE.
+// Gives exactly the same result as Frustum::intersects for each box.
+// Does not use the gpu, so can be used and tested headlessly.
+class FrustumCuller
+{
+public:
+    FrustumCuller();
+
+    // Removes every box
+    void clear();
+
+    // Adds a box, and returns its index
+    int add(const Bounds &bounds);
+
+    // The number of boxes in the culler
+    int count() const { return count_; }
+
+    // Finds the boxes that are at least partially inside the frustum.
+    // The indices of the visible boxes are written to visible, in increasing order.
+    void cull(const Frustum &frustum, std::vector<int> &visible) const;
+
+private:
+    int count_;
+
+    // The box corners, padded to a multiple of 4 boxes.
+    std::vector<float> minX_, minY_, minZ_;
+    std::vector<float> maxX_, maxY_, maxZ_;
+};
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "GLRenderDevice.h"
+
+#include "Renderer/Framebuffer.h"
+#include "Renderer/InstanceBatcher.h"
+#include "Renderer/Mesh.h"
+#include "Renderer/Shader.h"
+#include "Renderer/StorageBuffer.h"
+#include "Renderer/Texture.h"
+
+GLRenderDevice::GLRenderDevice(FrameRingBuffer &ring)
+    : ring_(ring),
+    boundMesh_(nullptr),
+    indirectCommands_()
+{
+
+}
+
+void GLRenderDevice::bindShader(Shader* shader, ShaderFeatureList shaderFeatures)
+{
+    shader->bindVariant(shaderFeatures);
+}
+
+void GLRenderDevice::bindMesh(const Mesh* mesh)
+{
+    mesh->bind();
+    boundMesh_ = mesh;
+}
+
+void GLRenderDevice::bindTexture(int slot, const Texture* texture)
+{
+    texture->bind(slot);
+}
+
+void GLRenderDevice::bindArrayTexture(int slot, const ArrayTexture* texture)
+{
+    texture->bind(slot);
+}
+
+void GLRenderDevice::bindStorageBuffer(const StorageBufferBase* storageBuffer)
+{
+    storageBuffer->use();
+}
+
+void GLRenderDevice::setState(const RenderState &state)
+{
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(state.depthGreater ? GL_GREATER : GL_LESS);
+    glDepthMask(state.depthWrite);
+
+    switch (state.blend)
+    {
+    case RenderBlendMode::Opaque:
+        glDisable(GL_BLEND);
+        glColorMask(true, true, true, true);
+        break;
+
+    case RenderBlendMode::Alpha:
+        // The blend factor is output from the fragment shader
+        glEnable(GL_BLEND);
+        glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+        glColorMask(true, true, true, true);
+        break;
+
+    case RenderBlendMode::MinAlpha:
+        glEnable(GL_BLEND);
+        glBlendEquation(GL_MIN);
+        glColorMask(false, false, false, true);
+        break;
+    }
+}
+
+void GLRenderDevice::clearDepth()
+{
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void GLRenderDevice::setWireframe(bool wireframe)
+{
+    glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
+}
+
+void GLRenderDevice::bindFramebuffer(const Framebuffer* framebuffer)
+{
+    framebuffer->use();
+}
+
+void GLRenderDevice::bindFramebufferDepth(int slot, const Framebuffer* framebuffer)
+{
+    framebuffer->bindDepthTexture(slot);
+}
+
+void GLRenderDevice::clearColor(const Color &color)
+{
+    glClearColor(color.r, color.g, color.b, color.a);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void GLRenderDevice::blitFramebuffer(const Framebuffer* source, const Framebuffer* destination, int sourceWidth, int sourceHeight)
+{
+    // Color is filtered, but depth can only be point sampled
+    glBlitNamedFramebuffer(source->glid(), destination->glid(), 0, 0, sourceWidth, sourceHeight, 0, 0, destination->width(), destination->height(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBlitNamedFramebuffer(source->glid(), destination->glid(), 0, 0, sourceWidth, sourceHeight, 0, 0, destination->width(), destination->height(), GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+void GLRenderDevice::uniformData(int binding, const void* data, uint32_t size)
+{
+    ring_.bindUniformRange(binding, ring_.upload(data, size));
+}
+
+void GLRenderDevice::storageData(int binding, const void* data, uint32_t size)
+{
+    ring_.bindStorageRange(binding, ring_.upload(data, size));
+}
+
+void GLRenderDevice::indirectData(const void* data, uint32_t size)
+{
+    indirectCommands_ = ring_.upload(data, size);
+    ring_.useForIndirectDraws(indirectCommands_);
+}
+
+void GLRenderDevice::draw(RenderPrimitive primitive, int elementCount, int firstElement, int firstInstance, int instanceCount)
+{
+    const GLenum mode = (primitive == RenderPrimitive::Patches) ? GL_PATCHES : GL_TRIANGLES;
+    if (instanceCount > 0)
+    {
+        // The base instance is the first instance of the draw in the instance buffer
+        glDrawElementsInstancedBaseInstance(mode, elementCount, boundMesh_->indexType(), boundMesh_->elementOffset(firstElement), instanceCount, firstInstance);
+    }
+    else
+    {
+        glDrawElements(mode, elementCount, boundMesh_->indexType(), boundMesh_->elementOffset(firstElement));
+    }
+}
+
+void GLRenderDevice::multiDrawIndirect(int firstIndirectCommand, int indirectCommandCount)
+{
+    const GLintptr offset = indirectCommands_.offset + firstIndirectCommand * sizeof(DrawIndirectCommand);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, boundMesh_->indexType(), (const void*)offset, indirectCommandCount, 0);
+}
\ No newline at end of file
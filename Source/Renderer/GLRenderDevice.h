@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Renderer/FrameRingBuffer.h"
+#include "Renderer/RenderDevice.h"
+
+class Mesh;
+
+// Executes render commands with OpenGL.
+// Recorded buffer data is copied into the frame ring buffer and bound from there.
+// Must only be used on the thread that owns the gl context.
+class GLRenderDevice : public RenderDevice
+{
+public:
+    explicit GLRenderDevice(FrameRingBuffer &ring);
+
+protected:
+    void bindShader(Shader* shader, ShaderFeatureList shaderFeatures) override;
+    void bindMesh(const Mesh* mesh) override;
+    void bindTexture(int slot, const Texture* texture) override;
+    void bindArrayTexture(int slot, const ArrayTexture* texture) override;
+    void bindStorageBuffer(const StorageBufferBase* storageBuffer) override;
+    void setState(const RenderState &state) override;
+    void clearDepth() override;
+    void setWireframe(bool wireframe) override;
+    void bindFramebuffer(const Framebuffer* framebuffer) override;
+    void bindFramebufferDepth(int slot, const Framebuffer* framebuffer) override;
+    void clearColor(const Color &color) override;
+    void blitFramebuffer(const Framebuffer* source, const Framebuffer* destination, int sourceWidth, int sourceHeight) override;
+    void uniformData(int binding, const void* data, uint32_t size) override;
+    void storageData(int binding, const void* data, uint32_t size) override;
+    void indirectData(const void* data, uint32_t size) override;
+    void draw(RenderPrimitive primitive, int elementCount, int firstElement, int firstInstance, int instanceCount) override;
+    void multiDrawIndirect(int firstIndirectCommand, int indirectCommandCount) override;
+
+private:
+    FrameRingBuffer& ring_;
+
+    // The mesh bound by the last BindMesh, which sets the index type of draws
+    const Mesh* boundMesh_;
+
+    // The indirect commands used by multi draws
+    RingAllocation indirectCommands_;
+};
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "GpuTimer.h"
+
+#include <assert.h>
+
+GpuTimer::GpuTimer()
+    : currentFrame_(0),
+    measuring_(false),
+    hasResult_(false),
+    newResult_(false),
+    resultFrame_(0),
+    results_()
+{
+    for (FrameQueries& frame : frames_)
+    {
+        glCreateQueries(GL_TIME_ELAPSED, MAX_TIMINGS_PER_FRAME, frame.queries);
+        frame.frame = 0;
+        frame.count = 0;
+        frame.pending = false;
+    }
+}
+
+GpuTimer::~GpuTimer()
+{
+    for (FrameQueries& frame : frames_)
+    {
+        glDeleteQueries(MAX_TIMINGS_PER_FRAME, frame.queries);
+    }
+}
+
+void GpuTimer::beginFrame(uint64_t frame)
+{
+    assert(!measuring_);
+
+    // Collect any results that have arrived since the last frame
+    newResult_ = false;
+    readResults();
+
+    // Move on to the next set of queries.
+    // Rather than wait, a frame whose results are still outstanding is dropped.
+    currentFrame_ = (currentFrame_ + 1) % FRAME_COUNT;
+    frames_[currentFrame_].frame = frame;
+    frames_[currentFrame_].count = 0;
+    frames_[currentFrame_].pending = false;
+}
+
+int GpuTimer::begin()
+{
+    assert(!measuring_);
+
+    FrameQueries& frame = frames_[currentFrame_];
+    if (frame.count == MAX_TIMINGS_PER_FRAME)
+    {
+        return -1;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.count]);
+    measuring_ = true;
+    frame.pending = true;
+    return frame.count;
+}
+
+void GpuTimer::end()
+{
+    if (!measuring_)
+    {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    measuring_ = false;
+    frames_[currentFrame_].count++;
+}
+
+float GpuTimer::resultMilliseconds() const
+{
+    float milliseconds = 0.0f;
+    for (float result : results_)
+    {
+        milliseconds += result;
+    }
+
+    return milliseconds;
+}
+
+void GpuTimer::readResults()
+{
+    // Visit the frames from oldest to newest.
+    // Queries finish in the order they were issued, so stop at the first frame that is not ready.
+    for (int i = 1; i <= FRAME_COUNT; ++i)
+    {
+        FrameQueries& frame = frames_[(currentFrame_ + i) % FRAME_COUNT];
+        if (!frame.pending)
+        {
+            continue;
+        }
+
+        // The frame is finished once its last query is
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[frame.count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE)
+        {
+            break;
+        }
+
+        results_.resize(frame.count);
+        for (int query = 0; query < frame.count; ++query)
+        {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(frame.queries[query], GL_QUERY_RESULT, &nanoseconds);
+            results_[query] = (float)(nanoseconds / 1000000.0);
+        }
+
+        resultFrame_ = frame.frame;
+        hasResult_ = true;
+        newResult_ = true;
+        frame.pending = false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/gl3w.h>
+
+// Measures how long the gpu spends on each of the passes in a frame, using timer queries.
+// Each frame in flight has its own set of queries, and a frame's results are read back a few frames
+// later once they are available, so reading them never stalls the cpu. If a frame's results have not
+// arrived by the time its queries are reused, they are dropped. Timer queries cannot be nested,
+// so only one measurement can be running at once.
+class GpuTimer
+{
+public:
+    // The number of frames of queries that can be waiting for their results
+    const static int FRAME_COUNT = 4;
+
+    // The number of measurements that can be made in each frame
+    const static int MAX_TIMINGS_PER_FRAME = 32;
+
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    // Prevent the timer from being copied
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Starts a new frame of measurements, after reading back earlier frames whose results have arrived
+    void beginFrame(uint64_t frame);
+
+    // Starts and stops a measurement. Returns the index of the measurement
+    // in the frame, or -1 if the frame has run out of queries.
+    int begin();
+    void end();
+
+    // True once the results of at least one frame have been read back
+    bool hasResult() const { return hasResult_; }
+
+    // True if beginFrame() read back the results of a new frame
+    bool newResult() const { return newResult_; }
+
+    // The most recent frame whose results have been read back, and its measurements
+    // in milliseconds, in the order they were made
+    uint64_t resultFrame() const { return resultFrame_; }
+    const std::vector<float>& results() const { return results_; }
+
+    // The sum of the most recent frame's measurements, in milliseconds
+    float resultMilliseconds() const;
+
+private:
+    struct FrameQueries
+    {
+        GLuint queries[MAX_TIMINGS_PER_FRAME];
+        uint64_t frame;
+        int count;
+        bool pending;
+    };
+
+    FrameQueries frames_[FRAME_COUNT];
+
+    // The frame being measured
+    int currentFrame_;
+
+    // True between begin() and end() when a query was started
+    bool measuring_;
+
+    bool hasResult_;
+    bool newResult_;
+    uint64_t resultFrame_;
+    std::vector<float> results_;
+
+    // Reads the results of the oldest frames whose queries have all finished, without waiting
+    void readResults();
+};
\ No newline at end of file
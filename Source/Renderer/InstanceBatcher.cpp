@@ -0,0 +1,186 @@
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+ObjectInstanceData ObjectInstanceData::fromMatrix(const Matrix4x4 &localToWorld)
+{
+    ObjectInstanceData instance;
+    for (int row = 0; row < 3; ++row)
+    {
+        instance.rows[row] = Vector4(localToWorld.get(row, 0), localToWorld.get(row, 1), localToWorld.get(row, 2), localToWorld.get(row, 3));
+    }
+
+    return instance;
+}
+
+InstanceBatcher::InstanceBatcher()
+{
+
+}
+
+void InstanceBatcher::clear()
+{
+    draws_.clear();
+    firstElements_.clear();
+    elementCounts_.clear();
+    batches_.clear();
+    commands_.clear();
+    instances_.clear();
+    instanceMaterialIndices_.clear();
+    materials_.clear();
+    singles_.clear();
+}
+
+void InstanceBatcher::add(Shader* shader, ShaderFeatureList shaderFeatures, const Material* material, const Mesh* mesh, int lod, int firstElement, int elementCount, const Matrix4x4 &localToWorld)
+{
+    RenderQueueItem draw;
+    draw.sortKey = 0;
+    draw.shader = shader;
+    draw.shaderFeatures = shaderFeatures;
+    draw.material = material;
+    draw.mesh = mesh;
+    draw.localToWorld = localToWorld;
+    draw.lod = lod;
+    draw.firstInstance = 0;
+    draw.instanceCount = 0;
+
+    draws_.push_back(draw);
+    firstElements_.push_back(firstElement);
+    elementCounts_.push_back(elementCount);
+}
+
+void InstanceBatcher::build(int minInstances)
+{
+    batches_.clear();
+    commands_.clear();
+    instances_.clear();
+    instanceMaterialIndices_.clear();
+    materials_.clear();
+    singles_.clear();
+
+    // Order the draws so that each command is a contiguous group, and commands that
+    // share a shader variant and mesh are next to each other.
+    order_.resize(draws_.size());
+    for (unsigned int i = 0; i < draws_.size(); ++i)
+    {
+        order_[i] = i;
+    }
+
+    std::stable_sort(order_.begin(), order_.end(), [this](int a, int b)
+    {
+        const RenderQueueItem& drawA = draws_[a];
+        const RenderQueueItem& drawB = draws_[b];
+        if (drawA.shader != drawB.shader) return (uintptr_t)drawA.shader < (uintptr_t)drawB.shader;
+        if (drawA.shaderFeatures != drawB.shaderFeatures) return drawA.shaderFeatures < drawB.shaderFeatures;
+        if (drawA.mesh != drawB.mesh) return (uintptr_t)drawA.mesh < (uintptr_t)drawB.mesh;
+        if (drawA.material != drawB.material) return (uintptr_t)drawA.material < (uintptr_t)drawB.material;
+        return drawA.lod < drawB.lod;
+    });
+
+    // Finds a material in the material table, adding it if needed
+    std::unordered_map<const Material*, uint32_t> materialIndices;
+    auto findMaterial = [this, &materialIndices](const Material* material)
+    {
+        const auto found = materialIndices.find(material);
+        if (found != materialIndices.end())
+        {
+            return found->second;
+        }
+
+        const uint32_t materialIndex = (uint32_t)materials_.size();
+        materialIndices[material] = materialIndex;
+        materials_.push_back(material);
+        return materialIndex;
+    };
+
+    // Turn each group of identical draws into a command
+    unsigned int groupStart = 0;
+    while (groupStart < order_.size())
+    {
+        // Find the end of the group
+        unsigned int groupEnd = groupStart + 1;
+        while (groupEnd < order_.size() && sameCommand(order_[groupStart], order_[groupEnd]))
+        {
+            groupEnd++;
+        }
+
+        const int groupSize = groupEnd - groupStart;
+        const RenderQueueItem& first = draws_[order_[groupStart]];
+        if (groupSize < minInstances)
+        {
+            // Too small to be worth instancing
+            for (unsigned int i = groupStart; i < groupEnd; ++i)
+            {
+                singles_.push_back(order_[i]);
+            }
+        }
+        else
+        {
+            // Find the material in the material table
+            const uint32_t materialIndex = findMaterial(first.material);
+
+            // Add a command drawing every instance in the group
+            DrawIndirectCommand command;
+            command.count = elementCounts_[order_[groupStart]];
+            command.instanceCount = groupSize;
+            command.firstIndex = firstElements_[order_[groupStart]];
+            command.baseVertex = 0;
+            command.baseInstance = (uint32_t)instances_.size();
+
+            for (unsigned int i = groupStart; i < groupEnd; ++i)
+            {
+                instances_.push_back(ObjectInstanceData::fromMatrix(draws_[order_[i]].localToWorld));
+                instanceMaterialIndices_.push_back(materialIndex);
+            }
+
+            // Commands for the same variant and mesh are drawn with a single multi draw call
+            InstanceBatch* previous = batches_.empty() ? nullptr : &batches_.back();
+            if (previous != nullptr && previous->shader == first.shader && previous->shaderFeatures == first.shaderFeatures && previous->mesh == first.mesh)
+            {
+                previous->commandCount++;
+                previous->instanceCount += groupSize;
+            }
+            else
+            {
+                InstanceBatch batch;
+                batch.shader = first.shader;
+                batch.shaderFeatures = first.shaderFeatures;
+                batch.mesh = first.mesh;
+                batch.firstCommand = (int)commands_.size();
+                batch.commandCount = 1;
+                batch.instanceCount = groupSize;
+                batches_.push_back(batch);
+            }
+
+            commands_.push_back(command);
+        }
+
+        groupStart = groupEnd;
+    }
+
+    // Keep the single draws in the order they were added
+    std::sort(singles_.begin(), singles_.end());
+
+    // Single draws are drawn as one instance, so that they read their transform and material
+    // from the instance data like the batches do, and need no per draw data
+    for (int single : singles_)
+    {
+        RenderQueueItem& draw = draws_[single];
+        draw.firstInstance = (int)instances_.size();
+        draw.instanceCount = 1;
+        instances_.push_back(ObjectInstanceData::fromMatrix(draw.localToWorld));
+        instanceMaterialIndices_.push_back(findMaterial(draw.material));
+    }
+}
+
+bool InstanceBatcher::sameCommand(int a, int b) const
+{
+    const RenderQueueItem& drawA = draws_[a];
+    const RenderQueueItem& drawB = draws_[b];
+    return drawA.shader == drawB.shader
+        && drawA.shaderFeatures == drawB.shaderFeatures
+        && drawA.mesh == drawB.mesh
+        && drawA.material == drawB.material
+        && drawA.lod == drawB.lod;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math/Matrix4x4.h"
+#include "Math/Vector4.h"
+#include "Renderer/RenderQueue.h"
+
+// The gpu copy of an instanced object transform.
+// Holds the top 3 rows of the local to world matrix, as the bottom row is always 0 0 0 1.
+// Must match the std430 layout in Standard.shader.
+struct ObjectInstanceData
+{
+    Vector4 rows[3];
+
+    static ObjectInstanceData fromMatrix(const Matrix4x4 &localToWorld);
+};
+
+// A single command for glMultiDrawElementsIndirect.
+// Must match the DrawElementsIndirectCommand layout in the gl spec.
+struct DrawIndirectCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// A run of indirect commands that share a shader variant and mesh, drawn with one multi draw call.
+// Each command draws the instances of one material and level of detail.
+struct InstanceBatch
+{
+    Shader* shader;
+    ShaderFeatureList shaderFeatures;
+    const Mesh* mesh;
+    int firstCommand;
+    int commandCount;
+    int instanceCount;
+};
+
+// Groups draws of the same mesh, material and shader variant into instanced batches.
+// Each instance has a transform and the index of its material in a per-frame material table,
+// so batches of several materials that share a mesh can be drawn with one multi draw call.
+// Groups that are too small to be worth instancing are left as single draws.
+// Does not use the gpu, so can be used and tested headlessly.
+class InstanceBatcher
+{
+public:
+    // The smallest group of identical draws that is instanced
+    const static int DEFAULT_MIN_INSTANCES = 2;
+
+    InstanceBatcher();
+
+    // Removes every draw and batch
+    void clear();
+
+    // Adds a draw of one level of detail of a mesh.
+    // The first element and element count are the range of indices used by the level of detail.
+    void add(Shader* shader, ShaderFeatureList shaderFeatures, const Material* material, const Mesh* mesh, int lod, int firstElement, int elementCount, const Matrix4x4 &localToWorld);
+
+    // Groups the draws into batches.
+    // Groups with fewer than minInstances draws are left in singles() instead.
+    void build(int minInstances = DEFAULT_MIN_INSTANCES);
+
+    // The multi draw batches, and the commands, instances and materials they use.
+    // The instances of the single draws come after the instances of the batches.
+    const std::vector<InstanceBatch>& batches() const { return batches_; }
+    const std::vector<DrawIndirectCommand>& commands() const { return commands_; }
+    const std::vector<ObjectInstanceData>& instances() const { return instances_; }
+    const std::vector<uint32_t>& instanceMaterialIndices() const { return instanceMaterialIndices_; }
+    const std::vector<const Material*>& materials() const { return materials_; }
+
+    // The indices of draws that were not batched, in the order they were added.
+    // Each of these draws one instance, given by its first instance.
+    const std::vector<int>& singles() const { return singles_; }
+
+    // Gets a draw by its index
+    const RenderQueueItem& draw(int index) const { return draws_[index]; }
+
+private:
+    std::vector<RenderQueueItem> draws_;
+    std::vector<int> firstElements_;
+    std::vector<int> elementCounts_;
+
+    std::vector<InstanceBatch> batches_;
+    std::vector<DrawIndirectCommand> commands_;
+    std::vector<ObjectInstanceData> instances_;
+    std::vector<uint32_t> instanceMaterialIndices_;
+    std::vector<const Material*> materials_;
+    std::vector<int> singles_;
+
+    // The draw indices in grouped order, reused between frames
+    std::vector<int> order_;
+
+    // Checks if two draws can share an indirect command
+    bool sameCommand(int a, int b) const;
+};
\ No newline at end of file
@@ -4,13 +4,15 @@
 #include "Utils/ImGuiExtensions.h"
 
 Material::Material()
-    : Resource(NOT_SAVED_RESOURCE)
+    : Resource(NOT_SAVED_RESOURCE),
+    changeCount_(0)
 {
     
 }
 
 Material::Material(ResourceID resourceID)
-    : Resource(resourceID)
+    : Resource(resourceID),
+    changeCount_(0)
 {
     
 }
@@ -22,40 +24,57 @@ void Material::serialize(PropertyTable& table)
     table.serialize("normal_map_texture", normalMapTexture_);
     table.serialize("smoothness", smoothness_, 0.5f);
     table.serialize("cutout", cutout_, false);
+
+    // Reloading replaces every setting
+    if (table.mode() == PropertyTableMode::Reading)
+    {
+        changeCount_++;
+    }
 }
 
 void Material::drawEditor()
 {
-    ImGui::ColorEdit3("Color", &color_.r);
-    ImGui::ResourceSelect("Albedo", "Select Albedo Texture", albedoTexture_);
-    ImGui::ResourceSelect("Normal Map", "Select Normal Map Texture", normalMapTexture_);
-    ImGui::SliderFloat("Smoothness", &smoothness_, 0.0f, 1.0f);
-    ImGui::Checkbox("Cutout", &cutout_);
+    bool changed = false;
+    changed |= ImGui::ColorEdit3("Color", &color_.r);
+    changed |= ImGui::ResourceSelect("Albedo", "Select Albedo Texture", albedoTexture_);
+    changed |= ImGui::ResourceSelect("Normal Map", "Select Normal Map Texture", normalMapTexture_);
+    changed |= ImGui::SliderFloat("Smoothness", &smoothness_, 0.0f, 1.0f);
+    changed |= ImGui::Checkbox("Cutout", &cutout_);
+
+    if (changed)
+    {
+        changeCount_++;
+    }
 }
 
 void Material::setColor(const Color& color)
 {
     color_ = color;
+    changeCount_++;
 }
 
 void Material::setAlbedoTexture(Texture* albedoTexture)
 {
     albedoTexture_ = albedoTexture;
+    changeCount_++;
 }
 
 void Material::setNormalMapTexture(Texture* normalMapTexture)
 {
     normalMapTexture_ = normalMapTexture;
+    changeCount_++;
 }
 
 void Material::setSmoothness(float smoothness)
 {
     smoothness_ = smoothness;
+    changeCount_++;
 }
 
 void Material::setCutout(bool cutout)
 {
     cutout_ = cutout;
+    changeCount_++;
 }
 
 ShaderFeatureList Material::supportedFeatures() const
@@ -36,10 +36,15 @@ public:
     // Computes the set of enabled shader features, based on material settings
     ShaderFeatureList supportedFeatures() const;
 
+    // Counts the changes to the settings, including edits and reloads.
+    // Anything copied from the material, such as its material table entry, checks this.
+    uint32_t changeCount() const { return changeCount_; }
+
 private:
     Color color_;
     Texture* albedoTexture_;
     Texture* normalMapTexture_;
     float smoothness_;
     bool cutout_;
+    uint32_t changeCount_;
 };
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "MaterialTable.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+    // The version of entries that have not been set yet
+    const uint64_t UNSET_VERSION = ~0ull;
+}
+
+MaterialTable::MaterialTable()
+    : dirtyBegin_(0),
+    dirtyEnd_(0),
+    update_(0)
+{
+
+}
+
+uint32_t MaterialTable::add(const Material* material)
+{
+    const auto found = indices_.find(material);
+    if (found != indices_.end())
+    {
+        lastUsed_[found->second] = update_;
+        return found->second;
+    }
+
+    // Reuse a freed entry if there is one
+    uint32_t index;
+    if (!freeIndices_.empty())
+    {
+        index = freeIndices_.back();
+        freeIndices_.pop_back();
+        materials_[index] = material;
+        entries_[index] = MaterialData();
+        versions_[index] = UNSET_VERSION;
+        lastUsed_[index] = update_;
+    }
+    else
+    {
+        index = (uint32_t)materials_.size();
+        materials_.push_back(material);
+        entries_.push_back(MaterialData());
+        versions_.push_back(UNSET_VERSION);
+        lastUsed_.push_back(update_);
+    }
+
+    // New entries are uploaded once their data has been set
+    indices_[material] = index;
+    markDirty(index);
+    return index;
+}
+
+uint32_t MaterialTable::find(const Material* material) const
+{
+    const auto found = indices_.find(material);
+    return (found != indices_.end()) ? found->second : 0;
+}
+
+void MaterialTable::set(uint32_t index, const MaterialData &data)
+{
+    // Compare the bytes, so that padding never hides a change
+    if (memcmp(&entries_[index], &data, sizeof(MaterialData)) != 0)
+    {
+        entries_[index] = data;
+        markDirty(index);
+    }
+}
+
+void MaterialTable::set(uint32_t index, const MaterialData &data, uint64_t version)
+{
+    versions_[index] = version;
+    set(index, data);
+}
+
+int MaterialTable::removeUnused(int updates)
+{
+    int removed = 0;
+    for (uint32_t index = 1; index < materials_.size(); ++index)
+    {
+        if (materials_[index] == nullptr || lastUsed_[index] + updates >= update_)
+        {
+            continue;
+        }
+
+        // Nothing refers to the entry any more, so it does not need uploading until it is reused
+        indices_.erase(materials_[index]);
+        materials_[index] = nullptr;
+        freeIndices_.push_back(index);
+        removed++;
+    }
+
+    return removed;
+}
+
+void MaterialTable::clearDirty()
+{
+    dirtyBegin_ = 0;
+    dirtyEnd_ = 0;
+}
+
+void MaterialTable::markDirty(int index)
+{
+    if (!dirty())
+    {
+        dirtyBegin_ = index;
+        dirtyEnd_ = index + 1;
+    }
+    else
+    {
+        dirtyBegin_ = std::min(dirtyBegin_, index);
+        dirtyEnd_ = std::max(dirtyEnd_, index + 1);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Math/Color.h"
+
+class Material;
+
+// One material in the material table.
+// Must match the std430 layout of MaterialData in Materials.inc.shader.
+struct MaterialData
+{
+    Color colorSmoothness; // rgb = color, a = smoothness
+    uint64_t albedoTexture; // Bindless texture handles, or 0 when the material has no texture
+    uint64_t normalMapTexture;
+};
+
+// A table of every material that has been drawn, kept in a persistent storage buffer.
+// Draws and instances refer to their material by its index in the table, rather than
+// sending the material settings with every draw.
+// Entries are only refreshed when the version of their material changes, and only the range
+// that changed is uploaded. Entries of materials that are no longer drawn are freed and reused.
+// Does not use the gpu, so can be used and tested headlessly.
+class MaterialTable
+{
+public:
+    // The number of updates a material can go without being drawn before its entry is freed
+    const static int MAX_UNUSED_UPDATES = 600;
+
+    MaterialTable();
+
+    // Adds a material to the table, if it is not already in it, and gets its index.
+    // Adding a material also marks it as used in the current update.
+    // Not thread safe, so materials are added before views are recorded.
+    uint32_t add(const Material* material);
+
+    // Gets the index of a material that has already been added.
+    // Materials that were never added use the first material, which is the default material.
+    uint32_t find(const Material* material) const;
+
+    // The materials and their gpu data, in table order.
+    // Freed entries have no material until they are reused.
+    int size() const { return (int)materials_.size(); }
+    const Material* material(int index) const { return materials_[index]; }
+    const std::vector<MaterialData>& entries() const { return entries_; }
+
+    // Sets the gpu data of a material, marking it as changed if it differs from the current data
+    void set(uint32_t index, const MaterialData &data);
+
+    // Checks if an entry needs setting, given a version that changes whenever its material does.
+    // New entries always need setting.
+    bool needsRefresh(uint32_t index, uint64_t version) const { return versions_[index] != version; }
+
+    // Sets the gpu data of a material, and remembers the version it was made from
+    void set(uint32_t index, const MaterialData &data, uint64_t version);
+
+    // Frees the entries of materials that have not been added for more than the given number of updates.
+    // The first entry is the default material, and is never freed. Returns the number of entries freed.
+    int removeUnused(int updates);
+
+    // Starts the next update
+    void nextUpdate() { update_++; }
+
+    // The range of entries that changed since the last upload
+    bool dirty() const { return dirtyEnd_ > dirtyBegin_; }
+    int firstDirty() const { return dirtyBegin_; }
+    int dirtyCount() const { return dirtyEnd_ - dirtyBegin_; }
+    void clearDirty();
+
+private:
+    std::vector<const Material*> materials_;
+    std::vector<MaterialData> entries_;
+    std::unordered_map<const Material*, uint32_t> indices_;
+    int dirtyBegin_;
+    int dirtyEnd_;
+
+    // The version each entry was set from, and the update it was last added in
+    std::vector<uint64_t> versions_;
+    std::vector<uint64_t> lastUsed_;
+    uint64_t update_;
+
+    // Entries that were freed, and can be reused by new materials
+    std::vector<uint32_t> freeIndices_;
+
+    // Adds an entry to the dirty range
+    void markDirty(int index);
+};
\ No newline at end of file
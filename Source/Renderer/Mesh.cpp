@@ -1,19 +1,51 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <math.h>
 #include <memory>
 
+#include "Math/Point2.h"
 #include "Math/Point3.h"
-#include "Math/Vector2.h"
 #include "Math/Vector3.h"
 #include "Math/Vector4.h"
+#include "Renderer/UniformBuffer.h"
+
+MeshBounds MeshBounds::covering(const Point3* positions, int count)
+{
+    MeshBounds bounds;
+    if (count == 0)
+    {
+        bounds.sphereCentre = Point3::origin();
+        bounds.sphereRadius = 0.0f;
+        return bounds;
+    }
+
+    // The sphere is centred on the box, rather than being the smallest possible sphere.
+    // It is only used for quick rejection tests, and is cheap to compute.
+    bounds.box = Bounds::covering(positions, count);
+    bounds.sphereCentre = bounds.box.centre();
+    float sqrRadius = 0.0f;
+    for (int i = 0; i < count; ++i)
+    {
+        sqrRadius = std::max(sqrRadius, Point3::sqrDistance(bounds.sphereCentre, positions[i]));
+    }
+
+    bounds.sphereRadius = sqrtf(sqrRadius);
+    return bounds;
+}
 
 Mesh::Mesh(ResourceID id)
     : Resource(id),
     loaded_(false),
+    loadCount_(0),
     settings_(),
+    bounds_(),
+    layout_(),
     vertexArray_(0),
-    attributeBuffers_(),
-    elementsBuffer_(0)
+    vertexBuffer_(0),
+    elementsBuffer_(0),
+    uniformBuffer_(0),
+    keepOccluderTriangles_(false)
 {
 
 }
@@ -35,104 +67,235 @@ void Mesh::load(std::ifstream& file)
         unload();
     }
 
-    // Read the mesh settings from the file
+    // Read the mesh settings from the file.
+    // Files without the marker were imported before vertices were interleaved, and start with the settings.
+    int marker = 0;
+    file.read((char*)&marker, sizeof(int));
+    const bool interleaved = (marker == FILE_MARKER);
+    if (!interleaved)
+    {
+        file.seekg(-(std::streamoff)sizeof(int), std::ios::cur);
+    }
+
     file.read((char*)&settings_, sizeof(MeshSettings));
 
-    // First, create the vertex array object.
-    glCreateVertexArrays(1, &vertexArray_);
+    // Read the vertices. Older files are packed once the bounds are known, as quantised positions depend on them.
+    std::vector<unsigned char> vertices;
+    std::vector<Point3> positions;
+    std::vector<Vector3> normals;
+    std::vector<Vector4> tangents;
+    std::vector<Point2> texcoords;
+    if (interleaved)
+    {
+        int flags = 0;
+        file.read((char*)&flags, sizeof(int));
+        layout_ = MeshVertexLayout::create(flags, hasNormals(), hasTangents(), hasTexcoords());
+        vertices.resize(vertexBufferSize());
+        file.read((char*)vertices.data(), vertices.size());
+    }
+    else
+    {
+        readSeparateAttributes(file, positions, normals, tangents, texcoords);
+    }
+
+    // Read the elements list, which holds every level of detail.
+    // The indices are 16 bit unless the mesh has too many vertices.
+    const int elementsSize = indexSize() * settings_.elementsCount;
+    std::unique_ptr<char[]> fileElements(new char[elementsSize]);
+    file.read(fileElements.get(), elementsSize);
 
-    // Load the positions attribute buffer.
+    // Read the bounding volumes.
+    // Meshes imported before the bounds were added to the file do not have them, so compute them instead.
+    file.read((char*)&bounds_, sizeof(MeshBounds));
+    if (file.gcount() != sizeof(MeshBounds))
     {
-        // First read in the attribute data
-        const int positionsSize = sizeof(Point3) * vertexCount();
-        std::unique_ptr<Point3[]> positionsData(new Point3[vertexCount()]);
-        file.read((char*)positionsData.get(), positionsSize);
+        bounds_ = MeshBounds::covering(positions.data(), vertexCount());
+    }
 
-        // Create a buffer to hold the data.
-        glCreateBuffers(1, &attributeBuffers_[PositionsBuffer]);      
-        glNamedBufferData(attributeBuffers_[PositionsBuffer], positionsSize, positionsData.get(), GL_STATIC_DRAW);
+    // Read the levels of detail.
+    // Meshes imported before levels of detail were added only have the full detail level.
+    int lodCount = 0;
+    file.read((char*)&lodCount, sizeof(int));
+    if (file.gcount() == sizeof(int) && lodCount > 0)
+    {
+        lods_.resize(lodCount);
+        file.read((char*)lods_.data(), sizeof(MeshLod) * lodCount);
+        if (file.gcount() != (std::streamsize)(sizeof(MeshLod) * lodCount))
+        {
+            lods_.clear();
+        }
+    }
 
-        // Now link the buffer to the vertex array attribute
-        glVertexArrayVertexBuffer(vertexArray_, PositionsBuffer, attributeBuffers_[PositionsBuffer], 0, 3 * sizeof(float));
-        glVertexArrayAttribFormat(vertexArray_, PositionsBuffer, 3, GL_FLOAT, false, 0);
-        glVertexArrayAttribBinding(vertexArray_, PositionsBuffer, PositionsBuffer);
-        glEnableVertexArrayAttrib(vertexArray_, PositionsBuffer);
+    if (lods_.empty())
+    {
+        lods_.push_back(MeshLod { 0, settings_.elementsCount, 0.0f });
     }
 
-    // Load the normals attribute buffer
-    if (hasNormals())
+    // Pack the vertices of older files the same way as the importer now does,
+    // or read the positions back out of the interleaved vertices for the cpu copy of occluders.
+    if (interleaved)
+    {
+        if (keepOccluderTriangles_)
+        {
+            positions.resize(vertexCount());
+            MeshVertexFormat::unpackPositions(layout_, bounds_.box, vertices.data(), vertexCount(), positions.data());
+        }
+    }
+    else
+    {
+        const int flags = MeshVertexFormat::chooseFlags(bounds_.box, texcoords.data(), (int)texcoords.size());
+        layout_ = MeshVertexLayout::create(flags, hasNormals(), hasTangents(), hasTexcoords());
+        vertices = MeshVertexFormat::pack(layout_, bounds_.box, vertexCount(), positions.data(), normals.data(), tangents.data(), texcoords.data());
+    }
+
+    // First, create the vertex array object.
+    glCreateVertexArrays(1, &vertexArray_);
+
+    // Create a buffer to hold the interleaved vertices, and link it to the vertex array
+    glCreateBuffers(1, &vertexBuffer_);
+    glNamedBufferData(vertexBuffer_, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    glVertexArrayVertexBuffer(vertexArray_, 0, vertexBuffer_, 0, layout_.stride);
+
+    // Quantised positions are unorm16 across the bounds, and are moved back into place by the shader
+    if (layout_.quantisedPositions())
     {
-        // First read in the attribute data
-        const int normalsSize = sizeof(Vector3) * vertexCount();
-        std::unique_ptr<Vector3[]> normalsData(new Vector3[vertexCount()]);
-        file.read((char*)normalsData.get(), normalsSize);
+        glVertexArrayAttribFormat(vertexArray_, PositionAttribute, 3, GL_UNSIGNED_SHORT, true, layout_.positionOffset);
+    }
+    else
+    {
+        glVertexArrayAttribFormat(vertexArray_, PositionAttribute, 3, GL_FLOAT, false, layout_.positionOffset);
+    }
 
-        // Create a buffer to hold the data.
-        glCreateBuffers(1, &attributeBuffers_[NormalsBuffer]);
-        glNamedBufferData(attributeBuffers_[NormalsBuffer], normalsSize, normalsData.get(), GL_STATIC_DRAW);
+    glVertexArrayAttribBinding(vertexArray_, PositionAttribute, 0);
+    glEnableVertexArrayAttrib(vertexArray_, PositionAttribute);
 
-        // Now link the buffer to the vertex array attribute
-        glVertexArrayVertexBuffer(vertexArray_, NormalsBuffer, attributeBuffers_[NormalsBuffer], 0, 3 * sizeof(float));
-        glVertexArrayAttribFormat(vertexArray_, NormalsBuffer, 3, GL_FLOAT, false, 0);
-        glVertexArrayAttribBinding(vertexArray_, NormalsBuffer, NormalsBuffer);
-        glEnableVertexArrayAttrib(vertexArray_, NormalsBuffer);
+    // Normals and tangents are octahedral encoded, and are decoded by the shader
+    if (hasNormals())
+    {
+        glVertexArrayAttribFormat(vertexArray_, NormalAttribute, 2, GL_SHORT, true, layout_.normalOffset);
+        glVertexArrayAttribBinding(vertexArray_, NormalAttribute, 0);
+        glEnableVertexArrayAttrib(vertexArray_, NormalAttribute);
     }
 
-    // Load the tangents attribute buffer
     if (hasTangents())
     {
-        // First read in the attribute data
-        const int tangentsSize = sizeof(Vector4) * vertexCount();
-        std::unique_ptr<Vector4[]> tangentsData(new Vector4[vertexCount()]);
-        file.read((char*)tangentsData.get(), tangentsSize);
+        glVertexArrayAttribFormat(vertexArray_, TangentAttribute, 2, GL_SHORT, true, layout_.tangentOffset);
+        glVertexArrayAttribBinding(vertexArray_, TangentAttribute, 0);
+        glEnableVertexArrayAttrib(vertexArray_, TangentAttribute);
+    }
 
-        // Create a buffer to hold the data.
-        glCreateBuffers(1, &attributeBuffers_[TangentsBuffer]);
-        glNamedBufferData(attributeBuffers_[TangentsBuffer], tangentsSize, tangentsData.get(), GL_STATIC_DRAW);
+    if (hasTexcoords())
+    {
+        if (layout_.halfTexcoords())
+        {
+            glVertexArrayAttribFormat(vertexArray_, TexcoordAttribute, 2, GL_HALF_FLOAT, false, layout_.texcoordOffset);
+        }
+        else
+        {
+            glVertexArrayAttribFormat(vertexArray_, TexcoordAttribute, 2, GL_FLOAT, false, layout_.texcoordOffset);
+        }
 
-        // Now link the buffer to the vertex array attribute
-        glVertexArrayVertexBuffer(vertexArray_, TangentsBuffer, attributeBuffers_[TangentsBuffer], 0, 4 * sizeof(float));
-        glVertexArrayAttribFormat(vertexArray_, TangentsBuffer, 4, GL_FLOAT, false, 0);
-        glVertexArrayAttribBinding(vertexArray_, TangentsBuffer, TangentsBuffer);
-        glEnableVertexArrayAttrib(vertexArray_, TangentsBuffer);
+        glVertexArrayAttribBinding(vertexArray_, TexcoordAttribute, 0);
+        glEnableVertexArrayAttrib(vertexArray_, TexcoordAttribute);
     }
 
-    // Load the texcoords attribute buffer
-    if (hasTexcoords())
+    // Create a buffer to hold the elements, and attach it to the vertex array.
+    glCreateBuffers(1, &elementsBuffer_);
+    glNamedBufferData(elementsBuffer_, elementsSize, fileElements.get(), GL_STATIC_DRAW);
+    glVertexArrayElementBuffer(vertexArray_, elementsBuffer_);
+
+    // Create the mesh uniform buffer, which holds the transform from stored positions to mesh space
+    MeshUniformData uniformData;
+    Vector3 positionOffset, positionScale;
+    MeshVertexFormat::positionTransform(layout_, bounds_.box, positionOffset, positionScale);
+    uniformData.positionOffset = Vector4(positionOffset.x, positionOffset.y, positionOffset.z, 0.0f);
+    uniformData.positionScale = Vector4(positionScale.x, positionScale.y, positionScale.z, 0.0f);
+    glCreateBuffers(1, &uniformBuffer_);
+    glNamedBufferData(uniformBuffer_, sizeof(MeshUniformData), &uniformData, GL_STATIC_DRAW);
+
+    // Keep a copy of the full detail triangles for meshes that are used as occluders.
+    // Simplified levels may bulge outside the real surface, so are not conservative enough.
+    // Other meshes let the copies go now they are on the gpu.
+    if (keepOccluderTriangles_)
     {
-        // First read in the attribute data
-        const int texcoordsSize = sizeof(Vector2) * vertexCount();
-        std::unique_ptr<Vector2[]> texcoordsData(new Vector2[vertexCount()]);
-        file.read((char*)texcoordsData.get(), texcoordsSize);
+        occluderPositions_.swap(positions);
+        const MeshLod& fullDetail = lods_[0];
+        if (indexType() == GL_UNSIGNED_INT)
+        {
+            const uint32_t* wideElements = (const uint32_t*)fileElements.get() + fullDetail.firstElement;
+            occluderIndices_.assign(wideElements, wideElements + fullDetail.elementsCount);
+        }
+        else
+        {
+            const uint16_t* shortElements = (const uint16_t*)fileElements.get() + fullDetail.firstElement;
+            occluderIndices_.assign(shortElements, shortElements + fullDetail.elementsCount);
+        }
+    }
 
-        // Create a buffer to hold the data.
-        glCreateBuffers(1, &attributeBuffers_[TexcoordsBuffer]);
-        glNamedBufferData(attributeBuffers_[TexcoordsBuffer], texcoordsSize, texcoordsData.get(), GL_STATIC_DRAW);
+    // Now loaded
+    loaded_ = true;
+    loadCount_++;
+}
 
-        // Now link the buffer to the vertex array attribute
-        glVertexArrayVertexBuffer(vertexArray_, TexcoordsBuffer, attributeBuffers_[TexcoordsBuffer], 0, 2 * sizeof(float));
-        glVertexArrayAttribFormat(vertexArray_, TexcoordsBuffer, 2, GL_FLOAT, false, 0);
-        glVertexArrayAttribBinding(vertexArray_, TexcoordsBuffer, TexcoordsBuffer);
-        glEnableVertexArrayAttrib(vertexArray_, TexcoordsBuffer);
+void Mesh::keepOccluderTriangles()
+{
+    // Meshes that already keep the triangles do so again whenever they are reloaded
+    if (keepOccluderTriangles_)
+    {
+        return;
     }
 
-    // Load the elements buffer
+    keepOccluderTriangles_ = true;
+    if (!loaded_)
     {
-        // Read in the elements list
-        const int elementsSize = sizeof(MeshElementIndex) * elementsCount();
-        std::unique_ptr<MeshElementIndex[]> elementsData(new MeshElementIndex[elementsCount()]);
-        file.read((char*)elementsData.get(), elementsSize);
+        return;
+    }
 
-        // Create a buffer to hold the elements
-        glCreateBuffers(1, &elementsBuffer_);
-        glNamedBufferData(elementsBuffer_, elementsSize, elementsData.get(), GL_STATIC_DRAW);
+    // The mesh was loaded before it was used as an occluder, and has freed its cpu copy.
+    // Read the vertices back from the gpu and unpack the positions.
+    std::vector<unsigned char> vertices(vertexBufferSize());
+    glGetNamedBufferSubData(vertexBuffer_, 0, vertices.size(), vertices.data());
+    occluderPositions_.resize(vertexCount());
+    MeshVertexFormat::unpackPositions(layout_, bounds_.box, vertices.data(), vertexCount(), occluderPositions_.data());
 
-        // Now attack the elements buffer to the vertex array.
-        glVertexArrayElementBuffer(vertexArray_, elementsBuffer_);
+    // Read back the full detail elements, widening 16 bit indices
+    const MeshLod& fullDetail = lods_[0];
+    occluderIndices_.resize(fullDetail.elementsCount);
+    if (indexType() == GL_UNSIGNED_INT)
+    {
+        glGetNamedBufferSubData(elementsBuffer_, fullDetail.firstElement * indexSize(), fullDetail.elementsCount * indexSize(), occluderIndices_.data());
+    }
+    else
+    {
+        std::vector<uint16_t> shortElements(fullDetail.elementsCount);
+        glGetNamedBufferSubData(elementsBuffer_, fullDetail.firstElement * indexSize(), fullDetail.elementsCount * indexSize(), shortElements.data());
+        std::copy(shortElements.begin(), shortElements.end(), occluderIndices_.begin());
     }
+}
 
-    // Now loaded
-    loaded_ = true;
+void Mesh::readSeparateAttributes(std::ifstream &file, std::vector<Point3> &positions, std::vector<Vector3> &normals,
+    std::vector<Vector4> &tangents, std::vector<Point2> &texcoords) const
+{
+    positions.resize(vertexCount());
+    file.read((char*)positions.data(), sizeof(Point3) * vertexCount());
+
+    if (hasNormals())
+    {
+        normals.resize(vertexCount());
+        file.read((char*)normals.data(), sizeof(Vector3) * vertexCount());
+    }
+
+    if (hasTangents())
+    {
+        tangents.resize(vertexCount());
+        file.read((char*)tangents.data(), sizeof(Vector4) * vertexCount());
+    }
+
+    if (hasTexcoords())
+    {
+        texcoords.resize(vertexCount());
+        file.read((char*)texcoords.data(), sizeof(Point2) * vertexCount());
+    }
 }
 
 void Mesh::unload()
@@ -146,14 +309,15 @@ void Mesh::unload()
     // Delete the vertex array object
     glDeleteVertexArrays(1, &vertexArray_);
 
-    // Delete all vertex attribute buffers that were in use
-    glDeleteBuffers(1, &attributeBuffers_[PositionsBuffer]);
-    if (hasNormals()) glDeleteBuffers(1, &attributeBuffers_[NormalsBuffer]);
-    if (hasTangents()) glDeleteBuffers(1, &attributeBuffers_[TangentsBuffer]);
-    if (hasTexcoords()) glDeleteBuffers(1, &attributeBuffers_[TexcoordsBuffer]);
-
-    // Delete the elements buffer
+    // Delete the vertex, elements and uniform buffers
+    glDeleteBuffers(1, &vertexBuffer_);
     glDeleteBuffers(1, &elementsBuffer_);
+    glDeleteBuffers(1, &uniformBuffer_);
+
+    // Free the cpu copy of the triangles and the levels of detail
+    std::vector<Point3>().swap(occluderPositions_);
+    std::vector<uint32_t>().swap(occluderIndices_);
+    lods_.clear();
 
     // Now unloaded
     loaded_ = false;
@@ -163,4 +327,5 @@ void Mesh::bind() const
 {
     glBindVertexArray(vertexArray_);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementsBuffer_);
+    glBindBufferBase(GL_UNIFORM_BUFFER, (GLuint)UniformBufferType::MeshBuffer, uniformBuffer_);
 }
\ No newline at end of file
@@ -4,28 +4,60 @@
 
 #include <GL/gl3w.h>
 
+#include <cstdint>
+#include <vector>
+
+#include "Math/Bounds.h"
+#include "Math/Point3.h"
+#include "Renderer/MeshLod.h"
+#include "Renderer/MeshVertexFormat.h"
+
 struct MeshSettings
 {
 	int vertexCount;
-	int elementsCount;
+	int elementsCount; // The total over every level of detail
 	bool hasNormals;
 	bool hasTangents;
 	bool hasTexcoords;
 };
 
-typedef unsigned short MeshElementIndex;
+// Element indices are 32 bit while importing and on the cpu.
+// Meshes with few enough vertices store them as 16 bit in the file and on the gpu.
+typedef uint32_t MeshElementIndex;
+
+// The bounding volumes of a mesh, in mesh space.
+// These are stored after the elements in the binary mesh file, followed by
+// the number of levels of detail and a MeshLod for each level.
+// Binary mesh files start with FILE_MARKER, the settings and the MeshVertexLayout flags,
+// followed by the interleaved vertices and the elements.
+struct MeshBounds
+{
+    Bounds box;
+    Point3 sphereCentre;
+    float sphereRadius;
+
+    // Computes the bounding volumes of a set of vertex positions
+    static MeshBounds covering(const Point3* positions, int count);
+};
 
 class Mesh : public Resource
 {
 private:
-    // Vertex attribute buffers
-    const static int PositionsBuffer = 0;
-    const static int NormalsBuffer = 1;
-    const static int TangentsBuffer = 2;
-    const static int TexcoordsBuffer = 3;
-    const static int AttributeBufferCount = 4; // Must keep up to date.
+    // Vertex attribute locations, which all read from the one interleaved vertex buffer
+    const static int PositionAttribute = 0;
+    const static int NormalAttribute = 1;
+    const static int TangentAttribute = 2;
+    const static int TexcoordAttribute = 3;
 
 public:
+    // Marks binary mesh files with interleaved vertices.
+    // Older files start with the vertex count and store each attribute as separate float arrays.
+    const static int FILE_MARKER = 0x3248534d; // "MSH2"
+
+    // Meshes with more vertices than this need 32 bit element indices
+    const static int MAX_SHORT_INDEX_VERTICES = 65536;
+    static bool needsWideIndices(int vertexCount) { return vertexCount > MAX_SHORT_INDEX_VERTICES; }
+
     explicit Mesh(ResourceID id);
     ~Mesh();
 
@@ -35,18 +67,65 @@ public:
 
     // Basic mesh information
     int vertexCount() const { return settings_.vertexCount; }
-    int elementsCount() const { return settings_.elementsCount; }
+    int elementsCount() const { return lods_.empty() ? 0 : lods_[0].elementsCount; }
     bool hasNormals() const { return settings_.hasNormals; }
     bool hasTangents() const { return settings_.hasTangents; }
     bool hasTexcoords() const { return settings_.hasTexcoords; }
 
-    // Attaches the vbo and elements buffer for use.
+    // The type and size of the indices in the elements buffer
+    GLenum indexType() const { return needsWideIndices(vertexCount()) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT; }
+    int indexSize() const { return needsWideIndices(vertexCount()) ? sizeof(uint32_t) : sizeof(uint16_t); }
+
+    // The byte offset of an element in the elements buffer, to pass as the indices of a draw call
+    const void* elementOffset(int element) const { return (const void*)(uintptr_t)(element * indexSize()); }
+
+    // The bounding box and sphere of the mesh, in mesh space.
+    const MeshBounds& bounds() const { return bounds_; }
+
+    // The levels of detail, from the full detail mesh down.
+    // Every mesh has at least one level.
+    int lodCount() const { return (int)lods_.size(); }
+    const MeshLod& lod(int index) const { return lods_[index]; }
+    const std::vector<MeshLod>& lods() const { return lods_; }
+
+    // How the vertices are laid out in the vertex buffer
+    const MeshVertexLayout& vertexLayout() const { return layout_; }
+
+    // The size of the vertex buffer, in bytes
+    int vertexBufferSize() const { return layout_.stride * vertexCount(); }
+
+    // Attaches the vbo, elements buffer and the mesh uniform buffer for use.
     void bind() const;
 
+    // Counts the times the mesh has been loaded.
+    // Hot reloading replaces the mesh data in place, so anything cached from it checks this.
+    uint32_t loadCount() const { return loadCount_; }
+
+    // Keeps the full detail triangles on the cpu for software occlusion culling.
+    // Only meshes used as occluders need them, so other meshes free them once they are uploaded.
+    // Meshes that are already loaded read them back from the gpu, which only happens once.
+    void keepOccluderTriangles();
+
+    // The vertex positions and full detail triangle indices, if the mesh keeps them.
+    const std::vector<Point3>& occluderPositions() const { return occluderPositions_; }
+    const std::vector<uint32_t>& occluderIndices() const { return occluderIndices_; }
+
 private:
     bool loaded_;
+    uint32_t loadCount_;
     MeshSettings settings_;
+    MeshBounds bounds_;
+    std::vector<MeshLod> lods_;
+    MeshVertexLayout layout_;
     GLuint vertexArray_;
-    GLuint attributeBuffers_[AttributeBufferCount];
+    GLuint vertexBuffer_;
     GLuint elementsBuffer_;
+    GLuint uniformBuffer_;
+    bool keepOccluderTriangles_;
+    std::vector<Point3> occluderPositions_;
+    std::vector<uint32_t> occluderIndices_;
+
+    // Reads the separate float attribute arrays of older mesh files
+    void readSeparateAttributes(std::ifstream &file, std::vector<Point3> &positions, std::vector<Vector3> &normals,
+        std::vector<Vector4> &tangents, std::vector<Point2> &texcoords) const;
 };
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <math.h>
+
+float MeshLod::projectedRadius(float radius, float distance, float pixelsPerUnit)
+{
+    // Cameras inside the sphere see it fill the screen
+    return radius * pixelsPerUnit / std::max(distance, radius);
+}
+
+int MeshLod::select(const MeshLod* lods, int lodCount, float projectedRadius, float bias, float errorPixels)
+{
+    // Errors only grow with each level, so stop at the first level that is too coarse
+    const float threshold = errorPixels * powf(2.0f, bias);
+    int selected = 0;
+    for (int i = 1; i < lodCount; ++i)
+    {
+        if (lods[i].error * projectedRadius > threshold)
+        {
+            break;
+        }
+
+        selected = i;
+    }
+
+    return selected;
+}
\ No newline at end of file
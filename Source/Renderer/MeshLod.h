@@ -0,0 +1,26 @@
+#pragma once
+
+// The default number of pixels the surface of a level of detail may move on screen
+// before a more detailed level is used.
+const float DEFAULT_LOD_ERROR_PIXELS = 1.0f;
+
+// One level of detail of a mesh.
+// Every level shares the vertices of the mesh, and draws its own range of the elements buffer.
+struct MeshLod
+{
+    int firstElement;
+    int elementsCount;
+
+    // The furthest the simplified surface is from the full detail surface,
+    // as a fraction of the radius of the mesh bounding sphere.
+    float error;
+
+    // Gets the radius of a sphere on screen, in pixels.
+    // pixelsPerUnit is the size on screen of one unit at a distance of one unit from the camera.
+    static float projectedRadius(float radius, float distance, float pixelsPerUnit);
+
+    // Picks the coarsest level whose error on screen is within the error threshold.
+    // The threshold is doubled for each step of bias, so positive biases pick coarser levels.
+    // Levels are ordered from the most to the least detailed.
+    static int select(const MeshLod* lods, int lodCount, float projectedRadius, float bias, float errorPixels = DEFAULT_LOD_ERROR_PIXELS);
+};
\ No newline at end of file
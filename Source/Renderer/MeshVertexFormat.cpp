@@ -0,0 +1,308 @@
+#include "MeshVertexFormat.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+const float MeshVertexFormat::MAX_POSITION_STEP = 0.0005f;
+const float MeshVertexFormat::MAX_HALF_TEXCOORD = 2.0f;
+
+MeshVertexLayout MeshVertexLayout::create(int flags, bool hasNormals, bool hasTangents, bool hasTexcoords)
+{
+    MeshVertexLayout layout;
+    layout.flags = flags;
+
+    // Quantised positions are padded to four components to keep every attribute 4 byte aligned
+    int offset = 0;
+    layout.positionOffset = offset;
+    offset += layout.quantisedPositions() ? 4 * sizeof(uint16_t) : 3 * sizeof(float);
+
+    layout.normalOffset = hasNormals ? offset : -1;
+    offset += hasNormals ? 2 * sizeof(int16_t) : 0;
+
+    layout.tangentOffset = hasTangents ? offset : -1;
+    offset += hasTangents ? 2 * sizeof(int16_t) : 0;
+
+    layout.texcoordOffset = hasTexcoords ? offset : -1;
+    offset += hasTexcoords ? (layout.halfTexcoords() ? 2 * sizeof(uint16_t) : 2 * sizeof(float)) : 0;
+
+    layout.stride = offset;
+    return layout;
+}
+
+int MeshVertexFormat::chooseFlags(const Bounds &box, const Point2* texcoords, int texcoordCount)
+{
+    int flags = 0;
+
+    // Only quantise positions when the steps across the largest axis are too small to see
+    const Vector3 size = box.size();
+    const float largestAxis = std::max(size.x, std::max(size.y, size.z));
+    if (largestAxis / 65535.0f <= MAX_POSITION_STEP)
+    {
+        flags |= MeshVertexLayout::QuantisedPositionsFlag;
+    }
+
+    // Half floats lose precision quickly above 1, which shows up on tiled textures
+    bool texcoordsInRange = true;
+    for (int i = 0; i < texcoordCount && texcoordsInRange; ++i)
+    {
+        texcoordsInRange = fabsf(texcoords[i].x) <= MAX_HALF_TEXCOORD && fabsf(texcoords[i].y) <= MAX_HALF_TEXCOORD;
+    }
+
+    if (texcoordsInRange)
+    {
+        flags |= MeshVertexLayout::HalfTexcoordsFlag;
+    }
+
+    return flags;
+}
+
+int16_t MeshVertexFormat::toSnorm16(float value)
+{
+    value = std::min(std::max(value, -1.0f), 1.0f);
+    return (int16_t)(value * 32767.0f + (value < 0.0f ? -0.5f : 0.5f));
+}
+
+float MeshVertexFormat::fromSnorm16(int16_t value)
+{
+    // Both -32768 and -32767 are -1
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+uint16_t MeshVertexFormat::toUnorm16(float value)
+{
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return (uint16_t)(value * 65535.0f + 0.5f);
+}
+
+float MeshVertexFormat::fromUnorm16(uint16_t value)
+{
+    return value / 65535.0f;
+}
+
+uint16_t MeshVertexFormat::toHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    const int floatExponent = (int)((bits >> 23) & 0xff);
+    const int exponent = floatExponent - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // Infinities and nans keep their type
+    if (floatExponent == 0xff)
+    {
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+    }
+
+    // Values too large for a half become infinite
+    if (exponent >= 31)
+    {
+        return sign | 0x7c00;
+    }
+
+    // Values too small for a normal half become denormal, or zero
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return sign;
+        }
+
+        mantissa |= 0x800000;
+        const int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+        {
+            ++half;
+        }
+
+        return sign | (uint16_t)half;
+    }
+
+    // Round to the nearest half. A carry out of the mantissa correctly moves up to the next exponent.
+    uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+    {
+        ++half;
+    }
+
+    return sign | (uint16_t)half;
+}
+
+float MeshVertexFormat::fromHalf(uint16_t value)
+{
+    const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1f;
+    const uint32_t mantissa = value & 0x3ff;
+
+    // Denormals have no implicit leading one
+    if (exponent == 0)
+    {
+        const float magnitude = mantissa / 16777216.0f;
+        return sign != 0 ? -magnitude : magnitude;
+    }
+
+    uint32_t bits;
+    if (exponent == 31)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+void MeshVertexFormat::encodeOctahedral(const Vector3 &direction, int16_t &x, int16_t &y)
+{
+    // Project onto the octahedron. Zero length directions are stored as straight up the z axis.
+    const float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+    if (length <= 0.0f)
+    {
+        x = 0;
+        y = 0;
+        return;
+    }
+
+    float u = direction.x / length;
+    float v = direction.y / length;
+
+    // Fold the lower half of the octahedron over the upper half
+    if (direction.z < 0.0f)
+    {
+        const float foldedU = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        const float foldedV = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = foldedU;
+        v = foldedV;
+    }
+
+    x = toSnorm16(u);
+    y = toSnorm16(v);
+}
+
+Vector3 MeshVertexFormat::decodeOctahedral(int16_t x, int16_t y)
+{
+    const float u = fromSnorm16(x);
+    const float v = fromSnorm16(y);
+    Vector3 direction(u, v, 1.0f - fabsf(u) - fabsf(v));
+
+    // Unfold the lower half of the octahedron
+    if (direction.z < 0.0f)
+    {
+        direction.x = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        direction.y = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    return direction.normalized();
+}
+
+void MeshVertexFormat::positionTransform(const MeshVertexLayout &layout, const Bounds &box, Vector3 &offset, Vector3 &scale)
+{
+    if (layout.quantisedPositions())
+    {
+        const Point3 min = box.min();
+        offset = Vector3(min.x, min.y, min.z);
+        scale = box.size();
+    }
+    else
+    {
+        offset = Vector3(0.0f, 0.0f, 0.0f);
+        scale = Vector3(1.0f, 1.0f, 1.0f);
+    }
+}
+
+std::vector<unsigned char> MeshVertexFormat::pack(const MeshVertexLayout &layout, const Bounds &box, int vertexCount,
+    const Point3* positions, const Vector3* normals, const Vector4* tangents, const Point2* texcoords)
+{
+    std::vector<unsigned char> vertices(layout.stride * vertexCount, 0);
+
+    // Quantised positions are stored as fractions of the way across the bounding box
+    const Point3 min = box.min();
+    const Vector3 size = box.size();
+    const Vector3 inverseSize(size.x > 0.0f ? 1.0f / size.x : 0.0f, size.y > 0.0f ? 1.0f / size.y : 0.0f, size.z > 0.0f ? 1.0f / size.z : 0.0f);
+
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        unsigned char* vertex = &vertices[layout.stride * i];
+
+        if (layout.quantisedPositions())
+        {
+            const uint16_t position[4] =
+            {
+                toUnorm16((positions[i].x - min.x) * inverseSize.x),
+                toUnorm16((positions[i].y - min.y) * inverseSize.y),
+                toUnorm16((positions[i].z - min.z) * inverseSize.z),
+                0
+            };
+            memcpy(vertex + layout.positionOffset, position, sizeof(position));
+        }
+        else
+        {
+            const float position[3] = { positions[i].x, positions[i].y, positions[i].z };
+            memcpy(vertex + layout.positionOffset, position, sizeof(position));
+        }
+
+        if (layout.normalOffset >= 0)
+        {
+            int16_t normal[2];
+            encodeOctahedral(normals[i], normal[0], normal[1]);
+            memcpy(vertex + layout.normalOffset, normal, sizeof(normal));
+        }
+
+        // Every shader builds the bitangent from the normal and tangent, so the handedness in w is dropped
+        if (layout.tangentOffset >= 0)
+        {
+            int16_t tangent[2];
+            encodeOctahedral(Vector3(tangents[i].x, tangents[i].y, tangents[i].z), tangent[0], tangent[1]);
+            memcpy(vertex + layout.tangentOffset, tangent, sizeof(tangent));
+        }
+
+        if (layout.texcoordOffset >= 0)
+        {
+            if (layout.halfTexcoords())
+            {
+                const uint16_t texcoord[2] = { toHalf(texcoords[i].x), toHalf(texcoords[i].y) };
+                memcpy(vertex + layout.texcoordOffset, texcoord, sizeof(texcoord));
+            }
+            else
+            {
+                const float texcoord[2] = { texcoords[i].x, texcoords[i].y };
+                memcpy(vertex + layout.texcoordOffset, texcoord, sizeof(texcoord));
+            }
+        }
+    }
+
+    return vertices;
+}
+
+void MeshVertexFormat::unpackPositions(const MeshVertexLayout &layout, const Bounds &box, const unsigned char* vertices,
+    int vertexCount, Point3* positions)
+{
+    Vector3 offset, scale;
+    positionTransform(layout, box, offset, scale);
+
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        const unsigned char* vertex = vertices + layout.stride * i + layout.positionOffset;
+        if (layout.quantisedPositions())
+        {
+            uint16_t position[3];
+            memcpy(position, vertex, sizeof(position));
+            positions[i] = Point3(offset.x + fromUnorm16(position[0]) * scale.x,
+                offset.y + fromUnorm16(position[1]) * scale.y,
+                offset.z + fromUnorm16(position[2]) * scale.z);
+        }
+        else
+        {
+            float position[3];
+            memcpy(position, vertex, sizeof(position));
+            positions[i] = Point3(position[0], position[1], position[2]);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math/Bounds.h"
+#include "Math/Point2.h"
+#include "Math/Point3.h"
+#include "Math/Vector3.h"
+#include "Math/Vector4.h"
+
+// Where each attribute is in one vertex of a mesh's interleaved vertex buffer.
+// Positions are floats, or unorm16 across the mesh bounding box when quantised.
+// Normals and tangents are unit vectors stored as two snorm16 octahedral coordinates.
+// Texcoords are half floats, unless they are too large to keep enough precision.
+struct MeshVertexLayout
+{
+    // Stored in the binary mesh file as a set of flags
+    const static int QuantisedPositionsFlag = 1;
+    const static int HalfTexcoordsFlag = 2;
+
+    int flags;
+    int stride;
+
+    // The byte offset of each attribute in a vertex, or -1 if the mesh does not have it
+    int positionOffset;
+    int normalOffset;
+    int tangentOffset;
+    int texcoordOffset;
+
+    bool quantisedPositions() const { return (flags & QuantisedPositionsFlag) != 0; }
+    bool halfTexcoords() const { return (flags & HalfTexcoordsFlag) != 0; }
+
+    // Builds the layout for a mesh with the given flags and attributes
+    static MeshVertexLayout create(int flags, bool hasNormals, bool hasTangents, bool hasTexcoords);
+};
+
+// Packs and unpacks the interleaved, quantised vertices of a mesh.
+// This does not use the gpu, so the importer and loader share it.
+class MeshVertexFormat
+{
+public:
+    // Positions are only quantised when each step is no longer than this, in mesh units
+    static const float MAX_POSITION_STEP;
+
+    // Texcoords are only stored as half floats when every component is within this range
+    static const float MAX_HALF_TEXCOORD;
+
+    // Picks the flags for a mesh, quantising wherever it loses no visible precision
+    static int chooseFlags(const Bounds &box, const Point2* texcoords, int texcoordCount);
+
+    // Converts between floats and normalized integers or half floats
+    static int16_t toSnorm16(float value);
+    static float fromSnorm16(int16_t value);
+    static uint16_t toUnorm16(float value);
+    static float fromUnorm16(uint16_t value);
+    static uint16_t toHalf(float value);
+    static float fromHalf(uint16_t value);
+
+    // Encodes a direction as two snorm16 octahedral coordinates, and decodes it again.
+    // Decoding must match meshDirection in MeshVertex.inc.shader.
+    static void encodeOctahedral(const Vector3 &direction, int16_t &x, int16_t &y);
+    static Vector3 decodeOctahedral(int16_t x, int16_t y);
+
+    // The offset and scale that turn quantised positions in 0..1 back into mesh space.
+    // Float positions use an offset of 0 and a scale of 1, so shaders always apply them.
+    static void positionTransform(const MeshVertexLayout &layout, const Bounds &box, Vector3 &offset, Vector3 &scale);
+
+    // Interleaves and quantises separate attribute arrays into a vertex buffer.
+    // Attributes the layout does not have may be null. Tangent handedness is not stored.
+    static std::vector<unsigned char> pack(const MeshVertexLayout &layout, const Bounds &box, int vertexCount,
+        const Point3* positions, const Vector3* normals, const Vector4* tangents, const Point2* texcoords);
+
+    // Reads the positions back out of an interleaved vertex buffer
+    static void unpackPositions(const MeshVertexLayout &layout, const Bounds &box, const unsigned char* vertices,
+        int vertexCount, Point3* positions);
+};
\ No newline at end of file
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <vector>
+
+#include "Renderer/RenderDevice.h"
+
+// A render device that makes no graphics api calls, for running and measuring the renderer on the cpu.
+// Every executed command is recorded, without its data, so tests can check the command stream.
+// Recorded resources are the pointers that were recorded, and must not be dereferenced.
+class NullRenderDevice : public RenderDevice
+{
+public:
+    NullRenderDevice()
+        : recording_(true)
+    {
+
+    }
+
+    // The commands executed since the last clear, in order
+    const std::vector<RenderCommand>& executed() const { return executed_; }
+    void clear() { executed_.clear(); }
+
+    // Turns recording off, so benchmarks only measure the cost of submitting and counting
+    void setRecording(bool recording) { recording_ = recording; }
+
+protected:
+    void bindShader(Shader* shader, ShaderFeatureList shaderFeatures) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::BindShader;
+        command.shader = shader;
+        command.shaderFeatures = shaderFeatures;
+        record(command);
+    }
+
+    void bindMesh(const Mesh* mesh) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::BindMesh;
+        command.mesh = mesh;
+        record(command);
+    }
+
+    void bindTexture(int slot, const Texture* texture) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::BindTexture;
+        command.binding = slot;
+        command.texture = texture;
+        record(command);
+    }
+
+    void bindArrayTexture(int slot, const ArrayTexture* texture) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::BindArrayTexture;
+        command.binding = slot;
+        command.arrayTexture = texture;
+        record(command);
+    }
+
+    void bindStorageBuffer(const StorageBufferBase* storageBuffer) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::BindStorageBuffer;
+        command.storageBuffer = storageBuffer;
+        record(command);
+    }
+
+    void setState(const RenderState &state) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::SetState;
+        command.state = state;
+        record(command);
+    }
+
+    void clearDepth() override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::ClearDepth;
+        record(command);
+    }
+
+    void setWireframe(bool wireframe) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::SetWireframe;
+        command.wireframe = wireframe;
+        record(command);
+    }
+
+    void bindFramebuffer(const Framebuffer* framebuffer) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::BindFramebuffer;
+        command.framebuffer = framebuffer;
+        record(command);
+    }
+
+    void bindFramebufferDepth(int slot, const Framebuffer* framebuffer) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::BindFramebufferDepth;
+        command.binding = slot;
+        command.framebuffer = framebuffer;
+        record(command);
+    }
+
+    void clearColor(const Color &color) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::ClearColor;
+        command.color = color;
+        record(command);
+    }
+
+    void blitFramebuffer(const Framebuffer* source, const Framebuffer* destination, int sourceWidth, int sourceHeight) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::BlitFramebuffer;
+        command.framebuffer = source;
+        command.destination = destination;
+        command.sourceWidth = sourceWidth;
+        command.sourceHeight = sourceHeight;
+        record(command);
+    }
+
+    void uniformData(int binding, const void* data, uint32_t size) override
+    {
+        recordData(RenderCommandType::UniformData, binding, size);
+    }
+
+    void storageData(int binding, const void* data, uint32_t size) override
+    {
+        recordData(RenderCommandType::StorageData, binding, size);
+    }
+
+    void indirectData(const void* data, uint32_t size) override
+    {
+        recordData(RenderCommandType::IndirectData, 0, size);
+    }
+
+    void draw(RenderPrimitive primitive, int elementCount, int firstElement, int firstInstance, int instanceCount) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::Draw;
+        command.primitive = primitive;
+        command.elementCount = elementCount;
+        command.firstElement = firstElement;
+        command.firstInstance = firstInstance;
+        command.instanceCount = instanceCount;
+        record(command);
+    }
+
+    void multiDrawIndirect(int firstIndirectCommand, int indirectCommandCount) override
+    {
+        RenderCommand command = {};
+        command.type = RenderCommandType::MultiDrawIndirect;
+        command.firstIndirectCommand = firstIndirectCommand;
+        command.indirectCommandCount = indirectCommandCount;
+        record(command);
+    }
+
+private:
+    bool recording_;
+    std::vector<RenderCommand> executed_;
+
+    void record(const RenderCommand &command)
+    {
+        if (recording_)
+        {
+            executed_.push_back(command);
+        }
+    }
+
+    void recordData(RenderCommandType type, int binding, uint32_t size)
+    {
+        RenderCommand command = {};
+        command.type = type;
+        command.binding = binding;
+        command.dataSize = size;
+        record(command);
+    }
+};
\ No newline at end of file
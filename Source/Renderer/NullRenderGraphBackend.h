@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Renderer/RenderGraph.h"
+
+// A render graph backend that creates no gpu resources, for compiling and running graphs on the cpu.
+// Each acquired texture is a unique placeholder pointer, which must not be dereferenced.
+class NullRenderGraphBackend : public RenderGraphBackend
+{
+public:
+    NullRenderGraphBackend()
+        : acquired_(0),
+        released_(0)
+    {
+
+    }
+
+    Texture* acquireTexture(const RenderGraphTextureDesc &desc) override
+    {
+        acquired_++;
+        return (Texture*)(uintptr_t)(acquired_ * 16);
+    }
+
+    void releaseTexture(Texture* texture) override
+    {
+        released_++;
+    }
+
+    // The number of textures acquired and released so far
+    int acquiredCount() const { return acquired_; }
+    int releasedCount() const { return released_; }
+
+private:
+    int acquired_;
+    int released_;
+};
\ No newline at end of file
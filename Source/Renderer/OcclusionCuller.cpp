@@ -0,0 +1,290 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <math.h>
+#include <xmmintrin.h>
+
+#include "Math/Vector4.h"
+#include "Utils/WorkerPool.h"
+
+namespace
+{
+    // Vertices closer to the camera plane than this cannot be projected safely
+    const float MIN_CLIP_W = 1e-5f;
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : tilesX_((width + TILE_SIZE - 1) / TILE_SIZE),
+    tilesY_((height + TILE_SIZE - 1) / TILE_SIZE),
+    worldToClip_(Matrix4x4::identity())
+{
+    // Round the buffer up to whole tiles, so rows of four pixels never cross the edge
+    width_ = tilesX_ * TILE_SIZE;
+    height_ = tilesY_ * TILE_SIZE;
+    depth_.assign(width_ * height_, FLT_MAX);
+    tileMaxDepth_.assign(tilesX_ * tilesY_, FLT_MAX);
+    rowTriangles_.resize(tilesY_);
+}
+
+void OcclusionCuller::begin(const Matrix4x4 &worldToClip)
+{
+    worldToClip_ = worldToClip;
+    triangles_.clear();
+    for (std::vector<int>& row : rowTriangles_)
+    {
+        row.clear();
+    }
+}
+
+void OcclusionCuller::addOccluder(const Point3* positions, int vertexCount, const uint32_t* indices, int indexCount, const Matrix4x4 &localToWorld)
+{
+    // Transform every vertex to clip space once, as they are shared between triangles
+    const Matrix4x4 localToClip = worldToClip_ * localToWorld;
+    clipVertices_.resize(vertexCount * 4);
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        const Vector4 clip = localToClip * Vector4(positions[i]);
+        clipVertices_[i * 4 + 0] = clip.x;
+        clipVertices_[i * 4 + 1] = clip.y;
+        clipVertices_[i * 4 + 2] = clip.z;
+        clipVertices_[i * 4 + 3] = clip.w;
+    }
+
+    for (int first = 0; first + 2 < indexCount; first += 3)
+    {
+        // Project the triangle to the screen.
+        // Triangles crossing the near plane are skipped, rather than clipped.
+        ScreenTriangle triangle;
+        bool behindCamera = false;
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            const float* clip = &clipVertices_[indices[first + corner] * 4];
+            if (clip[3] < MIN_CLIP_W)
+            {
+                behindCamera = true;
+                break;
+            }
+
+            const float invW = 1.0f / clip[3];
+            triangle.x[corner] = (clip[0] * invW * 0.5f + 0.5f) * width_;
+            triangle.y[corner] = (clip[1] * invW * 0.5f + 0.5f) * height_;
+            triangle.z[corner] = clip[2] * invW;
+        }
+
+        if (behindCamera)
+        {
+            continue;
+        }
+
+        // Skip triangles that are off screen
+        const float minX = std::min(std::min(triangle.x[0], triangle.x[1]), triangle.x[2]);
+        const float maxX = std::max(std::max(triangle.x[0], triangle.x[1]), triangle.x[2]);
+        const float minY = std::min(std::min(triangle.y[0], triangle.y[1]), triangle.y[2]);
+        const float maxY = std::max(std::max(triangle.y[0], triangle.y[1]), triangle.y[2]);
+        if (maxX < 0.0f || maxY < 0.0f || minX > width_ || minY > height_)
+        {
+            continue;
+        }
+
+        // Add the triangle to each row of tiles it overlaps
+        const int index = (int)triangles_.size();
+        triangles_.push_back(triangle);
+        const int firstRow = std::max(0, (int)floorf(minY) / TILE_SIZE);
+        const int lastRow = std::min(tilesY_ - 1, (int)floorf(maxY) / TILE_SIZE);
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+            rowTriangles_[row].push_back(index);
+        }
+    }
+}
+
+void OcclusionCuller::rasterize(WorkerPool* workerPool)
+{
+    // Rows of tiles do not share any pixels, so can be drawn at the same time
+    if (workerPool != nullptr)
+    {
+        workerPool->run(tilesY_, [this](int row) { rasterizeTileRow(row); });
+    }
+    else
+    {
+        for (int row = 0; row < tilesY_; ++row)
+        {
+            rasterizeTileRow(row);
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const Bounds &bounds) const
+{
+    // Project the corners of the box, and find the screen rectangle and nearest depth covering them.
+    // Depth is linear in screen space, so the nearest point of the box is always one of its corners.
+    const Point3 min = bounds.min();
+    const Point3 max = bounds.max();
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const Point3 point((corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z);
+        const Vector4 clip = worldToClip_ * Vector4(point);
+        if (clip.w < MIN_CLIP_W)
+        {
+            return true;
+        }
+
+        const float invW = 1.0f / clip.w;
+        const float x = (clip.x * invW * 0.5f + 0.5f) * width_;
+        const float y = (clip.y * invW * 0.5f + 0.5f) * height_;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, clip.z * invW);
+    }
+
+    // Boxes that are off screen cannot be seen
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width_ || minY >= height_)
+    {
+        return false;
+    }
+
+    // Find the pixels touched by the rectangle
+    const int x0 = std::max(0, (int)floorf(minX));
+    const int x1 = std::min(width_ - 1, (int)floorf(maxX));
+    const int y0 = std::max(0, (int)floorf(minY));
+    const int y1 = std::min(height_ - 1, (int)floorf(maxY));
+
+    // The box is visible if it is nearer than the occluders in any pixel.
+    // Tiles whose farthest occluder is nearer than the box hide it entirely, so their pixels are skipped.
+    for (int tileY = y0 / TILE_SIZE; tileY <= y1 / TILE_SIZE; ++tileY)
+    {
+        for (int tileX = x0 / TILE_SIZE; tileX <= x1 / TILE_SIZE; ++tileX)
+        {
+            if (minZ > tileMaxDepth_[tileX + tileY * tilesX_])
+            {
+                continue;
+            }
+
+            const int startX = std::max(x0, tileX * TILE_SIZE);
+            const int endX = std::min(x1, tileX * TILE_SIZE + TILE_SIZE - 1);
+            const int startY = std::max(y0, tileY * TILE_SIZE);
+            const int endY = std::min(y1, tileY * TILE_SIZE + TILE_SIZE - 1);
+            for (int y = startY; y <= endY; ++y)
+            {
+                for (int x = startX; x <= endX; ++x)
+                {
+                    if (minZ <= depth_[x + y * width_])
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void OcclusionCuller::rasterizeTileRow(int row)
+{
+    // Clear the rows of pixels in the tile row
+    const int minY = row * TILE_SIZE;
+    const int maxY = minY + TILE_SIZE - 1;
+    std::fill(depth_.begin() + minY * width_, depth_.begin() + (maxY + 1) * width_, FLT_MAX);
+
+    for (int index : rowTriangles_[row])
+    {
+        rasterizeTriangle(triangles_[index], minY, maxY);
+    }
+
+    // Find the farthest depth in each tile of the row
+    for (int tileX = 0; tileX < tilesX_; ++tileX)
+    {
+        float maxDepth = -FLT_MAX;
+        for (int y = minY; y <= maxY; ++y)
+        {
+            const float* pixels = &depth_[tileX * TILE_SIZE + y * width_];
+            for (int x = 0; x < TILE_SIZE; ++x)
+            {
+                maxDepth = std::max(maxDepth, pixels[x]);
+            }
+        }
+
+        tileMaxDepth_[tileX + row * tilesX_] = maxDepth;
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const ScreenTriangle &triangle, int minY, int maxY)
+{
+    // Order the corners anticlockwise, so the edge functions are positive inside
+    int i1 = 1, i2 = 2;
+    float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+    if (area == 0.0f)
+    {
+        return;
+    }
+    if (area < 0.0f)
+    {
+        std::swap(i1, i2);
+        area = -area;
+    }
+
+    const float x[3] = { triangle.x[0], triangle.x[i1], triangle.x[i2] };
+    const float y[3] = { triangle.y[0], triangle.y[i1], triangle.y[i2] };
+    const float z[3] = { triangle.z[0], triangle.z[i1], triangle.z[i2] };
+
+    // Set up an edge function for each edge, as a * x + b * y + c
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (int edge = 0; edge < 3; ++edge)
+    {
+        const int next = (edge + 1) % 3;
+        edgeA[edge] = y[edge] - y[next];
+        edgeB[edge] = x[next] - x[edge];
+        edgeC[edge] = (y[next] - y[edge]) * x[edge] - (x[next] - x[edge]) * y[edge];
+    }
+
+    // The depth is a plane in screen space
+    const float depthX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    const float depthY = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+
+    // Find the pixels covered by the triangle inside the rows being drawn.
+    // The first column is rounded down to a multiple of 4, so groups of 4 pixels stay aligned.
+    const int startX = std::max(0, (int)floorf(std::min(std::min(x[0], x[1]), x[2]))) & ~3;
+    const int endX = std::min(width_ - 1, (int)floorf(std::max(std::max(x[0], x[1]), x[2])));
+    const int startY = std::max(minY, (int)floorf(std::min(std::min(y[0], y[1]), y[2])));
+    const int endY = std::min(maxY, (int)floorf(std::max(std::max(y[0], y[1]), y[2])));
+
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+    const __m128 depthStepX = _mm_set1_ps(depthX);
+    for (int py = startY; py <= endY; ++py)
+    {
+        // The parts of each function that are constant along the row
+        const float centreY = py + 0.5f;
+        const __m128 row0 = _mm_set1_ps(edgeB[0] * centreY + edgeC[0]);
+        const __m128 row1 = _mm_set1_ps(edgeB[1] * centreY + edgeC[1]);
+        const __m128 row2 = _mm_set1_ps(edgeB[2] * centreY + edgeC[2]);
+        const __m128 rowDepth = _mm_set1_ps(z[0] + depthY * (centreY - y[0]) - depthX * x[0]);
+
+        float* pixels = &depth_[py * width_];
+        for (int px = startX; px <= endX; px += 4)
+        {
+            // Test the centres of 4 pixels against each edge
+            const __m128 centreX = _mm_add_ps(_mm_set1_ps((float)px), laneOffsets);
+            __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, centreX), row0), zero);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, centreX), row1), zero));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, centreX), row2), zero));
+            if (_mm_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+
+            // Keep the nearest depth in the covered pixels
+            const __m128 depth = _mm_add_ps(rowDepth, _mm_mul_ps(depthStepX, centreX));
+            const __m128 existing = _mm_loadu_ps(pixels + px);
+            const __m128 nearest = _mm_min_ps(existing, depth);
+            _mm_storeu_ps(pixels + px, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, existing)));
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math/Bounds.h"
+#include "Math/Matrix4x4.h"
+
+class WorkerPool;
+
+// Culls boxes that are hidden behind large occluders, using a low resolution depth buffer drawn on the cpu.
+// Occluders are conservative triangle meshes, such as a low detail terrain that lies under the real surface.
+// The buffer is split into square tiles that store the farthest depth inside them, so most boxes are accepted
+// or rejected from a few tiles. Each row of tiles is rasterised as a separate task, four pixels at a time with SSE.
+// Does not use the gpu, so can be used and tested headlessly.
+class OcclusionCuller
+{
+public:
+    // The size of each depth tile, in pixels. The buffer size is rounded up to a multiple of this.
+    const static int TILE_SIZE = 8;
+
+    // The default resolution of the depth buffer
+    const static int DEFAULT_WIDTH = 256;
+    const static int DEFAULT_HEIGHT = 128;
+
+public:
+    explicit OcclusionCuller(int width = DEFAULT_WIDTH, int height = DEFAULT_HEIGHT);
+
+    // The size of the depth buffer, in pixels
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    // Removes every occluder and sets the world to clip space transform for a new frame
+    void begin(const Matrix4x4 &worldToClip);
+
+    // Adds occluder triangles, given as a list of vertex indices.
+    // The positions are transformed into world space by localToWorld.
+    // Triangles that cross the camera near plane are skipped, which only makes the culling less aggressive.
+    void addOccluder(const Point3* positions, int vertexCount, const uint32_t* indices, int indexCount, const Matrix4x4 &localToWorld);
+
+    // Draws the occluders into the depth buffer.
+    // Each row of tiles is a separate task, which are run on the worker pool when one is given.
+    void rasterize(WorkerPool* workerPool = nullptr);
+
+    // Checks if any part of a box may be visible. Must be called after rasterize.
+    // Boxes that cross the near plane are always visible.
+    bool isVisible(const Bounds &bounds) const;
+
+    // The clip space depth stored in a pixel, or FLT_MAX where there is no occluder
+    float depth(int x, int y) const { return depth_[x + y * width_]; }
+
+    // The number of triangles that were rasterised in the last frame
+    int occluderTriangleCount() const { return (int)triangles_.size(); }
+
+private:
+    // A triangle in screen space, with x and y in pixels and z in clip space depth
+    struct ScreenTriangle
+    {
+        float x[3];
+        float y[3];
+        float z[3];
+    };
+
+    int width_;
+    int height_;
+    int tilesX_;
+    int tilesY_;
+    Matrix4x4 worldToClip_;
+
+    // The nearest occluder depth in each pixel, and the farthest depth in each tile
+    std::vector<float> depth_;
+    std::vector<float> tileMaxDepth_;
+
+    // The triangles added this frame, and the triangles overlapping each row of tiles
+    std::vector<ScreenTriangle> triangles_;
+    std::vector<std::vector<int>> rowTriangles_;
+
+    // Vertices transformed by addOccluder, kept to reuse their memory
+    std::vector<float> clipVertices_;
+
+    // Draws the triangles overlapping a row of tiles, and updates the tile depths
+    void rasterizeTileRow(int row);
+    void rasterizeTriangle(const ScreenTriangle &triangle, int minY, int maxY);
+};
\ No newline at end of file
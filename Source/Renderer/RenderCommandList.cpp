@@ -0,0 +1,156 @@
+#include "RenderCommandList.h"
+
+#include <cstring>
+
+void RenderCommandList::clear()
+{
+    commands_.clear();
+    data_.clear();
+}
+
+void RenderCommandList::bindShader(Shader* shader, ShaderFeatureList shaderFeatures)
+{
+    RenderCommand& command = addCommand(RenderCommandType::BindShader);
+    command.shader = shader;
+    command.shaderFeatures = shaderFeatures;
+}
+
+void RenderCommandList::bindMesh(const Mesh* mesh)
+{
+    RenderCommand& command = addCommand(RenderCommandType::BindMesh);
+    command.mesh = mesh;
+}
+
+void RenderCommandList::bindTexture(int slot, const Texture* texture)
+{
+    RenderCommand& command = addCommand(RenderCommandType::BindTexture);
+    command.binding = slot;
+    command.texture = texture;
+}
+
+void RenderCommandList::bindTexture(int slot, const ArrayTexture* texture)
+{
+    RenderCommand& command = addCommand(RenderCommandType::BindArrayTexture);
+    command.binding = slot;
+    command.arrayTexture = texture;
+}
+
+void RenderCommandList::bindStorageBuffer(const StorageBufferBase* storageBuffer)
+{
+    RenderCommand& command = addCommand(RenderCommandType::BindStorageBuffer);
+    command.storageBuffer = storageBuffer;
+}
+
+void RenderCommandList::setState(const RenderState &state)
+{
+    RenderCommand& command = addCommand(RenderCommandType::SetState);
+    command.state = state;
+}
+
+void RenderCommandList::clearDepth()
+{
+    addCommand(RenderCommandType::ClearDepth);
+}
+
+void RenderCommandList::setWireframe(bool wireframe)
+{
+    RenderCommand& command = addCommand(RenderCommandType::SetWireframe);
+    command.wireframe = wireframe;
+}
+
+void RenderCommandList::bindFramebuffer(const Framebuffer* framebuffer)
+{
+    RenderCommand& command = addCommand(RenderCommandType::BindFramebuffer);
+    command.framebuffer = framebuffer;
+}
+
+void RenderCommandList::bindFramebufferDepth(int slot, const Framebuffer* framebuffer)
+{
+    RenderCommand& command = addCommand(RenderCommandType::BindFramebufferDepth);
+    command.binding = slot;
+    command.framebuffer = framebuffer;
+}
+
+void RenderCommandList::clearColor(const Color &color)
+{
+    RenderCommand& command = addCommand(RenderCommandType::ClearColor);
+    command.color = color;
+}
+
+void RenderCommandList::blitFramebuffer(const Framebuffer* source, const Framebuffer* destination, int sourceWidth, int sourceHeight)
+{
+    RenderCommand& command = addCommand(RenderCommandType::BlitFramebuffer);
+    command.framebuffer = source;
+    command.destination = destination;
+    command.sourceWidth = sourceWidth;
+    command.sourceHeight = sourceHeight;
+}
+
+void RenderCommandList::uniformData(int binding, const void* data, uint32_t size)
+{
+    addDataCommand(RenderCommandType::UniformData, binding, data, size);
+}
+
+void RenderCommandList::storageData(int binding, const void* data, uint32_t size)
+{
+    addDataCommand(RenderCommandType::StorageData, binding, data, size);
+}
+
+void RenderCommandList::indirectData(const void* data, uint32_t size)
+{
+    addDataCommand(RenderCommandType::IndirectData, 0, data, size);
+}
+
+void RenderCommandList::draw(int elementCount, int firstElement)
+{
+    RenderCommand& command = addCommand(RenderCommandType::Draw);
+    command.elementCount = elementCount;
+    command.firstElement = firstElement;
+}
+
+void RenderCommandList::drawPatches(int elementCount)
+{
+    RenderCommand& command = addCommand(RenderCommandType::Draw);
+    command.primitive = RenderPrimitive::Patches;
+    command.elementCount = elementCount;
+}
+
+void RenderCommandList::drawInstanced(int elementCount, int firstInstance, int instanceCount, int firstElement)
+{
+    RenderCommand& command = addCommand(RenderCommandType::Draw);
+    command.elementCount = elementCount;
+    command.firstElement = firstElement;
+    command.firstInstance = firstInstance;
+    command.instanceCount = instanceCount;
+}
+
+void RenderCommandList::multiDrawIndirect(int firstIndirectCommand, int indirectCommandCount)
+{
+    RenderCommand& command = addCommand(RenderCommandType::MultiDrawIndirect);
+    command.firstIndirectCommand = firstIndirectCommand;
+    command.indirectCommandCount = indirectCommandCount;
+}
+
+RenderCommand& RenderCommandList::addCommand(RenderCommandType type)
+{
+    RenderCommand command = {};
+    command.type = type;
+    commands_.push_back(command);
+    return commands_.back();
+}
+
+void RenderCommandList::addDataCommand(RenderCommandType type, int binding, const void* data, uint32_t size)
+{
+    // Keep each block of data 16 byte aligned, so it can be read back as a struct
+    const uint32_t offset = (uint32_t)((data_.size() + 15) & ~(size_t)15);
+    data_.resize(offset + size);
+    if (size > 0)
+    {
+        memcpy(data_.data() + offset, data, size);
+    }
+
+    RenderCommand& command = addCommand(type);
+    command.binding = binding;
+    command.dataOffset = offset;
+    command.dataSize = size;
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math/Color.h"
+#include "Renderer/RenderQueue.h"
+
+class ArrayTexture;
+class Framebuffer;
+class StorageBufferBase;
+class Texture;
+
+// The primitives drawn by a draw command
+enum class RenderPrimitive
+{
+    Triangles,
+
+    // Triangle patches for the tessellation shaders
+    Patches
+};
+
+// How draws are blended into the color targets
+enum class RenderBlendMode
+{
+    // Replaces the existing color
+    Opaque,
+
+    // Blends the color by the output alpha, and keeps the existing alpha
+    Alpha,
+
+    // Only writes alpha, keeping the smaller of the existing and output values
+    MinAlpha
+};
+
+// The fixed function state used by draws.
+// Depth testing is always on.
+struct RenderState
+{
+    // Full screen passes draw where the existing depth is nearer, rather than further
+    bool depthGreater;
+    bool depthWrite;
+    RenderBlendMode blend;
+};
+
+// The types of command in a render command list
+enum class RenderCommandType
+{
+    // Binds a shader variant
+    BindShader,
+
+    // Binds a mesh for drawing
+    BindMesh,
+
+    // Binds a texture or array texture to a texture slot
+    BindTexture,
+    BindArrayTexture,
+
+    // Sets the depth and blending state, and clears the depth buffer
+    SetState,
+    ClearDepth,
+
+    // Binds the framebuffer that draws render into, and clears its color targets
+    BindFramebuffer,
+    ClearColor,
+
+    // Switches drawing the edges of triangles instead of filling them on or off
+    SetWireframe,
+
+    // Binds the depth texture attached to a framebuffer to a texture slot
+    BindFramebufferDepth,
+
+    // Stretches the color and depth of one framebuffer over another
+    BlitFramebuffer,
+
+    // Copies data into uniform or storage buffer memory, and binds it to a binding point
+    UniformData,
+    StorageData,
+
+    // Copies indirect draw commands into buffer memory, and uses them for indirect draws
+    IndirectData,
+
+    // Binds an existing storage buffer to the binding point of its type
+    BindStorageBuffer,
+
+    // Draws the bound mesh, optionally instanced
+    Draw,
+
+    // Draws the bound mesh once per indirect command
+    MultiDrawIndirect
+};
+
+// A single recorded command. Only the fields used by the command type are set.
+struct RenderCommand
+{
+    RenderCommandType type;
+
+    // BindShader
+    Shader* shader;
+    ShaderFeatureList shaderFeatures;
+
+    // BindMesh
+    const Mesh* mesh;
+
+    // BindTexture and BindArrayTexture, using the binding as the texture slot
+    const Texture* texture;
+    const ArrayTexture* arrayTexture;
+
+    // SetState
+    RenderState state;
+
+    // BindFramebuffer, BindFramebufferDepth and BlitFramebuffer, which copies into the destination
+    const Framebuffer* framebuffer;
+    const Framebuffer* destination;
+
+    // ClearColor
+    Color color;
+
+    // SetWireframe
+    bool wireframe;
+
+    // BlitFramebuffer. The region of the framebuffer, from its origin, that covers the destination.
+    int sourceWidth;
+    int sourceHeight;
+
+    // BindStorageBuffer
+    const StorageBufferBase* storageBuffer;
+
+    // UniformData, StorageData and IndirectData.
+    // The data is stored in the command list, and the binding is the buffer binding point.
+    int binding;
+    uint32_t dataOffset;
+    uint32_t dataSize;
+
+    // Draw. Non-instanced draws have an instanceCount of 0.
+    // The first element selects the level of detail within the mesh elements buffer.
+    RenderPrimitive primitive;
+    int elementCount;
+    int firstElement;
+    int firstInstance;
+    int instanceCount;
+
+    // MultiDrawIndirect, as an index into the last indirect data
+    int firstIndirectCommand;
+    int indirectCommandCount;
+};
+
+// A list of draws and state changes recorded without using the graphics api.
+// Lists can be recorded on worker threads, one per view, and then replayed
+// in order on the thread that owns the graphics context.
+// Any data used by the commands is copied into the list when recorded.
+class RenderCommandList
+{
+public:
+    // Removes every command, keeping the allocated memory for the next frame
+    void clear();
+
+    // Records state changes
+    void bindShader(Shader* shader, ShaderFeatureList shaderFeatures);
+    void bindMesh(const Mesh* mesh);
+    void bindTexture(int slot, const Texture* texture);
+    void bindTexture(int slot, const ArrayTexture* texture);
+    void bindStorageBuffer(const StorageBufferBase* storageBuffer);
+    void setState(const RenderState &state);
+    void clearDepth();
+    void setWireframe(bool wireframe);
+
+    // Records framebuffer binds, clears and copies
+    void bindFramebuffer(const Framebuffer* framebuffer);
+    void bindFramebufferDepth(int slot, const Framebuffer* framebuffer);
+    void clearColor(const Color &color);
+    void blitFramebuffer(const Framebuffer* source, const Framebuffer* destination, int sourceWidth, int sourceHeight);
+
+    // Records buffer contents to upload and bind
+    void uniformData(int binding, const void* data, uint32_t size);
+    void storageData(int binding, const void* data, uint32_t size);
+    void indirectData(const void* data, uint32_t size);
+
+    template <typename T>
+    void uniformData(int binding, const T &data)
+    {
+        uniformData(binding, &data, sizeof(T));
+    }
+
+    // Records draws
+    void draw(int elementCount, int firstElement = 0);
+    void drawPatches(int elementCount);
+    void drawInstanced(int elementCount, int firstInstance, int instanceCount, int firstElement = 0);
+    void multiDrawIndirect(int firstIndirectCommand, int indirectCommandCount);
+
+    // The recorded commands, in order
+    const std::vector<RenderCommand>& commands() const { return commands_; }
+
+    // Gets the data stored for a command
+    const void* data(const RenderCommand &command) const { return data_.data() + command.dataOffset; }
+
+    // The total size of the data stored in the list
+    uint32_t dataSize() const { return (uint32_t)data_.size(); }
+
+private:
+    std::vector<RenderCommand> commands_;
+    std::vector<unsigned char> data_;
+
+    // Adds a command with every field cleared
+    RenderCommand& addCommand(RenderCommandType type);
+
+    // Adds a command that copies data into the list
+    void addDataCommand(RenderCommandType type, int binding, const void* data, uint32_t size);
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "RenderDevice.h"
+
+#include "Renderer/InstanceBatcher.h"
+
+void RenderDeviceStats::add(const RenderDeviceStats &other)
+{
+    commands += other.commands;
+    shaderBinds += other.shaderBinds;
+    meshBinds += other.meshBinds;
+    bufferUploads += other.bufferUploads;
+    bytesUploaded += other.bytesUploaded;
+    draws += other.draws;
+    instances += other.instances;
+    triangles += other.triangles;
+}
+
+RenderDevice::RenderDevice()
+    : stats_()
+{
+
+}
+
+void RenderDevice::countUpload(uint64_t bytes)
+{
+    stats_.bufferUploads++;
+    stats_.bytesUploaded += bytes;
+}
+
+void RenderDevice::execute(const RenderCommandList &commands)
+{
+    // The indirect commands used by multi draws, kept to count the triangles they draw
+    const DrawIndirectCommand* indirectCommands = nullptr;
+
+    for (const RenderCommand& command : commands.commands())
+    {
+        stats_.commands++;
+
+        switch (command.type)
+        {
+        case RenderCommandType::BindShader:
+            bindShader(command.shader, command.shaderFeatures);
+            stats_.shaderBinds++;
+            break;
+
+        case RenderCommandType::BindMesh:
+            bindMesh(command.mesh);
+            stats_.meshBinds++;
+            break;
+
+        case RenderCommandType::UniformData:
+            uniformData(command.binding, commands.data(command), command.dataSize);
+            countUpload(command.dataSize);
+            break;
+
+        case RenderCommandType::StorageData:
+            storageData(command.binding, commands.data(command), command.dataSize);
+            countUpload(command.dataSize);
+            break;
+
+        case RenderCommandType::IndirectData:
+            indirectCommands = (const DrawIndirectCommand*)commands.data(command);
+            indirectData(commands.data(command), command.dataSize);
+            countUpload(command.dataSize);
+            break;
+
+        case RenderCommandType::BindTexture:
+            bindTexture(command.binding, command.texture);
+            break;
+
+        case RenderCommandType::BindArrayTexture:
+            bindArrayTexture(command.binding, command.arrayTexture);
+            break;
+
+        case RenderCommandType::SetState:
+            setState(command.state);
+            break;
+
+        case RenderCommandType::ClearDepth:
+            clearDepth();
+            break;
+
+        case RenderCommandType::SetWireframe:
+            setWireframe(command.wireframe);
+            break;
+
+        case RenderCommandType::BindFramebuffer:
+            bindFramebuffer(command.framebuffer);
+            break;
+
+        case RenderCommandType::BindFramebufferDepth:
+            bindFramebufferDepth(command.binding, command.framebuffer);
+            break;
+
+        case RenderCommandType::ClearColor:
+            clearColor(command.color);
+            break;
+
+        case RenderCommandType::BlitFramebuffer:
+            blitFramebuffer(command.framebuffer, command.destination, command.sourceWidth, command.sourceHeight);
+            break;
+
+        case RenderCommandType::BindStorageBuffer:
+            bindStorageBuffer(command.storageBuffer);
+            break;
+
+        case RenderCommandType::Draw:
+        {
+            // Patches are always triangles, so are counted the same way
+            const int instanceCount = (command.instanceCount > 0) ? command.instanceCount : 1;
+            draw(command.primitive, command.elementCount, command.firstElement, command.firstInstance, command.instanceCount);
+            stats_.draws++;
+            stats_.instances += instanceCount;
+            stats_.triangles += (uint64_t)(command.elementCount / 3) * instanceCount;
+            break;
+        }
+
+        case RenderCommandType::MultiDrawIndirect:
+            multiDrawIndirect(command.firstIndirectCommand, command.indirectCommandCount);
+            stats_.draws++;
+            for (int i = 0; indirectCommands != nullptr && i < command.indirectCommandCount; ++i)
+            {
+                const DrawIndirectCommand& indirect = indirectCommands[command.firstIndirectCommand + i];
+                stats_.instances += indirect.instanceCount;
+                stats_.triangles += (uint64_t)(indirect.count / 3) * indirect.instanceCount;
+            }
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Renderer/RenderCommandList.h"
+
+// Counts of the work submitted to a render device
+struct RenderDeviceStats
+{
+    int commands = 0;
+    int shaderBinds = 0;
+    int meshBinds = 0;
+    int bufferUploads = 0;
+    uint64_t bytesUploaded = 0;
+    int draws = 0;
+    int instances = 0;
+    uint64_t triangles = 0;
+
+    void add(const RenderDeviceStats &other);
+};
+
+// Executes recorded render commands with a graphics api.
+// The renderer records the draws, framebuffer binds, clears and uniform uploads of its passes
+// into command lists without touching the api, and a device replays them. The gl device draws
+// them, and the null device only counts and records them, so command streams can be tested and
+// measured without a gpu. Resources such as textures, meshes, shaders and framebuffers are still
+// created with the api, so the renderer itself still needs a gl context.
+class RenderDevice
+{
+public:
+    RenderDevice();
+    virtual ~RenderDevice() {}
+
+    // Replays every command in a list, in order, and counts the work it submits
+    void execute(const RenderCommandList &commands);
+
+    // The work submitted since the stats were last reset
+    const RenderDeviceStats& stats() const { return stats_; }
+    void resetStats() { stats_ = RenderDeviceStats(); }
+
+    // Counts an upload that is made directly with the api rather than through a command list,
+    // so that it is still included in the stats
+    void countUpload(uint64_t bytes);
+
+protected:
+    // Implemented by each device for each type of command.
+    // Data pointers are only valid for the duration of the call.
+    virtual void bindShader(Shader* shader, ShaderFeatureList shaderFeatures) = 0;
+    virtual void bindMesh(const Mesh* mesh) = 0;
+    virtual void bindTexture(int slot, const Texture* texture) = 0;
+    virtual void bindArrayTexture(int slot, const ArrayTexture* texture) = 0;
+    virtual void bindStorageBuffer(const StorageBufferBase* storageBuffer) = 0;
+    virtual void setState(const RenderState &state) = 0;
+    virtual void clearDepth() = 0;
+    virtual void setWireframe(bool wireframe) = 0;
+    virtual void bindFramebuffer(const Framebuffer* framebuffer) = 0;
+    virtual void bindFramebufferDepth(int slot, const Framebuffer* framebuffer) = 0;
+    virtual void clearColor(const Color &color) = 0;
+    virtual void blitFramebuffer(const Framebuffer* source, const Framebuffer* destination, int sourceWidth, int sourceHeight) = 0;
+    virtual void uniformData(int binding, const void* data, uint32_t size) = 0;
+    virtual void storageData(int binding, const void* data, uint32_t size) = 0;
+    virtual void indirectData(const void* data, uint32_t size) = 0;
+    virtual void draw(RenderPrimitive primitive, int elementCount, int firstElement, int firstInstance, int instanceCount) = 0;
+    virtual void multiDrawIndirect(int firstIndirectCommand, int indirectCommandCount) = 0;
+
+private:
+    RenderDeviceStats stats_;
+};
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "RenderGraph.h"
+
+#include <assert.h>
+
+RenderGraph::RenderGraph()
+    : compiled_(false)
+{
+
+}
+
+void RenderGraph::clear()
+{
+    resources_.clear();
+    passes_.clear();
+    physicalTextures_.clear();
+    compiled_ = false;
+}
+
+RenderGraphResource RenderGraph::createTexture(const std::string &name, const RenderGraphTextureDesc &desc)
+{
+    GraphResource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = false;
+    resource.output = false;
+    resource.texture = nullptr;
+    resource.firstPass = -1;
+    resource.lastPass = -1;
+    resource.physicalTexture = -1;
+    resources_.push_back(resource);
+
+    compiled_ = false;
+    return (RenderGraphResource)resources_.size() - 1;
+}
+
+RenderGraphResource RenderGraph::importTexture(const std::string &name, Texture* texture)
+{
+    GraphResource resource;
+    resource.name = name;
+    resource.desc = RenderGraphTextureDesc();
+    resource.imported = true;
+    resource.output = false;
+    resource.texture = texture;
+    resource.firstPass = -1;
+    resource.lastPass = -1;
+    resource.physicalTexture = -1;
+    resources_.push_back(resource);
+
+    compiled_ = false;
+    return (RenderGraphResource)resources_.size() - 1;
+}
+
+int RenderGraph::addPass(const std::string &name, const PassFunction &execute)
+{
+    GraphPass pass;
+    pass.name = name;
+    pass.execute = execute;
+    pass.culled = false;
+    passes_.push_back(pass);
+
+    compiled_ = false;
+    return (int)passes_.size() - 1;
+}
+
+void RenderGraph::read(int pass, RenderGraphResource resource)
+{
+    assert(resource >= 0 && resource < (int)resources_.size());
+    passes_[pass].reads.push_back(resource);
+    compiled_ = false;
+}
+
+void RenderGraph::write(int pass, RenderGraphResource resource)
+{
+    assert(resource >= 0 && resource < (int)resources_.size());
+    passes_[pass].writes.push_back(resource);
+    compiled_ = false;
+}
+
+void RenderGraph::markOutput(RenderGraphResource resource)
+{
+    resources_[resource].output = true;
+    compiled_ = false;
+}
+
+void RenderGraph::compile()
+{
+    // Walk backwards from the outputs, keeping each pass that writes a resource
+    // needed by an output or by a later pass that is kept.
+    // Writes are treated as adding to the previous contents, so earlier writers of a needed resource are kept too.
+    std::vector<bool> needed(resources_.size(), false);
+    for (size_t i = 0; i < resources_.size(); ++i)
+    {
+        needed[i] = resources_[i].output;
+    }
+
+    for (int p = (int)passes_.size() - 1; p >= 0; --p)
+    {
+        GraphPass& pass = passes_[p];
+        pass.culled = true;
+        for (RenderGraphResource resource : pass.writes)
+        {
+            if (needed[resource])
+            {
+                pass.culled = false;
+            }
+        }
+
+        if (!pass.culled)
+        {
+            for (RenderGraphResource resource : pass.reads)
+            {
+                needed[resource] = true;
+            }
+        }
+    }
+
+    // Find the lifetime of each resource, from its first use to its last use
+    for (GraphResource& resource : resources_)
+    {
+        resource.firstPass = -1;
+        resource.lastPass = -1;
+        resource.physicalTexture = -1;
+    }
+
+    for (int p = 0; p < (int)passes_.size(); ++p)
+    {
+        if (passes_[p].culled)
+        {
+            continue;
+        }
+
+        for (const std::vector<RenderGraphResource>* uses : { &passes_[p].reads, &passes_[p].writes })
+        {
+            for (RenderGraphResource resource : *uses)
+            {
+                if (resources_[resource].firstPass < 0)
+                {
+                    resources_[resource].firstPass = p;
+                }
+                resources_[resource].lastPass = p;
+            }
+        }
+    }
+
+    // Give each transient resource a physical texture, in order of first use.
+    // A texture with the same format and size is reused once the last resource using it is finished with.
+    physicalTextures_.clear();
+    for (int p = 0; p < (int)passes_.size(); ++p)
+    {
+        for (size_t r = 0; r < resources_.size(); ++r)
+        {
+            GraphResource& resource = resources_[r];
+            if (resource.imported || resource.firstPass != p)
+            {
+                continue;
+            }
+
+            for (size_t t = 0; t < physicalTextures_.size() && resource.physicalTexture < 0; ++t)
+            {
+                if (physicalTextures_[t].desc == resource.desc && physicalTextures_[t].lastPass < p)
+                {
+                    resource.physicalTexture = (int)t;
+                }
+            }
+
+            if (resource.physicalTexture < 0)
+            {
+                PhysicalTexture texture;
+                texture.desc = resource.desc;
+                texture.texture = nullptr;
+                physicalTextures_.push_back(texture);
+                resource.physicalTexture = (int)physicalTextures_.size() - 1;
+            }
+
+            physicalTextures_[resource.physicalTexture].lastPass = resource.lastPass;
+        }
+    }
+
+    compiled_ = true;
+}
+
+void RenderGraph::execute(RenderGraphBackend &backend)
+{
+    assert(compiled_ && "RenderGraph::compile must be called before execute");
+
+    // Acquire the textures for the transient resources
+    for (PhysicalTexture& texture : physicalTextures_)
+    {
+        texture.texture = backend.acquireTexture(texture.desc);
+    }
+
+    // Run the passes that were not culled, in order
+    for (const GraphPass& pass : passes_)
+    {
+        if (!pass.culled && pass.execute)
+        {
+            pass.execute(*this);
+        }
+    }
+
+    // Give the textures back, ready for the next graph
+    for (PhysicalTexture& texture : physicalTextures_)
+    {
+        backend.releaseTexture(texture.texture);
+        texture.texture = nullptr;
+    }
+}
+
+Texture* RenderGraph::texture(RenderGraphResource resource) const
+{
+    const GraphResource& graphResource = resources_[resource];
+    if (graphResource.imported)
+    {
+        return graphResource.texture;
+    }
+
+    return (graphResource.physicalTexture < 0) ? nullptr : physicalTextures_[graphResource.physicalTexture].texture;
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class Texture;
+enum class TextureFormat;
+
+// The format and size of a transient texture in a render graph
+struct RenderGraphTextureDesc
+{
+    TextureFormat format;
+    int width;
+    int height;
+
+    bool operator==(const RenderGraphTextureDesc &other) const
+    {
+        return format == other.format && width == other.width && height == other.height;
+    }
+};
+
+// Provides the textures used by transient render graph resources.
+// The renderer uses a pool of gpu textures, and tests use a null backend.
+class RenderGraphBackend
+{
+public:
+    virtual ~RenderGraphBackend() {}
+
+    // Gets a texture matching the description, to be used until it is released
+    virtual Texture* acquireTexture(const RenderGraphTextureDesc &desc) = 0;
+
+    // Returns a texture once the graph has finished with it
+    virtual void releaseTexture(Texture* texture) = 0;
+};
+
+// Identifies a texture in a render graph
+typedef int RenderGraphResource;
+
+// A frame of render passes, built each frame from the passes that are needed.
+// Each pass declares the textures it reads and writes. Compiling the graph culls passes
+// whose results are never used, and gives transient textures the shortest lifetime that
+// covers their uses, so that textures with the same format and size can share memory
+// when their lifetimes do not overlap. Passes then run in the order they were added.
+// Does not use the gpu, so can be compiled and tested headlessly.
+class RenderGraph
+{
+public:
+    typedef std::function<void(const RenderGraph&)> PassFunction;
+
+public:
+    RenderGraph();
+
+    // Removes every pass and resource, ready to build the next frame
+    void clear();
+
+    // Adds a texture that only exists while the graph executes
+    RenderGraphResource createTexture(const std::string &name, const RenderGraphTextureDesc &desc);
+
+    // Adds a texture that is owned outside the graph, such as a framebuffer or shadow map.
+    // The texture may be null for resources only used to order passes.
+    RenderGraphResource importTexture(const std::string &name, Texture* texture);
+
+    // Adds a pass. Passes execute in the order they are added.
+    int addPass(const std::string &name, const PassFunction &execute);
+
+    // Declares the resources a pass uses.
+    // A pass that reads and writes a resource adds to its previous contents.
+    void read(int pass, RenderGraphResource resource);
+    void write(int pass, RenderGraphResource resource);
+
+    // Marks a resource as used outside the graph, such as the framebuffer that is displayed.
+    // Passes are only kept if they contribute to an output.
+    void markOutput(RenderGraphResource resource);
+
+    // Culls unused passes and assigns a physical texture to each transient resource
+    void compile();
+
+    // Acquires the physical textures, runs each pass that was not culled, and then releases the textures.
+    // The graph must be compiled first.
+    void execute(RenderGraphBackend &backend);
+
+    // Gets the texture for a resource. Transient textures are only available while the graph executes.
+    Texture* texture(RenderGraphResource resource) const;
+
+    // Information about the passes, for tests and stats
+    int passCount() const { return (int)passes_.size(); }
+    const std::string& passName(int pass) const { return passes_[pass].name; }
+    bool isPassCulled(int pass) const { return passes_[pass].culled; }
+
+    // The number of textures needed for the transient resources, after aliasing
+    int physicalTextureCount() const { return (int)physicalTextures_.size(); }
+
+    // The physical texture used by a resource, or -1 for imported and unused resources
+    int physicalTextureIndex(RenderGraphResource resource) const { return resources_[resource].physicalTexture; }
+
+private:
+    struct GraphResource
+    {
+        std::string name;
+        RenderGraphTextureDesc desc;
+        bool imported;
+        bool output;
+        Texture* texture;
+
+        // The first and last passes that use the resource, after culling
+        int firstPass;
+        int lastPass;
+        int physicalTexture;
+    };
+
+    struct GraphPass
+    {
+        std::string name;
+        PassFunction execute;
+        std::vector<RenderGraphResource> reads;
+        std::vector<RenderGraphResource> writes;
+        bool culled;
+    };
+
+    struct PhysicalTexture
+    {
+        RenderGraphTextureDesc desc;
+        int lastPass;
+        Texture* texture;
+    };
+
+    std::vector<GraphResource> resources_;
+    std::vector<GraphPass> passes_;
+    std::vector<PhysicalTexture> physicalTextures_;
+    bool compiled_;
+};
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+void RenderQueueStats::add(const RenderQueueStats &other)
+{
+    shaderBinds += other.shaderBinds;
+    materialChanges += other.materialChanges;
+    meshBinds += other.meshBinds;
+    draws += other.draws;
+    instances += other.instances;
+}
+
+uint64_t RenderQueue::makeSortKey(RenderQueuePass pass, int variantID, int materialID, int meshID, float depth)
+{
+    const uint64_t passMask = (1ull << PASS_BITS) - 1;
+    const uint64_t variantMask = (1ull << VARIANT_BITS) - 1;
+    const uint64_t materialMask = (1ull << MATERIAL_BITS) - 1;
+    const uint64_t meshMask = (1ull << MESH_BITS) - 1;
+
+    return (((uint64_t)pass & passMask) << PASS_SHIFT)
+        | (((uint64_t)variantID & variantMask) << VARIANT_SHIFT)
+        | (((uint64_t)materialID & materialMask) << MATERIAL_SHIFT)
+        | (((uint64_t)meshID & meshMask) << MESH_SHIFT)
+        | ((uint64_t)quantiseDepth(depth) << DEPTH_SHIFT);
+}
+
+uint16_t RenderQueue::quantiseDepth(float depth)
+{
+    // The bit patterns of non-negative floats have the same order as their values,
+    // so the top 16 bits are a quantised depth with more precision close to the viewer.
+    depth = std::max(depth, 0.0f);
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return (uint16_t)(bits >> 16);
+}
+
+void RenderQueue::clear()
+{
+    items_.clear();
+}
+
+void RenderQueue::submit(RenderQueuePass pass, Shader* shader, ShaderFeatureList shaderFeatures, const Material* material, const Mesh* mesh, const Matrix4x4 &localToWorld, float depth, int lod)
+{
+    RenderQueueItem item;
+    item.sortKey = makeSortKey(pass, findID(variantIDs_, std::make_pair((const Shader*)shader, shaderFeatures)), findID(materialIDs_, material), findID(meshIDs_, mesh), depth);
+    item.shader = shader;
+    item.shaderFeatures = shaderFeatures;
+    item.material = material;
+    item.mesh = mesh;
+    item.localToWorld = localToWorld;
+    item.lod = lod;
+    item.firstInstance = 0;
+    item.instanceCount = 0;
+    items_.push_back(item);
+}
+
+void RenderQueue::submitInstanced(RenderQueuePass pass, Shader* shader, ShaderFeatureList shaderFeatures, const Material* material, const Mesh* mesh, int firstInstance, int instanceCount, float depth, int lod)
+{
+    submit(pass, shader, shaderFeatures, material, mesh, Matrix4x4::identity(), depth, lod);
+    items_.back().firstInstance = firstInstance;
+    items_.back().instanceCount = instanceCount;
+}
+
+void RenderQueue::sort()
+{
+    // A stable sort keeps items with equal keys in submission order, so the result is deterministic.
+    std::stable_sort(items_.begin(), items_.end(), [](const RenderQueueItem &a, const RenderQueueItem &b)
+    {
+        return a.sortKey < b.sortKey;
+    });
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Math/Matrix4x4.h"
+#include "Renderer/ShaderFeatures.h"
+
+class Material;
+class Mesh;
+class Shader;
+
+// The passes that draw items from a render queue.
+// Items from earlier passes sort before items from later passes.
+enum class RenderQueuePass
+{
+    ShadowCascade = 0,
+    Geometry = 1,
+};
+
+const int RENDER_QUEUE_PASS_COUNT = 2;
+
+// A single draw in a render queue.
+struct RenderQueueItem
+{
+    uint64_t sortKey;
+    Shader* shader;
+    ShaderFeatureList shaderFeatures;
+    const Material* material;
+    const Mesh* mesh;
+    Matrix4x4 localToWorld;
+
+    // The level of detail of the mesh to draw
+    int lod;
+
+    // Instanced items draw instanceCount instances, starting at firstInstance.
+    // Non-instanced items have an instanceCount of 0.
+    int firstInstance;
+    int instanceCount;
+};
+
+// Counters for the state changes and draws made when executing a queue.
+struct RenderQueueStats
+{
+    int shaderBinds = 0;
+    int materialChanges = 0;
+    int meshBinds = 0;
+    int draws = 0;
+    int instances = 0;
+
+    void add(const RenderQueueStats &other);
+};
+
+// A list of draws that is sorted to minimise state changes before execution.
+// Each item has a 64 bit sort key made from, most significant first:
+// the pass, the shader variant, the material, the mesh and the view depth.
+// Opaque items with the same state are therefore drawn front to back.
+// Does not use the gpu, so can be used and tested headlessly.
+class RenderQueue
+{
+public:
+    // The number of bits used by each part of the sort key
+    const static int PASS_BITS = 4;
+    const static int VARIANT_BITS = 12;
+    const static int MATERIAL_BITS = 16;
+    const static int MESH_BITS = 16;
+    const static int DEPTH_BITS = 16;
+
+    // The position of each part of the sort key
+    const static int DEPTH_SHIFT = 0;
+    const static int MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+    const static int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+    const static int VARIANT_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+    const static int PASS_SHIFT = VARIANT_SHIFT + VARIANT_BITS;
+
+    // Builds a sort key.
+    // The ids are masked to fit in the key. The depth must not be negative.
+    static uint64_t makeSortKey(RenderQueuePass pass, int variantID, int materialID, int meshID, float depth);
+
+    // Quantises a view depth so that the order of depths is preserved.
+    static uint16_t quantiseDepth(float depth);
+
+    // Removes every item, ready for the next frame.
+    // The ids given to shader variants, materials and meshes are kept, so that
+    // the order of items is stable from frame to frame.
+    void clear();
+
+    // Adds a draw to the queue.
+    // Draws of different levels of detail of the same mesh share the mesh binding.
+    void submit(RenderQueuePass pass, Shader* shader, ShaderFeatureList shaderFeatures, const Material* material, const Mesh* mesh, const Matrix4x4 &localToWorld, float depth, int lod = 0);
+
+    // Adds an instanced draw to the queue
+    void submitInstanced(RenderQueuePass pass, Shader* shader, ShaderFeatureList shaderFeatures, const Material* material, const Mesh* mesh, int firstInstance, int instanceCount, float depth, int lod = 0);
+
+    // Sorts the items by their sort keys
+    void sort();
+
+    // The items in the queue. They are in submission order until sorted.
+    const std::vector<RenderQueueItem>& items() const { return items_; }
+
+    // Executes the queue in its current order.
+    // The executor is only told about state that changes from the previous item, using the methods
+    //   bindShader(const RenderQueueItem&), bindMaterial(const RenderQueueItem&),
+    //   bindMesh(const RenderQueueItem&) and draw(const RenderQueueItem&)
+    // State is compared directly rather than through the sort key, so key collisions are harmless.
+    template <typename Executor>
+    RenderQueueStats execute(Executor &executor) const
+    {
+        RenderQueueStats stats;
+        const RenderQueueItem* previous = nullptr;
+        for (const RenderQueueItem& item : items_)
+        {
+            if (previous == nullptr || item.shader != previous->shader || item.shaderFeatures != previous->shaderFeatures)
+            {
+                executor.bindShader(item);
+                stats.shaderBinds++;
+            }
+
+            if (previous == nullptr || item.material != previous->material)
+            {
+                executor.bindMaterial(item);
+                stats.materialChanges++;
+            }
+
+            if (previous == nullptr || item.mesh != previous->mesh)
+            {
+                executor.bindMesh(item);
+                stats.meshBinds++;
+            }
+
+            executor.draw(item);
+            stats.draws++;
+            stats.instances += (item.instanceCount > 0) ? item.instanceCount : 1;
+            previous = &item;
+        }
+
+        return stats;
+    }
+
+private:
+    std::vector<RenderQueueItem> items_;
+
+    // Small ids for each shader variant, material and mesh, in order of first submission.
+    std::map<std::pair<const Shader*, ShaderFeatureList>, int> variantIDs_;
+    std::map<const Material*, int> materialIDs_;
+    std::map<const Mesh*, int> meshIDs_;
+
+    // Gets the id of an object, giving it the next free id if it has none.
+    template <typename Key>
+    static int findID(std::map<Key, int> &ids, const Key &key)
+    {
+        const auto found = ids.find(key);
+        if (found != ids.end())
+        {
+            return found->second;
+        }
+
+        const int id = (int)ids.size();
+        ids[key] = id;
+        return id;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "RenderStats.h"
+
+#include <cassert>
+
+RenderDeviceStats RenderFrameStats::total() const
+{
+    RenderDeviceStats total;
+    for (const RenderPassStats& pass : passes)
+    {
+        total.add(pass.counters);
+    }
+
+    return total;
+}
+
+float RenderFrameStats::cpuMilliseconds() const
+{
+    float milliseconds = 0.0f;
+    for (const RenderPassStats& pass : passes)
+    {
+        milliseconds += pass.cpuMilliseconds;
+    }
+
+    return milliseconds;
+}
+
+float RenderFrameStats::gpuMilliseconds() const
+{
+    // Passes without a timing are left out
+    float milliseconds = 0.0f;
+    for (const RenderPassStats& pass : passes)
+    {
+        milliseconds += (pass.gpuMilliseconds > 0.0f) ? pass.gpuMilliseconds : 0.0f;
+    }
+
+    return milliseconds;
+}
+
+void RenderFrameStats::writeCsvHeader(std::ostream &stream)
+{
+    stream << "frame,renderer,pass,view,draws,instances,triangles,shaderBinds,meshBinds,bufferUploads,bytesUploaded,cpuMs,gpuMs\n";
+}
+
+void RenderFrameStats::writeCsv(std::ostream &stream) const
+{
+    for (const RenderPassStats& pass : passes)
+    {
+        const RenderDeviceStats& counters = pass.counters;
+        stream << frame << "," << renderer << "," << pass.name << "," << pass.view << ","
+            << counters.draws << "," << counters.instances << "," << counters.triangles << ","
+            << counters.shaderBinds << "," << counters.meshBinds << ","
+            << counters.bufferUploads << "," << counters.bytesUploaded << ","
+            << pass.cpuMilliseconds << "," << pass.gpuMilliseconds << "\n";
+    }
+}
+
+void RenderFrameStats::writeJson(std::ostream &stream) const
+{
+    // Pass names are plain identifiers, so need no escaping
+    stream << "{\"frame\":" << frame << ",\"renderer\":" << renderer << ",\"passes\":[";
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        const RenderPassStats& pass = passes[i];
+        const RenderDeviceStats& counters = pass.counters;
+        stream << (i == 0 ? "" : ",")
+            << "{\"name\":\"" << pass.name << "\",\"view\":" << pass.view
+            << ",\"draws\":" << counters.draws << ",\"instances\":" << counters.instances << ",\"triangles\":" << counters.triangles
+            << ",\"shaderBinds\":" << counters.shaderBinds << ",\"meshBinds\":" << counters.meshBinds
+            << ",\"bufferUploads\":" << counters.bufferUploads << ",\"bytesUploaded\":" << counters.bytesUploaded
+            << ",\"cpuMs\":" << pass.cpuMilliseconds << ",\"gpuMs\":" << pass.gpuMilliseconds << "}";
+    }
+    stream << "]}\n";
+}
+
+RenderStatsHistory::RenderStatsHistory(int maxLatency)
+    : maxLatency_(maxLatency),
+    pending_(),
+    completed_(),
+    latest_(),
+    hasLatest_(false)
+{
+    assert(maxLatency >= 0);
+}
+
+RenderFrameStats& RenderStatsHistory::beginFrame(uint64_t frame, int renderer)
+{
+    // Stop waiting for the timings of frames that are too old
+    while (!pending_.empty() && pending_.front().frame + maxLatency_ < frame)
+    {
+        completeOldest();
+    }
+
+    RenderFrameStats stats;
+    stats.frame = frame;
+    stats.renderer = renderer;
+    pending_.push_back(stats);
+    return pending_.back();
+}
+
+void RenderStatsHistory::setGpuTimings(uint64_t frame, const std::vector<float> &milliseconds)
+{
+    // Frames before this one have had their timings dropped
+    while (!pending_.empty() && pending_.front().frame < frame)
+    {
+        completeOldest();
+    }
+
+    // The frame may already have been completed without its timings
+    if (pending_.empty() || pending_.front().frame != frame)
+    {
+        return;
+    }
+
+    for (RenderPassStats& pass : pending_.front().passes)
+    {
+        if (pass.gpuTiming >= 0 && pass.gpuTiming < (int)milliseconds.size())
+        {
+            pass.gpuMilliseconds = milliseconds[pass.gpuTiming];
+        }
+    }
+
+    completeOldest();
+}
+
+void RenderStatsHistory::completeOldest()
+{
+    completed_.push_back(pending_.front());
+    latest_ = pending_.front();
+    hasLatest_ = true;
+    pending_.pop_front();
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Renderer/RenderDevice.h"
+
+// The work done by one pass of the frame graph, for one view.
+// Each frame starts with a pass named Frame, holding the uploads, culling and
+// recording done before the frame graph runs, which is not timed on the gpu.
+struct RenderPassStats
+{
+    std::string name;
+
+    // The target framebuffer the pass drew for, or -1 for passes shared by every view, such as shadows
+    int view;
+
+    // The draws, binds and uploads submitted by the pass
+    RenderDeviceStats counters;
+
+    // The time spent submitting the pass on the cpu
+    float cpuMilliseconds;
+
+    // The time the pass took on the gpu, or negative if it was not timed or its result was dropped
+    float gpuMilliseconds;
+
+    // The index of the pass's gpu timing in its frame, or -1 if it was not timed
+    int gpuTiming;
+};
+
+// The work done by every pass of a frame
+struct RenderFrameStats
+{
+    uint64_t frame;
+
+    // Identifies the renderer that drew the frame, as several renderers can draw each frame
+    int renderer;
+
+    std::vector<RenderPassStats> passes;
+
+    // The counters and times added up over every pass
+    RenderDeviceStats total() const;
+    float cpuMilliseconds() const;
+    float gpuMilliseconds() const;
+
+    // Writes the frame as csv, with one line per pass
+    static void writeCsvHeader(std::ostream &stream);
+    void writeCsv(std::ostream &stream) const;
+
+    // Writes the frame as a single line json object, so that a file of frames can be read line by line
+    void writeJson(std::ostream &stream) const;
+};
+
+// Keeps the stats of recent frames until their gpu timings have been read back.
+// Gpu timings arrive a few frames late, so a frame is complete once its timings are filled in,
+// or once it is too old to wait for. Frames always complete in order, so that a stream of them
+// can be written. Does not use the gpu, so can be used and tested headlessly.
+class RenderStatsHistory
+{
+public:
+    // Frames wait for their gpu timings for up to this many frames
+    explicit RenderStatsHistory(int maxLatency);
+
+    // Starts a new frame, returning its stats to be filled in.
+    // Earlier frames that are too old to wait for are completed without their timings.
+    RenderFrameStats& beginFrame(uint64_t frame, int renderer);
+
+    // Fills in the gpu timings of an earlier frame, indexed by each pass's gpu timing, and completes it.
+    // Any frames before it will not get their timings, so are completed too.
+    void setGpuTimings(uint64_t frame, const std::vector<float> &milliseconds);
+
+    // The most recently completed frame, or null before the first frame completes
+    const RenderFrameStats* latest() const { return hasLatest_ ? &latest_ : nullptr; }
+
+    // The frames completed since they were last cleared, oldest first
+    const std::vector<RenderFrameStats>& completed() const { return completed_; }
+    void clearCompleted() { completed_.clear(); }
+
+private:
+    int maxLatency_;
+
+    // The frames waiting for their gpu timings, oldest first
+    std::deque<RenderFrameStats> pending_;
+
+    std::vector<RenderFrameStats> completed_;
+    RenderFrameStats latest_;
+    bool hasLatest_;
+
+    // Moves the oldest pending frame to the completed frames
+    void completeOldest();
+};
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "RenderTargetPool.h"
+
+#include <assert.h>
+
+#include "Utils/Clock.h"
+
+RenderTargetPool::RenderTargetPool()
+{
+
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    for (auto& bucket : buckets_)
+    {
+        for (PooledTexture& pooled : bucket.second)
+        {
+            delete pooled.texture;
+        }
+    }
+}
+
+Texture* RenderTargetPool::acquireTexture(const RenderGraphTextureDesc &desc)
+{
+    std::vector<PooledTexture>& bucket = buckets_[bucketKey(desc.format, desc.width, desc.height)];
+
+    // Reuse an unused texture with the same format and size
+    for (PooledTexture& pooled : bucket)
+    {
+        if (!pooled.inUse)
+        {
+            pooled.inUse = true;
+            pooled.lastUsedFrame = Clock::instance()->frameCount();
+            return pooled.texture;
+        }
+    }
+
+    // Otherwise create a new texture
+    PooledTexture pooled;
+    pooled.texture = new Texture(desc.format, desc.width, desc.height);
+    pooled.desc = desc;
+    pooled.inUse = true;
+    pooled.lastUsedFrame = Clock::instance()->frameCount();
+    bucket.push_back(pooled);
+    return pooled.texture;
+}
+
+void RenderTargetPool::releaseTexture(Texture* texture)
+{
+    // Find the texture in the bucket for its format and size
+    auto bucket = buckets_.find(bucketKey(texture->format(), texture->width(), texture->height()));
+    if (bucket != buckets_.end())
+    {
+        for (PooledTexture& pooled : bucket->second)
+        {
+            if (pooled.texture == texture)
+            {
+                assert(pooled.inUse);
+                pooled.inUse = false;
+                pooled.lastUsedFrame = Clock::instance()->frameCount();
+                return;
+            }
+        }
+    }
+
+    assert(false && "Texture was not acquired from this pool");
+}
+
+void RenderTargetPool::trim()
+{
+    // Delete textures that have not been used recently, such as after a window is resized
+    const uint64_t frame = Clock::instance()->frameCount();
+    for (auto bucket = buckets_.begin(); bucket != buckets_.end();)
+    {
+        std::vector<PooledTexture>& textures = bucket->second;
+        for (size_t i = textures.size() - 1; i < textures.size(); --i)
+        {
+            if (!textures[i].inUse && frame - textures[i].lastUsedFrame > UNUSED_FRAMES_BEFORE_DELETE)
+            {
+                delete textures[i].texture;
+                textures.erase(textures.begin() + i);
+            }
+        }
+
+        // Remove buckets for sizes that are no longer used
+        bucket = textures.empty() ? buckets_.erase(bucket) : std::next(bucket);
+    }
+}
+
+int RenderTargetPool::textureCount() const
+{
+    int count = 0;
+    for (const auto& bucket : buckets_)
+    {
+        count += (int)bucket.second.size();
+    }
+
+    return count;
+}
+
+uint64_t RenderTargetPool::bucketKey(TextureFormat format, int width, int height)
+{
+    // Sizes are limited to 16 bits per axis by the gpu, which leaves the top bits for the format
+    return ((uint64_t)format << 32) | ((uint64_t)(width & 0xFFFF) << 16) | (uint64_t)(height & 0xFFFF);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Renderer/RenderGraph.h"
+#include "Renderer/Texture.h"
+
+// Keeps render target textures between frames, so that render graphs do not create textures every frame.
+// Textures are shared by every graph and view that uses the pool, and are deleted once they have not been used for a while.
+// Textures are kept in buckets by format and size, so views that are resized back and forth reuse their old targets.
+class RenderTargetPool : public RenderGraphBackend
+{
+public:
+    // The number of frames a texture can go unused before it is deleted
+    const static int UNUSED_FRAMES_BEFORE_DELETE = 60;
+
+public:
+    RenderTargetPool();
+    ~RenderTargetPool();
+
+    // Prevent the pool from being copied
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    // Gets an unused texture with the description, creating one if needed
+    Texture* acquireTexture(const RenderGraphTextureDesc &desc) override;
+
+    // Returns a texture to the pool
+    void releaseTexture(Texture* texture) override;
+
+    // Deletes textures that have not been used recently
+    void trim();
+
+    // The number of textures in the pool, including ones that are in use
+    int textureCount() const;
+
+    // The number of different formats and sizes in the pool
+    int bucketCount() const { return (int)buckets_.size(); }
+
+private:
+    struct PooledTexture
+    {
+        Texture* texture;
+        RenderGraphTextureDesc desc;
+        bool inUse;
+        uint64_t lastUsedFrame;
+    };
+
+    // The textures in the pool, grouped by format and size
+    std::unordered_map<uint64_t, std::vector<PooledTexture>> buckets_;
+
+    // Packs a format and size into the key of its bucket
+    static uint64_t bucketKey(TextureFormat format, int width, int height);
+};
\ No newline at end of file
@@ -2,16 +2,18 @@
 
 #include <GL/gl3w.h>
 
+#include <algorithm>
 #include <assert.h>
+#include <chrono>
 
-#include "Math/Random.h"
 #include "RenderManager.h"
-#include "ResourceManager.h"
 #include "SceneManager.h"
 #include "Utils/Clock.h"
 #include "Scene/Transform.h"
 #include "Scene/Shield.h"
 
+int Renderer::nextId_ = 0;
+
 Renderer::Renderer()
     : Renderer(Framebuffer::backbuffer())
 {
@@ -25,201 +27,525 @@ Renderer::Renderer(Framebuffer* targetFramebuffer)
 }
 
 Renderer::Renderer(std::vector<Framebuffer*> targetFramebuffers)
-    : targetFramebuffers_(targetFramebuffers),
-    gbufferTextures_(),
-    gbufferFramebuffers_(),
-    shadowMap_(),
-    sceneUniformBuffer_(UniformBufferType::SceneBuffer),
-    cameraUniformBuffer_(UniformBufferType::CameraBuffer),
-    perDrawUniformBuffer_(UniformBufferType::PerDrawBuffer),
-    terrainUniformBuffer_(UniformBufferType::TerrainBuffer),
-    terrainDetailsUniformBuffer_(UniformBufferType::TerrainDetailsBuffer),
-    skyTransmittanceLUT_(TextureFormat::RGB16F, 256, 256)
+    : id_(nextId_++),
+    targetFramebuffers_(),
+    gbufferFramebuffers_(targetFramebuffers.size()),
+    scaledFramebuffers_(targetFramebuffers.size()),
+    context_(RenderManager::instance()->rendererContext()),
+    shadowMap_(context_.shadowAtlas),
+    uniformRing_(),
+    device_(uniformRing_),
+    occlusionCullers_(targetFramebuffers.size()),
+    views_(ShadowMap::CASCADE_COUNT + targetFramebuffers.size()),
+    dynamicResolution_(),
+    gpuTimer_(),
+    statsHistory_(GpuTimer::FRAME_COUNT),
+    frameStats_(nullptr),
+    warmedScene_(nullptr),
+    warmedFeatures_(0)
 {
-    fullScreenMesh_ = ResourceManager::instance()->load<Mesh>("Resources/Meshes/full_screen_mesh.mesh");
-
-    // Load the shaders required for each render pass
-    standardShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/Standard.shader");
-    terrainShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/Terrain.shader");
-    terrainDetailMeshShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/TerrainDetail.shader");
-    waterShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/Water.shader");
-    deferredAmbientOcclusionShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/Deferred-AmbientOcclusion.shader");
-    deferredLightingShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/Deferred-Lighting.shader");
-    deferredDebugShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/Deferred-Debug.shader");
-
-    // Load shield rendering resources
-    shieldShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/Shield.shader");
-    shieldFlowTexture_ = ResourceManager::instance()->load<Texture>("Resources/Textures/shield_flow.tga");
-    shieldOpacityTexture_ = ResourceManager::instance()->load<Texture>("Resources/Textures/shield_opacity.tga");
-    shieldMesh_ = ResourceManager::instance()->load<Mesh>("Resources/Meshes/sphere.obj");
-
-    // Load skybox shader and mesh
-    skyboxShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/SkyboxPass.shader");
-    skyboxMesh_ = ResourceManager::instance()->load<Mesh>("Resources/Meshes/skybox.obj");
-    skyTransmittanceShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/Sky/PrecomputeTransmittance.shader");
-
-    // Load the resources needed for physics debugging
-    physicsDebugShader_ = ResourceManager::instance()->load<Shader>("Resources/Shaders/PhysicsDebug.shader");
-    physicsBoxMesh_ = ResourceManager::instance()->load<Mesh>("Resources/Meshes/cube.obj");
-    physicsSphereMesh_ = ResourceManager::instance()->load<Mesh>("Resources/Meshes/sphere.obj");
-
-    // Generate the sky transmittance lut on startup.
-    // It should be ok for the entire app lifetime and shouldn't need to be remade.
-    regenerateSkyTransmittanceLUT();
+    setTargetFramebuffers(targetFramebuffers);
+}
 
-    // Generate the random poisson disks on startup.
-    for (int i = 0; i < 16; ++i)
-    {
-        const Vector2 disk = random_in_unit_circle();
-        poissonDisks_[i] = Vector4(disk.x, disk.y, 0.0f, 0.0f);
-    }
+Renderer::~Renderer()
+{
 
-    // Find the depth texture id for each framebuffer
-    // They are needed for the render loop later.
-    for(Framebuffer* framebuffer : targetFramebuffers_)
-    {
-        GLint depthTexture;
-        glGetNamedFramebufferAttachmentParameteriv(framebuffer->glid(), GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &depthTexture);
-        framebufferDepthTextures_.push_back(depthTexture);
-    }
 }
 
-Renderer::~Renderer()
+void Renderer::setTargetFramebuffers(const std::vector<Framebuffer*> &targetFramebuffers)
 {
-    destroyGBuffer();
+    assert(targetFramebuffers.size() == gbufferFramebuffers_.size());
+    targetFramebuffers_ = targetFramebuffers;
 }
 
 void Renderer::renderFrame(const Camera* camera)
 {
     const bool vr = (targetFramebuffers_.size() > 1);
 
-    // Ensure the correct uniform buffers are bound
-    sceneUniformBuffer_.use();
-    cameraUniformBuffer_.use();
-    perDrawUniformBuffer_.use();
-    terrainUniformBuffer_.use();
-    terrainDetailsUniformBuffer_.use();
+    // Start timing the new frame, and fill in the gpu timings of an earlier frame if they have been read back
+    const uint64_t frame = Clock::instance()->frameCount();
+    gpuTimer_.beginFrame(frame);
+    if (gpuTimer_.newResult())
+    {
+        statsHistory_.setGpuTimings(gpuTimer_.resultFrame(), gpuTimer_.results());
+    }
+    frameStats_ = &statsHistory_.beginFrame(frame, id_);
+
+    // Count the work done before the passes, such as the frame's uniform uploads, from here
+    device_.resetStats();
+    const auto frameStart = std::chrono::steady_clock::now();
+
+    // Write the stats of frames that are now complete to the stats file
+    for (const RenderFrameStats& stats : statsHistory_.completed())
+    {
+        RenderManager::instance()->recordFrameStats(stats);
+    }
+    statsHistory_.clearCompleted();
+
+    // Choose the scale to render at from the time the gpu took for recent frames.
+    // Only gpu work gets cheaper at lower resolutions, so the frame time from the
+    // clock is only used for the previous frame until the first timer results have been read back.
+    // Each timer result is only added once, in the frame it arrives.
+    dynamicResolution_.beginFrame(frame);
+    if (RenderManager::instance()->dynamicResolutionEnabled())
+    {
+        if (gpuTimer_.newResult())
+        {
+            dynamicResolution_.addFrame(gpuTimer_.resultFrame(), gpuTimer_.resultMilliseconds());
+        }
+        else if (!gpuTimer_.hasResult() && frame > 0)
+        {
+            dynamicResolution_.addFrame(frame - 1, Clock::instance()->realDeltaTime() * 1000.0f);
+        }
+    }
+    else
+    {
+        dynamicResolution_.reset();
+    }
+
+    // Start writing uniform data into the next region of the ring buffer.
+    // Each update binds its own range of the buffer.
+    uniformRing_.beginFrame();
 
     // Ensure the contents of the uniform buffers is up to date
     // The per-draw buffer is handled separately
     updateSceneUniformBuffer();
 
+    // Reset the render queue counters for the new frame
+    for (int pass = 0; pass < RENDER_QUEUE_PASS_COUNT; ++pass)
+    {
+        passStats_[pass] = RenderQueueStats();
+    }
+
+    // Gather the static meshes that can be drawn, and their world bounds.
+    // This is done once per frame, and each view then culls them separately.
+    frameStaticMeshes_.clear();
+    frameStaticMeshBounds_.clear();
+    staticMeshCuller_.clear();
+    for (StaticMesh* staticMesh : SceneManager::instance()->findAllComponentsInScene<StaticMesh>())
+    {
+        // Skip instances with no material
+        if (staticMesh->material() == nullptr || staticMesh->mesh() == nullptr)
+        {
+            continue;
+        }
+
+        // Meshes used as occluders need their triangles kept on the cpu
+        if (staticMesh->isOccluder())
+        {
+            staticMesh->mesh()->keepOccluderTriangles();
+        }
+
+        frameStaticMeshes_.push_back(staticMesh);
+        frameStaticMeshBounds_.push_back(staticMesh->worldBounds());
+        staticMeshCuller_.add(frameStaticMeshBounds_.back());
+        context_.materialTable.add(staticMesh->material());
+    }
+
+    // Stream the terrain heightfield tiles around the camera.
+    // The terrain settings are the same for every pass, so only upload them once.
+    Terrain* terrain = SceneManager::instance()->findComponentInScene<Terrain>();
+    if (terrain != nullptr)
+    {
+        terrain->updateStreaming(camera->gameObject()->transform()->positionWorld());
+        updateTerrainUniformBuffer(terrain);
+
+        for (const TerrainObjectBatch& batch : terrain->objectBatches())
+        {
+            context_.materialTable.add(batch.material);
+        }
+
+        if (terrain->detailMaterial() != nullptr)
+        {
+            context_.materialTable.add(terrain->detailMaterial());
+        }
+    }
+
+    // Every material drawn this frame is now in the material table, so upload the entries that changed.
+    // Views are recorded in parallel, and only look up the indices of materials from here on.
+    context_.updateMaterialTable();
+
     // Compute the aspect ratio using one of the framebuffers
     // All of the framebuffers are the same size anyway
     const float aspectRatio = targetFramebuffers_[0]->width() / (float)targetFramebuffers_[0]->height();
 
-    // Render the shadow map prior to the main render passes
-    if (RenderManager::instance()->filterFeatureList(SF_Shadows | SF_DebugShadows | SF_DebugShadowCascades) != 0)
+    // Set up a view for each shadow cascade.
+    // Casters are culled to the volume that can shadow the cascade's slice of the view,
+    // and are sorted from the sun, starting at the cascade camera's near plane.
+    const bool shadows = RenderManager::instance()->filterFeatureList(SF_Shadows | SF_DebugShadows | SF_DebugShadowCascades) != 0;
+
+    // Levels of detail are chosen from the size of objects in the camera, for every view.
+    // Shadow cascades add an extra bias, as casters are only seen through their blurred shadows.
+    const Point3 lodPosition = camera->gameObject()->transform()->positionWorld();
+    const float lodPixelsPerUnit = camera->pixelsPerUnit((float)targetFramebuffers_[0]->height());
+    const bool lodOrthographic = (camera->type() == CameraType::Orthographic);
+    const float lodBias = RenderManager::instance()->lodBias();
+    const float shadowLodBias = lodBias + RenderManager::instance()->shadowLodBias();
+    if (shadows)
     {
         shadowMap_.updatePosition(camera, aspectRatio, vr);
-        shadowMap_.bind();
+    }
+    for (int cascade = 0; cascade < ShadowMap::CASCADE_COUNT; ++cascade)
+    {
+        RenderView& view = views_[cascade];
+        view.active = shadows;
+        view.pass = RenderQueuePass::ShadowCascade;
+        view.shaderFeatures = SF_DepthOnly;
+        view.occlusionCuller = nullptr;
+        view.lodPosition = lodPosition;
+        view.lodPixelsPerUnit = lodPixelsPerUnit;
+        view.lodOrthographic = lodOrthographic;
+        view.lodBias = shadowLodBias;
+
+        if (shadows)
+        {
+            const Camera* cascadeCamera = shadowMap_.cascadeCamera(cascade);
+            const Transform* cascadeTransform = cascadeCamera->gameObject()->transform();
+            view.frustum = shadowMap_.casterFrustum(cascade);
+            view.viewPosition = cascadeTransform->positionWorld() + cascadeTransform->forwards() * cascadeCamera->nearPlane();
+        }
+    }
 
-        for (int cascade = 0; cascade < ShadowMap::CASCADE_COUNT; ++cascade)
+    // Set up a view for each target framebuffer, using the camera + eye
+    WorkerPool& workerPool = RenderManager::instance()->workerPool();
+    for (unsigned int fb = 0; fb < targetFramebuffers_.size(); ++fb)
+    {
+        const EyeType eye = (targetFramebuffers_.size() == 1) ? EyeType::None : (fb == 0 ? EyeType::LeftEye : EyeType::RightEye);
+
+        RenderView& view = views_[ShadowMap::CASCADE_COUNT + fb];
+        view.active = true;
+        view.pass = RenderQueuePass::Geometry;
+        view.shaderFeatures = CAMERA_PASS_FEATURES;
+        view.occlusionCuller = nullptr;
+        view.lodPosition = lodPosition;
+        view.lodPixelsPerUnit = lodPixelsPerUnit;
+        view.lodOrthographic = lodOrthographic;
+        view.lodBias = lodBias;
+
+        const Matrix4x4 worldToClip = camera->getWorldToCameraMatrix(aspectRatio, eye);
+        view.frustum = Frustum::fromMatrix(worldToClip);
+        view.viewPosition = camera->gameObject()->transform()->positionWorld();
+
+        // Draw the occluders for the camera, so that hidden objects can be culled.
+        // The tiles of each depth buffer are drawn in parallel.
+        if (RenderManager::instance()->occlusionCullingEnabled())
         {
-            shadowMap_.cascadeFramebuffer(cascade).use();
-            updateCameraUniformBuffer(shadowMap_.cascadeCamera(cascade), EyeType::None);
-            executeGeometryPass(shadowMap_.cascadeCamera(cascade), SF_HighTessellation);
+            drawOccluders(occlusionCullers_[fb], worldToClip, terrain);
+            view.occlusionCuller = &occlusionCullers_[fb];
         }
     }
 
-    // Ensure the gbuffer exists and is ok
-    createGBuffer();
+    // Cull every view in parallel
+    workerPool.run((int)views_.size(), [&](int index) { cullView(views_[index], terrain); });
 
-    // Bind the gbuffer textures for sampling in deferred passes
-    // The gbuffer textures are shared between eyes, but the depth
-    // textures are not, so bind the correct ones later.
-    for (int i = 0; i < GBUFFER_RENDER_TARGETS; ++i)
+    // Cached shadow cascades whose casters have not changed keep their previous contents, so need no draws
+    for (int cascade = 0; cascade < ShadowMap::CASCADE_COUNT; ++cascade)
     {
-        // Slot 15 is reserved for the depth texture.
-        // Start with gbuffer0 in slot 14, gbuffer1 in slot 13, etc.
-        gbufferTextures_[i]->bind(14 - i);
+        RenderView& view = views_[cascade];
+        view.active = view.active && shadowMap_.needsRender(cascade, view.casterSignature);
     }
 
-    // Draw each of the bound framebuffers
+    // Record the draws for every view in parallel.
+    // Nothing is drawn until the lists are replayed below.
+    workerPool.run((int)views_.size(), [&](int index) { recordView(views_[index], terrain); });
+
+    // Keep the work done so far as a pass of its own, as each pass starts counting from zero
+    RenderPassStats setupStats;
+    setupStats.name = "Frame";
+    setupStats.view = -1;
+    setupStats.counters = device_.stats();
+    setupStats.cpuMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    setupStats.gpuMilliseconds = -1.0f;
+    setupStats.gpuTiming = -1;
+    frameStats_->passes.push_back(setupStats);
+
+    // Wireframe debugging mode needs to be handled separately.
+    // It draws the geometry straight into the first target, without any of the deferred passes.
+    if (RenderManager::instance()->debugMode() == RenderDebugMode::Wireframe)
+    {
+        updateCameraUniformBuffer(camera, vr ? EyeType::LeftEye : EyeType::None);
+        setupCommands_.clear();
+        setupCommands_.setWireframe(true);
+
+        // We want to render directly to the target framebuffer
+        setupCommands_.bindFramebuffer(targetFramebuffers_[0]);
+
+        // Normally, the guffer pass only needs to clear depth, not colour.
+        // When rendering a wireframe we need to clear the color too
+        setupCommands_.clearColor(Color(0.0f, 0.0f, 0.0f, 0.0f));
+        device_.execute(setupCommands_);
+        executeGeometryPass(views_[ShadowMap::CASCADE_COUNT], CAMERA_PASS_FEATURES);
+        executeWaterPass();
+
+        // Ensure wireframe rendering is turned off again
+        setupCommands_.clear();
+        setupCommands_.setWireframe(false);
+        device_.execute(setupCommands_);
+        return;
+    }
+
+    // Build the frame's passes, with the textures each of them reads and writes.
+    // Passes whose results are not used are culled, and the gbuffer textures
+    // come from the shared render target pool, so eyes reuse the same textures.
+    frameGraph_.clear();
+
+    // Render the shadow map prior to the main render passes.
+    // Only passes that sample shadows read it, so it is culled when nothing does.
+    const RenderGraphResource shadowMap = frameGraph_.importTexture("ShadowMap", nullptr);
+    const int shadowPass = addPass("Shadows", -1, [this](const RenderGraph&)
+    {
+        shadowMap_.bind();
+
+        for (int cascade = 0; cascade < ShadowMap::CASCADE_COUNT; ++cascade)
+        {
+            if (views_[cascade].active)
+            {
+                executeShadowCasterPass(cascade, views_[cascade]);
+            }
+        }
+    });
+    frameGraph_.write(shadowPass, shadowMap);
+
+    // Add the passes for each of the bound framebuffers
     // There is one per eye, so either 1 (no vr) or 2 (vr).
     for (unsigned int fb = 0; fb < targetFramebuffers_.size(); ++fb)
     {
-        // Set the camera parameters for the current camera + eye
-        const EyeType eye = (targetFramebuffers_.size() == 1) ? EyeType::None : (fb == 0 ? EyeType::LeftEye : EyeType::RightEye);
-        updateCameraUniformBuffer(camera, eye);
+        addViewPasses(camera, fb, shadows ? shadowMap : -1, dynamicResolution_.scale());
+    }
 
-        // Each target framebuffer uses a different depth texture, so
-        // bind the correct one to slot 15
-        glActiveTexture(GL_TEXTURE15);
-        glBindTexture(GL_TEXTURE_2D, framebufferDepthTextures_[fb]);
+    frameGraph_.compile();
+    frameGraph_.execute(RenderManager::instance()->renderTargetPool());
 
-        // Wireframe debugging mode needs to be handled separately.
-        if (RenderManager::instance()->debugMode() == RenderDebugMode::Wireframe)
-        {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    // Free render targets that are no longer used, such as after a resize
+    RenderManager::instance()->renderTargetPool().trim();
+}
 
-            // We want to render directly to the target framebuffer
-            targetFramebuffers_[fb]->use();
+void Renderer::addViewPasses(const Camera* camera, unsigned int fb, RenderGraphResource shadowMap, float resolutionScale)
+{
+    const EyeType eye = (targetFramebuffers_.size() == 1) ? EyeType::None : (fb == 0 ? EyeType::LeftEye : EyeType::RightEye);
+
+    // Find the size the scene is rendered at
+    int width, height;
+    DynamicResolution::scaledSize(targetFramebuffers_[fb]->width(), targetFramebuffers_[fb]->height(), resolutionScale, width, height);
+    const bool scaled = (width != targetFramebuffers_[fb]->width() || height != targetFramebuffers_[fb]->height());
+
+    // The target framebuffer is what is displayed, so every pass must contribute to it
+    const RenderGraphResource target = frameGraph_.importTexture("Target", nullptr);
+    const RenderGraphResource targetDepth = frameGraph_.importTexture("Depth", nullptr);
+    frameGraph_.markOutput(target);
+
+    // When scaled, the scene is drawn into smaller color and depth textures, which only exist until
+    // they have been upscaled into the target. Otherwise the scene is drawn straight into the target.
+    const RenderGraphResource color = scaled ? frameGraph_.createTexture("SceneColor", { TextureFormat::RGBA8_SRGB, width, height }) : target;
+    const RenderGraphResource depth = scaled ? frameGraph_.createTexture("SceneDepth", { TextureFormat::Depth, width, height }) : targetDepth;
+
+    // The gbuffer only exists until the deferred passes have read it
+    const RenderGraphResource gbuffer0 = frameGraph_.createTexture("GBuffer0", { TextureFormat::RGBA8, width, height });
+    const RenderGraphResource gbuffer1 = frameGraph_.createTexture("GBuffer1", { TextureFormat::RGBA1010102, width, height });
+    assert(GBUFFER_RENDER_TARGETS == 2); // should be one higher than the last index
+
+    // Uses the framebuffer the scene is drawn into, which is either the target or the scaled textures
+    auto useSceneFramebuffer = [this, fb, scaled, color, depth](const RenderGraph &graph)
+    {
+        if (scaled)
+        {
+            scaledFramebuffers_[fb].attachDepthTexture(graph.texture(depth));
+            scaledFramebuffers_[fb].attachColorTexture(graph.texture(color));
+        }
 
-            // Normally, the guffer pass only needs to clear depth, not colour.
-            // When rendering a wireframe we need to clear the color too
-            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-            executeGeometryPass(camera, ALL_SHADER_FEATURES);
-            executeWaterPass();
+        setupCommands_.clear();
+        setupCommands_.bindFramebuffer(scaled ? &scaledFramebuffers_[fb] : targetFramebuffers_[fb]);
+        device_.execute(setupCommands_);
+    };
 
-            // Ensure wireframe rendering is turned off again
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            return;
+    // Binds the gbuffer textures and the scene depth texture for sampling in deferred passes
+    auto bindGBuffer = [this, fb, scaled, depth, gbuffer0, gbuffer1](const RenderGraph &graph)
+    {
+        // Slot 15 is reserved for the depth texture.
+        // Start with gbuffer0 in slot 14, gbuffer1 in slot 13, etc.
+        setupCommands_.clear();
+        setupCommands_.bindTexture(14, graph.texture(gbuffer0));
+        setupCommands_.bindTexture(13, graph.texture(gbuffer1));
+        if (scaled)
+        {
+            setupCommands_.bindTexture(15, graph.texture(depth));
         }
+        else
+        {
+            setupCommands_.bindFramebufferDepth(15, targetFramebuffers_[fb]);
+        }
+        device_.execute(setupCommands_);
+    };
 
-        // Render each opaque object into the gbuffer textures
-        gbufferFramebuffers_[fb].use();
-        executeGeometryPass(camera, ALL_SHADER_FEATURES);
+    // Render each opaque object into the gbuffer textures
+    const int gbufferPass = addPass("GBuffer", fb, [this, camera, eye, fb, scaled, depth, gbuffer0, gbuffer1, resolutionScale](const RenderGraph &graph)
+    {
+        // Set the camera parameters for the current camera + eye
+        updateCameraUniformBuffer(camera, eye, resolutionScale);
 
-        // Render ambient occlusion into the gbuffer, before computing lighting
-        if (RenderManager::instance()->isFeatureGloballyEnabled(SF_AmbientOcclusion))
+        // Use the scene depth texture with the pooled gbuffer textures.
+        // The pool may give different textures each frame, so they are always reattached.
+        const Texture* textures[GBUFFER_RENDER_TARGETS] = { graph.texture(gbuffer0), graph.texture(gbuffer1) };
+        if (scaled)
         {
-            executeDeferredAmbientOcclusionPass();
+            gbufferFramebuffers_[fb].attachDepthTexture(graph.texture(depth));
         }
+        else
+        {
+            gbufferFramebuffers_[fb].attachDepthTextureFromFramebuffer(targetFramebuffers_[fb]);
+        }
+        gbufferFramebuffers_[fb].attachColorTexturesMRT(GBUFFER_RENDER_TARGETS, textures);
+        setupCommands_.clear();
+        setupCommands_.bindFramebuffer(&gbufferFramebuffers_[fb]);
+        device_.execute(setupCommands_);
+
+        executeGeometryPass(views_[ShadowMap::CASCADE_COUNT + fb], CAMERA_PASS_FEATURES);
+    });
+    frameGraph_.write(gbufferPass, gbuffer0);
+    frameGraph_.write(gbufferPass, gbuffer1);
+    frameGraph_.write(gbufferPass, depth);
+
+    // Render ambient occlusion into the gbuffer, before computing lighting
+    if (RenderManager::instance()->isFeatureGloballyEnabled(SF_AmbientOcclusion))
+    {
+        const int ambientOcclusionPass = addPass("AmbientOcclusion", fb, [this, bindGBuffer](const RenderGraph &graph)
+        {
+            bindGBuffer(graph);
+            executeDeferredAmbientOcclusionPass();
+        });
+        frameGraph_.read(ambientOcclusionPass, depth);
+        frameGraph_.read(ambientOcclusionPass, gbuffer0);
+        frameGraph_.write(ambientOcclusionPass, gbuffer0);
+    }
 
-        // Now, we need to combine deferred lighting, sky, water etc into the target framebuffer
-        targetFramebuffers_[fb]->use();
+    // Now, we need to combine deferred lighting, sky, water etc into the scene color
+    const int lightingPass = addPass("Lighting", fb, [this, useSceneFramebuffer, bindGBuffer](const RenderGraph &graph)
+    {
+        useSceneFramebuffer(graph);
+        bindGBuffer(graph);
 
         // If we are not rendering the sky, clear the screen to black
         if (RenderManager::instance()->isFeatureGloballyEnabled(SF_Sky) == false)
         {
-            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
+            setupCommands_.clear();
+            setupCommands_.clearColor(Color(0.0f, 0.0f, 0.0f, 1.0f));
+            device_.execute(setupCommands_);
         }
 
         // Compute lighting into final render target
         executeDeferredLightingPass();
-
-        // Render the water on top of the geometry using alpha blending
+    });
+    frameGraph_.read(lightingPass, gbuffer0);
+    frameGraph_.read(lightingPass, gbuffer1);
+    frameGraph_.read(lightingPass, depth);
+    frameGraph_.write(lightingPass, color);
+
+    // Render the water on top of the geometry using alpha blending
+    const int waterPass = addPass("Water", fb, [this, useSceneFramebuffer](const RenderGraph &graph)
+    {
+        useSceneFramebuffer(graph);
         executeWaterPass();
-
-        // Show any debugging modes
-        if (RenderManager::instance()->debugMode() != RenderDebugMode::None)
+    });
+    frameGraph_.read(waterPass, depth);
+    frameGraph_.write(waterPass, depth);
+    frameGraph_.write(waterPass, color);
+
+    // Show any debugging modes
+    int debugPass = -1;
+    if (RenderManager::instance()->debugMode() != RenderDebugMode::None)
+    {
+        debugPass = addPass("Debug", fb, [this, useSceneFramebuffer, bindGBuffer](const RenderGraph &graph)
         {
+            useSceneFramebuffer(graph);
+            bindGBuffer(graph);
             executeDeferredDebugPass();
+        });
+        frameGraph_.read(debugPass, gbuffer0);
+        frameGraph_.read(debugPass, gbuffer1);
+        frameGraph_.read(debugPass, depth);
+        frameGraph_.write(debugPass, color);
+    }
+
+    // Passes that sample the sun's shadows need the shadow map
+    if (shadowMap >= 0)
+    {
+        frameGraph_.read(lightingPass, shadowMap);
+        frameGraph_.read(waterPass, shadowMap);
+        if (debugPass >= 0)
+        {
+            frameGraph_.read(debugPass, shadowMap);
         }
+    }
 
-        // Finally render the skybox
-        if (RenderManager::instance()->isFeatureGloballyEnabled(SF_Sky))
+    // Finally render the skybox
+    if (RenderManager::instance()->isFeatureGloballyEnabled(SF_Sky))
+    {
+        const int skyboxPass = addPass("Skybox", fb, [this, useSceneFramebuffer, camera](const RenderGraph &graph)
         {
+            useSceneFramebuffer(graph);
             executeSkyboxPass(camera);
-        }
+        });
+        frameGraph_.read(skyboxPass, depth);
+        frameGraph_.write(skyboxPass, color);
+    }
 
-        // Alpha blended shields are then rendered on top of the water and sky
-        if (RenderManager::instance()->debugMode() == RenderDebugMode::None)
+    // Alpha blended shields are then rendered on top of the water and sky
+    if (RenderManager::instance()->debugMode() == RenderDebugMode::None)
+    {
+        const int shieldPass = addPass("Shield", fb, [this, useSceneFramebuffer](const RenderGraph &graph)
         {
+            useSceneFramebuffer(graph);
             executeShieldPass();
-        }
+        });
+        frameGraph_.read(shieldPass, depth);
+        frameGraph_.write(shieldPass, color);
+    }
+
+    // Stretch the scaled scene over the target with bilinear filtering.
+    // The depth is copied too, so that anything drawn on top afterwards, such as physics wireframes, is still depth tested.
+    if (scaled)
+    {
+        const int upscalePass = addPass("Upscale", fb, [this, fb, width, height](const RenderGraph&)
+        {
+            setupCommands_.clear();
+            setupCommands_.blitFramebuffer(&scaledFramebuffers_[fb], targetFramebuffers_[fb], width, height);
+            device_.execute(setupCommands_);
+        });
+        frameGraph_.read(upscalePass, color);
+        frameGraph_.read(upscalePass, depth);
+        frameGraph_.write(upscalePass, target);
+        frameGraph_.write(upscalePass, targetDepth);
     }
 }
 
+int Renderer::addPass(const std::string &name, int view, const RenderGraph::PassFunction &execute)
+{
+    return frameGraph_.addPass(name, [this, name, view, execute](const RenderGraph &graph)
+    {
+        // Count the work the pass submits, and time it on the cpu and the gpu
+        device_.resetStats();
+        const auto start = std::chrono::steady_clock::now();
+        const int gpuTiming = gpuTimer_.begin();
+
+        execute(graph);
+
+        gpuTimer_.end();
+
+        RenderPassStats stats;
+        stats.name = name;
+        stats.view = view;
+        stats.counters = device_.stats();
+        stats.cpuMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.gpuMilliseconds = -1.0f;
+        stats.gpuTiming = gpuTiming;
+        frameStats_->passes.push_back(stats);
+    });
+}
+
 void Renderer::renderPhysicsObjects(const Camera * camera)
 {
-    // Ensure the correct uniform buffers are bound
-    sceneUniformBuffer_.use();
-    cameraUniformBuffer_.use();
-    perDrawUniformBuffer_.use();
+    // Ensure the scene uniforms are bound, in case another renderer has drawn since this frame started
+    updateSceneUniformBuffer();
 
     // Draw each of the bound framebuffers
     // There is one per eye, so either 1 (no vr) or 2 (vr).
@@ -230,67 +556,87 @@ void Renderer::renderPhysicsObjects(const Camera * camera)
         updateCameraUniformBuffer(camera, eye);
 
         // Render to the final target
-        targetFramebuffers_[fb]->use();
+        passCommands_.clear();
+        passCommands_.bindFramebuffer(targetFramebuffers_[fb]);
 
         // Render every physics object using wireframe mode.
-        physicsDebugShader_->bindVariant(ALL_SHADER_FEATURES);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        passCommands_.bindShader(context_.physicsDebugShader, ALL_SHADER_FEATURES);
+        passCommands_.setWireframe(true);
+        passCommands_.bindMesh(context_.physicsBoxMesh);
         for (const BoxCollider* box : SceneManager::instance()->findAllComponentsInScene<BoxCollider>())
         {
-            updatePerDrawUniformBuffer(box->gameObject()->transform()->localToWorld() * Matrix4x4::translation(box->offset()) * Matrix4x4::scale(box->size()), nullptr);
-            physicsBoxMesh_->bind();
-            glDrawElements(GL_TRIANGLES, physicsBoxMesh_->elementsCount(), GL_UNSIGNED_SHORT, (void*)0);
+            const Matrix4x4 localToWorld = box->gameObject()->transform()->localToWorld() * Matrix4x4::translation(box->offset()) * Matrix4x4::scale(box->size());
+            passCommands_.uniformData((int)UniformBufferType::PerDrawBuffer, perDrawUniformData(localToWorld, nullptr));
+            passCommands_.draw(context_.physicsBoxMesh->elementsCount());
         }
+        passCommands_.bindMesh(context_.physicsSphereMesh);
         for (const SphereCollider* sphere : SceneManager::instance()->findAllComponentsInScene<SphereCollider>())
         {
-            updatePerDrawUniformBuffer(sphere->gameObject()->transform()->localToWorld() * Matrix4x4::translation(sphere->offset())  * Matrix4x4::scale(Vector3(sphere->radius(), sphere->radius(), sphere->radius())), nullptr);
-            physicsSphereMesh_->bind();
-            glDrawElements(GL_TRIANGLES, physicsSphereMesh_->elementsCount(), GL_UNSIGNED_SHORT, (void*)0);
+            const Matrix4x4 localToWorld = sphere->gameObject()->transform()->localToWorld() * Matrix4x4::translation(sphere->offset())  * Matrix4x4::scale(Vector3(sphere->radius(), sphere->radius(), sphere->radius()));
+            passCommands_.uniformData((int)UniformBufferType::PerDrawBuffer, perDrawUniformData(localToWorld, nullptr));
+            passCommands_.draw(context_.physicsSphereMesh->elementsCount());
         }
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        passCommands_.setWireframe(false);
+        device_.execute(passCommands_);
     }
 }
 
-void Renderer::createGBuffer()
+bool Renderer::warmUpShaders(float maxMilliseconds)
 {
-    // If there is already an ok gbuffer, we dont need to do anything
-    // Check with the first texture - if it is ok, the whole thing is ok.
-    if (gbufferTextures_[0] != nullptr
-        && gbufferTextures_[0]->width() == targetFramebuffers_[0]->width()
-        && gbufferTextures_[0]->height() == targetFramebuffers_[0]->height())
+    ShaderWarmup& warmup = RenderManager::instance()->shaderWarmup();
+
+    // Changing the scene or the enabled features changes which variants are drawn
+    const Scene* scene = SceneManager::instance()->currentScene();
+    const ShaderFeatureList enabledFeatures = RenderManager::instance()->filterFeatureList(ALL_SHADER_FEATURES);
+    if (scene != warmedScene_ || enabledFeatures != warmedFeatures_)
     {
-        // GBuffer already exists and is the correct resolution.
-        return;
+        queueShaderWarmup(warmup);
+        warmedScene_ = scene;
+        warmedFeatures_ = enabledFeatures;
     }
 
-    // First destroy any existing gbuffer textures
-    destroyGBuffer();
-
-    // Create the textures    
-    gbufferTextures_[0] = new Texture(TextureFormat::RGBA8, targetFramebuffers_[0]->width(), targetFramebuffers_[0]->height());
-    gbufferTextures_[1] = new Texture(TextureFormat::RGBA1010102, targetFramebuffers_[0]->width(), targetFramebuffers_[0]->height());
-    assert(GBUFFER_RENDER_TARGETS == 2); // should be one higher than the last index
-
-    // Create the gbuffer framebuffers
-    gbufferFramebuffers_.resize(targetFramebuffers_.size());
+    warmup.update(maxMilliseconds);
+    return warmup.isComplete();
+}
 
-    // Use the target framebuffer's depth texture and the gbuffer textures
-    // The same gbuffer textures are used for each framebuffer, only the depth texture is different
-    for (int fb = 0; fb < targetFramebuffers_.size(); ++fb)
+void Renderer::queueShaderWarmup(ShaderWarmup &warmup) const
+{
+    // Screen space and forward passes use every enabled feature
+    warmup.add(context_.deferredAmbientOcclusionShader, ALL_SHADER_FEATURES);
+    warmup.add(context_.deferredLightingShader, ALL_SHADER_FEATURES);
+    warmup.add(context_.waterShader, ALL_SHADER_FEATURES);
+    warmup.add(context_.skyboxShader, ALL_SHADER_FEATURES);
+    warmup.add(context_.shieldShader, ALL_SHADER_FEATURES);
+
+    // Shadow casters use the same depth only variant for every material
+    warmup.add(context_.standardShader, SF_DepthOnly | SF_Instancing);
+
+    // Static meshes are always drawn as instances that read their material index from the instance data.
+    // Camera pass variants use the same feature lists as the draws, so that the variants drawn are the ones warmed.
+    for (const StaticMesh* staticMesh : SceneManager::instance()->findAllComponentsInScene<StaticMesh>())
     {
-        gbufferFramebuffers_[fb].attachDepthTextureFromFramebuffer(targetFramebuffers_[fb]);
-        gbufferFramebuffers_[fb].attachColorTexturesMRT(GBUFFER_RENDER_TARGETS, (const Texture**)gbufferTextures_);
+        if (staticMesh->material() != nullptr)
+        {
+            warmup.add(context_.standardShader, (staticMesh->material()->supportedFeatures() & CAMERA_PASS_FEATURES) | SF_Instancing | SF_InstancedMaterials);
+        }
     }
-}
 
-void Renderer::destroyGBuffer()
-{
-    if (gbufferTextures_[0] != nullptr)
+    // The terrain, its details and the objects placed on it
+    const Terrain* terrain = SceneManager::instance()->findComponentInScene<Terrain>();
+    if (terrain != nullptr)
     {
-        for (int i = 0; i < GBUFFER_RENDER_TARGETS; ++i)
+        warmup.add(context_.terrainShader, CAMERA_PASS_FEATURES);
+        warmup.add(context_.terrainShader, SF_DepthOnly);
+        warmup.add(context_.terrainShader, SF_DepthOnly | SF_HighTessellation);
+
+        for (const TerrainObjectBatch& batch : terrain->objectBatches())
+        {
+            warmup.add(context_.standardShader, (batch.material->supportedFeatures() & CAMERA_PASS_FEATURES) | SF_Instancing);
+        }
+
+        if (terrain->detailMaterial() != nullptr)
         {
-            delete gbufferTextures_[i];
-            gbufferTextures_[i] = nullptr;
+            warmup.add(context_.terrainDetailMeshShader, terrain->detailMaterial()->supportedFeatures() & CAMERA_PASS_FEATURES);
         }
     }
 }
@@ -311,23 +657,30 @@ void Renderer::updateSceneUniformBuffer() const
     // Copy the poisson disks into the scene data
     for(int disk = 0; disk < 16; ++disk)
     {
-        data.ambientOcclusionPoissonDisks[disk] = poissonDisks_[disk];
+        data.ambientOcclusionPoissonDisks[disk] = context_.poissonDisks[disk];
     }
 
     // Send time to shader for cloud texture scrolling
     const float time = Clock::instance()->time();
     data.time = Vector4(time, 1.0f / time, 0.0f, 0.0f);
 
-    // Update the uniform buffer
-    sceneUniformBuffer_.update(data);
+    // Upload the uniform buffer through the device
+    setupCommands_.clear();
+    setupCommands_.uniformData((int)UniformBufferType::SceneBuffer, data);
+    device_.execute(setupCommands_);
 }
 
-void Renderer::updateCameraUniformBuffer(const Camera* camera, EyeType eye) const
+void Renderer::updateCameraUniformBuffer(const Camera* camera, EyeType eye, float resolutionScale) const
 {
-    // Find out the resolution and aspect ratio of the framebuffer
-    const float width = (float)targetFramebuffers_[0]->width();
-    const float height = (float)targetFramebuffers_[0]->height();
-    const float aspect = width / height;
+    // Find out the resolution and aspect ratio of the framebuffer.
+    // The aspect ratio always comes from the target, so that rounding the scaled size does not stretch the image.
+    const float aspect = targetFramebuffers_[0]->width() / (float)targetFramebuffers_[0]->height();
+
+    // Deferred passes read the gbuffer at the scaled resolution
+    int scaledWidth, scaledHeight;
+    DynamicResolution::scaledSize(targetFramebuffers_[0]->width(), targetFramebuffers_[0]->height(), resolutionScale, scaledWidth, scaledHeight);
+    const float width = (float)scaledWidth;
+    const float height = (float)scaledHeight;
 
     // Gather the new contents of the camera buffer
     CameraUniformData data;
@@ -336,28 +689,20 @@ void Renderer::updateCameraUniformBuffer(const Camera* camera, EyeType eye) cons
     data.worldToClip = camera->getWorldToCameraMatrix(aspect, eye);
     data.clipToWorld = data.worldToClip.invert();
 
-    // Update the uniform buffer.
-    cameraUniformBuffer_.update(data);
+    // Upload the uniform buffer through the device
+    setupCommands_.clear();
+    setupCommands_.uniformData((int)UniformBufferType::CameraBuffer, data);
+    device_.execute(setupCommands_);
 }
 
-void Renderer::updatePerDrawUniformBuffer(const Matrix4x4 &localToWorld, const Material* material) const
+PerDrawUniformData Renderer::perDrawUniformData(const Matrix4x4 &localToWorld, const Material* material) const
 {
-    // Use the default material if none was specified
-    if(material == nullptr)
-    {
-        material = ResourceManager::instance()->load<Material>("Resources/Materials/default.material");
-    }
-
-    // Gather the new contents of the per-draw buffer
-    PerDrawUniformData data;
+    // Gather the new contents of the per-draw buffer.
+    // Draws without a material use the default material, which is the first in the material table.
+    PerDrawUniformData data = {};
     data.localToWorld = localToWorld;
-    data.colorSmoothness = material->color();
-    data.colorSmoothness.a = material->smoothness();
-    data.albedoTexture = (material->albedoTexture() == nullptr) ? 0 : material->albedoTexture()->bindlessHandle();
-    data.normalMapTexture = (material->normalMapTexture() == nullptr) ? 0 : material->normalMapTexture()->bindlessHandle();
-
-    // Update the uniform buffer.
-    perDrawUniformBuffer_.update(data);
+    data.materialIndex = context_.materialTable.find(material);
+    return data;
 }
 
 void Renderer::updateTerrainUniformBuffer(const Terrain* terrain) const
@@ -365,6 +710,7 @@ void Renderer::updateTerrainUniformBuffer(const Terrain* terrain) const
     TerrainUniformData data;
     data.terrainSize = Vector4(terrain->size().x, terrain->size().y, terrain->size().z, (float)terrain->layerCount());
     data.waterColorDepth = Vector4(terrain->waterColor().r, terrain->waterColor().g, terrain->waterColor().b, terrain->waterDepth());
+    data.heightfieldInfo = Vector4((float)terrain->heightfield().resolution(), (float)terrain->heightfield().tilesPerSide(), (float)TerrainHeightfield::TILE_RESOLUTION, 0.0f);
 
     for (int i = 0; i < terrain->layerCount(); ++i)
     {
@@ -381,63 +727,303 @@ void Renderer::updateTerrainUniformBuffer(const Terrain* terrain) const
         data.terrainNormalMapTextures[i * 2] = (layer.material->normalMapTexture() == nullptr) ? 0 : layer.material->normalMapTexture()->bindlessHandle();
     }
 
-    terrainUniformBuffer_.update(data);
+    setupCommands_.clear();
+    setupCommands_.uniformData((int)UniformBufferType::TerrainBuffer, data);
+    device_.execute(setupCommands_);
 }
 
-void Renderer::updateTerrainDetailsUniformBuffer(const DetailBatch& details) const
+void Renderer::drawOccluders(OcclusionCuller &culler, const Matrix4x4 &worldToClip, const Terrain* terrain) const
 {
-    TerrainDetailsData detailsData;
-    std::memcpy(detailsData.detailPositions, details.instancePositions, sizeof(Vector4) * details.count);
-    terrainDetailsUniformBuffer_.update(detailsData);
+    culler.begin(worldToClip);
+
+    // The low detail terrain hides most of the objects behind ridges
+    if (terrain != nullptr && !terrain->occluderIndices().empty())
+    {
+        culler.addOccluder(terrain->occluderPositions().data(), (int)terrain->occluderPositions().size(),
+            terrain->occluderIndices().data(), (int)terrain->occluderIndices().size(), Matrix4x4::identity());
+    }
+
+    // Then add the large meshes marked as occluders
+    for (const StaticMesh* staticMesh : frameStaticMeshes_)
+    {
+        if (staticMesh->isOccluder())
+        {
+            const Mesh* mesh = staticMesh->mesh();
+            culler.addOccluder(mesh->occluderPositions().data(), (int)mesh->occluderPositions().size(),
+                mesh->occluderIndices().data(), (int)mesh->occluderIndices().size(), staticMesh->gameObject()->transform()->localToWorld());
+        }
+    }
+
+    culler.rasterize(&RenderManager::instance()->workerPool());
 }
 
-void Renderer::executeGeometryPass(const Camera* camera, ShaderFeatureList shaderFeatures) const
+void Renderer::cullView(RenderView &view, const Terrain* terrain) const
 {
-    // Ensure that depth testing and depth write are on
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(true);
+    view.visibleStaticMeshes.clear();
+    view.visibleDetailBatches.clear();
+    view.visibleObjectBatches.clear();
+    view.occludedObjects = 0;
+    view.casterSignature = ShadowCascadeCache::EMPTY_SIGNATURE;
+    if (!view.active)
+    {
+        return;
+    }
 
-    // We only need to clear the depth buffer, and not the color buffer
-    // This pass is rendering into the gbuffer and the non-rendered areas are not used.
-    glClear(GL_DEPTH_BUFFER_BIT);
+    // Each view culls the same set of world bounds, gathered once per frame
+    staticMeshCuller_.cull(view.frustum, view.visibleStaticMeshes);
 
-    // Draw every static mesh component in the scene with the standard shaders
-    for (StaticMesh* staticMesh : SceneManager::instance()->findAllComponentsInScene<StaticMesh>())
+    // Find the terrain object batches in view. The tree returns them in tree order, so sort them
+    // back into batch order, where the batches with the same mesh and material are next to each other.
+    if (terrain != nullptr)
     {
-        // Skip instances with no material
-        if (staticMesh->material() == nullptr || staticMesh->mesh() == nullptr)
+        terrain->objectBatchTree().cull(view.frustum, view.viewPosition, 1.0f, view.visibleObjectBatches);
+        std::sort(view.visibleObjectBatches.begin(), view.visibleObjectBatches.end());
+    }
+
+    if (view.pass == RenderQueuePass::ShadowCascade)
+    {
+        // Build a signature of the casters, so cached cascades can tell when they have changed
+        for (int index : view.visibleStaticMeshes)
         {
-            continue;
+            const StaticMesh* staticMesh = frameStaticMeshes_[index];
+            view.casterSignature = ShadowCascadeCache::combineSignature(view.casterSignature, (uint64_t)(uintptr_t)staticMesh);
+            view.casterSignature = ShadowCascadeCache::combineSignature(view.casterSignature, (uint64_t)(uintptr_t)staticMesh->mesh());
+            view.casterSignature = ShadowCascadeCache::combineSignature(view.casterSignature, staticMesh->mesh()->loadCount());
+            view.casterSignature = ShadowCascadeCache::combineSignature(view.casterSignature, staticMesh->gameObject()->transform()->changeCount());
+        }
+        if (terrain != nullptr)
+        {
+            view.casterSignature = ShadowCascadeCache::combineSignature(view.casterSignature, (uint64_t)(uintptr_t)terrain);
+            view.casterSignature = ShadowCascadeCache::combineSignature(view.casterSignature, terrain->changeCount());
+        }
+    }
+    else if (terrain != nullptr)
+    {
+        // Find the terrain detail batches that are in view and within their draw distance.
+        // Terrain details are too small to cast visible shadows, so are only culled for cameras.
+        const float distanceScale = RenderManager::instance()->isFeatureGloballyEnabled(SF_ExtraTerrainDetails) ? 6.0f : 1.0f;
+        terrain->detailBatchTree().cull(view.frustum, view.viewPosition, distanceScale, view.visibleDetailBatches);
+    }
+
+    // Remove the objects in view that are hidden behind occluders
+    if (view.occlusionCuller != nullptr)
+    {
+        const size_t inView = view.visibleStaticMeshes.size() + view.visibleDetailBatches.size() + view.visibleObjectBatches.size();
+        view.visibleStaticMeshes.erase(std::remove_if(view.visibleStaticMeshes.begin(), view.visibleStaticMeshes.end(),
+            [&](int index) { return !view.occlusionCuller->isVisible(frameStaticMeshBounds_[index]); }), view.visibleStaticMeshes.end());
+
+        if (terrain != nullptr)
+        {
+            const std::vector<DetailBatch>& batches = terrain->detailBatches();
+            view.visibleDetailBatches.erase(std::remove_if(view.visibleDetailBatches.begin(), view.visibleDetailBatches.end(),
+                [&](int index) { return !view.occlusionCuller->isVisible(batches[index].bounds); }), view.visibleDetailBatches.end());
+
+            const std::vector<TerrainObjectBatch>& objectBatches = terrain->objectBatches();
+            view.visibleObjectBatches.erase(std::remove_if(view.visibleObjectBatches.begin(), view.visibleObjectBatches.end(),
+                [&](int index) { return !view.occlusionCuller->isVisible(objectBatches[index].bounds); }), view.visibleObjectBatches.end());
+        }
+
+        view.occludedObjects = (int)(inView - view.visibleStaticMeshes.size() - view.visibleDetailBatches.size() - view.visibleObjectBatches.size());
+    }
+}
+
+int Renderer::occludedObjectCount() const
+{
+    int count = 0;
+    for (const RenderView& view : views_)
+    {
+        count += view.occludedObjects;
+    }
+
+    return count;
+}
+
+int Renderer::selectLod(const RenderView &view, const Mesh* mesh, const Bounds &worldBounds) const
+{
+    if (mesh->lodCount() == 1)
+    {
+        return 0;
+    }
+
+    // The sphere around the world bounds includes the object's scale, and is never smaller than the mesh sphere
+    const Point3 centre = worldBounds.centre();
+    const float radius = (worldBounds.max() - centre).magnitude();
+    const float projectedRadius = view.lodOrthographic ? radius * view.lodPixelsPerUnit
+        : MeshLod::projectedRadius(radius, Point3::distance(view.lodPosition, centre), view.lodPixelsPerUnit);
+    return MeshLod::select(mesh->lods().data(), mesh->lodCount(), projectedRadius, view.lodBias);
+}
+
+void Renderer::recordView(RenderView &view, const Terrain* terrain) const
+{
+    view.commands.clear();
+    view.stats = RenderQueueStats();
+    if (!view.active)
+    {
+        return;
+    }
+
+    // Casters only write depth, so every static mesh uses the same depth only variant.
+    // The material is not used, so copies of a mesh are grouped regardless of their material.
+    const bool depthOnly = (view.pass == RenderQueuePass::ShadowCascade);
+    const ShaderFeatureList depthOnlyFeatures = RenderManager::instance()->filterFeatureList(SF_DepthOnly);
+
+    // Group copies of the same mesh, level of detail and material into multi draw batches
+    view.instanceBatcher.clear();
+    for (int index : view.visibleStaticMeshes)
+    {
+        const StaticMesh* staticMesh = frameStaticMeshes_[index];
+        const Material* material = depthOnly ? nullptr : staticMesh->material();
+        const ShaderFeatureList features = depthOnly ? depthOnlyFeatures : RenderManager::instance()->filterFeatureList(staticMesh->material()->supportedFeatures() & view.shaderFeatures);
+        const Mesh* mesh = staticMesh->mesh();
+        const int lod = selectLod(view, mesh, frameStaticMeshBounds_[index]);
+        view.instanceBatcher.add(context_.standardShader, features, material, mesh, lod, mesh->lod(lod).firstElement, mesh->lod(lod).elementsCount, staticMesh->gameObject()->transform()->localToWorld());
+    }
+    view.instanceBatcher.build();
+
+    // Every static mesh reads its transform and material index from the view's instance data.
+    // The batcher numbers materials per view, so convert them to indices in the shared material table.
+    // Depth only variants do not read the material, so the material indices are only needed by cameras.
+    const InstanceBatcher& batcher = view.instanceBatcher;
+    const ShaderFeatureList instancingFeatures = depthOnly ? SF_Instancing : (SF_Instancing | SF_InstancedMaterials);
+    if (!batcher.instances().empty())
+    {
+        view.commands.storageData((int)StorageBufferType::ObjectInstancesBuffer, batcher.instances().data(), (uint32_t)(batcher.instances().size() * sizeof(ObjectInstanceData)));
+    }
+
+    if (!depthOnly && !batcher.instances().empty())
+    {
+        std::vector<uint32_t>& tableIndices = view.materialTableIndices;
+        tableIndices.clear();
+        for (const Material* material : batcher.materials())
+        {
+            tableIndices.push_back(context_.materialTable.find(material));
         }
 
-        // Use the correct standard shader variant
-        standardShader_->bindVariant(staticMesh->material()->supportedFeatures() & shaderFeatures);
+        std::vector<uint32_t>& materialIndices = view.instanceMaterialIndices;
+        materialIndices.clear();
+        for (uint32_t index : batcher.instanceMaterialIndices())
+        {
+            materialIndices.push_back(tableIndices[index]);
+        }
 
-        // Set the correct mesh
-        // Textures are bound via bindless texture handles
-        staticMesh->mesh()->bind();
+        view.commands.storageData((int)StorageBufferType::InstanceMaterialIndicesBuffer, materialIndices.data(), (uint32_t)(materialIndices.size() * sizeof(uint32_t)));
+    }
 
-        // Update the per draw uniform buffer
-        const Matrix4x4 localToWorld = staticMesh->gameObject()->transform()->localToWorld();
-        updatePerDrawUniformBuffer(localToWorld, staticMesh->material());
+    // Queue the meshes that were not grouped, sorted by the distance to the object origin.
+    // Each is drawn as a single instance, so draws only differ by their base instance and need no per draw data.
+    view.renderQueue.clear();
+    for (int index : batcher.singles())
+    {
+        const RenderQueueItem& draw = batcher.draw(index);
+        const Point3 position(draw.localToWorld.get(0, 3), draw.localToWorld.get(1, 3), draw.localToWorld.get(2, 3));
+        const ShaderFeatureList features = RenderManager::instance()->filterFeatureList(draw.shaderFeatures | instancingFeatures);
+        view.renderQueue.submitInstanced(view.pass, draw.shader, features, draw.material, draw.mesh, draw.firstInstance, draw.instanceCount, Point3::distance(view.viewPosition, position), draw.lod);
+    }
 
-        // Draw the mesh
-        glDrawElements(GL_TRIANGLES, staticMesh->mesh()->elementsCount(), GL_UNSIGNED_SHORT, (void*)0);
+    // Records the queue's state changes and draws into the command list
+    struct QueueRecorder
+    {
+        RenderCommandList* commands;
+
+        void bindShader(const RenderQueueItem &item) { commands->bindShader(item.shader, item.shaderFeatures); }
+        // Materials are read from the material table using each instance's material index
+        void bindMaterial(const RenderQueueItem&) { }
+        void bindMesh(const RenderQueueItem &item) { commands->bindMesh(item.mesh); }
+
+        void draw(const RenderQueueItem &item)
+        {
+            const MeshLod& lod = item.mesh->lod(item.lod);
+            commands->drawInstanced(lod.elementsCount, item.firstInstance, item.instanceCount, lod.firstElement);
+        }
+    };
+
+    // Record the queue in sort key order
+    view.renderQueue.sort();
+    QueueRecorder recorder = { &view.commands };
+    view.stats.add(view.renderQueue.execute(recorder));
+
+    // Draw each batch with one multi draw call.
+    // Each command in a batch draws every instance of one material.
+    if (!batcher.batches().empty())
+    {
+        view.commands.indirectData(batcher.commands().data(), (uint32_t)(batcher.commands().size() * sizeof(DrawIndirectCommand)));
     }
 
+    for (const InstanceBatch& batch : batcher.batches())
+    {
+        view.commands.bindShader(batch.shader, RenderManager::instance()->filterFeatureList(batch.shaderFeatures | instancingFeatures));
+        view.commands.bindMesh(batch.mesh);
+        view.commands.multiDrawIndirect(batch.firstCommand, batch.commandCount);
+
+        view.stats.shaderBinds++;
+        view.stats.meshBinds++;
+        view.stats.materialChanges += batch.commandCount;
+        view.stats.draws++;
+        view.stats.instances += batch.instanceCount;
+    }
+
+    // Draw the static objects placed on the terrain that are in view.
+    // These have no StaticMesh components, and are drawn with one instanced draw per batch.
+    // They use the terrain's own instance buffer, so are drawn after everything that uses the view's instances.
+    if (terrain != nullptr && !view.visibleObjectBatches.empty())
+    {
+        view.commands.bindStorageBuffer(terrain->objectInstanceBuffer());
+
+        // The visible batches are sorted, so batches with the same mesh and material are drawn one after another,
+        // and the shader and per draw data only change with the material. Casters ignore the material, so
+        // every batch in a shadow cascade shares the same shader and identity per draw data.
+        const std::vector<TerrainObjectBatch>& batches = terrain->objectBatches();
+        const TerrainObjectBatch* previous = nullptr;
+        for (int index : view.visibleObjectBatches)
+        {
+            const TerrainObjectBatch& batch = batches[index];
+            if (previous == nullptr || (!depthOnly && previous->material != batch.material))
+            {
+                const Material* material = depthOnly ? nullptr : batch.material;
+                const ShaderFeatureList features = depthOnly ? (SF_DepthOnly | SF_Instancing) : ((batch.material->supportedFeatures() & view.shaderFeatures) | SF_Instancing);
+                view.commands.bindShader(context_.standardShader, RenderManager::instance()->filterFeatureList(features));
+                view.commands.uniformData((int)UniformBufferType::PerDrawBuffer, perDrawUniformData(Matrix4x4::identity(), material));
+
+                view.stats.shaderBinds++;
+                view.stats.materialChanges++;
+            }
+
+            if (previous == nullptr || previous->mesh != batch.mesh)
+            {
+                view.commands.bindMesh(batch.mesh);
+                view.stats.meshBinds++;
+            }
+
+            const MeshLod& lod = batch.mesh->lod(0);
+            view.commands.drawInstanced(lod.elementsCount, batch.firstInstance, batch.count, lod.firstElement);
+
+            view.stats.draws++;
+            view.stats.instances += batch.count;
+            previous = &batch;
+        }
+    }
+}
+
+void Renderer::executeGeometryPass(const RenderView &view, ShaderFeatureList shaderFeatures) const
+{
+    // Ensure that depth testing and depth write are on
+    // We only need to clear the depth buffer, and not the color buffer
+    // This pass is rendering into the gbuffer and the non-rendered areas are not used.
+    passCommands_.clear();
+    passCommands_.setState({ false, true, RenderBlendMode::Opaque });
+    passCommands_.clearDepth();
+    device_.execute(passCommands_);
+
+    // Draw the static meshes and terrain objects recorded for the view
+    device_.execute(view.commands);
+    passStats_[(int)view.pass].add(view.stats);
+
     // Draw terrain
+    passCommands_.clear();
     const Terrain* terrain = SceneManager::instance()->findComponentInScene<Terrain>();
     if (terrain != nullptr)
     {
-        terrainShader_->bindVariant(shaderFeatures);
-
-        //Set mesh and heightmap
-        terrain->mesh()->bind();
-        terrain->heightmap()->bind(8);
-        updateTerrainUniformBuffer(terrain);
-
-        // Render the terrain with tessellation
-        glDrawElements(GL_PATCHES, terrain->mesh()->elementsCount(), GL_UNSIGNED_SHORT, (void*)0);
+        recordTerrain(passCommands_, terrain, shaderFeatures);
     }
 
     // Draw terrain details
@@ -448,81 +1034,110 @@ void Renderer::executeGeometryPass(const Camera* camera, ShaderFeatureList shade
         && terrain->detailMesh() != nullptr)
     {
         // Use the terrain's detail mesh
-        terrain->detailMesh()->bind();
+        passCommands_.bindMesh(terrain->detailMesh());
         const int elementsCount = terrain->detailMesh()->elementsCount();
 
         // Use the terrain's detail material
-        updatePerDrawUniformBuffer(Matrix4x4::identity(), terrain->detailMaterial());
+        passCommands_.uniformData((int)UniformBufferType::PerDrawBuffer, perDrawUniformData(Matrix4x4::identity(), terrain->detailMaterial()));
 
         // Use the terrain's detail shader
-        terrainDetailMeshShader_->bindVariant(terrain->detailMaterial()->supportedFeatures() & shaderFeatures);
+        passCommands_.bindShader(context_.terrainDetailMeshShader, terrain->detailMaterial()->supportedFeatures() & shaderFeatures);
 
-        // Render each terrain details batch
-        const Point3 cameraPosition = camera->gameObject()->transform()->positionWorld();
-        const float distanceScale = RenderManager::instance()->isFeatureGloballyEnabled(SF_ExtraTerrainDetails) ? 6.0f : 1.0f;
-        for (const DetailBatch& batch : terrain->detailBatches())
-        {
-            // Skip batches that are further than the draw distance
-            if ((batch.bounds.centre() - cameraPosition).sqrMagnitude() > batch.drawDistance * batch.drawDistance * distanceScale)
-            {
-                continue;
-            }
+        // Use the terrain's packed detail instances.
+        // These are only uploaded when the details are placed.
+        passCommands_.bindStorageBuffer(terrain->detailInstanceBuffer());
+        passCommands_.bindStorageBuffer(terrain->detailBatchBuffer());
 
-            // Draw the batch data using an instanced draw call
-            updateTerrainDetailsUniformBuffer(batch);
-            glDrawElementsInstanced(GL_TRIANGLES, elementsCount, GL_UNSIGNED_SHORT, (void*)0, batch.count);
+        // Render each terrain details batch that was visible when the view was culled
+        const std::vector<DetailBatch>& batches = terrain->detailBatches();
+        for (int batchIndex : view.visibleDetailBatches)
+        {
+            // Draw the batch using an instanced draw call.
+            // The base instance is the batch index, which the shader uses to find the instances.
+            passCommands_.drawInstanced(elementsCount, batchIndex, batches[batchIndex].count);
         }
     }
+    device_.execute(passCommands_);
 }
 
-void Renderer::executeFullScreen(Shader* shader, ShaderFeatureList shaderFeatures) const
+void Renderer::executeShadowCasterPass(int cascade, const RenderView &view) const
+{
+    updateCameraUniformBuffer(shadowMap_.cascadeCamera(cascade), EyeType::None);
+
+    // Ensure that depth testing and depth write are on
+    // Shadow maps only have a depth buffer
+    passCommands_.clear();
+    passCommands_.bindFramebuffer(&shadowMap_.cascadeFramebuffer(cascade));
+    passCommands_.setState({ false, true, RenderBlendMode::Opaque });
+    passCommands_.clearDepth();
+    device_.execute(passCommands_);
+
+    // Draw the casters recorded for the cascade
+    device_.execute(view.commands);
+    passStats_[(int)view.pass].add(view.stats);
+
+    // Draw the terrain.
+    // Distant cascades cover many metres per texel, so the extra tessellation is not visible in them.
+    // Terrain details are too small to cast visible shadows, and are not drawn.
+    const Terrain* terrain = SceneManager::instance()->findComponentInScene<Terrain>();
+    if (terrain != nullptr)
+    {
+        const ShaderFeatureList tessellationFeatures = shadowMap_.HIGH_TESSELLATION_PER_CASCADE[cascade] ? SF_HighTessellation : 0;
+        passCommands_.clear();
+        recordTerrain(passCommands_, terrain, RenderManager::instance()->filterFeatureList(SF_DepthOnly | tessellationFeatures));
+        device_.execute(passCommands_);
+    }
+}
+
+void Renderer::recordTerrain(RenderCommandList &commands, const Terrain* terrain, ShaderFeatureList shaderFeatures) const
+{
+    commands.bindShader(context_.terrainShader, shaderFeatures);
+
+    //Set mesh and heightmap textures
+    commands.bindMesh(terrain->mesh());
+    commands.bindTexture(8, terrain->heightmap());
+    commands.bindTexture(11, terrain->heightmapTiles());
+    commands.bindTexture(12, terrain->heightmapTileIndirection());
+
+    // Render the terrain with tessellation
+    commands.drawPatches(terrain->mesh()->elementsCount());
+}
+
+void Renderer::executeFullScreen(Shader* shader, ShaderFeatureList shaderFeatures, RenderBlendMode blend) const
 {
     // "Full Screen" passes should write to all pixels that are not sky.
     // To do this, we render a full screen quad at the maximum depth
-    // and only render where the quad is further than the depth buffer value
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_GREATER);
-
+    // and only render where the quad is further than the depth buffer value.
     // Ensure that we arent' writing depth
-    glDepthMask(false);
+    passCommands_.clear();
+    passCommands_.setState({ true, false, blend });
 
     // Draw the full screen mesh
-    fullScreenMesh_->bind();
-    shader->bindVariant(shaderFeatures);
-    glDrawElements(GL_TRIANGLES, fullScreenMesh_->elementsCount(), GL_UNSIGNED_SHORT, (void*)0);
+    passCommands_.bindMesh(context_.fullScreenMesh);
+    passCommands_.bindShader(shader, shaderFeatures);
+    passCommands_.draw(context_.fullScreenMesh->elementsCount());
 
-    // Put the depth function back to normal
-    glDepthFunc(GL_LESS);
+    // Put the depth function and blending back to normal
+    passCommands_.setState({ false, false, RenderBlendMode::Opaque });
+    device_.execute(passCommands_);
 }
 
 void Renderer::executeDeferredAmbientOcclusionPass() const
 {
     // We only want to render into the occlusion gbuffer channel (gbuffer 0 alpha).
-    glColorMask(false, false, false, true);
-
     // Use min blending for alpha (= occlusion) so existing ao information is not lost
-    glEnable(GL_BLEND);
-    glBlendEquation(GL_MIN);
-
-    // Render the ao shader full screen
-    executeFullScreen(deferredAmbientOcclusionShader_, ALL_SHADER_FEATURES);
-
-    // Reset the color mask when done
-    glColorMask(true, true, true, true);
-
-    // Reset blending state
-    glDisable(GL_BLEND);
+    executeFullScreen(context_.deferredAmbientOcclusionShader, ALL_SHADER_FEATURES, RenderBlendMode::MinAlpha);
 }
 
 void Renderer::executeDeferredLightingPass() const
 {
-    executeFullScreen(deferredLightingShader_, ALL_SHADER_FEATURES);
+    executeFullScreen(context_.deferredLightingShader, ALL_SHADER_FEATURES);
 }
 
 void Renderer::executeDeferredDebugPass() const
 {
     RenderDebugMode mode = RenderManager::instance()->debugMode();
-    executeFullScreen(deferredDebugShader_, (ShaderFeatureList)mode | SF_SoftShadows);
+    executeFullScreen(context_.deferredDebugShader, (ShaderFeatureList)mode | SF_SoftShadows);
 }
 
 void Renderer::executeWaterPass() const
@@ -535,39 +1150,36 @@ void Renderer::executeWaterPass() const
     }
 
     // Ensure that depth testing and depth write are on
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(true);
-
     // Use alpha blending
     // The blend factor is output from the water fragment shader
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+    passCommands_.clear();
+    passCommands_.setState({ false, true, RenderBlendMode::Alpha });
 
     // Render the terrain mesh, using the water shader, with tessellation
-    waterShader_->bindVariant(ALL_SHADER_FEATURES);
-    terrain->mesh()->bind();
-    terrain->heightmap()->bind(8);
-    glDrawElements(GL_PATCHES, terrain->mesh()->elementsCount(), GL_UNSIGNED_SHORT, (void*)0);
+    passCommands_.bindShader(context_.waterShader, ALL_SHADER_FEATURES);
+    passCommands_.bindMesh(terrain->mesh());
+    passCommands_.bindTexture(8, terrain->heightmap());
+    passCommands_.drawPatches(terrain->mesh()->elementsCount());
 
     // Reset blending state
-    glDisable(GL_BLEND);
+    passCommands_.setState({ false, true, RenderBlendMode::Opaque });
+    device_.execute(passCommands_);
 }
 
 void Renderer::executeSkyboxPass(const Camera* camera) const
 {
     // Ensure that depth testing is turned on, but dont write depth
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(false);
+    passCommands_.clear();
+    passCommands_.setState({ false, false, RenderBlendMode::Opaque });
 
     // Ensure skybox shader is being used
-    skyboxShader_->bindVariant(ALL_SHADER_FEATURES);
+    passCommands_.bindShader(context_.skyboxShader, ALL_SHADER_FEATURES);
 
     // Ensure skybox mesh is being used
-    skyboxMesh_->bind();
+    passCommands_.bindMesh(context_.skyboxMesh);
 
     // Bind the sky lookup textures
-    skyTransmittanceLUT_.bind(5);
+    passCommands_.bindTexture(5, &context_.skyTransmittanceLUT);
 
     // Compute scale for skydome - must ensure it's big enough without exceeding far clipping plane
     const float farPlane = camera->farPlane();
@@ -582,30 +1194,27 @@ void Renderer::executeSkyboxPass(const Camera* camera) const
     // Set the local to world matrix in per draw data
     PerDrawUniformData data;
     data.localToWorld = translationMatrix * scaleMatrix;
-    perDrawUniformBuffer_.update(data);
+    passCommands_.uniformData((int)UniformBufferType::PerDrawBuffer, data);
 
     // Draw skybox mesh
-    glDrawElements(GL_TRIANGLES, skyboxMesh_->elementsCount(), GL_UNSIGNED_SHORT, (void*)0);
+    passCommands_.draw(context_.skyboxMesh->elementsCount());
+    device_.execute(passCommands_);
 }
 
 void Renderer::executeShieldPass() const
 {
     // Ensure that depth testing is turned on, but dont write depth
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(false);
-
     // Use alpha blending
-    glEnable(GL_BLEND);
-    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+    passCommands_.clear();
+    passCommands_.setState({ false, false, RenderBlendMode::Alpha });
 
     // Use the shield texture and shield mesh
-    shieldFlowTexture_->bind(6);
-    shieldOpacityTexture_->bind(7);
-    shieldMesh_->bind();
+    passCommands_.bindTexture(6, context_.shieldFlowTexture);
+    passCommands_.bindTexture(7, context_.shieldOpacityTexture);
+    passCommands_.bindMesh(context_.shieldMesh);
 
     // Use the shield shader
-    shieldShader_->bindVariant(ALL_SHADER_FEATURES);
+    passCommands_.bindShader(context_.shieldShader, ALL_SHADER_FEATURES);
 
     // Render each shield
     for (const Shield* shield : SceneManager::instance()->findAllComponentsInScene<Shield>())
@@ -616,26 +1225,11 @@ void Renderer::executeShieldPass() const
         const Matrix4x4 localToWorld = transformMat * radiusMat;
 
         // Draw the shield
-        updatePerDrawUniformBuffer(localToWorld, nullptr);
-        glDrawElements(GL_TRIANGLES, shieldMesh_->elementsCount(), GL_UNSIGNED_SHORT, (void*)0);
+        passCommands_.uniformData((int)UniformBufferType::PerDrawBuffer, perDrawUniformData(localToWorld, nullptr));
+        passCommands_.draw(context_.shieldMesh->elementsCount());
     }
 
     // Reset blending state
-    glDisable(GL_BLEND);
-}
-
-void Renderer::regenerateSkyTransmittanceLUT()
-{
-    // Ensure the lut wrap + clamp settings are correct
-    skyTransmittanceLUT_.setFilterMode(TextureFilterMode::Bilinear);
-    skyTransmittanceLUT_.setWrapMode(TextureWrapMode::Clamp);
-
-    // We run this process on the GPU.
-    // The result is stored in the texture, so make a framebuffer for it.
-    Framebuffer fbo;
-    fbo.attachColorTexture(&skyTransmittanceLUT_);
-
-    // Render to the fbo
-    fbo.use();
-    executeFullScreen(skyTransmittanceShader_, ALL_SHADER_FEATURES);
-}
+    passCommands_.setState({ false, false, RenderBlendMode::Opaque });
+    device_.execute(passCommands_);
+}
\ No newline at end of file
@@ -2,19 +2,88 @@
 
 #include <vector>
 
+#include "Renderer/DynamicResolution.h"
+#include "Renderer/FrameRingBuffer.h"
 #include "Renderer/Framebuffer.h"
+#include "Renderer/GLRenderDevice.h"
+#include "Renderer/GpuTimer.h"
+#include "Renderer/FrustumCuller.h"
+#include "Renderer/InstanceBatcher.h"
+#include "Renderer/OcclusionCuller.h"
+#include "Renderer/RenderCommandList.h"
+#include "Renderer/RenderGraph.h"
+#include "Renderer/RenderQueue.h"
+#include "Renderer/RenderStats.h"
+#include "Renderer/RendererContext.h"
 #include "Renderer/Shader.h"
+#include "Renderer/ShadowMap.h"
+#include "Renderer/StorageBuffer.h"
 #include "Renderer/UniformBuffer.h"
 
 #include "Scene/Camera.h"
 #include "Renderer/Mesh.h"
-#include "Renderer/ShadowMap.h"
+
+class Material;
+class Scene;
+class ShaderWarmup;
+class StaticMesh;
+class Terrain;
+
+// The cpu side work for one view of the scene, either a shadow cascade or a camera eye.
+// Views are culled and recorded in parallel on worker threads, and their
+// command lists are then replayed in order on the thread that owns the gl context.
+struct RenderView
+{
+    // Inactive views are not recorded or drawn
+    bool active;
+
+    RenderQueuePass pass;
+    ShaderFeatureList shaderFeatures;
+
+    // The region to cull against, and the point draws are sorted from
+    Frustum frustum;
+    Point3 viewPosition;
+
+    // The camera that levels of detail are chosen for, the size on screen of one unit at a distance of
+    // one unit, and the bias added to the choice. Orthographic cameras ignore the distance.
+    Point3 lodPosition;
+    float lodPixelsPerUnit;
+    bool lodOrthographic;
+    float lodBias;
+
+    // The depth buffer of occluders to test against, or null to skip occlusion culling
+    const OcclusionCuller* occlusionCuller;
+
+    // The static meshes, terrain detail batches and terrain object batches left after culling,
+    // and how many were hidden by occluders
+    std::vector<int> visibleStaticMeshes;
+    std::vector<int> visibleDetailBatches;
+    std::vector<int> visibleObjectBatches;
+    int occludedObjects;
+
+    // A signature of the visible shadow casters, for cached shadow cascades
+    uint64_t casterSignature;
+
+    // The per-view state used while recording, kept between frames to reuse its memory
+    RenderQueue renderQueue;
+    InstanceBatcher instanceBatcher;
+    RenderCommandList commands;
+    RenderQueueStats stats;
+
+    // The material table index of each material in the instance batcher, and of each instance
+    std::vector<uint32_t> materialTableIndices;
+    std::vector<uint32_t> instanceMaterialIndices;
+};
 
 class Renderer
 {
 private:
     const static int GBUFFER_RENDER_TARGETS = 2;
 
+    // The features the camera's gbuffer pass draws with.
+    // The shader warmup uses the same list, so that it creates the variants the pass binds.
+    const static ShaderFeatureList CAMERA_PASS_FEATURES = ALL_SHADER_FEATURES;
+
 public:
     // Creates a renderer that draws directly to the back buffer
     Renderer();
@@ -25,6 +94,11 @@ public:
 
     ~Renderer();
 
+    // Changes the framebuffer(s) being rendered to, such as after a view is resized.
+    // The number of framebuffers must not change. Only the per-view targets are rebound,
+    // as the shared resources do not depend on the view size.
+    void setTargetFramebuffers(const std::vector<Framebuffer*> &targetFramebuffers);
+
     // Renders a new frame from the point of view
     // of the specified camera.
     void renderFrame(const Camera* camera);
@@ -33,83 +107,153 @@ public:
     // of the currently rendered objects.
     void renderPhysicsObjects(const Camera* camera);
 
+    // Queues the shader variants needed to draw the current scene, when the scene or the
+    // enabled features change, and spends up to the given time creating queued variants.
+    // Returns true once every queued variant is ready, so callers can show a loading
+    // screen until then. The progress is available from RenderManager::shaderWarmup().
+    bool warmUpShaders(float maxMilliseconds = 8.0f);
+
+    // The render queue state changes and draws made in a pass during the last frame.
+    // Passes that run more than once per frame, such as shadow cascades, are added together.
+    const RenderQueueStats& passStats(RenderQueuePass pass) const { return passStats_[(int)pass]; }
+
+    // The draws, uploads, and cpu and gpu times of each pass, for the most recent frame whose gpu timings
+    // have been read back. This is a few frames behind the current frame, and is null until the first one arrives.
+    const RenderFrameStats* frameStats() const { return statsHistory_.latest(); }
+
+    // The number of static meshes and detail batches in view during the last frame that were hidden by occluders
+    int occludedObjectCount() const;
+
+    // Controls which shadow cascades are re-rendered each frame, and counts how often each one was reused.
+    // Each renderer has its own cache, as cascades follow the renderer's camera.
+    ShadowCascadeCache& shadowCascadeCache() { return shadowMap_.cascadeCache(); }
+    const ShadowCascadeCache& shadowCascadeCache() const { return shadowMap_.cascadeCache(); }
+
+    // Chooses the scale the scene is rendered at, when dynamic resolution is enabled in the RenderManager.
+    // The frame budget and range of scales can be changed, such as to hold 90 Hz in vr.
+    DynamicResolution& dynamicResolution() { return dynamicResolution_; }
+    const DynamicResolution& dynamicResolution() const { return dynamicResolution_; }
+
 private:
-    // The framebuffer being rendered to
-    const std::vector<Framebuffer*> targetFramebuffers_;
+    // Identifies the renderer in the stats file, as several renderers can draw each frame
+    static int nextId_;
+    int id_;
 
-    // The depth buffer texture ids for each framebuffer
-    std::vector<GLint> framebufferDepthTextures_;
+    // The framebuffer being rendered to
+    std::vector<Framebuffer*> targetFramebuffers_;
 
-    // The current GBuffer objects
-    Texture* gbufferTextures_[GBUFFER_RENDER_TARGETS];
+    // The framebuffers used to render into the gbuffer, one per target framebuffer.
+    // The gbuffer textures come from the render target pool and are attached each frame.
     std::vector<Framebuffer> gbufferFramebuffers_;
 
-    // The shadow map rendering manager
+    // The framebuffers used to render the scene below the target resolution, one per target framebuffer.
+    // Their color and depth textures come from the render target pool, and are upscaled into the target.
+    std::vector<Framebuffer> scaledFramebuffers_;
+
+    // The passes rendered this frame
+    RenderGraph frameGraph_;
+
+    // The shared shaders, meshes and lookup textures
+    RendererContext& context_;
+
+    // The shadow cascades for this renderer's camera, rendered into the context's shared shadow atlas.
+    // Each renderer has its own cameras and cache, so that other cameras do not move its cascades.
     ShadowMap shadowMap_;
 
-    // A full screen triangle used for screen space passes
-    Mesh* fullScreenMesh_;
+    // The scene, camera, per-draw and terrain uniform data for the frames in flight.
+    // Each update is written to a new range of the buffer, so never reallocates or stalls.
+    mutable FrameRingBuffer uniformRing_;
+
+    // Replays the recorded command lists with gl, uploading their data into the uniform ring
+    mutable GLRenderDevice device_;
 
-    // Uniform buffers used in different render stages
-    UniformBuffer<SceneUniformData> sceneUniformBuffer_;
-    UniformBuffer<CameraUniformData> cameraUniformBuffer_;
-    UniformBuffer<PerDrawUniformData> perDrawUniformBuffer_;
-    UniformBuffer<TerrainUniformData> terrainUniformBuffer_;
-    UniformBuffer<TerrainDetailsData> terrainDetailsUniformBuffer_;
+    // The terrain, full screen and forward draws of the pass being executed.
+    // Each pass records into it and then replays it straight away.
+    mutable RenderCommandList passCommands_;
 
-    // Shaders used for gbuffer pass
-    Shader* standardShader_;
-    Shader* terrainShader_;
-    Shader* terrainDetailMeshShader_;
+    // The framebuffer binds, texture binds and uniform uploads that set up a pass before it draws.
+    // Each is recorded and then replayed straight away, like the pass commands.
+    mutable RenderCommandList setupCommands_;
 
-    // Shaders used for deferred passes
-    Shader* deferredAmbientOcclusionShader_;
-    Shader* deferredLightingShader_;
-    Shader* deferredDebugShader_;
+    // The static meshes drawn this frame, and a culler holding their world bounds.
+    // Each view culls them into its own visibility list.
+    std::vector<StaticMesh*> frameStaticMeshes_;
+    std::vector<Bounds> frameStaticMeshBounds_;
+    FrustumCuller staticMeshCuller_;
 
-    // Shader used for the forward water pass
-    Shader* waterShader_;
+    // The occluder depth buffer for each target framebuffer
+    std::vector<OcclusionCuller> occlusionCullers_;
 
-    // Shader used for the shield rendering pass
-    Shader* shieldShader_;
-    Texture* shieldFlowTexture_;
-    Texture* shieldOpacityTexture_;
-    Mesh* shieldMesh_;
+    // One view per shadow cascade, followed by one per target framebuffer
+    std::vector<RenderView> views_;
 
-    // Resources used for skybox shader pass
-    Shader* skyboxShader_;
-    Mesh* skyboxMesh_;
+    // Picks the resolution scale from the gpu time taken by recent frames
+    DynamicResolution dynamicResolution_;
 
-    // A shader used for generating the transmittance LUT
-    Shader* skyTransmittanceShader_;
+    // Times each pass on the gpu, and keeps each frame's pass stats until its timings are read back
+    GpuTimer gpuTimer_;
+    RenderStatsHistory statsHistory_;
+    RenderFrameStats* frameStats_;
 
-    // Sky lookup textures
-    Texture skyTransmittanceLUT_;
+    // The draw counters for each pass in the current frame
+    mutable RenderQueueStats passStats_[RENDER_QUEUE_PASS_COUNT];
 
-    // The poisson disks used for ambient occlusion
-    Vector4 poissonDisks_[16];
+    // The scene and enabled features that shader variants were last queued for
+    const Scene* warmedScene_;
+    ShaderFeatureList warmedFeatures_;
 
-    // Meshes and shaders used for rendering physics objects for debugging
-    Shader* physicsDebugShader_;
-    Mesh* physicsBoxMesh_;
-    Mesh* physicsSphereMesh_;
+    // Adds a pass to the frame graph that counts the work it submits, and times it on the cpu and gpu.
+    // The view is the target framebuffer the pass draws for, or -1 for passes shared by every view.
+    int addPass(const std::string &name, int view, const RenderGraph::PassFunction &execute);
 
-    // GBuffer management
-    void createGBuffer();
-    void destroyGBuffer();
+    // Adds the gbuffer, deferred and forward passes for one target framebuffer to the frame graph.
+    // The shadow map resource is -1 when shadows are disabled. Below a scale of one, the passes
+    // render into smaller textures, followed by a pass that upscales them into the target.
+    void addViewPasses(const Camera* camera, unsigned int fb, RenderGraphResource shadowMap, float resolutionScale);
 
-    // Methods for updating the contents of uniform buffers
+    // Queues every shader variant that the current scene may use
+    void queueShaderWarmup(ShaderWarmup &warmup) const;
+
+    // Methods for updating the contents of uniform buffers, through the device
     void updateSceneUniformBuffer() const;
-    void updateCameraUniformBuffer(const Camera* camera, EyeType eye) const;
-    void updatePerDrawUniformBuffer(const Matrix4x4 &localToWorld, const Material* material) const;
+    void updateCameraUniformBuffer(const Camera* camera, EyeType eye, float resolutionScale = 1.0f) const;
     void updateTerrainUniformBuffer(const Terrain* terrain) const;
-    void updateTerrainDetailsUniformBuffer(const DetailBatch& details) const;
 
-    // Renders a full geometry pass using the specified camera
-    void executeGeometryPass(const Camera* camera, ShaderFeatureList shaderFeatures) const;
+    // Builds the per-draw uniform data for a transform and material.
+    // Does not use the gl context, so can be called while recording on worker threads.
+    PerDrawUniformData perDrawUniformData(const Matrix4x4 &localToWorld, const Material* material) const;
+
+    // Draws the terrain and the occluder static meshes into a view's occlusion culler
+    void drawOccluders(OcclusionCuller &culler, const Matrix4x4 &worldToClip, const Terrain* terrain) const;
+
+    // Culls the static meshes and terrain details to a view.
+    // Shadow cascade views also build their caster signature.
+    // Runs on worker threads.
+    void cullView(RenderView &view, const Terrain* terrain) const;
+
+    // Chooses the level of detail of a mesh from the size of its world bounds on screen.
+    // Runs on worker threads.
+    int selectLod(const RenderView &view, const Mesh* mesh, const Bounds &worldBounds) const;
+
+    // Records the draws for a view into its command list.
+    // Visible meshes are grouped into multi draw batches, and the remaining draws
+    // are sorted through the view's render queue to minimise state changes.
+    // Runs on worker threads.
+    void recordView(RenderView &view, const Terrain* terrain) const;
 
-    // Renders a full screen pass using the specifed shader
-    void executeFullScreen(Shader* shader, ShaderFeatureList shaderFeatures) const;
+    // Renders a full geometry pass for a camera view.
+    // The view's recorded draws are replayed, followed by the terrain and its details.
+    void executeGeometryPass(const RenderView &view, ShaderFeatureList shaderFeatures) const;
+
+    // Renders the shadow casters for a cascade with depth only shaders.
+    // The view's recorded casters are replayed, followed by the terrain.
+    void executeShadowCasterPass(int cascade, const RenderView &view) const;
+
+    // Records the terrain draw, with tessellation, into a command list
+    void recordTerrain(RenderCommandList &commands, const Terrain* terrain, ShaderFeatureList shaderFeatures) const;
+
+    // Renders a full screen pass using the specifed shader and blending
+    void executeFullScreen(Shader* shader, ShaderFeatureList shaderFeatures, RenderBlendMode blend = RenderBlendMode::Opaque) const;
 
     // Methods for each render pass
     void executeDeferredAmbientOcclusionPass() const;
@@ -118,8 +262,4 @@ private:
     void executeWaterPass() const;
     void executeSkyboxPass(const Camera* camera) const;
     void executeShieldPass() const;
-
-    // Computes the sky transmittance lut
-    // This is slow and should only be done when needed (aka when the atmosphere composition changes).
-    void regenerateSkyTransmittanceLUT();
 };
@@ -0,0 +1,132 @@
+#include "RendererContext.h"
+
+#include <GL/gl3w.h>
+
+#include "Math/Random.h"
+#include "Renderer/Framebuffer.h"
+#include "Renderer/Material.h"
+#include "Renderer/Mesh.h"
+#include "Renderer/Shader.h"
+#include "ResourceManager.h"
+
+RendererContext::RendererContext()
+    : skyTransmittanceLUT(TextureFormat::RGB16F, 256, 256),
+    shadowAtlas(),
+    materialTable(),
+    materialTableBuffer(StorageBufferType::MaterialTableBuffer)
+{
+    fullScreenMesh = ResourceManager::instance()->load<Mesh>("Resources/Meshes/full_screen_mesh.mesh");
+
+    // Load the shaders required for each render pass
+    standardShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/Standard.shader");
+    terrainShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/Terrain.shader");
+    terrainDetailMeshShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/TerrainDetail.shader");
+    waterShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/Water.shader");
+    deferredAmbientOcclusionShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/Deferred-AmbientOcclusion.shader");
+    deferredLightingShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/Deferred-Lighting.shader");
+    deferredDebugShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/Deferred-Debug.shader");
+
+    // Load shield rendering resources
+    shieldShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/Shield.shader");
+    shieldFlowTexture = ResourceManager::instance()->load<Texture>("Resources/Textures/shield_flow.tga");
+    shieldOpacityTexture = ResourceManager::instance()->load<Texture>("Resources/Textures/shield_opacity.tga");
+    shieldMesh = ResourceManager::instance()->load<Mesh>("Resources/Meshes/sphere.obj");
+
+    // Load skybox shader and mesh
+    skyboxShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/SkyboxPass.shader");
+    skyboxMesh = ResourceManager::instance()->load<Mesh>("Resources/Meshes/skybox.obj");
+    skyTransmittanceShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/Sky/PrecomputeTransmittance.shader");
+
+    // Load the resources needed for physics debugging
+    physicsDebugShader = ResourceManager::instance()->load<Shader>("Resources/Shaders/PhysicsDebug.shader");
+    physicsBoxMesh = ResourceManager::instance()->load<Mesh>("Resources/Meshes/cube.obj");
+    physicsSphereMesh = ResourceManager::instance()->load<Mesh>("Resources/Meshes/sphere.obj");
+
+    // Load the default material, used by draws without a material
+    defaultMaterial = ResourceManager::instance()->load<Material>("Resources/Materials/default.material");
+    materialTable.add(defaultMaterial);
+
+    // Generate the sky transmittance lut on startup.
+    // It should be ok for the entire app lifetime and shouldn't need to be remade.
+    regenerateSkyTransmittanceLUT();
+
+    // Generate the random poisson disks on startup.
+    for (int i = 0; i < 16; ++i)
+    {
+        const Vector2 disk = random_in_unit_circle();
+        poissonDisks[i] = Vector4(disk.x, disk.y, 0.0f, 0.0f);
+    }
+}
+
+void RendererContext::regenerateSkyTransmittanceLUT()
+{
+    // Ensure the lut wrap + clamp settings are correct
+    skyTransmittanceLUT.setFilterMode(TextureFilterMode::Bilinear);
+    skyTransmittanceLUT.setWrapMode(TextureWrapMode::Clamp);
+
+    // We run this process on the GPU.
+    // The result is stored in the texture, so make a framebuffer for it.
+    Framebuffer fbo;
+    fbo.attachColorTexture(&skyTransmittanceLUT);
+    fbo.use();
+
+    // Render the full screen mesh into the lut, without writing depth
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_GREATER);
+    glDepthMask(false);
+    fullScreenMesh->bind();
+    skyTransmittanceShader->bindVariant(ALL_SHADER_FEATURES);
+    glDrawElements(GL_TRIANGLES, fullScreenMesh->elementsCount(), fullScreenMesh->indexType(), (void*)0);
+    glDepthFunc(GL_LESS);
+}
+
+void RendererContext::updateMaterialTable()
+{
+    // Free the entries of materials that are no longer drawn, such as the materials of a previous scene.
+    // The resource manager keeps materials loaded, so entries are freed once nothing has drawn them for a while.
+    materialTable.removeUnused(MaterialTable::MAX_UNUSED_UPDATES);
+
+    // Refresh the entries of materials that were edited or reloaded, or whose textures were reloaded.
+    // Changing a texture also changes the material, so the texture load counts only need to be added together.
+    for (int i = 0; i < materialTable.size(); ++i)
+    {
+        const Material* material = materialTable.material(i);
+        if (material == nullptr)
+        {
+            continue;
+        }
+
+        const uint32_t textureLoads = ((material->albedoTexture() == nullptr) ? 0 : material->albedoTexture()->loadCount())
+            + ((material->normalMapTexture() == nullptr) ? 0 : material->normalMapTexture()->loadCount());
+        const uint64_t version = material->changeCount() | ((uint64_t)textureLoads << 32);
+        if (!materialTable.needsRefresh(i, version))
+        {
+            continue;
+        }
+
+        MaterialData data;
+        data.colorSmoothness = material->color();
+        data.colorSmoothness.a = material->smoothness();
+        data.albedoTexture = (material->albedoTexture() == nullptr) ? 0 : material->albedoTexture()->bindlessHandle();
+        data.normalMapTexture = (material->normalMapTexture() == nullptr) ? 0 : material->normalMapTexture()->bindlessHandle();
+        materialTable.set(i, data, version);
+    }
+
+    // Upload the changed range, or the whole table when new materials no longer fit in the buffer
+    if (materialTable.dirty())
+    {
+        if (materialTable.size() > materialTableBuffer.count())
+        {
+            materialTableBuffer.update(materialTable.entries().data(), materialTable.size());
+        }
+        else
+        {
+            materialTableBuffer.updateRange(&materialTable.entries()[materialTable.firstDirty()], materialTable.firstDirty(), materialTable.dirtyCount());
+        }
+
+        materialTable.clearDirty();
+    }
+
+    materialTableBuffer.use();
+    materialTable.nextUpdate();
+}
\ No newline at end of file
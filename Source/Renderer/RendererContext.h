@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Renderer/MaterialTable.h"
+#include "Renderer/ShadowMap.h"
+#include "Renderer/StorageBuffer.h"
+#include "Renderer/Texture.h"
+#include "Math/Vector4.h"
+
+class Material;
+class Mesh;
+class Shader;
+
+// The render resources shared by every renderer, such as shaders, meshes and lookup textures.
+// These are created once and do not depend on the size of a view or on a camera, so the game panel,
+// full screen and vr renderers all use the same context, and creating or resizing a renderer is cheap.
+// Anything that depends on a renderer's camera, such as the shadow cascade cameras, belongs to the renderer.
+class RendererContext
+{
+public:
+    RendererContext();
+
+    // Prevent the context from being copied
+    RendererContext(const RendererContext&) = delete;
+    RendererContext& operator=(const RendererContext&) = delete;
+
+    // A full screen triangle used for screen space passes
+    Mesh* fullScreenMesh;
+
+    // Shaders used for gbuffer pass
+    Shader* standardShader;
+    Shader* terrainShader;
+    Shader* terrainDetailMeshShader;
+
+    // Shaders used for deferred passes
+    Shader* deferredAmbientOcclusionShader;
+    Shader* deferredLightingShader;
+    Shader* deferredDebugShader;
+
+    // Shader used for the forward water pass
+    Shader* waterShader;
+
+    // Shader used for the shield rendering pass
+    Shader* shieldShader;
+    Texture* shieldFlowTexture;
+    Texture* shieldOpacityTexture;
+    Mesh* shieldMesh;
+
+    // Resources used for skybox shader pass
+    Shader* skyboxShader;
+    Mesh* skyboxMesh;
+
+    // A shader used for generating the transmittance LUT
+    Shader* skyTransmittanceShader;
+
+    // Sky lookup textures
+    Texture skyTransmittanceLUT;
+
+    // The texture every renderer's shadow cascades are rendered into
+    ShadowAtlas shadowAtlas;
+
+    // The poisson disks used for ambient occlusion
+    Vector4 poissonDisks[16];
+
+    // The material used by draws that do not specify one.
+    // Loaded up front, as the resource manager cannot be used from worker threads.
+    Material* defaultMaterial;
+
+    // Every material that has been drawn, which draws refer to by index.
+    // The default material is always the first entry.
+    MaterialTable materialTable;
+    StorageBuffer<MaterialData> materialTableBuffer;
+
+    // Meshes and shaders used for rendering physics objects for debugging
+    Shader* physicsDebugShader;
+    Mesh* physicsBoxMesh;
+    Mesh* physicsSphereMesh;
+
+    // Computes the sky transmittance lut
+    // This is slow and should only be done when needed (aka when the atmosphere composition changes).
+    void regenerateSkyTransmittanceLUT();
+
+    // Frees unused material table entries, refreshes the entries whose materials changed, uploads them and binds the table.
+    // Materials must be added to the table first, before any views are recorded.
+    void updateMaterialTable();
+};
\ No newline at end of file
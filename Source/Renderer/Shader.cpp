@@ -10,6 +10,23 @@
 
 #include "ResourceManager.h"
 #include "RenderManager.h"
+#include "Renderer/ShaderBinaryCache.h"
+
+namespace
+{
+    // The name of a shader stage, for error messages
+    const char* stageName(GLenum stage)
+    {
+        switch (stage)
+        {
+        case GL_VERTEX_SHADER: return "vertex";
+        case GL_FRAGMENT_SHADER: return "fragment";
+        case GL_TESS_CONTROL_SHADER: return "tessellation control";
+        case GL_TESS_EVALUATION_SHADER: return "tessellation evaluation";
+        default: return "unknown";
+        }
+    }
+}
 
 ShaderInclude::ShaderInclude(ResourceID resourceID)
     : Resource(resourceID),
@@ -45,7 +62,9 @@ void ShaderInclude::unload()
 }
 
 ShaderVariant::ShaderVariant(ShaderFeatureList features, const std::string &originalSource)
-    : features_(features)
+    : features_(features),
+    program_(0),
+    binaryKey_(0)
 {
     // The single file contains the vertex and fragment shader source code,
     // #ifdef VERTEX_SHADER and #ifdef FRAGMENT_SHADER are used to separate
@@ -53,83 +72,45 @@ ShaderVariant::ShaderVariant(ShaderFeatureList features, const std::string &orig
     // Apply preprocessing to the source code for each shader stage.
     // This adds stage-specific and variant-specific #defines and handles
     // custom preprocessor steps (eg adding extra source code and the version header).
-    const std::string vertexSource = preprocessSource(GL_VERTEX_SHADER, originalSource);
-    const std::string fragmentSource = preprocessSource(GL_FRAGMENT_SHADER, originalSource);
+    std::vector<GLenum> stages = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    std::vector<std::string> sources = { preprocessSource(GL_VERTEX_SHADER, originalSource), preprocessSource(GL_FRAGMENT_SHADER, originalSource) };
 
-    // Attempt to compile the vertex shader code.
-    GLuint vertexShader;
-    if (!compileShader(GL_VERTEX_SHADER, vertexSource.c_str(), vertexShader))
+    // If detected in the source code, also use tessellation control and evaluation shaders
+    if (sources[0].find("TESS_CONTROL_SHADER") != std::string::npos)
     {
-        printf("Failed to compile vertex shader");
+        stages.push_back(GL_TESS_CONTROL_SHADER);
+        sources.push_back(preprocessSource(GL_TESS_CONTROL_SHADER, originalSource));
     }
-
-    // Attempt to compile the fragment shader code.
-    GLuint fragmentShader;
-    if (!compileShader(GL_FRAGMENT_SHADER, fragmentSource.c_str(), fragmentShader))
+    if (sources[0].find("TESS_EVALUATION_SHADER") != std::string::npos)
     {
-        printf("Failed to compile fragment shader");
+        stages.push_back(GL_TESS_EVALUATION_SHADER);
+        sources.push_back(preprocessSource(GL_TESS_EVALUATION_SHADER, originalSource));
     }
 
-    // Create and link the shader program.
-    program_ = glCreateProgram();
-    glAttachShader(program_, vertexShader);
-    glAttachShader(program_, fragmentShader);
-
-    // If detected in the source code, also compile a tessellation control shader
-    if (vertexSource.find("TESS_CONTROL_SHADER") != std::string::npos)
+    // Use the program binary from a previous run if there is one, so no glsl is compiled.
+    // Otherwise start compiling the program. The binary is stored for next time once it has linked.
+    ShaderBinaryCache& cache = RenderManager::instance()->shaderBinaryCache();
+    binaryKey_ = cache.makeKey(sources, features);
+    if (!loadProgramBinary(cache, binaryKey_))
     {
-        const std::string tessEvaluationSource = preprocessSource(GL_TESS_CONTROL_SHADER, originalSource);
-        GLuint tessEvaluationShader;
-        if (!compileShader(GL_TESS_CONTROL_SHADER, tessEvaluationSource.c_str(), tessEvaluationShader))
-        {
-            printf("Failed to compile tessellation control shader \n");
-        }
-        else
-        {
-            glAttachShader(program_, tessEvaluationShader);
-        }
+        startCompiling(stages, sources);
     }
 
-    // If detected in the source code, also compile a tessellation evaluation shader
-    if(vertexSource.find("TESS_EVALUATION_SHADER") != std::string::npos)
-    {
-        const std::string tessEvaluationSource = preprocessSource(GL_TESS_EVALUATION_SHADER, originalSource);
-        GLuint tessEvaluationShader;
-        if(!compileShader(GL_TESS_EVALUATION_SHADER, tessEvaluationSource.c_str(), tessEvaluationShader))
-        {
-            printf("Failed to compile tessellation evaluation shader \n");
-        }
-        else
-        {
-            glAttachShader(program_, tessEvaluationShader);
-        }
-    }
-
-    glLinkProgram(program_);
-
     // We are using program id 0 to mean no program.
     // Ensure that opengl does not create a program with id 0.
     assert(program_ != 0);
 
-    // Check that the program linking succeeded.
-    if (!checkLinkerErrors(program_))
-    {
-        printf("Failed to create program \n");
-    }
-
-    // We no longer need the vertex and fragment shader objects
-    // as the shader program is now compiled.
-    glDetachShader(program_, vertexShader);
-    glDetachShader(program_, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
     // Specify that tessellation is always on triangles (aka patches of 3)
     glPatchParameteri(GL_PATCH_VERTICES, 3);
 }
 
 ShaderVariant::~ShaderVariant()
 {
+    for (GLuint shader : compilingShaders_)
+    {
+        glDeleteShader(shader);
+    }
+
     if (program_ != 0)
     {
         glDeleteProgram(program_);
@@ -141,10 +122,15 @@ ShaderVariant::ShaderVariant(ShaderVariant&& other)
     // Steal the contents of other
     features_ = other.features_;
     program_ = other.program_;
+    binaryKey_ = other.binaryKey_;
+    compilingShaders_ = std::move(other.compilingShaders_);
+    compilingStages_ = std::move(other.compilingStages_);
 
     // Reset other
     other.features_ = 0;
     other.program_ = 0;
+    other.compilingShaders_.clear();
+    other.compilingStages_.clear();
 }
 
 ShaderVariant& ShaderVariant::operator=(ShaderVariant&& other)
@@ -154,17 +140,79 @@ ShaderVariant& ShaderVariant::operator=(ShaderVariant&& other)
         // Steal the contents of other
         features_ = other.features_;
         program_ = other.program_;
+        binaryKey_ = other.binaryKey_;
+        compilingShaders_ = std::move(other.compilingShaders_);
+        compilingStages_ = std::move(other.compilingStages_);
 
         // Reset other
         other.features_ = 0;
         other.program_ = 0;
+        other.compilingShaders_.clear();
+        other.compilingStages_.clear();
     }
 
     return *this;
 }
 
-void ShaderVariant::bind() const
+bool ShaderVariant::isCompiling() const
+{
+    if (compilingShaders_.empty())
+    {
+        return false;
+    }
+
+    // Without parallel compilation, the driver compiles when the result is first needed,
+    // so asking it would only wait. Treat the program as finished instead.
+    if (!RenderManager::instance()->parallelShaderCompile())
+    {
+        return false;
+    }
+
+    GLint complete = GL_FALSE;
+    glGetProgramiv(program_, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_FALSE;
+}
+
+void ShaderVariant::finishCompiling()
 {
+    if (compilingShaders_.empty())
+    {
+        return;
+    }
+
+    // Check each stage compiled. This waits for the driver if it is still compiling.
+    for (size_t i = 0; i < compilingShaders_.size(); ++i)
+    {
+        if (!checkShaderErrors(compilingShaders_[i]))
+        {
+            printf("Error compiling shader with ID: %d \n", compilingShaders_[i]);
+            printf("Failed to compile %s shader \n", stageName(compilingStages_[i]));
+        }
+    }
+
+    // Check that the program linking succeeded.
+    if (!checkLinkerErrors(program_))
+    {
+        printf("Failed to create program \n");
+    }
+
+    // We no longer need the shader objects as the shader program is now compiled.
+    for (GLuint shader : compilingShaders_)
+    {
+        glDetachShader(program_, shader);
+        glDeleteShader(shader);
+    }
+    compilingShaders_.clear();
+    compilingStages_.clear();
+
+    // Store the binary, so the next run does not need to compile
+    saveProgramBinary(RenderManager::instance()->shaderBinaryCache(), binaryKey_);
+}
+
+void ShaderVariant::bind()
+{
+    // Variants that are still compiling must finish before they can be used
+    finishCompiling();
     glUseProgram(program_);
 }
 
@@ -197,6 +245,9 @@ std::string ShaderVariant::createFeatureDefines() const
     if (hasFeature(SF_DebugShadows)) defines += "#define DEBUG_SHADOWS \n";
     if (hasFeature(SF_DebugShadowCascades)) defines += "#define DEBUG_SHADOW_CASCADES \n";
     if (hasFeature(SF_AmbientOcclusion)) defines += "#define AMBIENT_OCCLUSION_ON \n";
+    if (hasFeature(SF_Instancing)) defines += "#define INSTANCING_ON \n";
+    if (hasFeature(SF_DepthOnly)) defines += "#define DEPTH_ONLY \n";
+    if (hasFeature(SF_InstancedMaterials)) defines += "#define INSTANCED_MATERIALS \n";
 
     return defines;
 }
@@ -256,21 +307,76 @@ std::string ShaderVariant::preprocessSource(GLenum shaderStage, const std::strin
     return finalSource;
 }
 
-bool ShaderVariant::compileShader(GLenum type, const char* shader, GLuint& id)
+bool ShaderVariant::loadProgramBinary(ShaderBinaryCache &cache, uint64_t key)
 {
-    //Setup and compile shader
-    id = glCreateShader(type);
-    glShaderSource(id, 1, &shader, NULL);
-    glCompileShader(id);
+    ProgramBinary binary;
+    if (!cache.load(key, binary))
+    {
+        return false;
+    }
+
+    program_ = glCreateProgram();
+    glProgramBinary(program_, binary.format, binary.data.data(), (GLsizei)binary.data.size());
 
-    if (!checkShaderErrors(id))
+    // Drivers reject binaries made by other driver versions.
+    // Remove the binary and compile instead, which stores a new one.
+    GLint linked = 0;
+    glGetProgramiv(program_, GL_LINK_STATUS, &linked);
+    if (!linked)
     {
-        printf("Error compiling shader with ID: %d \n", id);
+        glDeleteProgram(program_);
+        program_ = 0;
+        cache.remove(key);
         return false;
     }
+
     return true;
 }
 
+void ShaderVariant::saveProgramBinary(ShaderBinaryCache &cache, uint64_t key) const
+{
+    // Only store programs that linked
+    GLint linked = 0;
+    glGetProgramiv(program_, GL_LINK_STATUS, &linked);
+    GLint length = 0;
+    glGetProgramiv(program_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!linked || length <= 0 || !cache.enabled())
+    {
+        return;
+    }
+
+    ProgramBinary binary;
+    binary.data.resize(length);
+    GLenum format = 0;
+    glGetProgramBinary(program_, length, nullptr, &format, binary.data.data());
+    binary.format = format;
+    cache.save(key, binary);
+}
+
+void ShaderVariant::startCompiling(const std::vector<GLenum> &stages, const std::vector<std::string> &sources)
+{
+    program_ = glCreateProgram();
+
+    // Ask the driver to keep the binary, so it can be stored after linking
+    glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    // Start compiling the code for each stage.
+    // The results are not checked here, as that would wait for the compile to finish.
+    for (size_t i = 0; i < stages.size(); ++i)
+    {
+        const char* source = sources[i].c_str();
+        const GLuint shader = glCreateShader(stages[i]);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+
+        glAttachShader(program_, shader);
+        compilingShaders_.push_back(shader);
+        compilingStages_.push_back(stages[i]);
+    }
+
+    glLinkProgram(program_);
+}
+
 bool ShaderVariant::checkShaderErrors(GLuint shaderID)
 {
     //Check shader compile
@@ -355,18 +461,35 @@ void Shader::bindVariant(ShaderFeatureList features)
     // Ensure only globally enabled features are used
     features = RenderManager::instance()->filterFeatureList(features);
 
-    //Loop through all variants to see if it already exists.
-    for (int variant = 0; variant < loadedVariants_.size(); ++variant)
+    // Find the variant with the same features, or create it if it does not exist yet.
+    findOrCreateVariant(features).bind();
+}
+
+bool Shader::prepareVariant(ShaderFeatureList features)
+{
+    // Ensure only globally enabled features are used
+    features = RenderManager::instance()->filterFeatureList(features);
+
+    // Start creating the variant if needed, and finish it once the driver has compiled it
+    ShaderVariant& variant = findOrCreateVariant(features);
+    if (variant.isCompiling())
     {
-        ShaderVariant& current = loadedVariants_[variant];
-        if (current.features() == features)
-        {
-            current.bind();
-            return;
-        }
+        return false;
     }
 
-    //If not, compile and bind new variant, and add it to the list.
-    loadedVariants_.push_back(ShaderVariant(features, originalSource_));
-    loadedVariants_.back().bind();
+    variant.finishCompiling();
+    return true;
 }
+
+ShaderVariant& Shader::findOrCreateVariant(ShaderFeatureList features)
+{
+    const auto found = loadedVariants_.find(features);
+    if (found != loadedVariants_.end())
+    {
+        return found->second;
+    }
+
+    //If not, create a new variant, and add it to the map.
+    const auto inserted = loadedVariants_.emplace(features, ShaderVariant(features, originalSource_));
+    return inserted.first->second;
+}
\ No newline at end of file
@@ -1,69 +1,13 @@
 #pragma once
 
 #include <GL/gl3w.h>
+#include <unordered_map>
 #include  <vector>
 
 #include "ResourceManager.h"
+#include "Renderer/ShaderFeatures.h"
 #include "Renderer/UniformBuffer.h"
 
-enum ShaderFeature
-{
-    SF_Texture = 1,
-
-    SF_NormalMap = 2,
-
-    SF_Specular = 4,
-
-    SF_Cutout = 8,
-
-    SF_Fog = 16,
-
-    // Causes a large amount of tessellation to be used on the terrain
-    SF_HighTessellation = 32,
-
-    // Enables shadow sampling for the sun
-    SF_Shadows = 64,
-
-    // Enables PCF shadows with a high filter count. Removes shadow map aliasing.
-    SF_SoftShadows = 128,
-
-    // Enables a smooth transition between shadow map cascades.
-    SF_ShadowCascadeBlending = 32768,
-
-    // Enables detail meshes on the terrain
-    SF_TerrainDetailMeshes = 65536,
-
-    // Increases the terrain details draw distance
-    SF_ExtraTerrainDetails = 524288,
-
-    // Enables computation of translucency lighting
-    SF_Translucency = 262144,
-
-    // Enables a heightmap-based ambient occlusion pass
-    SF_AmbientOcclusion = 2097152,
-    
-    // Enables sky rendering
-    SF_Sky = 1048576,
-
-    // GBuffer debugging modes
-    SF_DebugGBufferDepth = 32768,
-    SF_DebugGBufferAlbedo = 256,
-    SF_DebugGBufferOcclusion = 512,
-    SF_DebugGBufferTranslucency = 131072,
-    SF_DebugGBufferNormals = 1024,
-    SF_DebugGBufferGloss = 2048,
-
-    // Shadow debugging modes for viewing raw shadow sampling & cascade splits
-    SF_DebugShadows = 4096,
-    SF_DebugShadowCascades = 8192,
-
-    // Wireframe rendering mode
-    SF_DebugWireframe = 16384,
-};
-
-typedef unsigned int ShaderFeatureList;
-const ShaderFeatureList ALL_SHADER_FEATURES = ~0u;
-
 // Handles a .inc.shader resource
 // It is simply glsl source code that can be #include'd into a shader variant.
 class ShaderInclude : public Resource
@@ -83,6 +27,8 @@ private:
     bool previouslyLoaded_;
 };
 
+class ShaderBinaryCache;
+
 class ShaderVariant
 {
 public:
@@ -100,16 +46,42 @@ public:
     // Gets the features in the variant.
     ShaderFeatureList features() const { return features_; }
 
+    // True while the driver is still compiling the variant in the background.
+    // Always false when the driver does not support parallel shader compilation.
+    bool isCompiling() const;
+
+    // Checks the results of compiling the variant, and stores its program binary.
+    // Waits for the driver if it has not finished compiling.
+    void finishCompiling();
+
     // Sets the variant as the active shader program.
-    void bind() const;
+    // Finishes compiling the variant first, if needed.
+    void bind();
 
 private:
     ShaderFeatureList features_;
     GLuint program_;
 
+    // The key of the variant in the program binary cache
+    uint64_t binaryKey_;
+
+    // The shaders being compiled for each stage, until compiling is finished
+    std::vector<GLuint> compilingShaders_;
+    std::vector<GLenum> compilingStages_;
+
     bool hasFeature(ShaderFeature feature) const;
     std::string createFeatureDefines() const;
 
+    // Creates the program from a binary stored by a previous run.
+    // Returns false if there is no binary, or the driver rejects it.
+    bool loadProgramBinary(ShaderBinaryCache &cache, uint64_t key);
+
+    // Stores the linked program's binary for the next run
+    void saveProgramBinary(ShaderBinaryCache &cache, uint64_t key) const;
+
+    // Starts compiling each stage and linking them into the program, without waiting for the results
+    void startCompiling(const std::vector<GLenum> &stages, const std::vector<std::string> &sources);
+
     // Handles preprocessing for a shader source code string.
     // This function does the following:
     //     - adds version header
@@ -118,7 +90,6 @@ private:
     //     - Resolves #include statements
     std::string preprocessSource(GLenum shaderStage, const std::string &originalSource) const;
 
-    bool compileShader(GLenum type, const char* shader, GLuint &id);
     bool checkShaderErrors(GLuint shaderID);
     bool checkLinkerErrors(GLuint programID);
 };
@@ -140,7 +111,15 @@ public:
     // and binds it as the active gl program.
     void bindVariant(ShaderFeatureList features);
 
+    // Starts creating the variant with the given feature list, if it does not exist yet.
+    // Returns true once the variant can be bound without waiting for the driver to compile it.
+    bool prepareVariant(ShaderFeatureList features);
+
 private:
-    std::vector<ShaderVariant> loadedVariants_;
+    // The loaded variants, keyed by their filtered feature list
+    std::unordered_map<ShaderFeatureList, ShaderVariant> loadedVariants_;
     std::string originalSource_;
+
+    // Gets the variant with the given features, creating it if it does not exist yet
+    ShaderVariant& findOrCreateVariant(ShaderFeatureList features);
 };
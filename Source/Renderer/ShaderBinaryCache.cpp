@@ -0,0 +1,152 @@
+#include "ShaderBinaryCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::experimental::filesystem::v1;
+
+namespace
+{
+    // Identifies program binary files
+    const uint32_t FILE_MAGIC = 0x42505347; // "GSPB"
+
+    // The header at the start of each program binary file
+    struct ProgramBinaryHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t size;
+    };
+
+    // Combines bytes into a 64 bit FNV-1a hash
+    uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    const uint64_t EMPTY_HASH = 14695981039346656037ull;
+}
+
+ShaderBinaryCache::ShaderBinaryCache(const std::string &directory, const std::string &driver)
+    : directory_(directory),
+    driverHash_(hashBytes(EMPTY_HASH, driver.data(), driver.size())),
+    enabled_(true),
+    hits_(0),
+    misses_(0)
+{
+
+}
+
+uint64_t ShaderBinaryCache::makeKey(const std::vector<std::string> &stageSources, uint32_t features) const
+{
+    const uint32_t version = FILE_VERSION;
+    uint64_t key = driverHash_;
+    key = hashBytes(key, &version, sizeof(version));
+    key = hashBytes(key, &features, sizeof(features));
+
+    // Include the length of each stage, so that moving text between stages changes the key
+    for (const std::string& source : stageSources)
+    {
+        const uint64_t length = source.size();
+        key = hashBytes(key, &length, sizeof(length));
+        key = hashBytes(key, source.data(), source.size());
+    }
+
+    return key;
+}
+
+std::string ShaderBinaryCache::pathForKey(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return directory_ + "/" + name;
+}
+
+bool ShaderBinaryCache::load(uint64_t key, ProgramBinary &binary)
+{
+    if (!enabled_)
+    {
+        return false;
+    }
+
+    std::ifstream file(pathForKey(key), std::ifstream::binary);
+    ProgramBinaryHeader header;
+    if (!file.is_open() || !file.read((char*)&header, sizeof(header)))
+    {
+        misses_++;
+        return false;
+    }
+
+    // Ignore files from other versions of the cache, and files for a different key
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.key != key || header.size == 0)
+    {
+        misses_++;
+        return false;
+    }
+
+    binary.format = header.format;
+    binary.data.resize(header.size);
+    if (!file.read((char*)binary.data.data(), header.size))
+    {
+        binary.data.clear();
+        misses_++;
+        return false;
+    }
+
+    hits_++;
+    return true;
+}
+
+bool ShaderBinaryCache::save(uint64_t key, const ProgramBinary &binary)
+{
+    if (!enabled_ || binary.data.empty())
+    {
+        return false;
+    }
+
+    // Write to a temporary file first, so that a partly written file is never loaded
+    fs::create_directories(fs::path(directory_));
+    const std::string path = pathForKey(key);
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ofstream::binary | std::ofstream::trunc);
+        if (!file.is_open())
+        {
+            printf("Unable to write shader binary %s \n", temporaryPath.c_str());
+            return false;
+        }
+
+        ProgramBinaryHeader header;
+        header.magic = FILE_MAGIC;
+        header.version = FILE_VERSION;
+        header.key = key;
+        header.format = binary.format;
+        header.size = (uint32_t)binary.data.size();
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)binary.data.data(), binary.data.size());
+        if (!file)
+        {
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    std::remove(path.c_str());
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+void ShaderBinaryCache::remove(uint64_t key)
+{
+    std::remove(pathForKey(key).c_str());
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A linked shader program, as returned by glGetProgramBinary
+struct ProgramBinary
+{
+    uint32_t format;
+    std::vector<unsigned char> data;
+};
+
+// Stores linked shader program binaries on disk, so that later runs do not need to compile glsl.
+// Binaries are keyed on a hash of the preprocessed source of every stage, the feature mask
+// and the driver identification string, so binaries for old source or another driver are
+// never found. Drivers may still reject a stored binary, so callers must be able to compile.
+// Does not use the gpu, so can be used and tested headlessly.
+class ShaderBinaryCache
+{
+public:
+    // Increase when the file layout changes, so that older files are ignored
+    const static uint32_t FILE_VERSION = 1;
+
+public:
+    // Creates a cache storing files in the directory.
+    // The driver string should identify the gpu, driver and driver version.
+    ShaderBinaryCache(const std::string &directory, const std::string &driver);
+
+    // A disabled cache never finds or stores binaries
+    bool enabled() const { return enabled_; }
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+
+    // Builds the key for a program from its preprocessed stage sources and its features
+    uint64_t makeKey(const std::vector<std::string> &stageSources, uint32_t features) const;
+
+    // The file that the binary for a key is stored in
+    std::string pathForKey(uint64_t key) const;
+
+    // Loads a stored binary.
+    // Returns false if there is none, or if the file is from another version or is truncated.
+    bool load(uint64_t key, ProgramBinary &binary);
+
+    // Stores a binary, replacing any previous binary for the key.
+    // Returns false if the file could not be written.
+    bool save(uint64_t key, const ProgramBinary &binary);
+
+    // Removes a stored binary, such as one that the driver has rejected
+    void remove(uint64_t key);
+
+    // The number of binaries found and not found since the cache was created
+    int hits() const { return hits_; }
+    int misses() const { return misses_; }
+
+private:
+    std::string directory_;
+    uint64_t driverHash_;
+    bool enabled_;
+    int hits_;
+    int misses_;
+};
\ No newline at end of file
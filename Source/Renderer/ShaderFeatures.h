@@ -0,0 +1,74 @@
+#pragma once
+
+enum ShaderFeature
+{
+    SF_Texture = 1,
+
+    SF_NormalMap = 2,
+
+    SF_Specular = 4,
+
+    SF_Cutout = 8,
+
+    SF_Fog = 16,
+
+    // Causes a large amount of tessellation to be used on the terrain
+    SF_HighTessellation = 32,
+
+    // Enables shadow sampling for the sun
+    SF_Shadows = 64,
+
+    // Enables PCF shadows with a high filter count. Removes shadow map aliasing.
+    SF_SoftShadows = 128,
+
+    // Enables a smooth transition between shadow map cascades.
+    SF_ShadowCascadeBlending = 32768,
+
+    // Enables detail meshes on the terrain
+    SF_TerrainDetailMeshes = 65536,
+
+    // Increases the terrain details draw distance
+    SF_ExtraTerrainDetails = 524288,
+
+    // Enables computation of translucency lighting
+    SF_Translucency = 262144,
+
+    // Enables a heightmap-based ambient occlusion pass
+    SF_AmbientOcclusion = 2097152,
+    
+    // Enables sky rendering
+    SF_Sky = 1048576,
+
+    // Reads the object transform from the instance buffer, for instanced draws
+    SF_Instancing = 4194304,
+
+    // Only outputs depth, for shadow caster passes
+    SF_DepthOnly = 8388608,
+
+    // Reads the material from the instance material table, for multi draw instanced batches
+    SF_InstancedMaterials = 16777216,
+
+    // GBuffer debugging modes
+    SF_DebugGBufferDepth = 32768,
+    SF_DebugGBufferAlbedo = 256,
+    SF_DebugGBufferOcclusion = 512,
+    SF_DebugGBufferTranslucency = 131072,
+    SF_DebugGBufferNormals = 1024,
+    SF_DebugGBufferGloss = 2048,
+
+    // Shadow debugging modes for viewing raw shadow sampling & cascade splits
+    SF_DebugShadows = 4096,
+    SF_DebugShadowCascades = 8192,
+
+    // Wireframe rendering mode
+    SF_DebugWireframe = 16384,
+};
+
+typedef unsigned int ShaderFeatureList;
+
+// Features that the renderer picks for a pass or a draw, rather than ones the user enables.
+// A depth only variant has no colour outputs, so these must never be reached by asking for every feature.
+const ShaderFeatureList PASS_SHADER_FEATURES = SF_Instancing | SF_DepthOnly | SF_InstancedMaterials;
+
+// Every feature that can be enabled for a pass, such as the camera's gbuffer pass and the screen space passes
+const ShaderFeatureList ALL_SHADER_FEATURES = ~PASS_SHADER_FEATURES;
\ No newline at end of file
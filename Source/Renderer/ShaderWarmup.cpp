@@ -0,0 +1,54 @@
+#include "ShaderWarmup.h"
+
+#include <chrono>
+
+#include "RenderManager.h"
+
+ShaderWarmup::ShaderWarmup()
+    : completed_(0)
+{
+
+}
+
+void ShaderWarmup::add(Shader* shader, ShaderFeatureList features)
+{
+    features = RenderManager::instance()->filterFeatureList(features);
+    if (shader == nullptr || !queued_.insert(std::make_pair(shader, features)).second)
+    {
+        return;
+    }
+
+    WarmupRequest request;
+    request.shader = shader;
+    request.features = features;
+    request.ready = false;
+    requests_.push_back(request);
+}
+
+void ShaderWarmup::update(float maxMilliseconds)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // Start every outstanding variant, so the driver can compile them in parallel,
+    // and count the variants that have finished since the last update.
+    for (WarmupRequest& request : requests_)
+    {
+        if (request.ready)
+        {
+            continue;
+        }
+
+        request.ready = request.shader->prepareVariant(request.features);
+        if (request.ready)
+        {
+            completed_++;
+        }
+
+        // Without parallel compilation each variant is compiled as it is prepared, so limit how many are done at once
+        const float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed > maxMilliseconds)
+        {
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Renderer/Shader.h"
+
+// Creates shader variants ahead of time, such as while a scene is loading,
+// so that they do not need to be compiled the first time they are drawn.
+// Where the driver supports parallel shader compilation the variants compile
+// in the background, and the warm-up only checks when they have finished.
+class ShaderWarmup
+{
+public:
+    ShaderWarmup();
+
+    // Queues a variant to be created.
+    // The features are filtered to the globally enabled features, and each variant is only queued once.
+    void add(Shader* shader, ShaderFeatureList features);
+
+    // Starts and finishes queued variants, for up to roughly the given time
+    void update(float maxMilliseconds);
+
+    // The number of queued variants, and the number of those that are ready
+    int total() const { return (int)requests_.size(); }
+    int completed() const { return completed_; }
+
+    // The fraction of the queued variants that are ready, from 0 to 1
+    float progress() const { return requests_.empty() ? 1.0f : completed_ / (float)requests_.size(); }
+
+    // True once every queued variant is ready
+    bool isComplete() const { return completed_ == (int)requests_.size(); }
+
+private:
+    struct WarmupRequest
+    {
+        Shader* shader;
+        ShaderFeatureList features;
+        bool ready;
+    };
+
+    // Every variant that has been queued, in order
+    std::vector<WarmupRequest> requests_;
+    std::set<std::pair<Shader*, ShaderFeatureList>> queued_;
+
+    // The number of requests that are ready
+    int completed_;
+};
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "ShadowCascadeCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <math.h>
+
+#include "Math/Vector3.h"
+
+ShadowCascadeCache::ShadowCascadeCache(int cascadeCount, int firstCachedCascade)
+    : enabled_(true),
+    firstCachedCascade_(firstCachedCascade),
+    renderBudget_(1),
+    refreshInterval_(30),
+    budgetRemaining_(0),
+    frame_(0),
+    nextRefreshCascade_(firstCachedCascade),
+    refreshCascade_(-1),
+    cascades_(cascadeCount)
+{
+    assert(cascadeCount > 0);
+    assert(firstCachedCascade >= 0);
+
+    invalidate();
+    resetStats();
+}
+
+void ShadowCascadeCache::setEnabled(bool enabled)
+{
+    // Cached contents are not kept up to date while caching is off
+    if (enabled != enabled_)
+    {
+        invalidate();
+    }
+
+    enabled_ = enabled;
+}
+
+void ShadowCascadeCache::setRenderBudget(int cascades)
+{
+    renderBudget_ = (cascades < 0) ? 0 : cascades;
+}
+
+void ShadowCascadeCache::setRefreshInterval(int frames)
+{
+    refreshInterval_ = (frames < 0) ? 0 : frames;
+}
+
+void ShadowCascadeCache::beginFrame()
+{
+    frame_++;
+    budgetRemaining_ = renderBudget_;
+
+    // Pick the next cached cascade to refresh.
+    // A refresh that does not fit in the budget is kept until it does.
+    const int cascadeCount = (int)cascades_.size();
+    if (refreshInterval_ > 0 && refreshCascade_ < 0 && firstCachedCascade_ < cascadeCount && frame_ % refreshInterval_ == 0)
+    {
+        refreshCascade_ = nextRefreshCascade_;
+
+        nextRefreshCascade_++;
+        if (nextRefreshCascade_ >= cascadeCount)
+        {
+            nextRefreshCascade_ = firstCachedCascade_;
+        }
+    }
+}
+
+bool ShadowCascadeCache::update(int cascade, const Matrix4x4 &worldToShadow, uint64_t casterSignature)
+{
+    CachedCascade& cached = cascades_[cascade];
+
+    // Uncached cascades always render, and are treated as new when caching is turned on
+    if (!isCached(cascade))
+    {
+        cached.valid = false;
+        return record(cached, ShadowCascadeUpdate::Uncached);
+    }
+
+    // Check if the cascade camera has moved since the contents were rendered.
+    // The camera is snapped to texels, so this only changes when the contents would.
+    bool moved = false;
+    for (int i = 0; i < 16; ++i)
+    {
+        moved |= (cached.worldToShadow.elements[i] != worldToShadow.elements[i]);
+    }
+
+    // Casters changes are remembered until the budget allows the cascade to be rendered
+    if (casterSignature != cached.casterSignature)
+    {
+        cached.castersChanged = true;
+    }
+
+    // Work out why the cascade needs to be rendered, if at all
+    ShadowCascadeUpdate update = ShadowCascadeUpdate::Skipped;
+    if (!cached.valid)
+    {
+        update = ShadowCascadeUpdate::FirstRender;
+    }
+    else if (moved)
+    {
+        update = ShadowCascadeUpdate::Moved;
+    }
+    else if (cached.castersChanged && budgetRemaining_ > 0)
+    {
+        update = ShadowCascadeUpdate::CastersChanged;
+        budgetRemaining_--;
+    }
+    else if (cascade == refreshCascade_ && budgetRemaining_ > 0)
+    {
+        update = ShadowCascadeUpdate::Refresh;
+        budgetRemaining_--;
+    }
+
+    // Store the state the new contents are rendered with
+    if (update != ShadowCascadeUpdate::Skipped)
+    {
+        cached.valid = true;
+        cached.worldToShadow = worldToShadow;
+        cached.casterSignature = casterSignature;
+        cached.castersChanged = false;
+
+        // Rendering for any reason also counts as a refresh
+        if (cascade == refreshCascade_)
+        {
+            refreshCascade_ = -1;
+        }
+    }
+
+    return record(cached, update);
+}
+
+void ShadowCascadeCache::invalidate()
+{
+    for (int i = 0; i < (int)cascades_.size(); ++i)
+    {
+        invalidate(i);
+    }
+}
+
+void ShadowCascadeCache::invalidate(int cascade)
+{
+    CachedCascade& cached = cascades_[cascade];
+    cached.valid = false;
+    cached.casterSignature = EMPTY_SIGNATURE;
+    cached.castersChanged = false;
+}
+
+void ShadowCascadeCache::resetStats()
+{
+    for (CachedCascade& cached : cascades_)
+    {
+        cached.stats.renders = 0;
+        cached.stats.skips = 0;
+        cached.stats.framesSinceRender = 0;
+        cached.stats.lastUpdate = ShadowCascadeUpdate::Skipped;
+    }
+}
+
+ShadowCascadePlacement ShadowCascadeCache::placeCachedCascade(const Point3 &viewPosition, const Point3* viewSpaceCorners, int cornerCount)
+{
+    // Find the sphere around the view that contains the slice.
+    // View space distances do not depend on the view rotation.
+    float radius = 0.0f;
+    for (int i = 0; i < cornerCount; ++i)
+    {
+        radius = std::max(radius, (viewSpaceCorners[i] - Point3::origin()).magnitude());
+    }
+
+    // Snap the centre to the world space grid
+    const float step = 2.0f * radius / SNAP_DIVISIONS;
+    ShadowCascadePlacement placement;
+    placement.centre.x = roundf(viewPosition.x / step) * step;
+    placement.centre.y = roundf(viewPosition.y / step) * step;
+    placement.centre.z = roundf(viewPosition.z / step) * step;
+
+    // Snapping moves the centre less than a step from the view,
+    // so padding by a step on each side keeps the sphere covered.
+    placement.size = 2.0f * (radius + step);
+    return placement;
+}
+
+uint64_t ShadowCascadeCache::combineSignature(uint64_t signature, uint64_t value)
+{
+    // FNV-1a over the bytes of the value
+    for (int i = 0; i < 8; ++i)
+    {
+        signature ^= (value >> (i * 8)) & 0xff;
+        signature *= 1099511628211ull;
+    }
+
+    return signature;
+}
+
+bool ShadowCascadeCache::record(CachedCascade &cascade, ShadowCascadeUpdate update)
+{
+    cascade.stats.lastUpdate = update;
+    if (update == ShadowCascadeUpdate::Skipped)
+    {
+        cascade.stats.skips++;
+        cascade.stats.framesSinceRender++;
+        return false;
+    }
+
+    cascade.stats.renders++;
+    cascade.stats.framesSinceRender = 0;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math/Matrix4x4.h"
+#include "Math/Point3.h"
+
+// The reason a shadow cascade was, or was not, rendered in a frame
+enum class ShadowCascadeUpdate
+{
+    // The cached contents were reused
+    Skipped,
+
+    // The cascade is not cached, and renders every frame
+    Uncached,
+
+    // The cascade had not been rendered yet, or was invalidated
+    FirstRender,
+
+    // The cascade camera moved, or the sun changed direction
+    Moved,
+
+    // A caster inside the cascade was added, removed or moved
+    CastersChanged,
+
+    // The cascade was refreshed by the round-robin budget
+    Refresh
+};
+
+// Counters for a single shadow cascade
+struct ShadowCascadeStats
+{
+    // The number of frames the cascade was rendered and reused since the stats were reset
+    int renders;
+    int skips;
+
+    // The number of frames since the cascade was last rendered
+    int framesSinceRender;
+
+    // What happened to the cascade in the last frame
+    ShadowCascadeUpdate lastUpdate;
+};
+
+// The position and size of a cached cascade camera
+struct ShadowCascadePlacement
+{
+    // The centre of the cascade, in world space
+    Point3 centre;
+
+    // The orthographic size of the cascade
+    float size;
+};
+
+// Decides which shadow cascades need to be re-rendered each frame.
+// Cascades before the first cached cascade are rendered every frame. The others
+// keep their contents until their camera moves or the casters inside them change.
+// Changes to casters are limited to a number of renders per frame, and a cached
+// cascade is also refreshed in turn every few frames, to pick up changes that are
+// not tracked. Does not use the gpu, so can be used and tested headlessly.
+class ShadowCascadeCache
+{
+public:
+    ShadowCascadeCache(int cascadeCount, int firstCachedCascade);
+
+    // Turns caching on and off. When off, every cascade renders every frame.
+    bool enabled() const { return enabled_; }
+    void setEnabled(bool enabled);
+
+    // The first cascade that is cached
+    int firstCachedCascade() const { return firstCachedCascade_; }
+    bool isCached(int cascade) const { return enabled_ && cascade >= firstCachedCascade_; }
+
+    // The maximum number of cached cascades rendered per frame because of caster changes or refreshes.
+    // Cascades whose camera moved are always rendered, as their contents no longer match.
+    int renderBudget() const { return renderBudget_; }
+    void setRenderBudget(int cascades);
+
+    // The number of frames between round-robin refreshes. 0 disables refreshes.
+    int refreshInterval() const { return refreshInterval_; }
+    void setRefreshInterval(int frames);
+
+    // Starts a new frame, resetting the budget
+    void beginFrame();
+
+    // Decides if a cascade needs rendering this frame.
+    // The world to shadow matrix identifies the cascade camera, and the caster signature
+    // identifies the casters inside it. Returns true if the cascade must be rendered.
+    bool update(int cascade, const Matrix4x4 &worldToShadow, uint64_t casterSignature);
+
+    // Forces every cascade to be rendered in the next frame
+    void invalidate();
+
+    // Forces a single cascade to be rendered the next time it is updated, such as when its contents were drawn over
+    void invalidate(int cascade);
+
+    // Gets the counters for a cascade
+    const ShadowCascadeStats& stats(int cascade) const { return cascades_[cascade].stats; }
+    void resetStats();
+
+    // Places a cached cascade so that it covers a view frustum slice.
+    // The cascade covers the slice in every direction around the view, so it does not
+    // change as the view rotates, and its centre is snapped to a world space grid of
+    // SNAP_DIVISIONS cells per cascade, so it only moves when the view crosses a cell.
+    // The size is padded by a cell on each side, so the snapped cascade still covers the slice.
+    static ShadowCascadePlacement placeCachedCascade(const Point3 &viewPosition, const Point3* viewSpaceCorners, int cornerCount);
+
+    // The number of world space grid cells across a cached cascade
+    const static int SNAP_DIVISIONS = 8;
+
+    // Combines a value into a caster signature
+    static uint64_t combineSignature(uint64_t signature, uint64_t value);
+
+    // The signature of a cascade with no casters
+    const static uint64_t EMPTY_SIGNATURE = 14695981039346656037ull;
+
+private:
+    struct CachedCascade
+    {
+        bool valid;
+        Matrix4x4 worldToShadow;
+        uint64_t casterSignature;
+        bool castersChanged;
+        ShadowCascadeStats stats;
+    };
+
+    bool enabled_;
+    int firstCachedCascade_;
+    int renderBudget_;
+    int refreshInterval_;
+
+    // The renders left in the budget this frame
+    int budgetRemaining_;
+
+    // The frame counter, and the next cascade to refresh
+    uint64_t frame_;
+    int nextRefreshCascade_;
+    int refreshCascade_;
+
+    std::vector<CachedCascade> cascades_;
+
+    // Records the outcome of an update
+    bool record(CachedCascade &cascade, ShadowCascadeUpdate update);
+};
\ No newline at end of file
@@ -8,15 +8,26 @@
 #include "Scene/Camera.h"
 #include "VRManager.h"
 
-ShadowMap::ShadowMap()
-    : texture_(TextureFormat::ShadowMap, RESOLUTION, RESOLUTION, CASCADE_COUNT),
-    uniformBuffer_(UniformBufferType::ShadowsBuffer)
+ShadowAtlas::ShadowAtlas()
+    : texture_(TextureFormat::ShadowMap, ShadowMap::RESOLUTION, ShadowMap::RESOLUTION, ShadowMap::CASCADE_COUNT)
+{
+    // No shadow map has rendered into the texture yet
+    for (int i = 0; i < ShadowMap::CASCADE_COUNT; ++i)
+    {
+        owners_[i] = nullptr;
+    }
+}
+
+ShadowMap::ShadowMap(ShadowAtlas& atlas)
+    : atlas_(atlas),
+    uniformBuffer_(UniformBufferType::ShadowsBuffer),
+    cascadeCache_(CASCADE_COUNT, FIRST_CACHED_CASCADE)
 {
     // Create a framebuffer and camera for each shadow cascade
     for (int i = 0; i < CASCADE_COUNT; ++i)
     {
         // Attach layer i of the shadow array texture to the framebuffer
-        cascades_[i].framebuffer.attachDepthTexture(&texture_, i);
+        cascades_[i].framebuffer.attachDepthTexture(&atlas_.texture(), i);
 
         // Create the camera and set to orthographic
         GameObject* cameraGameObject = new GameObject("Shadows Camera [Cascade " + std::to_string(i) + "]");
@@ -30,26 +41,46 @@ ShadowMap::ShadowMap()
     }
 }
 
-Framebuffer& ShadowMap::cascadeFramebuffer(int cascade)
+const Framebuffer& ShadowMap::cascadeFramebuffer(int cascade) const
 {
     return cascades_[cascade].framebuffer;
 }
 
-Camera* ShadowMap::cascadeCamera(int cascade)
+const Camera* ShadowMap::cascadeCamera(int cascade) const
 {
     return cascades_[cascade].camera;
 }
 
+bool ShadowMap::needsRender(int cascade, uint64_t casterSignature)
+{
+    // Another renderer may have drawn over the cascade since this shadow map rendered it
+    if (!atlas_.isOwner(cascade, this))
+    {
+        cascadeCache_.invalidate(cascade);
+    }
+
+    const bool render = cascadeCache_.update(cascade, cascades_[cascade].worldToCamera, casterSignature);
+    if (render)
+    {
+        atlas_.setOwner(cascade, this);
+    }
+
+    return render;
+}
+
 void ShadowMap::bind()
 {
     uniformBuffer_.use();
-    texture_.bind(10);
+    atlas_.texture().bind(10);
 }
 
 void ShadowMap::updatePosition(const Camera* viewCamera, float viewCameraAspect, bool vr)
 {
     const Scene* scene = SceneManager::instance()->currentScene();
 
+    // Start a new frame of cascade caching
+    cascadeCache_.beginFrame();
+
     // Ensure each cascade is drawn from the correct direction
     const Quaternion rotation = scene->sunRotation();
     for (int i = 0; i < CASCADE_COUNT; ++i)
@@ -70,12 +101,14 @@ void ShadowMap::updatePosition(const Camera* viewCamera, float viewCameraAspect,
     lightToWorld.set(2, 3, 0.0);
 
     // Compute the view to light matrix
-    Matrix4x4 viewToLight = worldToLight * viewCamera->gameObject()->transform()->localToWorld();
+    Matrix4x4 viewToWorld = viewCamera->gameObject()->transform()->localToWorld();
     if (vr)
     {
         // Ideally we should use matrix without the eye offset, but its close enough
-        viewToLight = viewToLight * VRManager::instance()->getEyeMatrix(EyeType::LeftEye).invert();
+        viewToWorld = viewToWorld * VRManager::instance()->getEyeMatrix(EyeType::LeftEye).invert();
     }
+    Matrix4x4 viewToLight = worldToLight * viewToWorld;
+    const Point3 viewPosition = viewToWorld * Point3::origin();
 
     // Set up each cascade camera size and centre
     for (int i = 0; i < CASCADE_COUNT; ++i)
@@ -89,15 +122,27 @@ void ShadowMap::updatePosition(const Camera* viewCamera, float viewCameraAspect,
         viewCamera->getFrustumCorners(cascades_[i].minDistance, corners, viewCameraAspect);
         viewCamera->getFrustumCorners(cascades_[i].maxDistance, corners + 4, viewCameraAspect);
 
-        // Size the cascade camera to cover the frustum bounds.
-        // Compute in view space so the size doesn't change during camera rotation.
-        Bounds viewSpaceBounds = Bounds::covering(corners, 8);
-        Vector3 viewSpaceSize = viewSpaceBounds.size();
-        cascades_[i].camera->setOrthographicSize(viewSpaceSize.magnitude());
-
-        // Calculate the shadow map centre in light space
-        Point3 viewSpaceCentre = viewSpaceBounds.centre();
-        Point3 lightSpaceCentre = viewToLight * viewSpaceCentre;
+        Point3 lightSpaceCentre;
+        if (cascadeCache_.isCached(i))
+        {
+            // Cached cascades are placed on a world space grid around the view,
+            // so they stay still until the view moves into another grid cell.
+            const ShadowCascadePlacement placement = ShadowCascadeCache::placeCachedCascade(viewPosition, corners, 8);
+            cascades_[i].camera->setOrthographicSize(placement.size);
+            lightSpaceCentre = worldToLight * placement.centre;
+        }
+        else
+        {
+            // Size the cascade camera to cover the frustum bounds.
+            // Compute in view space so the size doesn't change during camera rotation.
+            Bounds viewSpaceBounds = Bounds::covering(corners, 8);
+            Vector3 viewSpaceSize = viewSpaceBounds.size();
+            cascades_[i].camera->setOrthographicSize(viewSpaceSize.magnitude());
+
+            // Calculate the shadow map centre in light space
+            Point3 viewSpaceCentre = viewSpaceBounds.centre();
+            lightSpaceCentre = viewToLight * viewSpaceCentre;
+        }
 
         // Snap the centre to the nearest texel in light space.
         float texelSize = cascades_[i].camera->orthographicSize() / (float)RESOLUTION;
@@ -110,6 +155,29 @@ void ShadowMap::updatePosition(const Camera* viewCamera, float viewCameraAspect,
         // The camera has a -ve near clip plane, so placing the camera in
         // the centre of the cascade will render the full cascade.
         cascades_[i].cameraTransform->setPositionLocal(centre);
+
+        // Find the extents of the frustum slice relative to the cascade camera
+        Point3 lightSpaceCorners[8];
+        for (int c = 0; c < 8; ++c)
+        {
+            Point3 corner = viewToLight * corners[c];
+            lightSpaceCorners[c] = Point3(corner.x - lightSpaceCentre.x, corner.y - lightSpaceCentre.y, corner.z - lightSpaceCentre.z);
+        }
+        Bounds sliceBounds = Bounds::covering(lightSpaceCorners, 8);
+
+        // Casters can only shadow the slice if they overlap it when viewed from the sun,
+        // and are between the sun and the far side of the slice.
+        // The near plane matches the cascade camera, so that casters behind the view still cast shadows.
+        Matrix4x4 casterProjection = Matrix4x4::orthographic(sliceBounds.min().x, sliceBounds.max().x, sliceBounds.min().y, sliceBounds.max().y,
+            cascades_[i].camera->nearPlane(), sliceBounds.max().z);
+        cascades_[i].casterFrustum = Frustum::fromMatrix(casterProjection * cascades_[i].cameraTransform->worldToLocal());
+
+        // Cached cascades are reused while the view moves around inside a grid cell,
+        // so need casters for the whole cascade rather than the current slice
+        if (cascadeCache_.isCached(i))
+        {
+            cascades_[i].casterFrustum = Frustum::fromMatrix(cascades_[i].camera->getWorldToCameraMatrix(1.0f));
+        }
     }
 
     // Update the uniform buffer to match the camera position
@@ -128,7 +196,8 @@ void ShadowMap::updatePosition(const Camera* viewCamera, float viewCameraAspect,
         offsetMatrix.setRow(3, 0.0f, 0.0f, 0.0f, 1.0f);
 
         // Store the world to shadow matrix
-        data.worldToShadow[i] = offsetMatrix * cascades_[i].camera->getWorldToCameraMatrix(1.0f);
+        cascades_[i].worldToCamera = cascades_[i].camera->getWorldToCameraMatrix(1.0f);
+        data.worldToShadow[i] = offsetMatrix * cascades_[i].worldToCamera;
     }
     uniformBuffer_.update(data);
 }
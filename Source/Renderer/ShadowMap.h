@@ -3,10 +3,14 @@
 #include "Framebuffer.h"
 #include "Texture.h"
 #include "UniformBuffer.h"
+#include "ShadowCascadeCache.h"
+
+#include "Math/Frustum.h"
 
 class GameObject;
 class Camera;
 class Transform;
+class ShadowAtlas;
 
 struct ShadowCascade
 {
@@ -20,6 +24,11 @@ struct ShadowCascade
     // Camera used to render the cascade
     Transform* cameraTransform;
     Camera* camera;
+    Matrix4x4 worldToCamera;
+
+    // The volume containing every object that can cast a shadow into the cascade.
+    // This is tighter than the cascade camera, as it only covers the view frustum slice.
+    Frustum casterFrustum;
 };
 
 class ShadowMap
@@ -29,17 +38,31 @@ public:
     static const int CASCADE_COUNT = 4; // Increasing past 4 will require reworking the uniform buffer layout
     const float DEPTH_BIAS_PER_CASCADE[CASCADE_COUNT] = { 0.00001f, 0.0002f, 0.0003f, 0.0005f };
     const float DRAW_DISTANCE_PER_CASCADE[CASCADE_COUNT] = { 15.0f, 70.0f, 150.0f, 300.0f };
+    const bool HIGH_TESSELLATION_PER_CASCADE[CASCADE_COUNT] = { true, true, false, false };
+    static const int FIRST_CACHED_CASCADE = 2; // Nearer cascades are rendered every frame
 
 public:
-    ShadowMap();
+    ShadowMap(ShadowAtlas& atlas);
 
     // Do not allow the shadowmap class to copied
     ShadowMap(const ShadowMap&) = delete;
     ShadowMap& operator=(const ShadowMap&) = delete;
 
     // Gets the framebuffer for a cascade index
-    Framebuffer& cascadeFramebuffer(int cascade);
-    Camera* cascadeCamera(int cascade);
+    const Framebuffer& cascadeFramebuffer(int cascade) const;
+    const Camera* cascadeCamera(int cascade) const;
+
+    // Gets the volume used to cull shadow casters for a cascade
+    const Frustum& casterFrustum(int cascade) const { return cascades_[cascade].casterFrustum; }
+
+    // Checks if a cascade needs rendering this frame, given a signature of the casters inside it.
+    // Cached cascades keep their contents while their camera and casters are unchanged,
+    // and no other shadow map has rendered into their layer of the atlas.
+    bool needsRender(int cascade, uint64_t casterSignature);
+
+    // Gets the cache deciding which cascades are rendered, with its settings and stats
+    ShadowCascadeCache& cascadeCache() { return cascadeCache_; }
+    const ShadowCascadeCache& cascadeCache() const { return cascadeCache_; }
 
     // Binds the texture and uniform buffer
     void bind();
@@ -48,8 +71,8 @@ public:
     void updatePosition(const Camera* viewCamera, float viewCameraAspect, bool vr);
 
 private:
-    // A single array texture stores all of the shadow cascades
-    ArrayTexture texture_;
+    // The array texture the cascades are rendered into, which is shared with other shadow maps
+    ShadowAtlas& atlas_;
 
     // The uniform buffer containg the shadow render settings
     UniformBuffer<ShadowUniformData> uniformBuffer_;
@@ -57,9 +80,42 @@ private:
     // The data for each shadow cascade
     ShadowCascade cascades_[CASCADE_COUNT];
 
+    // Tracks which cascades still hold valid contents
+    ShadowCascadeCache cascadeCache_;
+
     // Computes the start distance of a shadow cascade
     float getCascadeMin(int cascade) const;
 
     // Computes the end distance of a shadow cascade
     float getCascadeMax(int cascade) const;
+};
+
+// A single array texture that stores all of the shadow cascades.
+// Every renderer's shadow map renders into the same texture, rather than each allocating
+// its own, as the cascades of one renderer are only read while that renderer draws its frame.
+// Each layer remembers which shadow map last rendered it, so a cached cascade is only reused
+// while its contents have not been drawn over by another renderer.
+class ShadowAtlas
+{
+public:
+    ShadowAtlas();
+
+    // Do not allow the atlas to be copied
+    ShadowAtlas(const ShadowAtlas&) = delete;
+    ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+    // Gets the texture holding every cascade
+    ArrayTexture& texture() { return texture_; }
+
+    // Records the shadow map that rendered into a cascade layer
+    void setOwner(int cascade, const ShadowMap* shadowMap) { owners_[cascade] = shadowMap; }
+
+    // Checks if a cascade layer still holds the contents rendered by a shadow map
+    bool isOwner(int cascade, const ShadowMap* shadowMap) const { return owners_[cascade] == shadowMap; }
+
+private:
+    ArrayTexture texture_;
+
+    // The shadow map that last rendered into each layer
+    const ShadowMap* owners_[ShadowMap::CASCADE_COUNT];
 };
\ No newline at end of file
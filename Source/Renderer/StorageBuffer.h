@@ -0,0 +1,84 @@
+#pragma once
+
+#include <GL/gl3w.h>
+
+// Enum for specifying the binding point to the StorageBuffer constructor
+enum class StorageBufferType
+{
+    TerrainDetailInstancesBuffer = 0,
+    TerrainDetailBatchesBuffer = 1,
+    ObjectInstancesBuffer = 2,
+    InstanceMaterialIndicesBuffer = 3,
+    MaterialTableBuffer = 4,
+};
+
+// The part of a storage buffer that does not depend on its element type,
+// so that buffers of any type can be bound from a render command list.
+class StorageBufferBase
+{
+public:
+    // Prevent the buffer being copied
+    StorageBufferBase(const StorageBufferBase&) = delete;
+    StorageBufferBase& operator=(const StorageBufferBase&) = delete;
+
+    // Bind buffer to usage slot governed by buffer type
+    void use() const
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(type_), bufferID_);
+    }
+
+protected:
+    explicit StorageBufferBase(StorageBufferType type)
+        : type_(type)
+    {
+        glCreateBuffers(1, &bufferID_);
+    }
+
+    ~StorageBufferBase()
+    {
+        if (bufferID_ != 0)
+        {
+            glDeleteBuffers(1, &bufferID_);
+        }
+    }
+
+    StorageBufferType type_;
+    GLuint bufferID_;
+};
+
+// A shader storage buffer holding an array of plain old data elements.
+// Unlike uniform buffers, the array size is only limited by gpu memory.
+template <typename T>
+class StorageBuffer : public StorageBufferBase
+{
+public:
+    explicit StorageBuffer(StorageBufferType type)
+        : StorageBufferBase(type),
+        count_(0)
+    {
+
+    }
+
+    // The number of elements currently in the buffer
+    int count() const { return count_; }
+
+    // Replaces the buffer contents with the given elements.
+    // This reallocates the buffer, so should only be used for data that changes rarely.
+    void update(const T* data, int count)
+    {
+        count_ = count;
+
+        // Zero sized buffers are not allowed, so always store at least one element.
+        const T empty = T();
+        glNamedBufferData(bufferID_, sizeof(T) * (count > 0 ? count : 1), count > 0 ? data : &empty, GL_STATIC_DRAW);
+    }
+
+    // Replaces a range of the elements already in the buffer, without reallocating it
+    void updateRange(const T* data, int first, int count)
+    {
+        glNamedBufferSubData(bufferID_, sizeof(T) * first, sizeof(T) * count, data);
+    }
+
+private:
+    int count_;
+};
\ No newline at end of file
@@ -73,7 +73,8 @@ ArrayTexture::ArrayTexture(TextureFormat format, int width, int height, int laye
     : format_(format),
     filterMode_(TextureFilterMode::Bilinear),
     width_(width),
-    height_(height)
+    height_(height),
+    layers_(layers)
 {
     // Get details for the texture format.
     TextureFormatData* formatData = getFormatData(format);
@@ -82,9 +83,18 @@ ArrayTexture::ArrayTexture(TextureFormat format, int width, int height, int laye
     glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &glid_);
     glTextureStorage3D(glid_, 1, formatData->glInternalFormat, width, height, layers);
 
-    // Set shadow mapping compare mode if required
-    if (format_ == TextureFormat::ShadowMap)
+    // Array textures have no mipmaps, so use bilinear filtering and clamp at the edges.
+    // Shadow maps use a compare mode and border instead.
+    if (format_ != TextureFormat::ShadowMap)
+    {
+        glTextureParameteri(glid_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(glid_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(glid_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(glid_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    else
     {
+        // Set shadow mapping compare mode
         glTextureParameteri(glid_, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
         glTextureParameteri(glid_, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 
@@ -140,8 +150,20 @@ void ArrayTexture::bind(int slot) const
     glBindTexture(GL_TEXTURE_2D_ARRAY, glid_);
 }
 
+void ArrayTexture::setLayerData(int layer, const void* data, int dataSizeBytes)
+{
+    assert(layer >= 0 && layer < layers_);
+    assert(dataSizeBytes == width_ * height_ * getFormatData(format_)->blockSize);
+
+    // This currently only works for R16 textures (for the terrain tiles)
+    assert(format_ == TextureFormat::R16);
+
+    glTextureSubImage3D(glid_, 0, 0, 0, layer, width_, height_, 1, GL_RED, GL_UNSIGNED_SHORT, data);
+}
+
 Texture::Texture(TextureFormat format, int width, int height)
-    : Resource(NOT_SAVED_RESOURCE)
+    : Resource(NOT_SAVED_RESOURCE),
+    loadCount_(0)
 {
     // The texture is *not* created by the resource manager,
     // so we create the texture and set default wrap / filter
@@ -160,7 +182,8 @@ Texture::Texture(ResourceID resourceID)
     height_(-1),
     levels_(0),
     glid_(0),
-    created_(false)
+    created_(false),
+    loadCount_(0)
 {
     // This texture is a resource file.
     // The texture is created in load().
@@ -328,6 +351,9 @@ void Texture::load(std::ifstream& file)
     handle_ = gettexturehandle(glid_);
     PFNGLMAKETEXTUREHANDLERESIDENTARBPROC makeresident = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)gl3wGetProcAddress("glMakeTextureHandleResidentARB");
     makeresident(handle_);
+
+    // Now loaded
+    loadCount_++;
 }
 
 void Texture::unload()
@@ -384,11 +410,12 @@ void Texture::setData(const void* data, int dataSizeBytes, int mipLevel)
     assert(!isCompressed());
     assert(dataSizeBytes == getMipSize(format_, width_, height_, mipLevel));
     
-    // This currently only works for R16 textures (for the terrain)
-    assert(format_ == TextureFormat::R16);
+    // This currently only works for single channel textures (for the terrain)
+    assert(format_ == TextureFormat::R16 || format_ == TextureFormat::RFloat);
 
+    const GLenum type = (format_ == TextureFormat::R16) ? GL_UNSIGNED_SHORT : GL_FLOAT;
     glTextureSubImage2D(glid_, mipLevel, 0, 0, width_ >> mipLevel, height_ >> mipLevel,
-        GL_RED, GL_UNSIGNED_SHORT, data);
+        GL_RED, type, data);
 }
 
 const std::string& Texture::getFormatName(TextureFormat format)
@@ -74,6 +74,10 @@ public:
     // Attaches the texture to the specified slot for use.
     void bind(int slot) const;
 
+    // Replaces the contents of a single layer.
+    // The data must be the correct format and size to replace the entire layer.
+    void setLayerData(int layer, const void* data, int dataSizeBytes);
+
     // Basic settings
     TextureFormat format() const { return format_; }
     TextureFilterMode filterMode() const { return filterMode_; }
@@ -120,6 +124,10 @@ public:
     // This can be placed in uniform buffers to sample the texture.
     BindlessTextureHandle bindlessHandle() const { return handle_; }
 
+    // Counts the times the texture has been loaded.
+    // Hot reloading creates a new bindless handle, so anything that copied the handle checks this.
+    uint32_t loadCount() const { return loadCount_; }
+
     // Basic settings
     TextureFormat format() const { return format_; }
     TextureWrapMode wrapMode() const { return wrapMode_; }
@@ -154,6 +162,7 @@ protected:
     GLuint glid_;
     GLuint64 handle_;
     bool created_;
+    uint32_t loadCount_;
 
     // Determines the size of a mip level for a texture.
     // mipLevel starts at 0
@@ -18,9 +18,8 @@ enum class UniformBufferType
     CameraBuffer = 1,
     ShadowsBuffer = 2,
     PerDrawBuffer = 3,
-    PerMaterialBuffer = 4,
     TerrainBuffer = 5,
-    TerrainDetailsBuffer = 6,
+    MeshBuffer = 6,
 };
 
 // Plain old uniform data for scene
@@ -69,6 +68,9 @@ struct TerrainUniformData
     // rgb = Water color, a = water depth
     Vector4 waterColorDepth;
 
+    // x = heightfield resolution, y = tiles per side, z = texels per tile
+    Vector4 heightfieldInfo;
+
     // Per-layer data
     Vector4 terrainLayerBlendData[Terrain::MAX_LAYERS];
     Vector4 terrainLayerScale[Terrain::MAX_LAYERS]; // xy for scale, zw unused
@@ -77,23 +79,21 @@ struct TerrainUniformData
     BindlessTextureHandle terrainNormalMapTextures[Terrain::MAX_LAYERS*2];  // x2 to pad each value to 16 bytes
 };
 
-// Plain old uniform data for converting object local coordinates to world space
+// Plain old uniform data for converting object local coordinates to world space.
+// The material settings are in the material table, so draws only send the material's index.
 struct PerDrawUniformData
 {
     Matrix4x4 localToWorld;
-    Color colorSmoothness;
-    BindlessTextureHandle albedoTexture;
-    BindlessTextureHandle normalMapTexture;
-};
-
-struct TerrainDetailsData
-{
-    Vector4 detailPositions[DetailBatch::MaxInstancesPerBatch];
+    uint32_t materialIndex;
+    uint32_t padding[3];
 };
 
-struct PerMaterialUniformData
+// Plain old uniform data for a mesh, owned by the mesh and bound with it.
+// Moves quantised vertex positions back into mesh space.
+struct MeshUniformData
 {
-    
+    Vector4 positionOffset;
+    Vector4 positionScale;
 };
 
 template <typename T>
@@ -42,6 +42,18 @@ void Camera::serialize(PropertyTable &table)
     table.serialize("fov", fov_, 60.0f);
 }
 
+float Camera::pixelsPerUnit(float screenHeight) const
+{
+    if (type_ == CameraType::Orthographic)
+    {
+        return screenHeight / orthographicSize_;
+    }
+
+    // The height of the view at a distance of one is 2 tan(fov / 2)
+    float halfFov = (fov_ / 2.0f) * ((float)M_PI / 180.0f);
+    return screenHeight / (2.0f * tanf(halfFov));
+}
+
 void Camera::getFrustumCorners(float distance, Point3* corners, float aspect) const
 {
     // Currently supports perspective mode only
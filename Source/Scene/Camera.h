@@ -38,6 +38,10 @@ public:
     float orthographicSize() const { return orthographicSize_; }
     float fov() const { return fov_; }
 
+    // Gets the size in pixels of one unit on screen, at a distance of one unit in perspective mode.
+    // The screen height is in pixels.
+    float pixelsPerUnit(float screenHeight) const;
+
     // Gets the 4 corners of the view frustum at the specified distance.
     // Perspective mode only. The points returned are in local space.
     void getFrustumCorners(float distance, Point3* corners, float aspect) const;
@@ -1,11 +1,16 @@
 #include "StaticMesh.h"
 
+#include "Scene/Transform.h"
 #include "Utils/ImGuiExtensions.h"
 
 StaticMesh::StaticMesh(GameObject* gameObject)
     : Component(gameObject),
     mesh_(nullptr),
-    material_(nullptr)
+    material_(nullptr),
+    occluder_(false),
+    worldBoundsMesh_(nullptr),
+    worldBoundsMeshLoadCount_(0),
+    worldBoundsChangeCount_(0)
 {
 
 }
@@ -14,15 +19,39 @@ void StaticMesh::drawProperties()
 {
     ImGui::ResourceSelect<Material>("Material", "Select Material Resource", material_);
     ImGui::ResourceSelect<Mesh>("Mesh", "Select Mesh Resource", mesh_);
+    ImGui::Checkbox("Occluder", &occluder_);
 }
 
 void StaticMesh::serialize(PropertyTable &table)
 {
     table.serialize("mesh", mesh_);
     table.serialize("material", material_);
+    table.serialize("occluder", occluder_, false);
 }
 
 void StaticMesh::setMaterial(Material* material)
 {
     material_ = material;
+}
+
+Bounds StaticMesh::worldBounds() const
+{
+    // Meshes without a mesh have no size
+    const Transform* transform = gameObject()->transform();
+    if (mesh_ == nullptr)
+    {
+        return Bounds(transform->positionWorld(), transform->positionWorld());
+    }
+
+    // Recompute the bounds when the mesh or transform has changed.
+    // Hot reloading keeps the same mesh, so the load count is checked as well.
+    if (worldBoundsMesh_ != mesh_ || worldBoundsMeshLoadCount_ != mesh_->loadCount() || worldBoundsChangeCount_ != transform->changeCount())
+    {
+        worldBounds_ = mesh_->bounds().box.transformed(transform->localToWorld());
+        worldBoundsMesh_ = mesh_;
+        worldBoundsMeshLoadCount_ = mesh_->loadCount();
+        worldBoundsChangeCount_ = transform->changeCount();
+    }
+
+    return worldBounds_;
 }
\ No newline at end of file
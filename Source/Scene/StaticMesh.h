@@ -5,6 +5,8 @@
 #include "Renderer/Mesh.h"
 #include "Renderer/Material.h"
 
+#include "Math/Bounds.h"
+
 class StaticMesh : public Component
 {
 public:
@@ -23,7 +25,23 @@ public:
     Material* material() const { return material_; }
     Mesh* mesh() const { return mesh_; }
 
+    // Large solid meshes, such as buildings, can be used to hide the objects behind them.
+    // The mesh must not have holes or transparent parts.
+    bool isOccluder() const { return occluder_; }
+    void setOccluder(bool occluder) { occluder_ = occluder; }
+
+    // The bounding box of the mesh in world space.
+    // This is cached, and only recomputed when the transform or mesh change, or the mesh is reloaded.
+    Bounds worldBounds() const;
+
 private:
     Material* material_;
     Mesh* mesh_;
+    bool occluder_;
+
+    // The cached world bounds, and the mesh, mesh load count and transform change count they were computed from
+    mutable Bounds worldBounds_;
+    mutable const Mesh* worldBoundsMesh_;
+    mutable uint32_t worldBoundsMeshLoadCount_;
+    mutable uint32_t worldBoundsChangeCount_;
 };
@@ -0,0 +1,136 @@
+#include "StaticPrefab.h"
+
+#include <algorithm>
+
+#include "Physics/BoxCollider.h"
+#include "Physics/SphereCollider.h"
+#include "Scene/GameObject.h"
+#include "Scene/StaticMesh.h"
+#include "Scene/Transform.h"
+#include "Serialization/Prefab.h"
+
+namespace
+{
+    // Adds the static parts of an object and its children to the result.
+    // Returns false if any object has a component that is not static.
+    bool extractObject(const GameObject* object, const Matrix4x4 &worldToPrefab, StaticPrefab &result)
+    {
+        const Matrix4x4 localToPrefab = worldToPrefab * object->transform()->localToWorld();
+        const Matrix4x4 prefabToLocal = object->transform()->worldToLocal() * worldToPrefab.invert();
+
+        for (const Component* component : object->componentList())
+        {
+            if (dynamic_cast<const Transform*>(component) != nullptr)
+            {
+                continue;
+            }
+
+            if (const StaticMesh* staticMesh = dynamic_cast<const StaticMesh*>(component))
+            {
+                // Meshes with no material are never drawn
+                if (staticMesh->mesh() != nullptr && staticMesh->material() != nullptr)
+                {
+                    StaticPrefabMesh mesh;
+                    mesh.mesh = staticMesh->mesh();
+                    mesh.material = staticMesh->material();
+                    mesh.localToPrefab = localToPrefab;
+                    result.meshes.push_back(mesh);
+                }
+                continue;
+            }
+
+            // The corners of a box around the collider, in the collider space.
+            Vector3 cornerMin, cornerMax;
+            StaticPrefabCollider collider;
+            collider.prefabToLocal = prefabToLocal;
+            collider.size = Vector3::one();
+            collider.offset = Vector3::zero();
+            collider.radius = 0.0f;
+
+            if (const BoxCollider* box = dynamic_cast<const BoxCollider*>(component))
+            {
+                collider.shape = StaticColliderShape::Box;
+                collider.size = box->size();
+                collider.offset = box->offset();
+                cornerMin = collider.offset - collider.size * 0.5f;
+                cornerMax = collider.offset + collider.size * 0.5f;
+            }
+            else if (const SphereCollider* sphere = dynamic_cast<const SphereCollider*>(component))
+            {
+                collider.shape = StaticColliderShape::Sphere;
+                collider.radius = sphere->radius();
+                collider.offset = sphere->offset();
+                cornerMin = Vector3::one() * -collider.radius;
+                cornerMax = Vector3::one() * collider.radius;
+            }
+            else
+            {
+                // Any other component has behaviour
+                return false;
+            }
+
+            // Grow the collider radius to cover the corners of the box around the collider
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                const Point3 p((corner & 1) ? cornerMax.x : cornerMin.x,
+                               (corner & 2) ? cornerMax.y : cornerMin.y,
+                               (corner & 4) ? cornerMax.z : cornerMin.z);
+                const Point3 prefabPoint = localToPrefab * p;
+                result.colliderRadius = std::max(result.colliderRadius, Point3::distance(Point3::origin(), prefabPoint));
+            }
+
+            result.colliders.push_back(collider);
+        }
+
+        // Add the children
+        for (const Transform* child : object->transform()->children())
+        {
+            if (!extractObject(child->gameObject(), worldToPrefab, result))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+bool StaticPrefabCollider::checkForCollision(const Point3 &prefabPoint) const
+{
+    // Put the point into local space
+    const Point3 p = prefabToLocal * prefabPoint;
+
+    // Matches BoxCollider::checkForCollision and SphereCollider::checkForCollision
+    if (shape == StaticColliderShape::Box)
+    {
+        return (p.x > (size.x * -0.5f + offset.x)
+            && p.x < (size.x * 0.5f + offset.x)
+            && p.y > (size.y * -0.5f + offset.y)
+            && p.y < (size.y * 0.5f + offset.y)
+            && p.z > (size.z * -0.5f + offset.z)
+            && p.z < (size.z * 0.5f + offset.z));
+    }
+
+    return (Point3::sqrDistance(Point3::origin(), p) < radius * radius);
+}
+
+bool StaticPrefab::extract(Prefab* prefab, StaticPrefab &result)
+{
+    result.meshes.clear();
+    result.colliders.clear();
+    result.colliderRadius = 0.0f;
+
+    // Instantiate the prefab temporarily, so that its components are
+    // deserialized in exactly the same way as for a real instance.
+    GameObject* root = new GameObject(prefab->resourceName(), prefab);
+    root->setFlag(GameObjectFlag::NotShownOrSaved, true);
+
+    // Instances replace the position and rotation of the root, but keep its scale.
+    const Matrix4x4 worldToPrefab = Matrix4x4::trsInverse(root->transform()->positionWorld() - Point3::origin(), root->transform()->rotationWorld(), Vector3::one());
+    const bool isStatic = extractObject(root, worldToPrefab, result);
+
+    // Deleting the root also deletes its children
+    delete root;
+
+    return isStatic;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "Math/Matrix4x4.h"
+#include "Math/Point3.h"
+#include "Math/Vector3.h"
+
+class GameObject;
+class Material;
+class Mesh;
+class Prefab;
+
+// A mesh in a static prefab.
+struct StaticPrefabMesh
+{
+    Mesh* mesh;
+    Material* material;
+
+    // The transform of the mesh, relative to the prefab root
+    Matrix4x4 localToPrefab;
+};
+
+enum class StaticColliderShape
+{
+    Box,
+    Sphere,
+};
+
+// A collider in a static prefab.
+// The shape settings match the BoxCollider and SphereCollider components.
+struct StaticPrefabCollider
+{
+    StaticColliderShape shape;
+    Vector3 size;
+    Vector3 offset;
+    float radius;
+
+    // Transforms a point relative to the prefab root into the collider space
+    Matrix4x4 prefabToLocal;
+
+    // Checks if a point, relative to the prefab root, intersects with the collider.
+    bool checkForCollision(const Point3 &prefabPoint) const;
+};
+
+// The parts of a prefab that can be drawn and collided with without
+// creating a GameObject: its meshes and its colliders.
+// Prefabs with any other components have behaviour and are not static.
+struct StaticPrefab
+{
+    // The meshes and colliders are relative to the prefab root position and rotation.
+    // The scale of the prefab root is included in their transforms.
+    std::vector<StaticPrefabMesh> meshes;
+    std::vector<StaticPrefabCollider> colliders;
+
+    // The radius of a sphere around the prefab root that covers every collider
+    float colliderRadius;
+
+    // Extracts the static parts of a prefab.
+    // Returns false if the prefab has behaviour, in which case it must be instantiated.
+    static bool extract(Prefab* prefab, StaticPrefab &result);
+};
\ No newline at end of file
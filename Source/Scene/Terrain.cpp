@@ -1,9 +1,16 @@
 #include "Terrain.h"
 
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <float.h>
+#include <random>
 #include <imgui.h>
 #include "Utils/ImGuiExtensions.h"
 #include "Renderer/Material.h"
+#include "RenderManager.h"
 
+#include "Math/PoissonDisk.h"
 #include "Math/Random.h"
 
 #include "Scene/Transform.h"
@@ -32,16 +39,80 @@ void TerrainObject::serialize(PropertyTable& table)
     table.serialize("seed", seed, 0);
 }
 
+namespace
+{
+    // Quantises a value in the range [min, min + size] to 16 bits
+    uint16_t quantise(float value, float min, float size)
+    {
+        const float normalized = size > 0.0f ? (value - min) / size : 0.0f;
+        return (uint16_t)(std::max(0.0f, std::min(normalized, 1.0f)) * 65535.0f + 0.5f);
+    }
+
+    // Mixes the bits of a value, so that nearby inputs give unrelated outputs
+    uint32_t mixBits(uint32_t value)
+    {
+        value ^= value >> 16;
+        value *= 0x85ebca6b;
+        value ^= value >> 13;
+        value *= 0xc2b2ae35;
+        value ^= value >> 16;
+        return value;
+    }
+
+    // Returns a random number between -1 and 1 for a point of a fractal level.
+    // The same point always gets the same number, whatever order the points are generated in.
+    float fractalNoise(uint32_t seed, int level, int x, int y)
+    {
+        const uint32_t hash = mixBits(seed ^ mixBits((uint32_t)level ^ mixBits((uint32_t)x ^ mixBits((uint32_t)y))));
+        return (hash >> 8) * (2.0f / 16777216.0f) - 1.0f;
+    }
+}
+
+Vector4 DetailBatch::decode(const DetailInstance &instance) const
+{
+    const Point3 boundsMin = bounds.min();
+    const Vector3 boundsSize = bounds.size();
+    return Vector4(
+        boundsMin.x + instance.x / 65535.0f * boundsSize.x,
+        boundsMin.y + instance.y / 65535.0f * boundsSize.y,
+        boundsMin.z + instance.z / 65535.0f * boundsSize.z,
+        scaleRange.x + instance.scale / 65535.0f * (scaleRange.y - scaleRange.x));
+}
+
+Matrix4x4 TerrainObjectPlacement::prefabToWorld() const
+{
+    return Matrix4x4::trs(position - Point3::origin(), Quaternion::euler(0.0f, rotation, 0.0f), Vector3::one());
+}
+
+Matrix4x4 TerrainObjectPlacement::worldToPrefab() const
+{
+    return Matrix4x4::trsInverse(position - Point3::origin(), Quaternion::euler(0.0f, rotation, 0.0f), Vector3::one());
+}
+
+bool TerrainPlacementMask::isAllowed(float normalizedX, float normalizedZ) const
+{
+    const int x = std::max(0, std::min((int)(normalizedX * resolution), resolution - 1));
+    const int z = std::max(0, std::min((int)(normalizedZ * resolution), resolution - 1));
+    return allowed[x + z * resolution] != 0;
+}
+
 Terrain::Terrain(GameObject* gameObject)
     : Component(gameObject),
-    heightMap_(TextureFormat::R16, HEIGHTMAP_RESOLUTION, HEIGHTMAP_RESOLUTION),
+    heightMap_(TextureFormat::R16, OVERVIEW_RESOLUTION, OVERVIEW_RESOLUTION),
+    heightmapTiles_(TextureFormat::R16, TerrainHeightfield::TILE_STRIDE, TerrainHeightfield::TILE_STRIDE, GPU_TILE_LAYERS),
+    heightmapTileIndirection_(nullptr),
+    detailInstanceBuffer_(StorageBufferType::TerrainDetailInstancesBuffer),
+    detailBatchBuffer_(StorageBufferType::TerrainDetailBatchesBuffer),
+    objectInstanceBuffer_(StorageBufferType::ObjectInstancesBuffer),
     detailAltitudeLimits_(Vector2(0.0f, 500.0f)),
     detailSlopeLimit_(0.0f),
     dimensions_(Vector3(1024.0f, 80.0f, 1024.0f)),
+    heightmapResolution_(1024),
     seed_(0),
     fractalSmoothness_(2.0f),
     mountainScale_(4.0f),
     islandFactor_(2.0f),
+    changeCount_(0),
     waterColor_(Color(0.05f, 0.066f, 0.093f)),
     waterDepth_(30.0f)
 {
@@ -67,6 +138,7 @@ Terrain::~Terrain()
     }
     placedObjectInstances_.clear();
 
+    delete heightmapTileIndirection_;
 }
 
 void Terrain::drawProperties()
@@ -111,6 +183,7 @@ void Terrain::serialize(PropertyTable &table)
     table.serialize("dimensions", dimensions_, Vector3(1024.0f, 80.0f, 1024.0f));
     table.serialize("water_color", waterColor_, Color(0.05f, 0.066f, 0.093f));
     table.serialize("water_depth", waterDepth_, 30.0f);
+    table.serialize("heightmap_resolution", heightmapResolution_, 1024);
     table.serialize("layers", terrainLayers_);
     table.serialize("placed_objects", placedObjects_);
     table.serialize("seed", seed_, 0);
@@ -134,6 +207,16 @@ void Terrain::drawGenerationProperties()
 {
     bool terrainGenerationNeeded = ImGui::DragFloat3("Size", &dimensions_.x, 1.0f, 1.0f, 4096.0f);
     terrainGenerationNeeded |= ImGui::DragFloat("Water Depth", &waterDepth_, 0.1f, 0.0f, 100.0f);
+
+    // The heightmap resolution must be a power of two multiple of the overview resolution
+    int resolutionIndex = 0;
+    while ((OVERVIEW_RESOLUTION << resolutionIndex) < heightmapResolution_) resolutionIndex++;
+    if (ImGui::Combo("Heightmap Resolution", &resolutionIndex, "1024\0" "2048\0" "4096\0" "8192\0" "16384\0"))
+    {
+        heightmapResolution_ = OVERVIEW_RESOLUTION << resolutionIndex;
+        terrainGenerationNeeded = true;
+    }
+
     ImGui::Spacing();
 
     terrainGenerationNeeded |= ImGui::InputInt("Seed", &seed_);
@@ -254,11 +337,13 @@ void Terrain::generateTerrain()
      * will generate the same terrain in multiple runs.
      *
      * First, a fractal terrain generation process is run:
-     *     - Create a small 2x2 heightmap
-     *     - Offset each height value up or down by a small random amount
-     *     - Bilearly upscale the heightmap and repeat
+     *     - Start with a single height value
+     *     - Bilinearly upscale the heightmap to twice the resolution
+     *     - Offset each height value up or down by a small random amount, and repeat
      * The "fractal smoothness" property determines how rapidly the magnitude
      * of the random offset is reduced by for each subsequent iteration.
+     * The random offsets are hashed from the seed and the position, so any band
+     * of rows can be generated on its own without the rest of the heightmap.
      *
      * Next, tall mountains are formed by raising each height value to a power.
      * The power is called "mountain scale" - large values flatten most of the
@@ -270,159 +355,583 @@ void Terrain::generateTerrain()
      *
      * Finally, the maximum height in the heightmap is found. This is used to
      * normalize the heightmap prior to storing it in a gpu-memory texture.
+     *
+     * Large heightmaps do not fit in memory, so the heights are generated a band
+     * of rows at a time. The bands are generated once to find the maximum height,
+     * and again to normalize them and split them into heightfield tiles.
      */
 
-    srand(seed_);
-
-    // Reset the heightmap to a single value.
+    // The heightfield is stored in tiles, which need the resolution to be a multiple of
+    // the tile resolution. Also never generate less detail than the overview heightmap.
+    // Each fractal level doubles the resolution, so it is rounded up to a power of two.
+    const int heightmapResolution = std::max(heightmapResolution_, (int)OVERVIEW_RESOLUTION);
     int resolution = 1;
-    heights_.resize(1);
-    heights_[0] = dimensions_.y / 2.0f;
+    while (resolution < heightmapResolution)
+    {
+        resolution *= 2;
+    }
+    assert(resolution % TerrainHeightfield::TILE_RESOLUTION == 0);
 
-    // Run fractal passes, doubling the heightmap size each time, until
-    // we are up to the required resolution.
-    float moveSize = dimensions_.y / 2.0f;
-    while (resolution < HEIGHTMAP_RESOLUTION)
+    // Determine the maximum heightmap height, one band at a time
+    const int bandRows = TerrainHeightfield::TILE_RESOLUTION;
+    std::vector<float> band((size_t)bandRows * resolution);
+    float maxHeight = 0.0f;
+    for (int firstRow = 0; firstRow < resolution; firstRow += bandRows)
+    {
+        generateHeightRows(resolution, firstRow, bandRows, band.data());
+        maxHeight = std::max(maxHeight, *std::max_element(band.begin(), band.end()));
+    }
+    std::vector<float>().swap(band);
+
+    // Generate the heights again, corrected to match the terrain height, and split them into tiles.
+    // The heightfield pages out tiles beyond its memory budget as it goes.
+    // The overview heightmap and the occluder mesh are gathered from the same bands.
+    // Bands overlap by a few rows, which are written the same way each time.
+    const int overviewStep = resolution / OVERVIEW_RESOLUTION;
+    std::vector<uint16_t> overviewHeights(OVERVIEW_RESOLUTION * OVERVIEW_RESOLUTION);
+    std::vector<float> occluderCellHeights(OCCLUDER_RESOLUTION * OCCLUDER_RESOLUTION, FLT_MAX);
+    auto generateRows = [&](int firstRow, int rowCount, float* heights)
     {
-        int newResolution = resolution * 2;
-        std::vector<float> newHeights(newResolution * newResolution);
-        for (int y = 0; y < newResolution; ++y)
+        generateHeightRows(resolution, firstRow, rowCount, heights);
+        for (size_t i = 0; i < (size_t)rowCount * resolution; ++i)
+        {
+            heights[i] /= (maxHeight / dimensions_.y);
+        }
+
+        // Point sample the normalized uint16 overview of the heightmap, for passing to the gpu
+        for (int y = firstRow; y < firstRow + rowCount; ++y)
         {
-            for (int x = 0; x < newResolution; ++x)
+            if (y % overviewStep == 0)
             {
-                float v1 = heights_[x / 2 + y / 2 * resolution];
-                float v2 = heights_[std::min(x / 2 + 1, resolution - 1) + y / 2 * resolution];
-                float interp0 = (x % 2) == 0 ? v1 : (v1 + v2) / 2.0f;
+                for (int x = 0; x < OVERVIEW_RESOLUTION; ++x)
+                {
+                    const float height = heights[x * overviewStep + (size_t)(y - firstRow) * resolution];
+                    overviewHeights[x + y / overviewStep * OVERVIEW_RESOLUTION] = (uint16_t)(height / dimensions_.y * 65535.0f);
+                }
+            }
+        }
 
-                float v3 = heights_[x / 2 + std::min(y / 2 + 1, resolution - 1) * resolution];
-                float v4 = heights_[std::min(x / 2 + 1, resolution - 1) + std::min(y / 2 + 1, resolution - 1) * resolution];
-                float interp1 = (x % 2) == 0 ? v3 : (v3 + v4) / 2.0f;
+        addOccluderRows(heights, firstRow, rowCount, resolution, occluderCellHeights);
+    };
 
-                float interp = (y % 2) == 0 ? interp0 : (interp0 + interp1) / 2.0f;
+    // Normals are precomputed with the same gradient scale that the slope limits were tuned against.
+    heightfield_.build(resolution, 2.0f * resolution / dimensions_.x, 2.0f * resolution / dimensions_.z, generateRows);
 
-                newHeights[x + y * newResolution] = interp + random_float(-moveSize, moveSize);
-            }
-        }
+    // Upload the overview data to the gpu
+    heightMap_.setData(overviewHeights.data(), 2 * OVERVIEW_RESOLUTION * OVERVIEW_RESOLUTION, 0);
+
+    // Build the occluder mesh from the lowest heights in each cell
+    buildOccluderMesh(occluderCellHeights);
+
+    // Recreate the gpu tile indirection texture, with one texel per tile.
+    // Nothing is resident on the gpu until the tiles are streamed in.
+    delete heightmapTileIndirection_;
+    heightmapTileIndirection_ = new Texture(TextureFormat::RFloat, heightfield_.tilesPerSide(), heightfield_.tilesPerSide());
+    tileLayers_.assign(heightfield_.tileCount(), -1);
+    layerTiles_.assign(GPU_TILE_LAYERS, -1);
+
+    // Stream in the tiles around the centre of the terrain immediately.
+    updateStreaming(Point3(dimensions_.x / 2.0f, 0.0f, dimensions_.z / 2.0f), GPU_TILE_LAYERS);
+    changeCount_++;
+
+    // The heightmap is now build.
+    // Place objects on it.
+    placeObjects();
+    placeDetailMeshes();
+}
+
+void Terrain::generateFractalRows(int level, int firstRow, int rowCount, std::vector<float> &rows) const
+{
+    // The first level is a single height, half way up the terrain
+    if (level == 0)
+    {
+        rows.assign(1, dimensions_.y / 2.0f);
+        return;
+    }
+
+    // Find the rows of the previous level that these rows are upscaled from
+    const int resolution = 1 << level;
+    const int parentResolution = resolution / 2;
+    const int parentFirstRow = firstRow / 2;
+    const int parentLastRow = std::min((firstRow + rowCount - 1) / 2 + 1, parentResolution - 1);
+    std::vector<float> parent;
+    generateFractalRows(level - 1, parentFirstRow, parentLastRow - parentFirstRow + 1, parent);
+
+    // The random offsets shrink by the fractal smoothness at each level
+    const float moveSize = dimensions_.y / 2.0f / powf(fractalSmoothness_, (float)(level - 1));
+
+    // Bilinearly upscale the previous level, and offset each height
+    rows.resize((size_t)rowCount * resolution);
+    for (int y = firstRow; y < firstRow + rowCount; ++y)
+    {
+        const float* parentRow0 = &parent[(size_t)(y / 2 - parentFirstRow) * parentResolution];
+        const float* parentRow1 = &parent[(size_t)(std::min(y / 2 + 1, parentResolution - 1) - parentFirstRow) * parentResolution];
+        for (int x = 0; x < resolution; ++x)
+        {
+            const int x1 = std::min(x / 2 + 1, parentResolution - 1);
+            float v1 = parentRow0[x / 2];
+            float v2 = parentRow0[x1];
+            float interp0 = (x % 2) == 0 ? v1 : (v1 + v2) / 2.0f;
 
-        heights_ = newHeights;
-        resolution = newResolution;
-        moveSize /= fractalSmoothness_;
+            float v3 = parentRow1[x / 2];
+            float v4 = parentRow1[x1];
+            float interp1 = (x % 2) == 0 ? v3 : (v3 + v4) / 2.0f;
+
+            float interp = (y % 2) == 0 ? interp0 : (interp0 + interp1) / 2.0f;
+
+            rows[x + (size_t)(y - firstRow) * resolution] = interp + fractalNoise((uint32_t)seed_, level, x, y) * moveSize;
+        }
     }
+}
 
-    // Raise each height value to a power, allowing a controllable "mountain factor"
-    // that pulls high bits up and squashes lower bits down.
-    for (unsigned int i = 0; i < heights_.size(); ++i)
+void Terrain::generateHeightRows(int resolution, int firstRow, int rowCount, float* heights) const
+{
+    // Run the fractal up to the level with the required resolution
+    int level = 0;
+    while ((1 << level) < resolution)
     {
-        heights_[i] = powf(heights_[i], mountainScale_);
+        level++;
     }
 
-    // Use an "island factor" to flatten parts near the edge of the heightmap
-    // Just compute the distance from the island centre and flatten, with a controlable power factor.
-    for (int y = 0; y < HEIGHTMAP_RESOLUTION; ++y)
+    std::vector<float> fractalHeights;
+    generateFractalRows(level, firstRow, rowCount, fractalHeights);
+
+    for (int y = firstRow; y < firstRow + rowCount; ++y)
     {
-        for (int x = 0; x < HEIGHTMAP_RESOLUTION; ++x)
+        for (int x = 0; x < resolution; ++x)
         {
-            float distanceX = (x / (float)HEIGHTMAP_RESOLUTION) - 0.5f;
-            float distanceY = (y / (float)HEIGHTMAP_RESOLUTION) - 0.5f;
+            const size_t index = x + (size_t)(y - firstRow) * resolution;
+
+            // Raise each height value to a power, allowing a controllable "mountain factor"
+            // that pulls high bits up and squashes lower bits down.
+            float height = powf(fractalHeights[index], mountainScale_);
+
+            // Use an "island factor" to flatten parts near the edge of the heightmap
+            // Just compute the distance from the island centre and flatten, with a controlable power factor.
+            float distanceX = (x / (float)resolution) - 0.5f;
+            float distanceY = (y / (float)resolution) - 0.5f;
             float distanceFromCentre = sqrtf(distanceX * distanceX + distanceY * distanceY) * 2.0f;
             if (distanceFromCentre > 1.0f)
             {
                 distanceFromCentre = 1.0f;
             }
 
-            heights_[x + y * HEIGHTMAP_RESOLUTION] *= 1.0f - powf(distanceFromCentre, islandFactor_);
+            height *= 1.0f - powf(distanceFromCentre, islandFactor_);
 
             // Force values at the very edge of the terrain to 0.
             // This prevents weird artifacts in the water depth calculations
-            if (x == 0 || x == HEIGHTMAP_RESOLUTION - 1 || y == 0 || y == HEIGHTMAP_RESOLUTION - 1)
+            if (x == 0 || x == resolution - 1 || y == 0 || y == resolution - 1)
             {
-                heights_[x + y * HEIGHTMAP_RESOLUTION] = 0.0f;
+                height = 0.0f;
             }
+
+            heights[index] = height;
         }
     }
+}
 
-    // Determine the maximum heightmap height
-    float maxHeight = 0.0f;
-    for (unsigned int i = 0; i < heights_.size(); ++i)
+void Terrain::placeObjects()
+{
+    // Delete any existing objects
+    for (GameObject* go : placedObjectInstances_)
+    {
+        delete go;
+    }
+    placedObjectInstances_.clear();
+    staticPrefabs_.clear();
+    staticObjects_.clear();
+
+    // Consider each type of object we are supposed to place
+    for (const TerrainObject& objectType : placedObjects_)
     {
-        maxHeight = std::max(maxHeight, heights_[i]);
+        generateObjectInstances(objectType);
     }
 
-    // Generate a uint16 version of the data (normalized) for passing to the gpu.
-    std::vector<uint16_t> textureHeights(HEIGHTMAP_RESOLUTION * HEIGHTMAP_RESOLUTION);
-    for (int i = 0; i < textureHeights.size(); ++i)
+    buildObjectBatches();
+    changeCount_++;
+}
+
+void Terrain::buildObjectBatches()
+{
+    // The instances and world bounds of one mesh and material, split by batch grid cell
+    struct ObjectGroup
+    {
+        Mesh* mesh;
+        Material* material;
+        std::vector<std::vector<ObjectInstanceData>> cellInstances;
+        std::vector<Bounds> cellBounds;
+    };
+
+    // Gather the mesh instances of every static object, grouped by mesh and material,
+    // and then by the grid cell containing the object's origin.
+    // There are only a few distinct meshes, so the groups are found with a linear search.
+    const int cellCount = OBJECT_BATCH_GRID_RESOLUTION * OBJECT_BATCH_GRID_RESOLUTION;
+    std::vector<ObjectGroup> groups;
+    for (const TerrainObjectPlacement& placement : staticObjects_)
     {
-        textureHeights[i] = (uint16_t)(heights_[i] / maxHeight * 65535.0f);
+        const int cellX = std::max(0, std::min((int)(placement.position.x / dimensions_.x * OBJECT_BATCH_GRID_RESOLUTION), OBJECT_BATCH_GRID_RESOLUTION - 1));
+        const int cellZ = std::max(0, std::min((int)(placement.position.z / dimensions_.z * OBJECT_BATCH_GRID_RESOLUTION), OBJECT_BATCH_GRID_RESOLUTION - 1));
+        const int cell = cellX + cellZ * OBJECT_BATCH_GRID_RESOLUTION;
 
-        // Also correct the on-cpu heightfield to match
-        heights_[i] /= (maxHeight / dimensions_.y);
+        const Matrix4x4 prefabToWorld = placement.prefabToWorld();
+        for (const StaticPrefabMesh& mesh : staticPrefabs_[placement.prefabIndex].meshes)
+        {
+            unsigned int groupIndex = 0;
+            while (groupIndex < groups.size()
+                && (groups[groupIndex].mesh != mesh.mesh || groups[groupIndex].material != mesh.material))
+            {
+                groupIndex++;
+            }
+
+            if (groupIndex == groups.size())
+            {
+                ObjectGroup group;
+                group.mesh = mesh.mesh;
+                group.material = mesh.material;
+                group.cellInstances.resize(cellCount);
+                group.cellBounds.resize(cellCount);
+                groups.push_back(group);
+            }
+
+            // Grow the bounds of the cell's batch to cover the mesh
+            ObjectGroup& group = groups[groupIndex];
+            const Matrix4x4 meshToWorld = prefabToWorld * mesh.localToPrefab;
+            const Bounds worldBounds = mesh.mesh->bounds().box.transformed(meshToWorld);
+            if (group.cellInstances[cell].empty())
+            {
+                group.cellBounds[cell] = worldBounds;
+            }
+            else
+            {
+                group.cellBounds[cell].expandToCover(worldBounds.min());
+                group.cellBounds[cell].expandToCover(worldBounds.max());
+            }
+
+            // Only the top 3 rows are stored, as the bottom row is always 0 0 0 1
+            group.cellInstances[cell].push_back(ObjectInstanceData::fromMatrix(meshToWorld));
+        }
     }
 
-    // Upload the heightmap data to the gpu
-    heightMap_.setData(textureHeights.data(), 2 * HEIGHTMAP_RESOLUTION * HEIGHTMAP_RESOLUTION, 0);
+    // Make a batch for each cell of each group, packing the instances of each batch together,
+    // and upload them to the gpu once. The batches of a group are kept next to each other,
+    // so that the batches that are drawn can share their shader, mesh and material.
+    objectBatches_.clear();
+    std::vector<ObjectInstanceData> instances;
+    for (const ObjectGroup& group : groups)
+    {
+        for (int cell = 0; cell < cellCount; ++cell)
+        {
+            if (group.cellInstances[cell].empty())
+            {
+                continue;
+            }
 
-    // The heightmap is now build.
-    // Place objects on it.
-    placeObjects();
-    placeDetailMeshes();
+            TerrainObjectBatch batch;
+            batch.mesh = group.mesh;
+            batch.material = group.material;
+            batch.firstInstance = (int)instances.size();
+            batch.count = (int)group.cellInstances[cell].size();
+            batch.bounds = group.cellBounds[cell];
+            objectBatches_.push_back(batch);
+            instances.insert(instances.end(), group.cellInstances[cell].begin(), group.cellInstances[cell].end());
+        }
+    }
+
+    objectInstanceBuffer_.update(instances.data(), (int)instances.size());
+
+    // Rebuild the culling tree. Static objects are drawn at any distance.
+    std::vector<CullingItem> cullingItems(objectBatches_.size());
+    for (unsigned int i = 0; i < objectBatches_.size(); ++i)
+    {
+        cullingItems[i].bounds = objectBatches_[i].bounds;
+        cullingItems[i].drawDistance = FLT_MAX;
+    }
+
+    objectBatchTree_.build(cullingItems);
+
+    // Add each static object to the collider grid cells covered by its collider radius
+    objectColliderCells_.assign(OBJECT_COLLIDER_GRID_RESOLUTION * OBJECT_COLLIDER_GRID_RESOLUTION, std::vector<int>());
+    for (unsigned int i = 0; i < staticObjects_.size(); ++i)
+    {
+        const TerrainObjectPlacement& placement = staticObjects_[i];
+        const StaticPrefab& prefab = staticPrefabs_[placement.prefabIndex];
+        if (prefab.colliders.empty())
+        {
+            continue;
+        }
+
+        const float cellsPerMetreX = OBJECT_COLLIDER_GRID_RESOLUTION / dimensions_.x;
+        const float cellsPerMetreZ = OBJECT_COLLIDER_GRID_RESOLUTION / dimensions_.z;
+        const int minX = std::max(0, (int)floorf((placement.position.x - prefab.colliderRadius) * cellsPerMetreX));
+        const int maxX = std::min(OBJECT_COLLIDER_GRID_RESOLUTION - 1, (int)floorf((placement.position.x + prefab.colliderRadius) * cellsPerMetreX));
+        const int minZ = std::max(0, (int)floorf((placement.position.z - prefab.colliderRadius) * cellsPerMetreZ));
+        const int maxZ = std::min(OBJECT_COLLIDER_GRID_RESOLUTION - 1, (int)floorf((placement.position.z + prefab.colliderRadius) * cellsPerMetreZ));
+        for (int z = minZ; z <= maxZ; ++z)
+        {
+            for (int x = minX; x <= maxX; ++x)
+            {
+                objectColliderCells_[x + z * OBJECT_COLLIDER_GRID_RESOLUTION].push_back(i);
+            }
+        }
+    }
 }
 
-void Terrain::placeObjects()
+bool Terrain::checkForObjectCollision(const Point3 &point) const
 {
-    // Delete any existing objects
-    for (GameObject* go : placedObjectInstances_)
+    if (objectColliderCells_.empty())
     {
-        delete go;
+        return false;
     }
-    placedObjectInstances_.clear();
 
-    // Consider each type of object we are supposed to place
-    for (const TerrainObject& objectType : placedObjects_)
+    // Find the grid cell containing the point
+    const int x = std::max(0, std::min((int)(point.x / dimensions_.x * OBJECT_COLLIDER_GRID_RESOLUTION), OBJECT_COLLIDER_GRID_RESOLUTION - 1));
+    const int z = std::max(0, std::min((int)(point.z / dimensions_.z * OBJECT_COLLIDER_GRID_RESOLUTION), OBJECT_COLLIDER_GRID_RESOLUTION - 1));
+
+    // Check the colliders of each static object overlapping the cell
+    for (int objectIndex : objectColliderCells_[x + z * OBJECT_COLLIDER_GRID_RESOLUTION])
     {
-        generateObjectInstances(objectType);
+        const TerrainObjectPlacement& placement = staticObjects_[objectIndex];
+        const StaticPrefab& prefab = staticPrefabs_[placement.prefabIndex];
+
+        // Skip objects that are too far away before transforming the point
+        if (Point3::sqrDistance(point, placement.position) > prefab.colliderRadius * prefab.colliderRadius)
+        {
+            continue;
+        }
+
+        const Point3 prefabPoint = placement.worldToPrefab() * point;
+        for (const StaticPrefabCollider& collider : prefab.colliders)
+        {
+            if (collider.checkForCollision(prefabPoint))
+            {
+                return true;
+            }
+        }
     }
+
+    return false;
 }
 
 void Terrain::placeDetailMeshes()
 {
     // Delete any existing detail batches
     detailMeshBatches_.clear();
+    detailInstances_.clear();
 
     if (detailMesh_ != nullptr && detailMaterial_ != nullptr)
     {
-        // Split the terrain into a 12x12 grid of detail batches
-        const int batchResolution = 12;
-        for (int x = 0; x < batchResolution; ++x)
+        generateDetailBatches();
+    }
+
+    // Upload the instances and batches to the gpu once, rather than per draw.
+    std::vector<DetailBatchData> batchData(detailMeshBatches_.size());
+    for (unsigned int i = 0; i < detailMeshBatches_.size(); ++i)
+    {
+        const DetailBatch& batch = detailMeshBatches_[i];
+        const Point3 boundsMin = batch.bounds.min();
+        const Vector3 boundsSize = batch.bounds.size();
+        batchData[i].boundsMinScale = Vector4(boundsMin.x, boundsMin.y, boundsMin.z, batch.scaleRange.x);
+        batchData[i].boundsSizeScale = Vector4(boundsSize.x, boundsSize.y, boundsSize.z, batch.scaleRange.y - batch.scaleRange.x);
+        batchData[i].firstInstance = batch.firstInstance;
+        batchData[i].count = batch.count;
+    }
+
+    detailInstanceBuffer_.update(detailInstances_.data(), (int)detailInstances_.size());
+    detailBatchBuffer_.update(batchData.data(), (int)batchData.size());
+
+    // Rebuild the culling tree.
+    // The batch bounds only cover the instance positions, so expand them by the
+    // largest instance scale to cover the detail meshes, which are roughly unit sized.
+    std::vector<CullingItem> cullingItems(detailMeshBatches_.size());
+    for (unsigned int i = 0; i < detailMeshBatches_.size(); ++i)
+    {
+        const DetailBatch& batch = detailMeshBatches_[i];
+        const Vector3 margin = Vector3::one() * batch.scaleRange.y;
+        cullingItems[i].bounds = Bounds(batch.bounds.min() - margin, batch.bounds.max() + margin);
+        cullingItems[i].drawDistance = batch.drawDistance;
+    }
+
+    detailBatchTree_.build(cullingItems);
+}
+
+void Terrain::generateDetailBatches()
+{
+    // Work out where the altitude and slope limits allow details to be placed
+    TerrainPlacementMask mask;
+    buildPlacementMask(mask, detailAltitudeLimits_, detailSlopeLimit_);
+
+    // Split the terrain into a grid of cells, and generate the positions in each cell
+    // in parallel on the worker pool. Each cell uses its own seed, so the result is deterministic.
+    const int cellCount = DETAIL_GRID_RESOLUTION * DETAIL_GRID_RESOLUTION;
+    const float cellWidth = dimensions_.x / (float)DETAIL_GRID_RESOLUTION;
+    const float cellDepth = dimensions_.z / (float)DETAIL_GRID_RESOLUTION;
+    std::vector<std::vector<Vector4>> cellPositions(cellCount);
+    RenderManager::instance()->workerPool().run(cellCount, [&](int cell)
+    {
+        const int x = cell % DETAIL_GRID_RESOLUTION;
+        const int z = cell / DETAIL_GRID_RESOLUTION;
+        const uint32_t seed = (x << 12) | (z << 24);
+        generateDetailPositions(Rect(x * cellWidth, z * cellDepth, cellWidth, cellDepth), seed, mask, cellPositions[cell]);
+    });
+
+    // Build the batches for each cell.
+    // The heightfield pages tiles in and out, so heights are sampled on this thread.
+    std::vector<float> xs, zs, ys;
+    for (int cell = 0; cell < cellCount; ++cell)
+    {
+        const std::vector<Vector4>& positions = cellPositions[cell];
+        xs.resize(positions.size());
+        zs.resize(positions.size());
+        ys.resize(positions.size());
+        for (unsigned int i = 0; i < positions.size(); ++i)
+        {
+            xs[i] = positions[i].x;
+            zs[i] = positions[i].z;
+        }
+
+        sampleHeights(xs.data(), zs.data(), ys.data(), (int)positions.size());
+
+        // The positions are in a random order, so dealing them out to the batches
+        // keeps the pattern in each batch evenly spread over the cell.
+        const float minX = (cell % DETAIL_GRID_RESOLUTION) * cellWidth;
+        const float minZ = (cell / DETAIL_GRID_RESOLUTION) * cellDepth;
+        for (int iter = 0; iter < DETAIL_BATCHES_PER_CELL; ++iter)
+        {
+            // Find the height range of the instances in the batch
+            int count = 0;
+            float minY = FLT_MAX;
+            float maxY = -FLT_MAX;
+            for (unsigned int i = iter; i < positions.size() && count < DetailBatch::MaxInstancesPerBatch; i += DETAIL_BATCHES_PER_CELL)
+            {
+                minY = std::min(minY, ys[i]);
+                maxY = std::max(maxY, ys[i]);
+                count++;
+            }
+
+            // Skip empty batches
+            if (count == 0)
+            {
+                continue;
+            }
+
+            // The draw distance is based on the whole cell, regardless of the instance heights.
+            DetailBatch batch;
+            batch.drawDistance = Vector3(cellWidth, dimensions_.y, cellDepth).magnitude() * 0.25f * (float)(iter + 1);
+            batch.bounds = Bounds(Point3(minX, minY, minZ), Point3(minX + cellWidth, maxY, minZ + cellDepth));
+            batch.scaleRange = detailScale_;
+            batch.firstInstance = (int)detailInstances_.size();
+            batch.count = count;
+
+            // Append the quantised instances to the packed instance list
+            for (unsigned int i = iter; (int)detailInstances_.size() < batch.firstInstance + count; i += DETAIL_BATCHES_PER_CELL)
+            {
+                DetailInstance instance;
+                instance.x = quantise(xs[i], minX, cellWidth);
+                instance.y = quantise(ys[i], minY, maxY - minY);
+                instance.z = quantise(zs[i], minZ, cellDepth);
+                instance.scale = quantise(positions[i].w, detailScale_.x, detailScale_.y - detailScale_.x);
+                detailInstances_.push_back(instance);
+            }
+
+            detailMeshBatches_.push_back(batch);
+        }
+    }
+}
+
+void Terrain::addOccluderRows(const float* heights, int firstRow, int rowCount, int resolution, std::vector<float> &cellMinHeights) const
+{
+    // Lower the lowest height of each cell of the occluder grid that overlaps the rows, including the texels on its edges
+    const float texelsPerCell = (resolution - 1) / (float)OCCLUDER_RESOLUTION;
+    for (int cellZ = 0; cellZ < OCCLUDER_RESOLUTION; ++cellZ)
+    {
+        const int startZ = std::max(firstRow, (int)floorf(cellZ * texelsPerCell));
+        const int endZ = std::min(firstRow + rowCount - 1, std::min(resolution - 1, (int)ceilf((cellZ + 1) * texelsPerCell)));
+        if (startZ > endZ)
         {
-            // Determine the bounds in the x plane
-            float minX = x * dimensions_.x / (float)batchResolution;
-            float maxX = (x + 1) * dimensions_.x / (float)batchResolution;
+            continue;
+        }
 
-            for (int z = 0; z < batchResolution; ++z)
+        for (int cellX = 0; cellX < OCCLUDER_RESOLUTION; ++cellX)
+        {
+            const int startX = (int)floorf(cellX * texelsPerCell);
+            const int endX = std::min(resolution - 1, (int)ceilf((cellX + 1) * texelsPerCell));
+            float& minHeight = cellMinHeights[cellX + cellZ * OCCLUDER_RESOLUTION];
+            for (int z = startZ; z <= endZ; ++z)
             {
-                // Determine the bounds in the z plane
-                float minZ = z * dimensions_.z / (float)batchResolution;
-                float maxZ = (z + 1) * dimensions_.z / (float)batchResolution;
+                for (int x = startX; x <= endX; ++x)
+                {
+                    minHeight = std::min(minHeight, heights[x + (size_t)(z - firstRow) * resolution]);
+                }
+            }
+        }
+    }
+}
 
-                // For each tile, attempt to make multiple batches
-                // Each batch has a different draw distance, preventing a single grass/no grass transition
-                for (int iter = 0; iter < 3; ++iter)
+void Terrain::buildOccluderMesh(const std::vector<float> &cellMinHeights)
+{
+    // Each vertex uses the lowest height of the cells around it.
+    // The triangles in a cell then never rise above any texel in that cell.
+    const int verticesPerSide = OCCLUDER_RESOLUTION + 1;
+    occluderPositions_.resize(verticesPerSide * verticesPerSide);
+    for (int z = 0; z < verticesPerSide; ++z)
+    {
+        for (int x = 0; x < verticesPerSide; ++x)
+        {
+            float minHeight = FLT_MAX;
+            for (int cellZ = std::max(0, z - 1); cellZ <= std::min(OCCLUDER_RESOLUTION - 1, z); ++cellZ)
+            {
+                for (int cellX = std::max(0, x - 1); cellX <= std::min(OCCLUDER_RESOLUTION - 1, x); ++cellX)
                 {
-                    DetailBatch batch;
-                    batch.bounds = Bounds(Point3(minX, 0.0f, minZ), Point3(maxX, dimensions_.y, maxZ));
-                    batch.drawDistance = batch.bounds.size().magnitude() * 0.25f * (float)(iter + 1);
-
-                    // Look for instance positions within the bounds
-                    const uint32_t seed = iter | (x << 12) | (z << 24);
-                    generateDetailPositions(batch, seed);
-
-                    // If the batch is not empty, save it
-                    if (batch.count > 0)
-                    {
-                        detailMeshBatches_.push_back(batch);
-                    }
+                    minHeight = std::min(minHeight, cellMinHeights[cellX + cellZ * OCCLUDER_RESOLUTION]);
                 }
             }
+
+            occluderPositions_[x + z * verticesPerSide] = Point3(x * dimensions_.x / OCCLUDER_RESOLUTION, minHeight, z * dimensions_.z / OCCLUDER_RESOLUTION);
+        }
+    }
+
+    // Two triangles per cell
+    occluderIndices_.clear();
+    occluderIndices_.reserve(OCCLUDER_RESOLUTION * OCCLUDER_RESOLUTION * 6);
+    for (int z = 0; z < OCCLUDER_RESOLUTION; ++z)
+    {
+        for (int x = 0; x < OCCLUDER_RESOLUTION; ++x)
+        {
+            const uint32_t corner = x + z * verticesPerSide;
+            occluderIndices_.push_back(corner);
+            occluderIndices_.push_back(corner + verticesPerSide);
+            occluderIndices_.push_back(corner + 1);
+            occluderIndices_.push_back(corner + 1);
+            occluderIndices_.push_back(corner + verticesPerSide);
+            occluderIndices_.push_back(corner + verticesPerSide + 1);
+        }
+    }
+}
+
+void Terrain::buildPlacementMask(TerrainPlacementMask &mask, const Vector2 &altitudeLimits, float minNormalY) const
+{
+    mask.resolution = DETAIL_MASK_RESOLUTION;
+    mask.allowed.resize(DETAIL_MASK_RESOLUTION * DETAIL_MASK_RESOLUTION);
+
+    // Sample the centre of each mask cell, a row at a time
+    std::vector<float> xs(DETAIL_MASK_RESOLUTION), zs(DETAIL_MASK_RESOLUTION), ys(DETAIL_MASK_RESOLUTION);
+    std::vector<Vector3> normals(DETAIL_MASK_RESOLUTION);
+    for (int x = 0; x < DETAIL_MASK_RESOLUTION; ++x)
+    {
+        xs[x] = (x + 0.5f) / DETAIL_MASK_RESOLUTION * dimensions_.x;
+    }
+
+    for (int z = 0; z < DETAIL_MASK_RESOLUTION; ++z)
+    {
+        std::fill(zs.begin(), zs.end(), (z + 0.5f) / DETAIL_MASK_RESOLUTION * dimensions_.z);
+        sampleHeights(xs.data(), zs.data(), ys.data(), DETAIL_MASK_RESOLUTION);
+        sampleNormals(xs.data(), zs.data(), normals.data(), DETAIL_MASK_RESOLUTION);
+
+        for (int x = 0; x < DETAIL_MASK_RESOLUTION; ++x)
+        {
+            const bool altitudeAllowed = ys[x] >= altitudeLimits.x && ys[x] <= altitudeLimits.y;
+            const bool slopeAllowed = TerrainHeightfield::slopeNormalY(normals[x]) >= minNormalY;
+            mask.allowed[x + z * DETAIL_MASK_RESOLUTION] = (altitudeAllowed && slopeAllowed) ? 1 : 0;
         }
     }
 }
@@ -439,17 +948,49 @@ void Terrain::generateObjectInstances(const TerrainObject& objectType)
         return;
     }
 
+    // Prefabs that only have meshes and colliders are placed as lightweight static objects.
+    // Prefabs with behaviour need to be instantiated as full GameObjects.
+    int staticPrefabIndex = -1;
+    StaticPrefab staticPrefab;
+    if (StaticPrefab::extract(objectType.prefab, staticPrefab))
+    {
+        staticPrefabIndex = (int)staticPrefabs_.size();
+        staticPrefabs_.push_back(staticPrefab);
+    }
+
     // Pick random points on the heightmap and check if they are suitable for a windmill.
+    // Candidate points are generated and sampled in blocks, as batch sampling is much cheaper.
+    const int candidatesPerBlock = 64;
+    float xs[candidatesPerBlock], zs[candidatesPerBlock], ys[candidatesPerBlock];
+    Vector3 normals[candidatesPerBlock];
+    int candidate = candidatesPerBlock;
+
     int placed = 0;
     int attempts = 0;
     while (placed < objectType.minInstances || (attempts < objectType.maxInstances * 10 && placed < objectType.maxInstances))
     {
         attempts++;
 
-        // Pick a random point
-        float x = random_float(0.0f, dimensions_.x);
-        float z = random_float(0.0f, dimensions_.z);
-        float y = sampleHeightmap(x, z);
+        // Generate and sample the next block of random points
+        if (candidate == candidatesPerBlock)
+        {
+            for (int i = 0; i < candidatesPerBlock; ++i)
+            {
+                xs[i] = random_float(0.0f, dimensions_.x);
+                zs[i] = random_float(0.0f, dimensions_.z);
+            }
+
+            sampleHeights(xs, zs, ys, candidatesPerBlock);
+            sampleNormals(xs, zs, normals, candidatesPerBlock);
+            candidate = 0;
+        }
+
+        // Take the next random point
+        float x = xs[candidate];
+        float z = zs[candidate];
+        float y = ys[candidate];
+        const Vector3 normal = normals[candidate];
+        candidate++;
 
         // Check the altitude constraints are met
         if (y < objectType.minAltitude || y > objectType.maxAltitude)
@@ -458,18 +999,30 @@ void Terrain::generateObjectInstances(const TerrainObject& objectType)
         }
 
         // Check the slope constraints are met
-        if (sampleHeightmapNormal(x, z).y < (1.0f - objectType.maxSlope))
+        if (TerrainHeightfield::slopeNormalY(normal) < (1.0f - objectType.maxSlope))
         {
             continue;
         }
 
         // Place the object at that point
-        GameObject* newGO = new GameObject(objectType.prefab->resourceName(), objectType.prefab);
-        newGO->setFlag(GameObjectFlag::NotShownOrSaved, true);
-        newGO->setFlag(GameObjectFlag::SurviveSceneChanges, true); // The terrain handles deleting its sub-objects manually
-        newGO->transform()->setPositionLocal(Point3(x, y, z));
-        newGO->transform()->setRotationLocal(Quaternion::euler(0.0f, random_float(0.0f, 360.0f), 0.0f));
-        placedObjectInstances_.push_back(newGO);
+        const float rotation = random_float(0.0f, 360.0f);
+        if (staticPrefabIndex >= 0)
+        {
+            TerrainObjectPlacement placement;
+            placement.position = Point3(x, y, z);
+            placement.rotation = rotation;
+            placement.prefabIndex = staticPrefabIndex;
+            staticObjects_.push_back(placement);
+        }
+        else
+        {
+            GameObject* newGO = new GameObject(objectType.prefab->resourceName(), objectType.prefab);
+            newGO->setFlag(GameObjectFlag::NotShownOrSaved, true);
+            newGO->setFlag(GameObjectFlag::SurviveSceneChanges, true); // The terrain handles deleting its sub-objects manually
+            newGO->transform()->setPositionLocal(Point3(x, y, z));
+            newGO->transform()->setRotationLocal(Quaternion::euler(0.0f, rotation, 0.0f));
+            placedObjectInstances_.push_back(newGO);
+        }
         placed++;
 
         // Safety - if we have done a huge number of attempts, exit
@@ -481,80 +1034,181 @@ void Terrain::generateObjectInstances(const TerrainObject& objectType)
     }
 }
 
-void Terrain::generateDetailPositions(DetailBatch& batch, uint32_t seed) const
+void Terrain::generateDetailPositions(const Rect &area, uint32_t seed, const TerrainPlacementMask &mask, std::vector<Vector4> &positions) const
 {
-    // Use the batch centre as the seed
-    // This ensures that multiple runs are deterministic.
-    srand(seed);
+    // Fill the area with a blue noise pattern, spaced so that a fully
+    // allowed area gives every batch in the cell its maximum instance count.
+    const int maxPositions = DetailBatch::MaxInstancesPerBatch * DETAIL_BATCHES_PER_CELL;
+    const float spacing = poisson_disk_distance(area.width * area.height, (float)maxPositions);
+    std::vector<Point2> points = poisson_disk_points(area, spacing, seed, maxPositions * 2);
+
+    // Shuffle the points, as they are generated in an order that grows out from the first one.
+    // Use a local generator, as rand() is shared between threads.
+    std::mt19937 generator(seed);
+    std::shuffle(points.begin(), points.end(), generator);
+
+    // Keep the points that the mask allows, each with a random scale
+    std::uniform_real_distribution<float> scale(detailScale_.x, detailScale_.y);
+    positions.clear();
+    for (const Point2& p : points)
+    {
+        if ((int)positions.size() < maxPositions && mask.isAllowed(p.x / dimensions_.x, p.y / dimensions_.z))
+        {
+            positions.push_back(Vector4(p.x, 0.0f, p.y, scale(generator)));
+        }
+    }
+}
 
-    // Reset the number of positions in the batch
-    batch.count = 0;
+float Terrain::sampleHeightmap(float x, float z) const
+{
+    float height;
+    sampleHeights(&x, &z, &height, 1);
+    return height;
+}
 
-    // Otherwise, pick 1024 random points on the terrain
-    int attempts = 0;
-    while (attempts < 4000 && batch.count < DetailBatch::MaxInstancesPerBatch)
+Vector3 Terrain::sampleHeightmapNormal(float x, float z) const
+{
+    Vector3 normal;
+    sampleNormals(&x, &z, &normal, 1);
+    return normal;
+}
+
+void Terrain::sampleHeights(const float* xs, const float* zs, float* out, int n) const
+{
+    float texelXs[SAMPLE_BLOCK_SIZE], texelZs[SAMPLE_BLOCK_SIZE];
+    for (int i = 0; i < n; i += SAMPLE_BLOCK_SIZE)
     {
-        attempts++;
+        const int count = std::min((int)SAMPLE_BLOCK_SIZE, n - i);
+        worldToTexel(xs + i, zs + i, texelXs, texelZs, count);
+        heightfield_.sampleHeights(texelXs, texelZs, out + i, count);
 
-        // Pick a random point
-        float x = random_float(batch.bounds.min().x, batch.bounds.max().x);
-        float z = random_float(batch.bounds.min().z, batch.bounds.max().z);
-        float y = sampleHeightmap(x, z);
+        // The heightfield is stored relative to the bottom of the water
+        for (int j = 0; j < count; ++j)
+        {
+            out[i + j] -= waterDepth_;
+        }
+    }
+}
 
-        // Respect the detail altitude limits
-        if (y > detailAltitudeLimits_.y || y < detailAltitudeLimits_.x)
+void Terrain::sampleNormals(const float* xs, const float* zs, Vector3* out, int n) const
+{
+    float texelXs[SAMPLE_BLOCK_SIZE], texelZs[SAMPLE_BLOCK_SIZE];
+    for (int i = 0; i < n; i += SAMPLE_BLOCK_SIZE)
+    {
+        const int count = std::min((int)SAMPLE_BLOCK_SIZE, n - i);
+        worldToTexel(xs + i, zs + i, texelXs, texelZs, count);
+        heightfield_.sampleNormals(texelXs, texelZs, out + i, count);
+    }
+}
+
+void Terrain::worldToTexel(const float* xs, const float* zs, float* texelXs, float* texelZs, int n) const
+{
+    // The heightfield clamps the texel coordinates to its edges.
+    const float scaleX = (heightfield_.resolution() - 1) / dimensions_.x;
+    const float scaleZ = (heightfield_.resolution() - 1) / dimensions_.z;
+    for (int i = 0; i < n; ++i)
+    {
+        texelXs[i] = xs[i] * scaleX;
+        texelZs[i] = zs[i] * scaleZ;
+    }
+}
+
+void Terrain::updateStreaming(const Point3 &cameraPosition, int maxTileUploads)
+{
+    if (heightmapTileIndirection_ == nullptr)
+    {
+        return;
+    }
+
+    // Find the camera position in heightfield texels
+    const int tilesPerSide = heightfield_.tilesPerSide();
+    const float texelX = cameraPosition.x / dimensions_.x * heightfield_.resolution();
+    const float texelZ = cameraPosition.z / dimensions_.z * heightfield_.resolution();
+
+    // Keep the cpu copy of the tiles around the camera resident.
+    // Cover twice the area that is resident on the gpu, which the
+    // default budget of 17x17 tiles holds without evicting any of them.
+    const float gpuRadiusTiles = sqrtf((float)GPU_TILE_LAYERS) * 0.5f;
+    heightfield_.updateResidency(texelX, texelZ, gpuRadiusTiles * 2.0f * TerrainHeightfield::TILE_RESOLUTION);
+
+    // Rank every tile by its distance from the camera
+    const float cameraTileX = texelX / TerrainHeightfield::TILE_RESOLUTION;
+    const float cameraTileZ = texelZ / TerrainHeightfield::TILE_RESOLUTION;
+    std::vector<std::pair<float, int>> rankedTiles(heightfield_.tileCount());
+    for (int tileZ = 0; tileZ < tilesPerSide; ++tileZ)
+    {
+        for (int tileX = 0; tileX < tilesPerSide; ++tileX)
         {
-            continue;
+            const float dx = (tileX + 0.5f) - cameraTileX;
+            const float dz = (tileZ + 0.5f) - cameraTileZ;
+            rankedTiles[tileX + tileZ * tilesPerSide] = std::make_pair(dx * dx + dz * dz, tileX + tileZ * tilesPerSide);
         }
+    }
 
-        // Respect the layer's slope settings
-        if (sampleHeightmapNormal(x, z).y < detailSlopeLimit_)
+    // The closest tiles should be resident on the gpu
+    const int wantedCount = std::min((int)rankedTiles.size(), (int)GPU_TILE_LAYERS);
+    std::partial_sort(rankedTiles.begin(), rankedTiles.begin() + wantedCount, rankedTiles.end());
+    std::vector<bool> wanted(rankedTiles.size(), false);
+    for (int i = 0; i < wantedCount; ++i)
+    {
+        wanted[rankedTiles[i].second] = true;
+    }
+
+    // Upload missing tiles, closest first, replacing tiles that are no longer wanted.
+    bool indirectionChanged = false;
+    int uploads = 0;
+    for (int i = 0; i < wantedCount && uploads < maxTileUploads; ++i)
+    {
+        const int tileIndex = rankedTiles[i].second;
+        if (tileLayers_[tileIndex] != -1)
         {
             continue;
         }
 
-        float scale = random_float(detailScale_.x, detailScale_.y);
-        batch.instancePositions[batch.count] = Vector4(x, y, z, scale);
-        batch.count++;
+        // Find a free layer, or a layer holding a tile that is no longer wanted
+        int layer = -1;
+        for (int l = 0; l < GPU_TILE_LAYERS && layer == -1; ++l)
+        {
+            if (layerTiles_[l] == -1 || !wanted[layerTiles_[l]])
+            {
+                layer = l;
+            }
+        }
+
+        assert(layer != -1);
+        if (layerTiles_[layer] != -1)
+        {
+            tileLayers_[layerTiles_[layer]] = -1;
+        }
+
+        uploadTile(tileIndex, layer);
+        tileLayers_[tileIndex] = layer;
+        layerTiles_[layer] = tileIndex;
+        indirectionChanged = true;
+        uploads++;
+    }
+
+    // Update the indirection table so that shaders sample the new tiles
+    if (indirectionChanged)
+    {
+        std::vector<float> indirection(tileLayers_.begin(), tileLayers_.end());
+        heightmapTileIndirection_->setData(indirection.data(), (int)(sizeof(float) * indirection.size()), 0);
     }
 }
 
-float Terrain::sampleHeightmap(float x, float z) const
+void Terrain::uploadTile(int tileIndex, int layer)
 {
-	// Clamp the x and z to the terrain dimensions
-	if (x < 0.0f) x = 0.0f;
-	if (x > dimensions_.x) x = dimensions_.x;
-	if (z < 0.0f) z = 0.0f;
-	if (z > dimensions_.z) z = dimensions_.z;
+    const int tilesPerSide = heightfield_.tilesPerSide();
+    const float* heights = heightfield_.tileHeights(tileIndex % tilesPerSide, tileIndex / tilesPerSide);
 
-	// Now sample the correct heightmap texel
-    int xTexel = (int)((x / dimensions_.x) * (HEIGHTMAP_RESOLUTION - 1) + 0.5f);
-    int zTexel = (int)((z / dimensions_.z) * (HEIGHTMAP_RESOLUTION - 1) + 0.5f);
-    return heights_[xTexel + zTexel * HEIGHTMAP_RESOLUTION] - waterDepth_;
-}
+    // Store the tile as normalized uint16, matching the overview heightmap
+    const int valueCount = TerrainHeightfield::TILE_STRIDE * TerrainHeightfield::TILE_STRIDE;
+    std::vector<uint16_t> tileData(valueCount);
+    for (int i = 0; i < valueCount; ++i)
+    {
+        const float normalizedHeight = std::max(0.0f, std::min(heights[i] / dimensions_.y, 1.0f));
+        tileData[i] = (uint16_t)(normalizedHeight * 65535.0f);
+    }
 
-Vector3 Terrain::sampleHeightmapNormal(float x, float z) const
-{
-	// Clamp the x and z to the terrain dimensions
-	if (x < 1.0f) x = 0.0f;
-	if (x > dimensions_.x) x = dimensions_.x;
-	if (z < 1.0f) z = 0.0f;
-	if (z > dimensions_.z) z = dimensions_.z;
-
-	// Now sample the correct heightmap texels and perform finite difference
-    int xTexel = (int)((x / dimensions_.x) * (HEIGHTMAP_RESOLUTION - 1) + 0.5f);
-    int zTexel = (int)((z / dimensions_.z) * (HEIGHTMAP_RESOLUTION - 1) + 0.5f);
-    int x1Texel = std::max(xTexel - 1, 0);
-    int x2Texel = std::min(xTexel + 1, HEIGHTMAP_RESOLUTION - 1);
-    int z1Texel = std::max(zTexel - 1, 0);
-    int z2Texel = std::min(zTexel + 1, HEIGHTMAP_RESOLUTION - 1);
-    float x1 = heights_[x1Texel + zTexel * HEIGHTMAP_RESOLUTION];
-    float x2 = heights_[x2Texel + zTexel * HEIGHTMAP_RESOLUTION];
-    float z1 = heights_[xTexel + z1Texel * HEIGHTMAP_RESOLUTION];
-    float z2 = heights_[xTexel + z2Texel * HEIGHTMAP_RESOLUTION];
-    float dydx = (x2 - x1) * (2.0f * HEIGHTMAP_RESOLUTION / dimensions_.x);
-    float dydz = (z2 - z1) * (2.0f * HEIGHTMAP_RESOLUTION / dimensions_.z);
-    Vector3 worldTangent = Vector3(1.0f, dydx, 0.0f).normalized();
-    Vector3 worldBitangent = Vector3(0.0f, dydz, 1.0f).normalized();
-    return Vector3::cross(worldBitangent, worldTangent);
+    heightmapTiles_.setLayerData(layer, tileData.data(), (int)(sizeof(uint16_t) * tileData.size()));
 }
@@ -1,10 +1,17 @@
 #pragma once
 
 #include "Scene/Component.h"
+#include "Scene/StaticPrefab.h"
+#include "Scene/TerrainHeightfield.h"
+#include "Renderer/CullingQuadtree.h"
+#include "Renderer/InstanceBatcher.h"
 #include "Renderer/Mesh.h"
+#include "Renderer/StorageBuffer.h"
 #include "Renderer/Texture.h"
 #include "Math/Bounds.h"
 #include "Math/Color.h"
+#include "Math/Matrix4x4.h"
+#include "Math/Rect.h"
 #include "Math/Vector2.h"
 #include "Math/Vector3.h"
 #include "Math/Vector4.h"
@@ -38,23 +45,115 @@ struct TerrainObject : ISerializedObject
     void serialize(PropertyTable& table) override;
 };
 
-// A group of detail meshes drawn in a single batch
+// A static object placed on the terrain.
+// Static objects are not GameObjects; only their placement is stored,
+// and their meshes and colliders come from the shared static prefab.
+struct TerrainObjectPlacement
+{
+    Point3 position;
+    float rotation; // Rotation around the y axis, in degrees
+    int prefabIndex; // The index of the static prefab in the terrain
+
+    // The transformation matrices between the prefab space and world space
+    Matrix4x4 prefabToWorld() const;
+    Matrix4x4 worldToPrefab() const;
+};
+
+// A group of static object meshes with the same mesh and material in one cell of the object batch grid,
+// drawn together with an instanced draw. The instances are stored contiguously in the terrain's object
+// instance list, and the batches with the same mesh and material are stored next to each other.
+struct TerrainObjectBatch
+{
+    Mesh* mesh;
+    Material* material;
+    int firstInstance;
+    int count;
+    Bounds bounds;
+};
+
+// A single detail mesh instance.
+// The position is quantised relative to the bounds of its batch,
+// and the scale is quantised relative to the batch scale range.
+struct DetailInstance
+{
+    uint16_t x;
+    uint16_t z;
+    uint16_t y;
+    uint16_t scale;
+};
+
+// A group of detail meshes drawn in a single batch.
+// The instances are stored contiguously in the terrain's detail instance list.
 struct DetailBatch
 {
     const static int MaxInstancesPerBatch = 1024;
 
+    int firstInstance;
     int count;
-    Vector4 instancePositions[MaxInstancesPerBatch];
     Bounds bounds;
+    Vector2 scaleRange;
     float drawDistance;
+
+    // Converts a quantised instance in the batch back to a position and scale
+    Vector4 decode(const DetailInstance &instance) const;
+};
+
+// The gpu copy of a detail batch, used by shaders to decode its instances.
+// Must match the std430 layout in TerrainDetail.shader.
+struct DetailBatchData
+{
+    Vector4 boundsMinScale; // xyz = bounds min, w = min scale
+    Vector4 boundsSizeScale; // xyz = bounds size, w = scale range
+    int firstInstance;
+    int count;
+    int padding[2];
+};
+
+// A grid covering the terrain that marks where placement is allowed.
+// Built once from the altitude and slope limits, so that placement
+// only needs a single lookup per candidate point.
+struct TerrainPlacementMask
+{
+    int resolution = 0;
+    std::vector<uint8_t> allowed;
+
+    // Checks if placement is allowed at a point.
+    // The coordinates are normalized to the terrain size.
+    bool isAllowed(float normalizedX, float normalizedZ) const;
 };
 
 class Terrain : public Component
 {
 public:
-    const static int HEIGHTMAP_RESOLUTION = 1024;
     const static int MAX_LAYERS = 32;
 
+    // The resolution of the low detail heightmap covering the whole terrain.
+    // It is always resident on the gpu and is used where no detailed tile is resident.
+    const static int OVERVIEW_RESOLUTION = 1024;
+
+    // The number of full detail heightfield tiles that can be resident on the gpu.
+    const static int GPU_TILE_LAYERS = 64;
+
+    // The number of heightfield tiles uploaded to the gpu per frame while streaming.
+    const static int MAX_TILE_UPLOADS_PER_FRAME = 4;
+
+    // The resolution of the mask used for detail placement, along each side.
+    const static int DETAIL_MASK_RESOLUTION = 1024;
+
+    // The detail grid resolution, and the number of batches in each grid cell.
+    // Each batch in a cell has a different draw distance, preventing a single grass/no grass transition.
+    const static int DETAIL_GRID_RESOLUTION = 12;
+    const static int DETAIL_BATCHES_PER_CELL = 3;
+
+    // The resolution of the grid used to find static object colliders near a point.
+    const static int OBJECT_COLLIDER_GRID_RESOLUTION = 32;
+
+    // The resolution of the grid static objects are batched by, so that batches out of view can be culled.
+    const static int OBJECT_BATCH_GRID_RESOLUTION = 8;
+
+    // The number of quads along each side of the low detail mesh used for occlusion culling.
+    const static int OCCLUDER_RESOLUTION = 64;
+
     explicit Terrain(GameObject* gameObject);
     ~Terrain() override;
 
@@ -66,11 +165,19 @@ public:
 
     const Mesh* mesh() const { return mesh_; }
     const Texture* heightmap() const { return &heightMap_; }
+    const ArrayTexture* heightmapTiles() const { return &heightmapTiles_; }
+    const Texture* heightmapTileIndirection() const { return heightmapTileIndirection_; }
     const Mesh* detailMesh() const { return detailMesh_; }
     const Material* detailMaterial() const { return detailMaterial_; }
 
     // Total size of the terrain, in m, in X,Y,Z
     Vector3 size() const { return dimensions_; }
+
+    // The full resolution of the heightfield, in texels along each side.
+    int heightmapResolution() const { return heightmapResolution_; }
+
+    // The tiled heightfield data
+    const TerrainHeightfield& heightfield() const { return heightfield_; }
     
     // The base color of the water
     Color waterColor() const { return waterColor_; }
@@ -78,6 +185,10 @@ public:
     // The depth of the water at its deepest point
     float waterDepth() const { return waterDepth_; }
 
+    // Incremented each time the heightfield is generated or the static objects are placed,
+    // so that anything cached from the terrain, such as shadow cascades, can tell when it changed
+    uint32_t changeCount() const { return changeCount_; }
+
     // The layers on the terrain
     const TerrainLayer* layers() const { return &terrainLayers_.front(); }
     int layerCount() const { return (int)terrainLayers_.size(); }
@@ -85,9 +196,46 @@ public:
     // The detail mesh batches on the terrain
     const std::vector<DetailBatch>& detailBatches() const { return detailMeshBatches_; }
 
+    // A quadtree used for culling the detail batches.
+    // The item indices match the detail batch indices.
+    const CullingQuadtree& detailBatchTree() const { return detailBatchTree_; }
+
+    // The instances of every detail batch, packed together
+    const std::vector<DetailInstance>& detailInstances() const { return detailInstances_; }
+
+    // The gpu copies of the detail instances and batches.
+    // These are only updated when the details are placed.
+    const StorageBuffer<DetailInstance>* detailInstanceBuffer() const { return &detailInstanceBuffer_; }
+    const StorageBuffer<DetailBatchData>* detailBatchBuffer() const { return &detailBatchBuffer_; }
+
+    // The static objects placed on the terrain, grouped into instanced batches by mesh, material and grid cell
+    const std::vector<TerrainObjectBatch>& objectBatches() const { return objectBatches_; }
+
+    // A quadtree used for culling the static object batches.
+    // The item indices match the object batch indices.
+    const CullingQuadtree& objectBatchTree() const { return objectBatchTree_; }
+
+    // The gpu copy of the static object instance transforms.
+    // This is only updated when the objects are placed.
+    const StorageBuffer<ObjectInstanceData>* objectInstanceBuffer() const { return &objectInstanceBuffer_; }
+
+    // A low detail mesh of the terrain used for occlusion culling, in world space.
+    // Every point on it is at or below the real surface, so it never hides anything that is above the terrain.
+    const std::vector<Point3>& occluderPositions() const { return occluderPositions_; }
+    const std::vector<uint32_t>& occluderIndices() const { return occluderIndices_; }
+
+    // Checks if a world-space point intersects with the collider of any static object on the terrain.
+    bool checkForObjectCollision(const Point3 &point) const;
+
+    // Pages heightfield tiles in and out of cpu and gpu memory so that
+    // the tiles nearest to the camera are resident.
+    void updateStreaming(const Point3 &cameraPosition, int maxTileUploads = MAX_TILE_UPLOADS_PER_FRAME);
+
 private:
     Mesh* mesh_;
     Texture heightMap_;
+    ArrayTexture heightmapTiles_;
+    Texture* heightmapTileIndirection_;
     Mesh* detailMesh_;
     Material* detailMaterial_;
     Vector2 detailScale_;
@@ -100,19 +248,47 @@ private:
     std::vector<TerrainObject> placedObjects_;
 
     // Terrain generation settings
+    int heightmapResolution_;
     int seed_;
     float fractalSmoothness_;
     float mountainScale_;
     float islandFactor_;
 
-    // The current heightmap
-    std::vector<float> heights_;
+    // The current heightfield
+    TerrainHeightfield heightfield_;
+
+    // Counts the changes to the heightfield and static objects
+    uint32_t changeCount_;
+
+    // The low detail occluder mesh
+    std::vector<Point3> occluderPositions_;
+    std::vector<uint32_t> occluderIndices_;
 
-    // A list of objects placed on the terrain
+    // The gpu tile array layer used by each heightfield tile, or -1 if not resident.
+    std::vector<int> tileLayers_;
+
+    // The heightfield tile stored in each gpu tile array layer, or -1 if unused.
+    std::vector<int> layerTiles_;
+
+    // A list of objects with behaviour placed on the terrain
     std::vector<GameObject*> placedObjectInstances_;
 
+    // The static objects placed on the terrain, and the prefabs they use
+    std::vector<StaticPrefab> staticPrefabs_;
+    std::vector<TerrainObjectPlacement> staticObjects_;
+    std::vector<TerrainObjectBatch> objectBatches_;
+    StorageBuffer<ObjectInstanceData> objectInstanceBuffer_;
+    CullingQuadtree objectBatchTree_;
+
+    // The static objects that have colliders overlapping each grid cell
+    std::vector<std::vector<int>> objectColliderCells_;
+
     // A list of detail mesh layers on the terrain
     std::vector<DetailBatch> detailMeshBatches_;
+    std::vector<DetailInstance> detailInstances_;
+    StorageBuffer<DetailInstance> detailInstanceBuffer_;
+    StorageBuffer<DetailBatchData> detailBatchBuffer_;
+    CullingQuadtree detailBatchTree_;
 
     // Draws sections of the terrain editor
     void drawGenerationProperties();
@@ -128,8 +304,34 @@ private:
     // Generates object instances for the given object type
     void generateObjectInstances(const TerrainObject &objectType);
 
-    // Generates detail positions for the given detail batch
-    void generateDetailPositions(DetailBatch &batch, uint32_t seed) const;
+    // Groups the static objects into instanced batches, builds their culling tree and builds the collider grid
+    void buildObjectBatches();
+
+    // Places the detail batches and their packed instances
+    void generateDetailBatches();
+
+    // Generates rows of one level of the fractal, which has 2^level texels per side.
+    // Any band of rows can be generated on its own, and matches the same rows of the whole level.
+    void generateFractalRows(int level, int firstRow, int rowCount, std::vector<float> &rows) const;
+
+    // Generates rows of the heightmap, before they are corrected to match the terrain height
+    void generateHeightRows(int resolution, int firstRow, int rowCount, float* heights) const;
+
+    // Lowers the lowest height of each occluder grid cell to cover a band of full resolution rows
+    void addOccluderRows(const float* heights, int firstRow, int rowCount, int resolution, std::vector<float> &cellMinHeights) const;
+
+    // Builds the occluder mesh from the lowest height in each cell of the occluder grid
+    void buildOccluderMesh(const std::vector<float> &cellMinHeights);
+
+    // Builds a placement mask from altitude and slope limits
+    void buildPlacementMask(TerrainPlacementMask &mask, const Vector2 &altitudeLimits, float minNormalY) const;
+
+    // Generates detail positions inside an area of the terrain, as x, z and scale.
+    // Only reads the placement mask, so is safe to run on multiple threads at once.
+    void generateDetailPositions(const Rect &area, uint32_t seed, const TerrainPlacementMask &mask, std::vector<Vector4> &positions) const;
+
+    // Copies a heightfield tile into a layer of the gpu tile array
+    void uploadTile(int tileIndex, int layer);
 
 public:
     // Gets the heightmap height at a specified point
@@ -139,4 +341,19 @@ public:
     // Gets the heightmap normal at a specified point
     // The x and z coordinates are in world space.
     Vector3 sampleHeightmapNormal(float x, float z) const;
+
+    // Bilinearly samples the heightmap height at n points.
+    // The x and z coordinates are in world space.
+    void sampleHeights(const float* xs, const float* zs, float* out, int n) const;
+
+    // Bilinearly samples the precomputed heightmap normal at n points.
+    // The x and z coordinates are in world space.
+    void sampleNormals(const float* xs, const float* zs, Vector3* out, int n) const;
+
+private:
+    // The number of points converted to texel space at once by the batch sampling functions
+    const static int SAMPLE_BLOCK_SIZE = 256;
+
+    // Converts world space x and z coordinates into heightfield texel coordinates
+    void worldToTexel(const float* xs, const float* zs, float* texelXs, float* texelZs, int n) const;
 };
@@ -0,0 +1,445 @@
+#include "TerrainHeightfield.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+#include "ResourceManager.h"
+
+namespace
+{
+    // Converts between normal components and their snorm16 storage
+    int16_t packNormalComponent(float value)
+    {
+        return (int16_t)(std::max(-1.0f, std::min(value, 1.0f)) * 32767.0f + (value < 0.0f ? -0.5f : 0.5f));
+    }
+
+    float unpackNormalComponent(int16_t value)
+    {
+        return value / 32767.0f;
+    }
+
+    // Finds the texels used to bilinearly filter 4 sample points.
+    // Each point gets the index of the tile it lies in and the offset of its
+    // lowest texel inside that tile. The shared tile edge means the other
+    // 3 texels are always in the same tile, at +1, +STRIDE and +STRIDE+1.
+    void bilinearFootprints(const float* xs, const float* zs, int resolution, int tilesPerSide,
+        int tileIndices[4], int offsets[4], __m128 &fractionX, __m128 &fractionZ)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 maxCoord = _mm_set1_ps((float)(resolution - 1));
+        const __m128 maxTile = _mm_set1_ps((float)(tilesPerSide - 1));
+        const __m128 tileSize = _mm_set1_ps((float)TerrainHeightfield::TILE_RESOLUTION);
+        const __m128 inverseTileSize = _mm_set1_ps(1.0f / TerrainHeightfield::TILE_RESOLUTION);
+
+        // Clamp the coordinates to the heightfield.
+        // They are never negative, so truncation is the same as floor.
+        const __m128 x = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(xs), zero), maxCoord);
+        const __m128 z = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(zs), zero), maxCoord);
+        const __m128 x0 = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+        const __m128 z0 = _mm_cvtepi32_ps(_mm_cvttps_epi32(z));
+        fractionX = _mm_sub_ps(x, x0);
+        fractionZ = _mm_sub_ps(z, z0);
+
+        // The last texel belongs to the final tile's shared edge.
+        const __m128 tileX = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(x0, inverseTileSize))), maxTile);
+        const __m128 tileZ = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(z0, inverseTileSize))), maxTile);
+        const __m128 localX = _mm_sub_ps(x0, _mm_mul_ps(tileX, tileSize));
+        const __m128 localZ = _mm_sub_ps(z0, _mm_mul_ps(tileZ, tileSize));
+
+        // All of the values are small integers, so are exact as floats.
+        const __m128 tileIndex = _mm_add_ps(tileX, _mm_mul_ps(tileZ, _mm_set1_ps((float)tilesPerSide)));
+        const __m128 offset = _mm_add_ps(localX, _mm_mul_ps(localZ, _mm_set1_ps((float)TerrainHeightfield::TILE_STRIDE)));
+        _mm_storeu_si128((__m128i*)tileIndices, _mm_cvttps_epi32(tileIndex));
+        _mm_storeu_si128((__m128i*)offsets, _mm_cvttps_epi32(offset));
+    }
+
+    // Bilinearly interpolates 4 sets of corner values
+    __m128 bilinear(__m128 c00, __m128 c10, __m128 c01, __m128 c11, __m128 fractionX, __m128 fractionZ)
+    {
+        const __m128 row0 = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), fractionX));
+        const __m128 row1 = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), fractionX));
+        return _mm_add_ps(row0, _mm_mul_ps(_mm_sub_ps(row1, row0), fractionZ));
+    }
+
+    // Copies up to 4 sample coordinates into a full block, repeating the last one.
+    void fillBlock(const float* xs, const float* zs, int count, float blockX[4], float blockZ[4])
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            blockX[i] = xs[std::min(i, count - 1)];
+            blockZ[i] = zs[std::min(i, count - 1)];
+        }
+    }
+}
+
+TerrainHeightfield::TerrainHeightfield()
+    : resolution_(0),
+    tilesPerSide_(0),
+    residentTileBudget_(289),
+    residentTiles_(0),
+    pageOutCount_(0),
+    accessCounter_(0),
+    pagingAvailable_(false)
+{
+    // Each heightfield needs its own page file.
+    static int nextHeightfieldID = 0;
+    pageFilePath_ = "Build/TerrainCache/heightfield_" + std::to_string(nextHeightfieldID++) + ".tiles";
+}
+
+TerrainHeightfield::~TerrainHeightfield()
+{
+    // The page file is only valid for the lifetime of the heightfield.
+    // It may have been partly written even if paging failed.
+    pageFile_.close();
+    if (resolution_ > 0)
+    {
+        std::remove(pageFilePath_.c_str());
+    }
+}
+
+void TerrainHeightfield::setResidentTileBudget(int tiles)
+{
+    residentTileBudget_ = std::max(tiles, 1);
+    enforceResidentBudget(nullptr);
+}
+
+float TerrainHeightfield::maxResidencyRadius() const
+{
+    // updateResidency covers a square of (2r + 1) tiles per side
+    const int radiusTiles = std::max(0, (int)((sqrtf((float)residentTileBudget_) - 1.0f) * 0.5f));
+    return (float)(radiusTiles * TILE_RESOLUTION);
+}
+
+const float* TerrainHeightfield::tileHeights(int tileX, int tileZ) const
+{
+    return residentTile(tileX, tileZ).heights.data();
+}
+
+const int16_t* TerrainHeightfield::tileNormals(int tileX, int tileZ) const
+{
+    return residentTile(tileX, tileZ).normals.data();
+}
+
+const HeightfieldTile& TerrainHeightfield::residentTile(int tileX, int tileZ) const
+{
+    HeightfieldTile& t = tiles_[tileX + tileZ * tilesPerSide_];
+    t.lastUsed = ++accessCounter_;
+
+    if (t.heights.empty())
+    {
+        pageIn(t);
+        enforceResidentBudget(&t);
+    }
+
+    return t;
+}
+
+void TerrainHeightfield::build(const std::vector<float> &heights, int resolution, float gradientScaleX, float gradientScaleZ)
+{
+    assert(heights.size() == (size_t)resolution * resolution);
+
+    build(resolution, gradientScaleX, gradientScaleZ, [&](int firstRow, int rowCount, float* rows)
+    {
+        std::copy(heights.begin() + (size_t)firstRow * resolution, heights.begin() + (size_t)(firstRow + rowCount) * resolution, rows);
+    });
+}
+
+void TerrainHeightfield::build(int resolution, float gradientScaleX, float gradientScaleZ, const RowGenerator &generateRows)
+{
+    assert(resolution % TILE_RESOLUTION == 0);
+
+    resolution_ = resolution;
+    tilesPerSide_ = resolution / TILE_RESOLUTION;
+    residentTiles_ = 0;
+    pageOutCount_ = 0;
+    accessCounter_ = 0;
+    tiles_.clear();
+    tiles_.resize(tilesPerSide_ * tilesPerSide_);
+
+    // Recreate the page file from scratch.
+    // Tiles are paged out as they are built, as long as the page file is being written.
+    pageFile_.close();
+    fs::create_directories(fs::path(pageFilePath_).parent_path());
+    std::ofstream pageWriter(pageFilePath_, std::ofstream::binary | std::ofstream::trunc);
+    pagingAvailable_ = pageWriter.is_open();
+
+    // Build one row of tiles at a time.
+    // Each tile also copies the first row and column of the next tile, and the normals
+    // need the rows either side, so each band overlaps the next by a few rows.
+    std::vector<float> band;
+    for (int tileZ = 0; tileZ < tilesPerSide_; ++tileZ)
+    {
+        const int firstRow = std::max(tileZ * TILE_RESOLUTION - 1, 0);
+        const int lastRow = std::min(tileZ * TILE_RESOLUTION + TILE_STRIDE, resolution - 1);
+        band.resize((size_t)(lastRow - firstRow + 1) * resolution);
+        generateRows(firstRow, lastRow - firstRow + 1, band.data());
+
+        // Reads a height from the band, clamped to the heightfield
+        auto height = [&](int x, int z)
+        {
+            x = std::max(0, std::min(x, resolution - 1));
+            z = std::max(0, std::min(z, resolution - 1));
+            return band[x + (size_t)(z - firstRow) * resolution];
+        };
+
+        for (int tileX = 0; tileX < tilesPerSide_; ++tileX)
+        {
+            HeightfieldTile& t = tiles_[tileX + tileZ * tilesPerSide_];
+            t.x = tileX;
+            t.z = tileZ;
+            t.lastUsed = ++accessCounter_;
+            t.heights.resize(TILE_STRIDE * TILE_STRIDE);
+            t.normals.resize(2 * TILE_STRIDE * TILE_STRIDE);
+            t.minHeight = height(tileX * TILE_RESOLUTION, tileZ * TILE_RESOLUTION);
+            t.maxHeight = t.minHeight;
+
+            for (int z = 0; z < TILE_STRIDE; ++z)
+            {
+                const int sourceZ = std::min(tileZ * TILE_RESOLUTION + z, resolution - 1);
+                for (int x = 0; x < TILE_STRIDE; ++x)
+                {
+                    const int sourceX = std::min(tileX * TILE_RESOLUTION + x, resolution - 1);
+                    const float h = height(sourceX, sourceZ);
+                    t.heights[x + z * TILE_STRIDE] = h;
+                    t.minHeight = std::min(t.minHeight, h);
+                    t.maxHeight = std::max(t.maxHeight, h);
+
+                    // Precompute the normal with a central difference, clamped at the edges.
+                    const float x1 = height(sourceX - 1, sourceZ);
+                    const float x2 = height(sourceX + 1, sourceZ);
+                    const float z1 = height(sourceX, sourceZ - 1);
+                    const float z2 = height(sourceX, sourceZ + 1);
+                    const Vector3 normal = Vector3(-(x2 - x1) * gradientScaleX, 1.0f, -(z2 - z1) * gradientScaleZ).normalized();
+                    t.normals[(x + z * TILE_STRIDE) * 2 + 0] = packNormalComponent(normal.x);
+                    t.normals[(x + z * TILE_STRIDE) * 2 + 1] = packNormalComponent(normal.z);
+                }
+            }
+
+            // Store the tile in the page file at a fixed offset
+            pageWriter.write((const char*)t.heights.data(), sizeof(float) * t.heights.size());
+            pageWriter.write((const char*)t.normals.data(), sizeof(int16_t) * t.normals.size());
+            residentTiles_++;
+        }
+
+        // Once the row of tiles is safely in the page file, page out the oldest tiles beyond the budget.
+        // If writing fails, the tiles from here on stay resident.
+        pagingAvailable_ = pagingAvailable_ && pageWriter.flush().good();
+        enforceResidentBudget(nullptr);
+    }
+
+    // Tiles that were paged out are read back from the page file.
+    // After a failure, only the tiles written before it are ever paged out.
+    pageWriter.close();
+    pagingAvailable_ = pagingAvailable_ && !pageWriter.fail();
+    pageFile_.open(pageFilePath_, std::ifstream::binary);
+    pagingAvailable_ = pagingAvailable_ && pageFile_.is_open();
+
+    if (!pagingAvailable_)
+    {
+        printf("Unable to write heightfield page file %s. The remaining tiles will stay resident. \n", pageFilePath_.c_str());
+    }
+
+    enforceResidentBudget(nullptr);
+}
+
+float TerrainHeightfield::texel(int x, int z) const
+{
+    x = std::max(0, std::min(x, resolution_ - 1));
+    z = std::max(0, std::min(z, resolution_ - 1));
+
+    // The last texel in each row belongs to the final tile's shared edge.
+    const int tileX = std::min(x / TILE_RESOLUTION, tilesPerSide_ - 1);
+    const int tileZ = std::min(z / TILE_RESOLUTION, tilesPerSide_ - 1);
+    const float* heights = tileHeights(tileX, tileZ);
+    return heights[(x - tileX * TILE_RESOLUTION) + (z - tileZ * TILE_RESOLUTION) * TILE_STRIDE];
+}
+
+Vector3 TerrainHeightfield::texelNormal(int x, int z) const
+{
+    x = std::max(0, std::min(x, resolution_ - 1));
+    z = std::max(0, std::min(z, resolution_ - 1));
+
+    const int tileX = std::min(x / TILE_RESOLUTION, tilesPerSide_ - 1);
+    const int tileZ = std::min(z / TILE_RESOLUTION, tilesPerSide_ - 1);
+    const int16_t* normals = tileNormals(tileX, tileZ);
+    const int offset = (x - tileX * TILE_RESOLUTION) + (z - tileZ * TILE_RESOLUTION) * TILE_STRIDE;
+
+    // Rebuild the y component, which is always positive
+    const float normalX = unpackNormalComponent(normals[offset * 2 + 0]);
+    const float normalZ = unpackNormalComponent(normals[offset * 2 + 1]);
+    const float normalY = sqrtf(std::max(0.0f, 1.0f - normalX * normalX - normalZ * normalZ));
+    return Vector3(normalX, normalY, normalZ);
+}
+
+float TerrainHeightfield::slopeNormalY(const Vector3 &normal)
+{
+    // The gradients are -x/y and -z/y, and the tangents scale y by 1 / sqrt(1 + gradient^2) each
+    const float y2 = normal.y * normal.y;
+    const float length = sqrtf((y2 + normal.x * normal.x) * (y2 + normal.z * normal.z));
+    return (length > 0.0f) ? y2 / length : 0.0f;
+}
+
+void TerrainHeightfield::sampleHeights(const float* xs, const float* zs, float* out, int n) const
+{
+    // Points are processed in blocks of 4.
+    // The texel reads are scalar, as each point can lie in a different tile,
+    // but the addressing and filtering maths is done 4 points at a time.
+    for (int i = 0; i < n; i += 4)
+    {
+        const int count = std::min(4, n - i);
+        float blockX[4], blockZ[4];
+        fillBlock(xs + i, zs + i, count, blockX, blockZ);
+
+        int tileIndices[4], offsets[4];
+        __m128 fractionX, fractionZ;
+        bilinearFootprints(blockX, blockZ, resolution_, tilesPerSide_, tileIndices, offsets, fractionX, fractionZ);
+
+        // Gather the 4 corner heights for each point
+        float c00[4], c10[4], c01[4], c11[4];
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            const float* h = tileHeights(tileIndices[lane] % tilesPerSide_, tileIndices[lane] / tilesPerSide_) + offsets[lane];
+            c00[lane] = h[0];
+            c10[lane] = h[1];
+            c01[lane] = h[TILE_STRIDE];
+            c11[lane] = h[TILE_STRIDE + 1];
+        }
+
+        float result[4];
+        _mm_storeu_ps(result, bilinear(_mm_loadu_ps(c00), _mm_loadu_ps(c10), _mm_loadu_ps(c01), _mm_loadu_ps(c11), fractionX, fractionZ));
+        std::copy(result, result + count, out + i);
+    }
+}
+
+void TerrainHeightfield::sampleNormals(const float* xs, const float* zs, Vector3* out, int n) const
+{
+    const __m128 unpackScale = _mm_set1_ps(1.0f / 32767.0f);
+
+    for (int i = 0; i < n; i += 4)
+    {
+        const int count = std::min(4, n - i);
+        float blockX[4], blockZ[4];
+        fillBlock(xs + i, zs + i, count, blockX, blockZ);
+
+        int tileIndices[4], offsets[4];
+        __m128 fractionX, fractionZ;
+        bilinearFootprints(blockX, blockZ, resolution_, tilesPerSide_, tileIndices, offsets, fractionX, fractionZ);
+
+        // Gather the x and z normal components at the 4 corners of each point
+        float x00[4], x10[4], x01[4], x11[4];
+        float z00[4], z10[4], z01[4], z11[4];
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            const int16_t* normals = tileNormals(tileIndices[lane] % tilesPerSide_, tileIndices[lane] / tilesPerSide_) + offsets[lane] * 2;
+            x00[lane] = normals[0];
+            z00[lane] = normals[1];
+            x10[lane] = normals[2];
+            z10[lane] = normals[3];
+            x01[lane] = normals[TILE_STRIDE * 2];
+            z01[lane] = normals[TILE_STRIDE * 2 + 1];
+            x11[lane] = normals[TILE_STRIDE * 2 + 2];
+            z11[lane] = normals[TILE_STRIDE * 2 + 3];
+        }
+
+        // Filter the x and z components, then rebuild y and renormalize
+        const __m128 normalX = _mm_mul_ps(bilinear(_mm_loadu_ps(x00), _mm_loadu_ps(x10), _mm_loadu_ps(x01), _mm_loadu_ps(x11), fractionX, fractionZ), unpackScale);
+        const __m128 normalZ = _mm_mul_ps(bilinear(_mm_loadu_ps(z00), _mm_loadu_ps(z10), _mm_loadu_ps(z01), _mm_loadu_ps(z11), fractionX, fractionZ), unpackScale);
+        const __m128 horizontal = _mm_add_ps(_mm_mul_ps(normalX, normalX), _mm_mul_ps(normalZ, normalZ));
+        const __m128 normalY = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), horizontal), _mm_setzero_ps()));
+        const __m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_add_ps(horizontal, _mm_mul_ps(normalY, normalY))));
+
+        float resultX[4], resultY[4], resultZ[4];
+        _mm_storeu_ps(resultX, _mm_mul_ps(normalX, inverseLength));
+        _mm_storeu_ps(resultY, _mm_mul_ps(normalY, inverseLength));
+        _mm_storeu_ps(resultZ, _mm_mul_ps(normalZ, inverseLength));
+        for (int lane = 0; lane < count; ++lane)
+        {
+            out[i + lane] = Vector3(resultX[lane], resultY[lane], resultZ[lane]);
+        }
+    }
+}
+
+void TerrainHeightfield::updateResidency(float centreX, float centreZ, float radius)
+{
+    // Find the range of tiles that overlap the circle.
+    // The range is measured from the centre tile, so it never covers
+    // more than (2r + 1) tiles per side and always fits in the budget.
+    const int radiusTiles = (int)ceilf(std::min(radius, maxResidencyRadius()) / TILE_RESOLUTION);
+    const int centreTileX = (int)floorf(centreX / TILE_RESOLUTION);
+    const int centreTileZ = (int)floorf(centreZ / TILE_RESOLUTION);
+    const int minTileX = std::max(0, centreTileX - radiusTiles);
+    const int maxTileX = std::min(tilesPerSide_ - 1, centreTileX + radiusTiles);
+    const int minTileZ = std::max(0, centreTileZ - radiusTiles);
+    const int maxTileZ = std::min(tilesPerSide_ - 1, centreTileZ + radiusTiles);
+
+    // Touch each tile to page it in and mark it as recently used.
+    // Distant tiles then become the first candidates for paging out.
+    for (int tileZ = minTileZ; tileZ <= maxTileZ; ++tileZ)
+    {
+        for (int tileX = minTileX; tileX <= maxTileX; ++tileX)
+        {
+            tileHeights(tileX, tileZ);
+        }
+    }
+}
+
+void TerrainHeightfield::pageIn(HeightfieldTile &tile) const
+{
+    assert(pageFile_.is_open());
+
+    // Tiles are stored in the page file in index order.
+    // Each tile stores its heights followed by its normals.
+    const std::streamoff heightBytes = sizeof(float) * TILE_STRIDE * TILE_STRIDE;
+    const std::streamoff normalBytes = sizeof(int16_t) * 2 * TILE_STRIDE * TILE_STRIDE;
+    const std::streamoff offset = (heightBytes + normalBytes) * (tile.x + tile.z * tilesPerSide_);
+
+    tile.heights.resize(TILE_STRIDE * TILE_STRIDE);
+    tile.normals.resize(2 * TILE_STRIDE * TILE_STRIDE);
+    pageFile_.clear();
+    pageFile_.seekg(offset);
+    pageFile_.read((char*)tile.heights.data(), heightBytes);
+    pageFile_.read((char*)tile.normals.data(), normalBytes);
+    assert(pageFile_.good());
+
+    residentTiles_++;
+}
+
+void TerrainHeightfield::pageOut(HeightfieldTile &tile) const
+{
+    // The page file already contains the tile data, so just free the memory
+    std::vector<float>().swap(tile.heights);
+    std::vector<int16_t>().swap(tile.normals);
+    residentTiles_--;
+    pageOutCount_++;
+}
+
+void TerrainHeightfield::enforceResidentBudget(const HeightfieldTile* keep) const
+{
+    if (!pagingAvailable_)
+    {
+        return;
+    }
+
+    while (residentTiles_ > residentTileBudget_)
+    {
+        // Find the least recently used resident tile
+        HeightfieldTile* oldest = nullptr;
+        for (HeightfieldTile& t : tiles_)
+        {
+            if (!t.heights.empty() && &t != keep && (oldest == nullptr || t.lastUsed < oldest->lastUsed))
+            {
+                oldest = &t;
+            }
+        }
+
+        if (oldest == nullptr)
+        {
+            return;
+        }
+
+        pageOut(*oldest);
+    }
+}
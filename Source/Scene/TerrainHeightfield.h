@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Math/Vector3.h"
+
+// A single square section of a tiled heightfield.
+struct HeightfieldTile
+{
+    // The tile coordinates, measured in tiles.
+    int x;
+    int z;
+
+    // The range of heights inside the tile.
+    // These are always valid, even when the tile is paged out.
+    float minHeight;
+    float maxHeight;
+
+    // The height values in the tile, including the edge shared with the next tile.
+    // This is empty when the tile is not resident in memory.
+    std::vector<float> heights;
+
+    // The x and z components of the surface normal at each height value,
+    // stored as snorm16. The y component is always positive and is rebuilt
+    // from the other two. This is empty when the tile is not resident.
+    std::vector<int16_t> normals;
+
+    // The access counter value when the tile was last used.
+    // Used for choosing which tiles to page out.
+    mutable uint64_t lastUsed;
+};
+
+// Stores a large square heightfield as a grid of fixed size tiles.
+// Tiles that have not been used recently are paged out to a file on
+// disk and are paged back in automatically when they are next accessed.
+class TerrainHeightfield
+{
+public:
+    // The number of texels covered by each tile, along each axis.
+    const static int TILE_RESOLUTION = 256;
+
+    // The number of values stored per tile along each axis.
+    // Tiles store an extra row and column shared with the next tile, so
+    // that filtering never needs to read from two tiles.
+    const static int TILE_STRIDE = TILE_RESOLUTION + 1;
+
+public:
+    TerrainHeightfield();
+    ~TerrainHeightfield();
+
+    // Prevent the heightfield from being copied
+    TerrainHeightfield(const TerrainHeightfield&) = delete;
+    TerrainHeightfield& operator=(const TerrainHeightfield&) = delete;
+
+    // The number of texels along each side of the heightfield.
+    int resolution() const { return resolution_; }
+
+    // The number of tiles along each side of the heightfield.
+    int tilesPerSide() const { return tilesPerSide_; }
+    int tileCount() const { return tilesPerSide_ * tilesPerSide_; }
+
+    // The number of tiles that are currently held in memory.
+    int residentTileCount() const { return residentTiles_; }
+
+    // The maximum number of tiles that are kept in memory at once.
+    int residentTileBudget() const { return residentTileBudget_; }
+    void setResidentTileBudget(int tiles);
+
+    // The largest radius, in texels, that updateResidency can keep resident
+    // without exceeding the budget. Larger radii are clamped to this.
+    float maxResidencyRadius() const;
+
+    // The number of times a tile has been paged out since the heightfield was built.
+    int pageOutCount() const { return pageOutCount_; }
+
+    // Gets a tile. The height values may not be resident.
+    const HeightfieldTile& tile(int tileX, int tileZ) const { return tiles_[tileX + tileZ * tilesPerSide_]; }
+
+    // Gets the height values for a tile, paging them in if needed.
+    // There are TILE_STRIDE * TILE_STRIDE values, stored in rows along x.
+    const float* tileHeights(int tileX, int tileZ) const;
+
+    // Gets the normals for a tile, paging them in if needed.
+    // There are 2 * TILE_STRIDE * TILE_STRIDE values, stored as x,z pairs.
+    const int16_t* tileNormals(int tileX, int tileZ) const;
+
+    // Fills rowCount rows of heights, starting at firstRow. Each row holds resolution values along x.
+    typedef std::function<void(int firstRow, int rowCount, float* heights)> RowGenerator;
+
+    // Replaces the heightfield with a square heightmap of the given resolution.
+    // The resolution must be a multiple of TILE_RESOLUTION.
+    // The gradient scale converts a central height difference into a slope, per axis.
+    void build(const std::vector<float> &heights, int resolution, float gradientScaleX, float gradientScaleZ);
+
+    // Replaces the heightfield with rows of heights that are generated one row of tiles at a time.
+    // Only the rows around one row of tiles and the resident tiles are held in memory at once,
+    // as tiles beyond the budget are paged out once they have been written to the page file.
+    // Rows on the edges of each band are requested again by the next band.
+    void build(int resolution, float gradientScaleX, float gradientScaleZ, const RowGenerator &generateRows);
+
+    // Gets the height of a single texel.
+    // The coordinates are clamped to the heightfield.
+    float texel(int x, int z) const;
+
+    // Gets the precomputed surface normal at a single texel.
+    // The coordinates are clamped to the heightfield.
+    Vector3 texelNormal(int x, int z) const;
+
+    // Bilinearly samples the heights at n points.
+    // The coordinates are in texels, and are clamped to the heightfield.
+    void sampleHeights(const float* xs, const float* zs, float* out, int n) const;
+
+    // Bilinearly samples the precomputed normals at n points.
+    // The coordinates are in texels, and are clamped to the heightfield.
+    void sampleNormals(const float* xs, const float* zs, Vector3* out, int n) const;
+
+    // Gets the value that terrain slope limits are compared against for a unit normal.
+    // The limits were tuned against the y component of the cross product of the unit tangent and
+    // unit bitangent, which is shorter than the unit normal on slopes that are steep in both x and z.
+    static float slopeNormalY(const Vector3 &normal);
+
+    // Pages in the tiles within radius texels of the specified texel,
+    // and pages out distant tiles if the resident budget is exceeded.
+    // The radius is clamped so that the tiles it covers fit in the budget,
+    // otherwise tiles near the centre would be evicted on every update.
+    void updateResidency(float centreX, float centreZ, float radius);
+
+private:
+    int resolution_;
+    int tilesPerSide_;
+    int residentTileBudget_;
+    mutable int residentTiles_;
+    mutable int pageOutCount_;
+    mutable uint64_t accessCounter_;
+    mutable std::vector<HeightfieldTile> tiles_;
+
+    // The file used to hold tiles that are paged out.
+    // When the file could not be written, all tiles stay resident.
+    std::string pageFilePath_;
+    mutable std::ifstream pageFile_;
+    bool pagingAvailable_;
+
+    // Gets a tile, paging it in if needed.
+    const HeightfieldTile& residentTile(int tileX, int tileZ) const;
+
+    // Moves a tile in and out of memory
+    void pageIn(HeightfieldTile &tile) const;
+    void pageOut(HeightfieldTile &tile) const;
+
+    // Pages out the least recently used tiles until the budget is met.
+    void enforceResidentBudget(const HeightfieldTile* keep) const;
+};
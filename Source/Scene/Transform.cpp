@@ -9,7 +9,8 @@ Transform::Transform(GameObject* gameObject)
     scale_(Vector3::one()),
     localToWorld_(Matrix4x4::identity()),
     worldToLocal_(Matrix4x4::identity()),
-    parent_(nullptr)
+    parent_(nullptr),
+    changeCount_(0)
 {
 
 }
@@ -213,6 +214,8 @@ void Transform::recomputeMatrices()
         worldToLocal_ = worldToLocal() * parent_->worldToLocal();
     }
 
+    changeCount_++;
+
     // Recompute matrices for all children
     for (Transform* child : children_)
     {
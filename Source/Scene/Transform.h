@@ -42,6 +42,10 @@ public:
     Matrix4x4 worldToLocal() const { return worldToLocal_; }
     Matrix4x4 localToWorld() const { return localToWorld_; }
 
+    // Incremented whenever the transformation matrices change.
+    // Used to keep data cached in world space up to date.
+    uint32_t changeCount() const { return changeCount_; }
+
     // Object axis in world space
     Vector3 left() const;
     Vector3 right() const;
@@ -84,6 +88,7 @@ private:
     // Cached transformation matrices
     Matrix4x4 worldToLocal_;
     Matrix4x4 localToWorld_;
+    uint32_t changeCount_;
     void recomputeMatrices();
 
     // For adding and removal of child transforms
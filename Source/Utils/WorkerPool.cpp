@@ -0,0 +1,108 @@
+#include "WorkerPool.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(int workerCount)
+    : task_(nullptr),
+    taskCount_(0),
+    nextTask_(0),
+    busyWorkers_(0),
+    generation_(0),
+    stopping_(false)
+{
+    if (workerCount < 0)
+    {
+        workerCount = std::max(1, (int)std::thread::hardware_concurrency()) - 1;
+    }
+
+    for (int i = 0; i < workerCount; ++i)
+    {
+        workers_.push_back(std::thread(&WorkerPool::workerLoop, this));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    wakeWorkers_.notify_all();
+    for (std::thread& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(int count, const std::function<void(int)> &task)
+{
+    // Small runs are not worth waking the workers for
+    if (count <= 1 || workers_.empty())
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            task(i);
+        }
+
+        return;
+    }
+
+    // Start a new run, and wake the workers
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(task_ == nullptr && "WorkerPool::run cannot be called from inside a task");
+        task_ = &task;
+        taskCount_ = count;
+        nextTask_ = 0;
+        busyWorkers_ = (int)workers_.size();
+        generation_++;
+    }
+    wakeWorkers_.notify_all();
+
+    // Help with the tasks, then wait for the workers to finish theirs
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    workersFinished_.wait(lock, [this]() { return busyWorkers_ == 0; });
+    task_ = nullptr;
+}
+
+void WorkerPool::workerLoop()
+{
+    uint64_t lastGeneration = 0;
+    while (true)
+    {
+        // Sleep until a new run starts
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeWorkers_.wait(lock, [&]() { return stopping_ || generation_ != lastGeneration; });
+            if (stopping_)
+            {
+                return;
+            }
+
+            lastGeneration = generation_;
+        }
+
+        runTasks();
+
+        // The last worker to finish wakes the caller
+        std::lock_guard<std::mutex> lock(mutex_);
+        busyWorkers_--;
+        if (busyWorkers_ == 0)
+        {
+            workersFinished_.notify_one();
+        }
+    }
+}
+
+void WorkerPool::runTasks()
+{
+    for (int i = nextTask_++; i < taskCount_; i = nextTask_++)
+    {
+        (*task_)(i);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A set of persistent worker threads for splitting per-frame work into tasks.
+// The threads sleep between runs, so the pool is cheap to use every frame.
+class WorkerPool
+{
+public:
+    // Creates a pool with the given number of workers.
+    // A negative count uses one worker per hardware thread, minus the calling thread.
+    explicit WorkerPool(int workerCount = -1);
+    ~WorkerPool();
+
+    // Prevent the pool from being copied
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // The number of worker threads, not including the calling thread
+    int workerCount() const { return (int)workers_.size(); }
+
+    // Runs task(i) for each i from 0 to count - 1, on the workers and the calling thread.
+    // Returns once every task has finished. Tasks may run in any order.
+    void run(int count, const std::function<void(int)> &task);
+
+private:
+    std::vector<std::thread> workers_;
+
+    // Guards the run state, and wakes the workers and the caller
+    std::mutex mutex_;
+    std::condition_variable wakeWorkers_;
+    std::condition_variable workersFinished_;
+
+    // The current run. The generation changes each time a run starts.
+    const std::function<void(int)>* task_;
+    int taskCount_;
+    std::atomic<int> nextTask_;
+    int busyWorkers_;
+    uint64_t generation_;
+    bool stopping_;
+
+    // The main loop of each worker thread
+    void workerLoop();
+
+    // Takes tasks from the current run until there are none left
+    void runTasks();
+};
\ No newline at end of file
@@ -107,6 +107,8 @@ void VRManager::frameStart()
         return;
     }
 
+    // The headset needs a new frame every refresh, so variants that are not ready yet are finished while drawing
+    renderer_->warmUpShaders();
     renderer_->renderFrame(cam);
     renderToHmd(colorBuffers_[0]->glid(), colorBuffers_[1]->glid());
 }
@@ -0,0 +1,114 @@
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "Importers/MeshIndexOptimizer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(MeshIndexOptimizerTests)
+    {
+        // Creates a bumpy square grid of quads, with its triangles in a random order
+        static void createShuffledGrid(int size, std::vector<Point3> &positions, std::vector<uint32_t> &indices)
+        {
+            for (int z = 0; z <= size; ++z)
+            {
+                for (int x = 0; x <= size; ++x)
+                {
+                    positions.push_back(Point3((float)x, sinf(x * 0.3f) * cosf(z * 0.2f) * 4.0f, (float)z));
+                }
+            }
+
+            std::vector<std::vector<uint32_t>> triangles;
+            for (int z = 0; z < size; ++z)
+            {
+                for (int x = 0; x < size; ++x)
+                {
+                    const uint32_t a = x + z * (size + 1);
+                    const uint32_t b = a + 1;
+                    const uint32_t c = a + size + 1;
+                    const uint32_t d = c + 1;
+                    triangles.push_back({ a, c, b });
+                    triangles.push_back({ b, c, d });
+                }
+            }
+
+            std::mt19937 generator(1234);
+            std::shuffle(triangles.begin(), triangles.end(), generator);
+            for (const std::vector<uint32_t>& triangle : triangles)
+            {
+                indices.insert(indices.end(), triangle.begin(), triangle.end());
+            }
+        }
+
+        // The triangles of a triangle list in a fixed order, ignoring the order they are drawn in
+        static std::vector<std::vector<uint32_t>> sortedTriangles(const std::vector<uint32_t> &indices)
+        {
+            std::vector<std::vector<uint32_t>> triangles;
+            for (size_t first = 0; first < indices.size(); first += 3)
+            {
+                triangles.push_back({ indices[first], indices[first + 1], indices[first + 2] });
+            }
+
+            std::sort(triangles.begin(), triangles.end());
+            return triangles;
+        }
+
+    public:
+
+        TEST_METHOD(CacheMissRatioOfSimpleLists)
+        {
+            // A lone triangle transforms all three vertices, and a repeated one reuses them
+            Assert::AreEqual(3.0f, MeshIndexOptimizer::averageCacheMissRatio({ 0, 1, 2 }, 3));
+            Assert::AreEqual(1.5f, MeshIndexOptimizer::averageCacheMissRatio({ 0, 1, 2, 2, 1, 0 }, 3));
+            Assert::AreEqual(0.0f, MeshIndexOptimizer::averageCacheMissRatio({}, 0));
+        }
+
+        TEST_METHOD(VertexCacheOrderKeepsTriangles)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            createShuffledGrid(32, positions, indices);
+
+            std::vector<uint32_t> optimized = indices;
+            MeshIndexOptimizer::optimizeVertexCache(optimized, (int)positions.size());
+            Assert::IsTrue(sortedTriangles(optimized) == sortedTriangles(indices));
+        }
+
+        TEST_METHOD(VertexCacheOrderReducesMisses)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            createShuffledGrid(64, positions, indices);
+
+            const float before = MeshIndexOptimizer::averageCacheMissRatio(indices, (int)positions.size());
+            MeshIndexOptimizer::optimizeVertexCache(indices, (int)positions.size());
+            const float after = MeshIndexOptimizer::averageCacheMissRatio(indices, (int)positions.size());
+
+            // Each vertex is shared by about six triangles, so the best order transforms about half a vertex per triangle
+            Assert::IsTrue(before > 2.0f);
+            Assert::IsTrue(after < 0.8f);
+        }
+
+        TEST_METHOD(OverdrawOrderKeepsTrianglesAndCacheOrder)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            createShuffledGrid(64, positions, indices);
+            MeshIndexOptimizer::optimizeVertexCache(indices, (int)positions.size());
+            const float cacheOrderRatio = MeshIndexOptimizer::averageCacheMissRatio(indices, (int)positions.size());
+
+            std::vector<uint32_t> optimized = indices;
+            MeshIndexOptimizer::optimizeOverdraw(optimized, positions.data(), (int)positions.size());
+
+            // Clusters are only moved as a whole, so the vertex cache order is mostly kept
+            Assert::IsTrue(sortedTriangles(optimized) == sortedTriangles(indices));
+            Assert::IsTrue(MeshIndexOptimizer::averageCacheMissRatio(optimized, (int)positions.size()) < cacheOrderRatio * 1.1f);
+        }
+    };
+}
\ No newline at end of file
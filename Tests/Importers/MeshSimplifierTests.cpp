@@ -0,0 +1,227 @@
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <math.h>
+#include <vector>
+
+#include "Importers/MeshSimplifier.h"
+#include "Math/Bounds.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(MeshSimplifierTests)
+    {
+        // Creates a flat square grid of quads on the xz plane, one unit per quad.
+        // When seamColumn is not -1, the vertices in that column are duplicated, as if the
+        // texture coordinates were split there. Vertices left of the seam come first.
+        static void createGrid(int size, int seamColumn, std::vector<Point3> &positions, std::vector<uint32_t> &indices, int &firstRightVertex)
+        {
+            const int leftColumns = (seamColumn < 0) ? size + 1 : seamColumn + 1;
+            const int rightColumns = (seamColumn < 0) ? 0 : size + 1 - seamColumn;
+            for (int z = 0; z <= size; ++z)
+            {
+                for (int x = 0; x < leftColumns; ++x)
+                {
+                    positions.push_back(Point3((float)x, 0.0f, (float)z));
+                }
+            }
+
+            firstRightVertex = (int)positions.size();
+            for (int z = 0; z <= size; ++z)
+            {
+                for (int x = 0; x < rightColumns; ++x)
+                {
+                    positions.push_back(Point3((float)(seamColumn + x), 0.0f, (float)z));
+                }
+            }
+
+            // Quads left of the seam use the left copies of the seam vertices
+            for (int z = 0; z < size; ++z)
+            {
+                for (int x = 0; x < size; ++x)
+                {
+                    const bool left = (seamColumn < 0) || (x < seamColumn);
+                    const int columns = left ? leftColumns : rightColumns;
+                    const int first = left ? 0 : firstRightVertex;
+                    const int column = left ? x : x - seamColumn;
+                    const uint32_t a = first + column + z * columns;
+                    const uint32_t b = a + 1;
+                    const uint32_t c = a + columns;
+                    const uint32_t d = c + 1;
+                    indices.insert(indices.end(), { a, c, b, b, c, d });
+                }
+            }
+        }
+
+        // Creates a closed sphere by subdividing an octahedron and pushing the vertices out to the radius
+        static void createSphere(int subdivisions, float radius, std::vector<Point3> &positions, std::vector<uint32_t> &indices)
+        {
+            const int size = 1 << subdivisions;
+            const Vector3 axes[6] = { Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1), Vector3(-1, 0, 0), Vector3(0, -1, 0), Vector3(0, 0, -1) };
+            const int faces[8][3] = { { 0, 1, 2 }, { 2, 1, 3 }, { 3, 1, 5 }, { 5, 1, 0 }, { 2, 4, 0 }, { 3, 4, 2 }, { 5, 4, 3 }, { 0, 4, 5 } };
+
+            // Vertices on the shared edges are duplicated, and then welded by position
+            for (const int* face : faces)
+            {
+                const uint32_t first = (uint32_t)positions.size();
+                for (int j = 0; j <= size; ++j)
+                {
+                    for (int i = 0; i <= size - j; ++i)
+                    {
+                        const Vector3 direction = (axes[face[0]] * (float)(size - i - j) + axes[face[1]] * (float)i + axes[face[2]] * (float)j).normalized();
+                        Point3 position = Point3::origin() + direction * radius;
+                        for (const Point3& existing : positions)
+                        {
+                            if (Point3::sqrDistance(existing, position) < 1e-10f)
+                            {
+                                position = existing;
+                            }
+                        }
+                        positions.push_back(position);
+                    }
+                }
+
+                // The index of the vertex in row j, column i of this face
+                auto vertex = [&](int i, int j) { return first + (uint32_t)(j * (size + 1) - (j * (j - 1)) / 2 + i); };
+                for (int j = 0; j < size; ++j)
+                {
+                    for (int i = 0; i < size - j; ++i)
+                    {
+                        indices.insert(indices.end(), { vertex(i, j), vertex(i + 1, j), vertex(i, j + 1) });
+                        if (i + j + 1 < size)
+                        {
+                            indices.insert(indices.end(), { vertex(i + 1, j), vertex(i + 1, j + 1), vertex(i, j + 1) });
+                        }
+                    }
+                }
+            }
+        }
+
+        // The bounding box of the vertices used by a triangle list
+        static Bounds usedBounds(const std::vector<Point3> &positions, const std::vector<uint32_t> &indices)
+        {
+            std::vector<Point3> used;
+            for (uint32_t index : indices)
+            {
+                used.push_back(positions[index]);
+            }
+
+            return Bounds::covering(used.data(), (int)used.size());
+        }
+
+    public:
+
+        TEST_METHOD(FlatGridSimplifiesWithoutError)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            int firstRightVertex;
+            createGrid(16, -1, positions, indices, firstRightVertex);
+
+            MeshSimplifier simplifier(positions.data(), (int)positions.size());
+            float error;
+            const std::vector<uint32_t> simplified = simplifier.simplify(indices, 24, 1.0f, error);
+
+            // A flat square only needs two triangles, and its corners and borders are kept
+            Assert::IsTrue(simplified.size() <= 24);
+            Assert::IsTrue(simplified.size() >= 6);
+            Assert::IsTrue(simplified.size() % 3 == 0);
+            Assert::AreEqual(0.0f, error, 1e-4f);
+
+            const Bounds bounds = usedBounds(positions, simplified);
+            Assert::AreEqual(0.0f, bounds.min().x, 1e-6f);
+            Assert::AreEqual(0.0f, bounds.min().z, 1e-6f);
+            Assert::AreEqual(16.0f, bounds.max().x, 1e-6f);
+            Assert::AreEqual(16.0f, bounds.max().z, 1e-6f);
+        }
+
+        TEST_METHOD(TargetIsNotExceededWhenAlreadyMet)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            int firstRightVertex;
+            createGrid(4, -1, positions, indices, firstRightVertex);
+
+            MeshSimplifier simplifier(positions.data(), (int)positions.size());
+            float error;
+            const std::vector<uint32_t> simplified = simplifier.simplify(indices, (int)indices.size(), 1.0f, error);
+            Assert::IsTrue(simplified == indices);
+            Assert::AreEqual(0.0f, error);
+        }
+
+        TEST_METHOD(SeamsAreKept)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            int firstRightVertex;
+            createGrid(16, 8, positions, indices, firstRightVertex);
+
+            MeshSimplifier simplifier(positions.data(), (int)positions.size());
+            float error;
+            const std::vector<uint32_t> simplified = simplifier.simplify(indices, 48, 1.0f, error);
+            Assert::IsTrue(simplified.size() < indices.size() / 4);
+
+            // Every triangle must still use vertices from only one side of the seam,
+            // and the seam must still run the full length of the grid
+            float seamMinZ = FLT_MAX;
+            float seamMaxZ = -FLT_MAX;
+            for (size_t first = 0; first < simplified.size(); first += 3)
+            {
+                const bool left = (int)simplified[first] < firstRightVertex;
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    const uint32_t index = simplified[first + corner];
+                    Assert::AreEqual(left, (int)index < firstRightVertex);
+                    Assert::IsTrue(left ? positions[index].x <= 8.0f : positions[index].x >= 8.0f);
+                    if (positions[index].x == 8.0f)
+                    {
+                        seamMinZ = std::min(seamMinZ, positions[index].z);
+                        seamMaxZ = std::max(seamMaxZ, positions[index].z);
+                    }
+                }
+            }
+
+            Assert::AreEqual(0.0f, seamMinZ);
+            Assert::AreEqual(16.0f, seamMaxZ);
+        }
+
+        TEST_METHOD(CurvedSurfaceErrorIsMeasured)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            createSphere(4, 2.0f, positions, indices);
+
+            MeshSimplifier simplifier(positions.data(), (int)positions.size());
+            float error;
+            const int target = (int)indices.size() / 4 / 3 * 3;
+            const std::vector<uint32_t> simplified = simplifier.simplify(indices, target, 1.0f, error);
+
+            // The sphere loses detail, but stays close to its original surface
+            Assert::IsTrue((int)simplified.size() <= target);
+            Assert::IsTrue(simplified.size() > 0);
+            Assert::IsTrue(error > 0.0f);
+            Assert::IsTrue(error < 0.2f);
+        }
+
+        TEST_METHOD(MaxErrorLimitsSimplification)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            createSphere(4, 2.0f, positions, indices);
+
+            MeshSimplifier simplifier(positions.data(), (int)positions.size());
+            float looseError;
+            float tightError;
+            const std::vector<uint32_t> loose = simplifier.simplify(indices, 24, 1.0f, looseError);
+            const std::vector<uint32_t> tight = simplifier.simplify(indices, 24, 0.01f, tightError);
+
+            // A tight error limit stops before the target, with no collapse over the limit
+            Assert::IsTrue(tight.size() > loose.size());
+            Assert::IsTrue(tightError <= 0.01f);
+            Assert::IsTrue(looseError > tightError);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "CppUnitTest.h"
+
+#include "Math/Bounds.h"
+#include "Math/Matrix4x4.h"
+#include "Math/Quaternion.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(BoundsTests)
+    {
+        static bool approximately(const Point3 &a, const Point3 &b)
+        {
+            return Point3::distance(a, b) < 0.0001f;
+        }
+
+    public:
+
+        TEST_METHOD(Covering)
+        {
+            const Point3 points[] = { Point3(1.0f, 2.0f, 3.0f), Point3(-1.0f, 5.0f, 0.0f), Point3(0.0f, -2.0f, 4.0f) };
+            const Bounds b = Bounds::covering(points, 3);
+            Assert::IsTrue(b.min() == Point3(-1.0f, -2.0f, 0.0f));
+            Assert::IsTrue(b.max() == Point3(1.0f, 5.0f, 4.0f));
+        }
+
+        TEST_METHOD(TransformedByTranslationAndScale)
+        {
+            const Bounds b(Point3(-1.0f, -1.0f, -1.0f), Point3(1.0f, 2.0f, 3.0f));
+            const Bounds t = b.transformed(Matrix4x4::trs(Vector3(10.0f, 0.0f, -5.0f), Quaternion::identity(), Vector3(2.0f, -1.0f, 1.0f)));
+            Assert::IsTrue(approximately(t.min(), Point3(8.0f, -2.0f, -6.0f)));
+            Assert::IsTrue(approximately(t.max(), Point3(12.0f, 1.0f, -2.0f)));
+        }
+
+        TEST_METHOD(TransformedCoversCorners)
+        {
+            // The transformed bounds must cover every transformed corner, and touch the extreme ones.
+            const Bounds b(Point3(-1.0f, 0.0f, -2.0f), Point3(3.0f, 1.0f, 2.0f));
+            const Matrix4x4 m = Matrix4x4::trs(Vector3(4.0f, 5.0f, 6.0f), Quaternion::euler(30.0f, 45.0f, 10.0f), Vector3(1.0f, 2.0f, 0.5f));
+            const Bounds t = b.transformed(m);
+
+            Point3 corners[8];
+            for (int i = 0; i < 8; ++i)
+            {
+                corners[i] = m * Point3((i & 1) ? 3.0f : -1.0f, (i & 2) ? 1.0f : 0.0f, (i & 4) ? 2.0f : -2.0f);
+            }
+
+            const Bounds expected = Bounds::covering(corners, 8);
+            Assert::IsTrue(approximately(t.min(), expected.min()));
+            Assert::IsTrue(approximately(t.max(), expected.max()));
+        }
+    };
+}
@@ -0,0 +1,71 @@
+#include "CppUnitTest.h"
+
+#include "Math/Bounds.h"
+#include "Math/Frustum.h"
+#include "Math/Matrix4x4.h"
+#include "Math/Point3.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(FrustumTests)
+    {
+    public:
+
+        TEST_METHOD(DefaultContainsEverything)
+        {
+            Frustum f;
+            Assert::IsTrue(f.contains(Point3(1000.0f, -1000.0f, 5.0f)));
+            Assert::IsTrue(f.classify(Bounds(Point3(-1.0f, -1.0f, -1.0f), Point3(1.0f, 1.0f, 1.0f))) == FrustumIntersection::Inside);
+        }
+
+        TEST_METHOD(PerspectiveContains)
+        {
+            // A 90 degree frustum looking along +z, from z = 1 to z = 100
+            Frustum f = Frustum::fromMatrix(Matrix4x4::perspective(90.0f, 1.0f, 1.0f, 100.0f));
+
+            // Check points inside
+            Assert::IsTrue(f.contains(Point3(0.0f, 0.0f, 50.0f)));
+            Assert::IsTrue(f.contains(Point3(9.0f, -9.0f, 10.0f)));
+
+            // Check points outside each plane
+            Assert::IsFalse(f.contains(Point3(0.0f, 0.0f, 0.5f)));
+            Assert::IsFalse(f.contains(Point3(0.0f, 0.0f, 101.0f)));
+            Assert::IsFalse(f.contains(Point3(11.0f, 0.0f, 10.0f)));
+            Assert::IsFalse(f.contains(Point3(-11.0f, 0.0f, 10.0f)));
+            Assert::IsFalse(f.contains(Point3(0.0f, 11.0f, 10.0f)));
+            Assert::IsFalse(f.contains(Point3(0.0f, -11.0f, 10.0f)));
+        }
+
+        TEST_METHOD(OrthographicContains)
+        {
+            // A 20x20 box from z = 0 to z = 50
+            Frustum f = Frustum::fromMatrix(Matrix4x4::orthographic(-10.0f, 10.0f, -10.0f, 10.0f, 0.0f, 50.0f));
+
+            Assert::IsTrue(f.contains(Point3(9.0f, 9.0f, 49.0f)));
+            Assert::IsFalse(f.contains(Point3(11.0f, 0.0f, 10.0f)));
+            Assert::IsFalse(f.contains(Point3(0.0f, 0.0f, 51.0f)));
+        }
+
+        TEST_METHOD(ClassifyBounds)
+        {
+            Frustum f = Frustum::fromMatrix(Matrix4x4::orthographic(-10.0f, 10.0f, -10.0f, 10.0f, 0.0f, 50.0f));
+
+            // Fully inside
+            Bounds inside(Point3(-1.0f, -1.0f, 10.0f), Point3(1.0f, 1.0f, 12.0f));
+            Assert::IsTrue(f.classify(inside) == FrustumIntersection::Inside);
+            Assert::IsTrue(f.intersects(inside));
+
+            // Crossing the right plane
+            Bounds crossing(Point3(9.0f, -1.0f, 10.0f), Point3(11.0f, 1.0f, 12.0f));
+            Assert::IsTrue(f.classify(crossing) == FrustumIntersection::Intersecting);
+            Assert::IsTrue(f.intersects(crossing));
+
+            // Fully outside
+            Bounds outside(Point3(12.0f, -1.0f, 10.0f), Point3(14.0f, 1.0f, 12.0f));
+            Assert::IsTrue(f.classify(outside) == FrustumIntersection::Outside);
+            Assert::IsFalse(f.intersects(outside));
+        }
+    };
+}
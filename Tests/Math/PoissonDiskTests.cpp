@@ -0,0 +1,87 @@
+#include "CppUnitTest.h"
+
+#include "Math/PoissonDisk.h"
+#include "Math/Rect.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(PoissonDiskTests)
+    {
+    public:
+
+        TEST_METHOD(PointsAreInsideArea)
+        {
+            // Generate a set of points
+            Rect area(10.0f, -5.0f, 20.0f, 30.0f);
+            std::vector<Point2> points = poisson_disk_points(area, 1.0f, 1, 100000);
+
+            // Check every point is inside the rect
+            Assert::IsTrue(points.size() > 0);
+            for (const Point2& p : points)
+            {
+                Assert::IsTrue(p.x >= area.minx && p.x < area.minx + area.width);
+                Assert::IsTrue(p.y >= area.miny && p.y < area.miny + area.height);
+            }
+        }
+
+        TEST_METHOD(MinimumDistance)
+        {
+            // Generate a set of points
+            const float minDistance = 2.0f;
+            std::vector<Point2> points = poisson_disk_points(Rect(0.0f, 0.0f, 40.0f, 40.0f), minDistance, 2, 100000);
+
+            // Check no two points are closer than the minimum distance
+            for (unsigned int i = 0; i < points.size(); ++i)
+            {
+                for (unsigned int j = i + 1; j < points.size(); ++j)
+                {
+                    const float dx = points[i].x - points[j].x;
+                    const float dy = points[i].y - points[j].y;
+                    Assert::IsTrue(dx * dx + dy * dy >= minDistance * minDistance);
+                }
+            }
+        }
+
+        TEST_METHOD(Deterministic)
+        {
+            // Generate the same set of points twice, and a set with another seed
+            Rect area(0.0f, 0.0f, 30.0f, 30.0f);
+            std::vector<Point2> a = poisson_disk_points(area, 1.0f, 3, 100000);
+            std::vector<Point2> b = poisson_disk_points(area, 1.0f, 3, 100000);
+            std::vector<Point2> c = poisson_disk_points(area, 1.0f, 4, 100000);
+
+            // Check the same seed gives the same points
+            Assert::AreEqual(a.size(), b.size());
+            for (unsigned int i = 0; i < a.size(); ++i)
+            {
+                Assert::IsTrue(a[i] == b[i]);
+            }
+
+            // Check a different seed gives different points
+            Assert::IsFalse(a.size() == c.size() && a[0] == c[0] && a.back() == c.back());
+        }
+
+        TEST_METHOD(MaxPoints)
+        {
+            // Generate a limited number of points
+            std::vector<Point2> points = poisson_disk_points(Rect(0.0f, 0.0f, 100.0f, 100.0f), 0.5f, 5, 250);
+
+            // Check the limit was respected
+            Assert::AreEqual((size_t)250, points.size());
+        }
+
+        TEST_METHOD(Distance)
+        {
+            // Fill an area with the distance chosen for a point count
+            const float area = 50.0f * 50.0f;
+            const float distance = poisson_disk_distance(area, 1000.0f);
+            std::vector<Point2> points = poisson_disk_points(Rect(0.0f, 0.0f, 50.0f, 50.0f), distance, 6, 100000);
+
+            // Check the area was filled with slightly fewer points
+            Assert::IsTrue(points.size() <= 1000);
+            Assert::IsTrue(points.size() >= 900);
+        }
+    };
+}
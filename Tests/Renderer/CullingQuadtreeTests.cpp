@@ -0,0 +1,142 @@
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "Math/Frustum.h"
+#include "Math/Matrix4x4.h"
+#include "Renderer/CullingQuadtree.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(CullingQuadtreeTests)
+    {
+        // Creates a grid of items, laid out like the terrain detail batches
+        static std::vector<CullingItem> createGrid(int resolution, float cellSize)
+        {
+            std::vector<CullingItem> items;
+            for (int z = 0; z < resolution; ++z)
+            {
+                for (int x = 0; x < resolution; ++x)
+                {
+                    for (int iter = 0; iter < 3; ++iter)
+                    {
+                        CullingItem item;
+                        item.bounds = Bounds(Point3(x * cellSize, 0.0f, z * cellSize), Point3((x + 1) * cellSize, 10.0f, (z + 1) * cellSize));
+                        item.drawDistance = cellSize * (iter + 1);
+                        items.push_back(item);
+                    }
+                }
+            }
+
+            return items;
+        }
+
+        // Culls the items one by one, without the tree
+        static std::vector<int> cullLinear(const std::vector<CullingItem> &items, const Frustum &frustum, const Point3 &viewPosition, float scale)
+        {
+            std::vector<int> visible;
+            for (unsigned int i = 0; i < items.size(); ++i)
+            {
+                const CullingItem& item = items[i];
+                if ((item.bounds.centre() - viewPosition).sqrMagnitude() <= item.drawDistance * item.drawDistance * scale
+                    && frustum.intersects(item.bounds))
+                {
+                    visible.push_back(i);
+                }
+            }
+
+            return visible;
+        }
+
+    public:
+
+        TEST_METHOD(Empty)
+        {
+            CullingQuadtree tree;
+            tree.build(std::vector<CullingItem>());
+
+            std::vector<int> visible(3, 0);
+            tree.cull(Frustum(), Point3::origin(), 1.0f, visible);
+            Assert::AreEqual((size_t)0, visible.size());
+        }
+
+        TEST_METHOD(MatchesLinearCulling)
+        {
+            std::vector<CullingItem> items = createGrid(12, 85.0f);
+            CullingQuadtree tree;
+            tree.build(items);
+            Assert::AreEqual((int)items.size(), tree.itemCount());
+
+            // Look along +z from several places on the grid
+            const Point3 positions[] = { Point3(500.0f, 5.0f, 20.0f), Point3(100.0f, 50.0f, 500.0f), Point3(-200.0f, 5.0f, -200.0f) };
+            for (const Point3& position : positions)
+            {
+                const Frustum frustum = Frustum::fromMatrix(Matrix4x4::perspective(60.0f, 1.5f, 0.1f, 1000.0f) * Matrix4x4::translation(Vector3::zero() - Vector3(position)));
+                for (float scale : { 1.0f, 6.0f })
+                {
+                    std::vector<int> expected = cullLinear(items, frustum, position, scale);
+                    std::vector<int> visible;
+                    tree.cull(frustum, position, scale, visible);
+
+                    // The tree returns the same items, in tree order
+                    std::sort(visible.begin(), visible.end());
+                    Assert::IsTrue(expected == visible);
+                }
+            }
+        }
+
+        TEST_METHOD(CullsByDistance)
+        {
+            std::vector<CullingItem> items = createGrid(12, 85.0f);
+            CullingQuadtree tree;
+            tree.build(items);
+
+            // Only items near the view position are visible
+            std::vector<int> visible;
+            tree.cull(Frustum(), Point3(42.5f, 5.0f, 42.5f), 1.0f, visible);
+            Assert::IsTrue(visible.size() > 0);
+            for (int i : visible)
+            {
+                Assert::IsTrue((items[i].bounds.centre() - Point3(42.5f, 5.0f, 42.5f)).magnitude() <= items[i].drawDistance);
+            }
+        }
+
+        TEST_METHOD(Benchmark)
+        {
+            std::vector<CullingItem> items = createGrid(48, 20.0f);
+            CullingQuadtree tree;
+            tree.build(items);
+
+            const Point3 position(480.0f, 5.0f, 100.0f);
+            const Frustum frustum = Frustum::fromMatrix(Matrix4x4::perspective(60.0f, 1.5f, 0.1f, 1000.0f) * Matrix4x4::translation(Vector3::zero() - Vector3(position)));
+            const int iterations = 1000;
+
+            // Time the linear loop
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            size_t linearVisible = 0;
+            for (int i = 0; i < iterations; ++i)
+            {
+                linearVisible += cullLinear(items, frustum, position, 1.0f).size();
+            }
+            const double linearMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            // Time the tree
+            start = std::chrono::high_resolution_clock::now();
+            size_t treeVisible = 0;
+            std::vector<int> visible;
+            for (int i = 0; i < iterations; ++i)
+            {
+                tree.cull(frustum, position, 1.0f, visible);
+                treeVisible += visible.size();
+            }
+            const double treeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            Assert::AreEqual(linearVisible, treeVisible);
+            Logger::WriteMessage(("Linear culling: " + std::to_string(linearMs / iterations) + "ms, quadtree culling: " + std::to_string(treeMs / iterations) + "ms\n").c_str());
+        }
+    };
+}
@@ -0,0 +1,125 @@
+#include "CppUnitTest.h"
+
+#include "Renderer/DynamicResolution.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(DynamicResolutionTests)
+    {
+        // Adds the same frame time for a number of frames.
+        // Each frame's time arrives when a later frame begins, as gpu timer results do.
+        static void addFrames(DynamicResolution &resolution, uint64_t &frame, float milliseconds, int frames, int latency = 1)
+        {
+            for (int i = 0; i < frames; ++i, ++frame)
+            {
+                resolution.beginFrame(frame + latency);
+                resolution.addFrame(frame, milliseconds);
+            }
+        }
+
+        // Creates a controller with a 10ms budget, that acts after every 5 frames
+        static DynamicResolution create()
+        {
+            DynamicResolution resolution;
+            resolution.setFrameBudget(10.0f);
+            resolution.setScaleRange(0.5f, 1.0f);
+            resolution.setThresholds(0.8f, 0.95f);
+            resolution.setSettleFrames(5);
+            return resolution;
+        }
+
+    public:
+
+        TEST_METHOD(FramesInsideTheBandKeepTheScale)
+        {
+            DynamicResolution resolution = create();
+            uint64_t frame = 0;
+
+            // Frame times between 8ms and 9.5ms are close enough to the budget
+            addFrames(resolution, frame, 9.0f, 100);
+            Assert::AreEqual(1.0f, resolution.scale());
+        }
+
+        TEST_METHOD(SlowFramesLowerTheScale)
+        {
+            DynamicResolution resolution = create();
+            uint64_t frame = 0;
+
+            // Nothing changes until the frames have settled
+            addFrames(resolution, frame, 20.0f, 4);
+            Assert::AreEqual(1.0f, resolution.scale());
+            addFrames(resolution, frame, 20.0f, 1);
+            Assert::IsTrue(resolution.scale() < 1.0f);
+            Assert::IsTrue(resolution.scale() >= 0.5f);
+
+            // Twice the budget needs roughly half the pixels
+            Assert::AreEqual(0.65f, resolution.scale(), 0.001f);
+        }
+
+        TEST_METHOD(FastFramesRaiseTheScale)
+        {
+            DynamicResolution resolution = create();
+            uint64_t frame = 0;
+            addFrames(resolution, frame, 20.0f, 5);
+            const float lowered = resolution.scale();
+
+            // Once the frames are well under budget, the scale returns to full
+            addFrames(resolution, frame, 4.0f, 5);
+            Assert::IsTrue(resolution.scale() > lowered);
+            addFrames(resolution, frame, 4.0f, 50);
+            Assert::AreEqual(1.0f, resolution.scale());
+        }
+
+        TEST_METHOD(TimesFromBeforeAChangeAreDropped)
+        {
+            DynamicResolution resolution = create();
+            uint64_t frame = 0;
+
+            // The gpu times arrive four frames late, so the scale drops once five slow frames have arrived
+            addFrames(resolution, frame, 20.0f, 5, 4);
+            const float lowered = resolution.scale();
+            Assert::IsTrue(lowered < 1.0f);
+
+            // The next three frames were rendered before the change, so their slow times are not used
+            addFrames(resolution, frame, 20.0f, 3, 4);
+            Assert::AreEqual(lowered, resolution.scale());
+
+            // The frames at the new scale are in the band, so the scale stays where it is
+            addFrames(resolution, frame, 9.0f, 50, 4);
+            Assert::AreEqual(lowered, resolution.scale());
+            Assert::AreEqual(9.0f, resolution.smoothedFrameTime(), 0.001f);
+        }
+
+        TEST_METHOD(ScaleStaysInRange)
+        {
+            DynamicResolution resolution = create();
+            uint64_t frame = 0;
+            addFrames(resolution, frame, 1000.0f, 100);
+            Assert::AreEqual(0.5f, resolution.scale());
+
+            // Scales are always on a step of the granularity, so few render target sizes are used
+            resolution.setScaleRange(0.6f, 0.8f);
+            Assert::AreEqual(0.6f, resolution.scale());
+            addFrames(resolution, frame, 1.0f, 100);
+            Assert::AreEqual(0.8f, resolution.scale(), 0.001f);
+
+            // Resetting returns to the maximum scale
+            resolution.reset();
+            Assert::AreEqual(0.8f, resolution.scale());
+        }
+
+        TEST_METHOD(ScaledSizeIsRoundedAndNeverEmpty)
+        {
+            int width, height;
+            DynamicResolution::scaledSize(1920, 1080, 0.75f, width, height);
+            Assert::AreEqual(1440, width);
+            Assert::AreEqual(810, height);
+
+            DynamicResolution::scaledSize(1, 1, 0.1f, width, height);
+            Assert::AreEqual(1, width);
+            Assert::AreEqual(1, height);
+        }
+    };
+}
\ No newline at end of file
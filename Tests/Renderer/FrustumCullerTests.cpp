@@ -0,0 +1,157 @@
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "Math/Bounds.h"
+#include "Math/Frustum.h"
+#include "Math/Matrix4x4.h"
+#include "Math/Quaternion.h"
+#include "Renderer/FrustumCuller.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(FrustumCullerTests)
+    {
+        // Creates boxes of random sizes scattered around the origin
+        static std::vector<Bounds> createBoxes(int count)
+        {
+            std::mt19937 generator(1234);
+            std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+            std::uniform_real_distribution<float> size(0.1f, 40.0f);
+
+            std::vector<Bounds> boxes;
+            for (int i = 0; i < count; ++i)
+            {
+                const Point3 min(position(generator), position(generator) * 0.1f, position(generator));
+                boxes.push_back(Bounds(min, min + Vector3(size(generator), size(generator), size(generator))));
+            }
+
+            return boxes;
+        }
+
+        // A perspective camera frustum, and an orthographic shadow cascade style frustum
+        static std::vector<Frustum> createFrustums()
+        {
+            std::vector<Frustum> frustums;
+            const Matrix4x4 view = Matrix4x4::trsInverse(Vector3(20.0f, 5.0f, -100.0f), Quaternion::euler(0.0f, 30.0f, 0.0f), Vector3::one());
+            frustums.push_back(Frustum::fromMatrix(Matrix4x4::perspective(60.0f, 1.5f, 0.1f, 1000.0f) * view));
+
+            const Matrix4x4 lightView = Matrix4x4::trsInverse(Vector3(0.0f, 200.0f, 0.0f), Quaternion::euler(60.0f, 20.0f, 0.0f), Vector3::one());
+            frustums.push_back(Frustum::fromMatrix(Matrix4x4::orthographic(-150.0f, 150.0f, -150.0f, 150.0f, 0.0f, 600.0f) * lightView));
+            return frustums;
+        }
+
+        // Culls the boxes one by one
+        static std::vector<int> cullLinear(const std::vector<Bounds> &boxes, const Frustum &frustum)
+        {
+            std::vector<int> visible;
+            for (unsigned int i = 0; i < boxes.size(); ++i)
+            {
+                if (frustum.intersects(boxes[i]))
+                {
+                    visible.push_back(i);
+                }
+            }
+
+            return visible;
+        }
+
+    public:
+
+        TEST_METHOD(Empty)
+        {
+            FrustumCuller culler;
+            std::vector<int> visible(3, 0);
+            culler.cull(Frustum(), visible);
+            Assert::AreEqual((size_t)0, visible.size());
+        }
+
+        TEST_METHOD(MatchesFrustumIntersects)
+        {
+            // Use counts that do and do not fill the last group of 4
+            for (int count : { 1, 7, 64, 1001 })
+            {
+                const std::vector<Bounds> boxes = createBoxes(count);
+                FrustumCuller culler;
+                for (const Bounds& box : boxes)
+                {
+                    culler.add(box);
+                }
+
+                Assert::AreEqual(count, culler.count());
+                for (const Frustum& frustum : createFrustums())
+                {
+                    std::vector<int> visible;
+                    culler.cull(frustum, visible);
+                    Assert::IsTrue(cullLinear(boxes, frustum) == visible);
+                }
+            }
+
+            // Check that the frustums cull some, but not all, of the boxes
+            const std::vector<Bounds> boxes = createBoxes(1000);
+            for (const Frustum& frustum : createFrustums())
+            {
+                const size_t visibleCount = cullLinear(boxes, frustum).size();
+                Assert::IsTrue(visibleCount > 0 && visibleCount < boxes.size());
+            }
+        }
+
+        TEST_METHOD(DefaultFrustumKeepsEverything)
+        {
+            FrustumCuller culler;
+            for (const Bounds& box : createBoxes(10))
+            {
+                culler.add(box);
+            }
+
+            std::vector<int> visible;
+            culler.cull(Frustum(), visible);
+            Assert::AreEqual((size_t)10, visible.size());
+
+            culler.clear();
+            culler.cull(Frustum(), visible);
+            Assert::AreEqual(0, culler.count());
+            Assert::AreEqual((size_t)0, visible.size());
+        }
+
+        TEST_METHOD(Benchmark)
+        {
+            const std::vector<Bounds> boxes = createBoxes(10000);
+            FrustumCuller culler;
+            for (const Bounds& box : boxes)
+            {
+                culler.add(box);
+            }
+
+            const Frustum frustum = createFrustums()[0];
+            const int iterations = 100;
+
+            // Time the linear loop
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            size_t linearVisible = 0;
+            for (int i = 0; i < iterations; ++i)
+            {
+                linearVisible += cullLinear(boxes, frustum).size();
+            }
+            const double linearMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            // Time the culler
+            start = std::chrono::high_resolution_clock::now();
+            size_t cullerVisible = 0;
+            std::vector<int> visible;
+            for (int i = 0; i < iterations; ++i)
+            {
+                culler.cull(frustum, visible);
+                cullerVisible += visible.size();
+            }
+            const double cullerMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            Assert::AreEqual(linearVisible, cullerVisible);
+            Logger::WriteMessage(("Linear culling: " + std::to_string(linearMs / iterations) + "ms, SSE culling: " + std::to_string(cullerMs / iterations) + "ms\n").c_str());
+        }
+    };
+}
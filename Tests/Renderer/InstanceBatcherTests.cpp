@@ -0,0 +1,182 @@
+#include "CppUnitTest.h"
+
+#include <cstdint>
+
+#include "Math/Matrix4x4.h"
+#include "Math/Vector3.h"
+#include "Renderer/InstanceBatcher.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(InstanceBatcherTests)
+    {
+        // The batcher never dereferences its resources, so tests can use fake pointers.
+        template <typename T>
+        static T* fake(uintptr_t id)
+        {
+            return reinterpret_cast<T*>(id * 16);
+        }
+
+        static Matrix4x4 at(float x)
+        {
+            return Matrix4x4::translation(Vector3(x, 0.0f, 0.0f));
+        }
+
+    public:
+
+        TEST_METHOD(Empty)
+        {
+            InstanceBatcher batcher;
+            batcher.build();
+
+            Assert::AreEqual(0, (int)batcher.batches().size());
+            Assert::AreEqual(0, (int)batcher.commands().size());
+            Assert::AreEqual(0, (int)batcher.singles().size());
+        }
+
+        TEST_METHOD(GroupsIdenticalDraws)
+        {
+            // 100 copies of one mesh and material, interleaved with 100 copies of another
+            InstanceBatcher batcher;
+            for (int i = 0; i < 200; ++i)
+            {
+                batcher.add(fake<Shader>(1), 0, fake<Material>(1 + i % 2), fake<Mesh>(1 + i % 2), 0, 0, 36 * (1 + i % 2), at((float)i));
+            }
+            batcher.build();
+
+            // Each mesh is drawn with one command in its own multi draw batch
+            Assert::AreEqual(2, (int)batcher.batches().size());
+            Assert::AreEqual(2, (int)batcher.commands().size());
+            Assert::AreEqual(0, (int)batcher.singles().size());
+            Assert::AreEqual(200, (int)batcher.instances().size());
+
+            for (const InstanceBatch& batch : batcher.batches())
+            {
+                Assert::AreEqual(1, batch.commandCount);
+                Assert::AreEqual(100, batch.instanceCount);
+
+                const DrawIndirectCommand& command = batcher.commands()[batch.firstCommand];
+                Assert::AreEqual(100u, command.instanceCount);
+                Assert::AreEqual(batch.mesh == fake<Mesh>(1) ? 36u : 72u, command.count);
+
+                // Each instance keeps its transform, in the order the draws were added
+                const int parity = (batch.mesh == fake<Mesh>(1)) ? 0 : 1;
+                for (unsigned int i = 0; i < command.instanceCount; ++i)
+                {
+                    const ObjectInstanceData& instance = batcher.instances()[command.baseInstance + i];
+                    Assert::AreEqual((float)(i * 2 + parity), instance.rows[0].w);
+                }
+            }
+        }
+
+        TEST_METHOD(MaterialsShareMeshBatch)
+        {
+            // One mesh with three materials becomes three commands in a single multi draw
+            InstanceBatcher batcher;
+            for (int i = 0; i < 30; ++i)
+            {
+                batcher.add(fake<Shader>(1), 0, fake<Material>(1 + i % 3), fake<Mesh>(1), 0, 0, 36, at((float)i));
+            }
+            batcher.build();
+
+            Assert::AreEqual(1, (int)batcher.batches().size());
+            Assert::AreEqual(3, batcher.batches()[0].commandCount);
+            Assert::AreEqual(3, (int)batcher.materials().size());
+
+            // Every instance refers to the material of its draw
+            for (const DrawIndirectCommand& command : batcher.commands())
+            {
+                Assert::AreEqual(10u, command.instanceCount);
+
+                const uint32_t materialIndex = batcher.instanceMaterialIndices()[command.baseInstance];
+                for (unsigned int i = 0; i < command.instanceCount; ++i)
+                {
+                    Assert::AreEqual(materialIndex, batcher.instanceMaterialIndices()[command.baseInstance + i]);
+                }
+
+                const int x = (int)batcher.instances()[command.baseInstance].rows[0].w;
+                Assert::IsTrue(batcher.materials()[materialIndex] == fake<Material>(1 + x % 3));
+            }
+        }
+
+        TEST_METHOD(VariantsSplitBatches)
+        {
+            // The same mesh and material with two shader variants cannot share a draw
+            InstanceBatcher batcher;
+            for (int i = 0; i < 10; ++i)
+            {
+                batcher.add(fake<Shader>(1), (ShaderFeatureList)(i % 2), fake<Material>(1), fake<Mesh>(1), 0, 0, 36, at((float)i));
+            }
+            batcher.build();
+
+            Assert::AreEqual(2, (int)batcher.batches().size());
+            Assert::IsTrue(batcher.batches()[0].shaderFeatures != batcher.batches()[1].shaderFeatures);
+        }
+
+        TEST_METHOD(LevelsOfDetailSplitCommands)
+        {
+            // Two levels of detail of one mesh share the mesh binding, but each draws its own range of elements
+            InstanceBatcher batcher;
+            for (int i = 0; i < 10; ++i)
+            {
+                const int lod = i % 2;
+                batcher.add(fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(1), lod, lod * 36, 36 >> lod, at((float)i));
+            }
+            batcher.build();
+
+            Assert::AreEqual(1, (int)batcher.batches().size());
+            Assert::AreEqual(2, batcher.batches()[0].commandCount);
+            Assert::AreEqual(0u, batcher.commands()[0].firstIndex);
+            Assert::AreEqual(36u, batcher.commands()[0].count);
+            Assert::AreEqual(36u, batcher.commands()[1].firstIndex);
+            Assert::AreEqual(18u, batcher.commands()[1].count);
+            Assert::AreEqual(5u, batcher.commands()[1].instanceCount);
+        }
+
+        TEST_METHOD(SmallGroupsStaySingle)
+        {
+            InstanceBatcher batcher;
+            batcher.add(fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(3), 0, 0, 36, at(0.0f));
+            batcher.add(fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(1), 0, 0, 36, at(1.0f));
+            batcher.add(fake<Shader>(1), 0, fake<Material>(2), fake<Mesh>(2), 0, 0, 36, at(2.0f));
+            batcher.add(fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(1), 0, 0, 36, at(3.0f));
+            batcher.build(2);
+
+            // Only the pair is instanced, and the single draws keep the order they were added in
+            Assert::AreEqual(1, (int)batcher.batches().size());
+            Assert::AreEqual(2, batcher.batches()[0].instanceCount);
+            Assert::AreEqual(2, (int)batcher.singles().size());
+            Assert::AreEqual(0, batcher.singles()[0]);
+            Assert::AreEqual(2, batcher.singles()[1]);
+            Assert::IsTrue(batcher.draw(batcher.singles()[1]).mesh == fake<Mesh>(2));
+        }
+
+        TEST_METHOD(SingleDrawsAreOneInstance)
+        {
+            InstanceBatcher batcher;
+            batcher.add(fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(1), 0, 0, 36, at(0.0f));
+            batcher.add(fake<Shader>(1), 0, fake<Material>(2), fake<Mesh>(2), 0, 0, 36, at(1.0f));
+            batcher.add(fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(1), 0, 0, 36, at(2.0f));
+            batcher.add(fake<Shader>(1), 0, fake<Material>(3), fake<Mesh>(3), 0, 0, 36, at(3.0f));
+            batcher.build(2);
+
+            // The singles' instances come after the batch's two instances
+            Assert::AreEqual(2, (int)batcher.singles().size());
+            Assert::AreEqual(4, (int)batcher.instances().size());
+            Assert::AreEqual(4, (int)batcher.instanceMaterialIndices().size());
+
+            for (int i = 0; i < 2; ++i)
+            {
+                const RenderQueueItem& draw = batcher.draw(batcher.singles()[i]);
+                Assert::AreEqual(2 + i, draw.firstInstance);
+                Assert::AreEqual(1, draw.instanceCount);
+
+                // Each instance holds the draw's transform and material
+                Assert::AreEqual(1.0f + i * 2.0f, batcher.instances()[draw.firstInstance].rows[0].w);
+                Assert::IsTrue(batcher.materials()[batcher.instanceMaterialIndices()[draw.firstInstance]] == draw.material);
+            }
+        }
+    };
+}
@@ -0,0 +1,146 @@
+#include "CppUnitTest.h"
+
+#include <cstdint>
+
+#include "Renderer/MaterialTable.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(MaterialTableTests)
+    {
+        // The table never dereferences its materials, so tests can use fake pointers.
+        static const Material* fake(uintptr_t id)
+        {
+            return reinterpret_cast<const Material*>(id * 16);
+        }
+
+        static MaterialData data(float red, uint64_t albedo)
+        {
+            MaterialData result = {};
+            result.colorSmoothness = Color(red, 1.0f, 1.0f, 0.5f);
+            result.albedoTexture = albedo;
+            return result;
+        }
+
+    public:
+
+        TEST_METHOD(MaterialsKeepTheirIndex)
+        {
+            MaterialTable table;
+            Assert::AreEqual(0u, table.add(fake(1)));
+            Assert::AreEqual(1u, table.add(fake(2)));
+            Assert::AreEqual(0u, table.add(fake(1)));
+            Assert::AreEqual(2, table.size());
+
+            Assert::AreEqual(1u, table.find(fake(2)));
+            Assert::IsTrue(table.material(1) == fake(2));
+        }
+
+        TEST_METHOD(UnknownMaterialsUseTheFirstEntry)
+        {
+            MaterialTable table;
+            table.add(fake(1));
+            table.add(fake(2));
+
+            Assert::AreEqual(0u, table.find(fake(3)));
+            Assert::AreEqual(0u, table.find(nullptr));
+        }
+
+        TEST_METHOD(OnlyChangedEntriesAreDirty)
+        {
+            MaterialTable table;
+            for (int i = 0; i < 10; ++i)
+            {
+                table.set(table.add(fake(1 + i)), data(i * 0.1f, 0));
+            }
+
+            // Every new entry needs uploading
+            Assert::IsTrue(table.dirty());
+            Assert::AreEqual(0, table.firstDirty());
+            Assert::AreEqual(10, table.dirtyCount());
+            table.clearDirty();
+
+            // Setting the same data again changes nothing
+            for (int i = 0; i < 10; ++i)
+            {
+                table.set(i, data(i * 0.1f, 0));
+            }
+            Assert::IsFalse(table.dirty());
+
+            // Editing two materials only uploads the range between them
+            table.set(3, data(1.0f, 0));
+            table.set(6, data(0.6f, 42));
+            Assert::AreEqual(3, table.firstDirty());
+            Assert::AreEqual(4, table.dirtyCount());
+            Assert::AreEqual((uint64_t)42, table.entries()[6].albedoTexture);
+        }
+
+        TEST_METHOD(AddedMaterialsAreDirty)
+        {
+            MaterialTable table;
+            table.add(fake(1));
+            table.add(fake(2));
+            table.clearDirty();
+
+            table.add(fake(2));
+            Assert::IsFalse(table.dirty());
+
+            table.add(fake(3));
+            Assert::IsTrue(table.dirty());
+            Assert::AreEqual(2, table.firstDirty());
+            Assert::AreEqual(1, table.dirtyCount());
+        }
+
+        TEST_METHOD(OnlyChangedVersionsNeedRefreshing)
+        {
+            MaterialTable table;
+            const uint32_t index = table.add(fake(1));
+
+            // New entries always need setting
+            Assert::IsTrue(table.needsRefresh(index, 0));
+            table.set(index, data(0.5f, 0), 0);
+            Assert::IsFalse(table.needsRefresh(index, 0));
+
+            // Editing or reloading the material changes its version
+            Assert::IsTrue(table.needsRefresh(index, 1));
+        }
+
+        TEST_METHOD(UnusedEntriesAreFreedAndReused)
+        {
+            MaterialTable table;
+            table.add(fake(1));
+            table.add(fake(2));
+            table.add(fake(3));
+
+            // Keep drawing the second material, but stop drawing the third
+            for (int update = 0; update < 5; ++update)
+            {
+                table.add(fake(2));
+                Assert::AreEqual(0, table.removeUnused(10));
+                table.nextUpdate();
+            }
+
+            for (int update = 0; update < 10; ++update)
+            {
+                table.add(fake(2));
+                table.removeUnused(10);
+                table.nextUpdate();
+            }
+
+            // The default material is never freed, even when it is not drawn
+            Assert::IsTrue(table.material(0) == fake(1));
+            Assert::IsTrue(table.material(1) == fake(2));
+            Assert::IsTrue(table.material(2) == nullptr);
+            Assert::AreEqual(0u, table.find(fake(3)));
+
+            // New materials reuse the freed entry, and need setting again
+            table.clearDirty();
+            Assert::AreEqual(2u, table.add(fake(4)));
+            Assert::AreEqual(3, table.size());
+            Assert::IsTrue(table.needsRefresh(2, 0));
+            Assert::AreEqual(2, table.firstDirty());
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "CppUnitTest.h"
+
+#include "Renderer/MeshLod.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(MeshLodTests)
+    {
+        // Four levels, each with half the triangles and twice the error of the level before
+        static const MeshLod* chain()
+        {
+            static const MeshLod lods[4] =
+            {
+                { 0, 3000, 0.0f },
+                { 3000, 1500, 0.01f },
+                { 4500, 750, 0.02f },
+                { 5250, 375, 0.04f }
+            };
+            return lods;
+        }
+
+    public:
+
+        TEST_METHOD(ProjectedRadiusShrinksWithDistance)
+        {
+            Assert::AreEqual(100.0f, MeshLod::projectedRadius(1.0f, 10.0f, 1000.0f), 1e-3f);
+            Assert::AreEqual(50.0f, MeshLod::projectedRadius(1.0f, 20.0f, 1000.0f), 1e-3f);
+
+            // A camera inside the sphere sees it at its largest
+            Assert::AreEqual(1000.0f, MeshLod::projectedRadius(1.0f, 0.5f, 1000.0f), 1e-3f);
+        }
+
+        TEST_METHOD(LargeObjectsUseFullDetail)
+        {
+            Assert::AreEqual(0, MeshLod::select(chain(), 4, 500.0f, 0.0f));
+        }
+
+        TEST_METHOD(SmallerObjectsUseCoarserLevels)
+        {
+            // The error on screen must stay within one pixel
+            Assert::AreEqual(1, MeshLod::select(chain(), 4, 100.0f, 0.0f));
+            Assert::AreEqual(2, MeshLod::select(chain(), 4, 50.0f, 0.0f));
+            Assert::AreEqual(3, MeshLod::select(chain(), 4, 10.0f, 0.0f));
+        }
+
+        TEST_METHOD(BiasDoublesThreshold)
+        {
+            // Each step of bias moves one level when the errors double per level
+            Assert::AreEqual(1, MeshLod::select(chain(), 4, 100.0f, 0.0f));
+            Assert::AreEqual(2, MeshLod::select(chain(), 4, 100.0f, 1.0f));
+            Assert::AreEqual(3, MeshLod::select(chain(), 4, 100.0f, 2.0f));
+            Assert::AreEqual(0, MeshLod::select(chain(), 4, 100.0f, -1.0f));
+        }
+
+        TEST_METHOD(SingleLevelIsAlwaysSelected)
+        {
+            Assert::AreEqual(0, MeshLod::select(chain(), 1, 0.0f, 10.0f));
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "CppUnitTest.h"
+
+#include "Renderer/MeshVertexFormat.h"
+
+#include <math.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(MeshVertexFormatTests)
+    {
+        // Directions covering every octant, the axes and the folded edges of the octahedron
+        static std::vector<Vector3> directions()
+        {
+            std::vector<Vector3> result;
+            for (int i = 0; i < 200; ++i)
+            {
+                const float theta = i * 0.7853f;
+                const float z = -1.0f + 2.0f * (i + 0.5f) / 200.0f;
+                const float r = sqrtf(1.0f - z * z);
+                result.push_back(Vector3(r * cosf(theta), r * sinf(theta), z));
+            }
+
+            result.push_back(Vector3(0.0f, 0.0f, 1.0f));
+            result.push_back(Vector3(0.0f, 0.0f, -1.0f));
+            result.push_back(Vector3(-1.0f, 0.0f, 0.0f));
+            result.push_back(Vector3(0.0f, -1.0f, 0.0f));
+            return result;
+        }
+
+    public:
+
+        TEST_METHOD(OctahedralDirectionsRoundTrip)
+        {
+            for (const Vector3& direction : directions())
+            {
+                int16_t x, y;
+                MeshVertexFormat::encodeOctahedral(direction, x, y);
+                const Vector3 decoded = MeshVertexFormat::decodeOctahedral(x, y);
+
+                // 16 bit octahedral coordinates keep directions well within a hundredth of a degree
+                const float cosAngle = decoded.x * direction.x + decoded.y * direction.y + decoded.z * direction.z;
+                Assert::IsTrue(cosAngle > 0.99999f);
+            }
+        }
+
+        TEST_METHOD(HalfFloatsRoundTrip)
+        {
+            Assert::AreEqual(0.0f, MeshVertexFormat::fromHalf(MeshVertexFormat::toHalf(0.0f)));
+            Assert::AreEqual(1.0f, MeshVertexFormat::fromHalf(MeshVertexFormat::toHalf(1.0f)));
+            Assert::AreEqual(-2.0f, MeshVertexFormat::fromHalf(MeshVertexFormat::toHalf(-2.0f)));
+            Assert::AreEqual(0.5f, MeshVertexFormat::fromHalf(MeshVertexFormat::toHalf(0.5f)));
+
+            // Texcoords in the unit square stay within half a texel of a 2048 texture
+            for (int i = 0; i <= 1000; ++i)
+            {
+                const float value = i / 1000.0f;
+                Assert::AreEqual(value, MeshVertexFormat::fromHalf(MeshVertexFormat::toHalf(value)), 0.5f / 2048.0f);
+            }
+
+            // Tiny values become denormals, and huge values become infinite
+            Assert::AreEqual(1e-6f, MeshVertexFormat::fromHalf(MeshVertexFormat::toHalf(1e-6f)), 1e-7f);
+            Assert::IsTrue(MeshVertexFormat::fromHalf(MeshVertexFormat::toHalf(1e6f)) > 65504.0f);
+        }
+
+        TEST_METHOD(QuantisedLayoutIsLessThanHalfTheFloatSize)
+        {
+            const MeshVertexLayout floats = MeshVertexLayout::create(0, true, true, true);
+            const MeshVertexLayout quantised = MeshVertexLayout::create(MeshVertexLayout::QuantisedPositionsFlag | MeshVertexLayout::HalfTexcoordsFlag, true, true, true);
+
+            // The separate float attributes used 48 bytes for each vertex
+            Assert::AreEqual(28, floats.stride);
+            Assert::AreEqual(20, quantised.stride);
+            Assert::IsTrue(quantised.stride * 2 < 48);
+
+            // Every attribute stays 4 byte aligned
+            Assert::AreEqual(0, quantised.normalOffset % 4);
+            Assert::AreEqual(0, quantised.tangentOffset % 4);
+            Assert::AreEqual(0, quantised.texcoordOffset % 4);
+
+            // Missing attributes take no space
+            const MeshVertexLayout positionsOnly = MeshVertexLayout::create(MeshVertexLayout::QuantisedPositionsFlag, false, false, false);
+            Assert::AreEqual(8, positionsOnly.stride);
+            Assert::AreEqual(-1, positionsOnly.normalOffset);
+        }
+
+        TEST_METHOD(LargeMeshesAndTiledTexcoordsKeepFloats)
+        {
+            const Point2 unitTexcoords[2] = { Point2(0.0f, 0.0f), Point2(1.0f, 1.0f) };
+            const Point2 tiledTexcoords[2] = { Point2(0.0f, 0.0f), Point2(40.0f, 1.0f) };
+            const Bounds small(Point3(-1.0f, -1.0f, -1.0f), Point3(1.0f, 1.0f, 1.0f));
+            const Bounds huge(Point3(-500.0f, 0.0f, -500.0f), Point3(500.0f, 1.0f, 500.0f));
+
+            Assert::AreEqual(MeshVertexLayout::QuantisedPositionsFlag | MeshVertexLayout::HalfTexcoordsFlag, MeshVertexFormat::chooseFlags(small, unitTexcoords, 2));
+            Assert::AreEqual(MeshVertexLayout::HalfTexcoordsFlag, MeshVertexFormat::chooseFlags(huge, unitTexcoords, 2));
+            Assert::AreEqual(MeshVertexLayout::QuantisedPositionsFlag, MeshVertexFormat::chooseFlags(small, tiledTexcoords, 2));
+        }
+
+        TEST_METHOD(PackedPositionsUnpackWithinOneStep)
+        {
+            std::vector<Point3> positions;
+            for (int i = 0; i < 100; ++i)
+            {
+                positions.push_back(Point3(sinf(i * 1.3f) * 4.0f, cosf(i * 0.7f) * 2.0f + 3.0f, i * 0.05f - 1.0f));
+            }
+
+            const Bounds box = Bounds::covering(positions.data(), (int)positions.size());
+            const MeshVertexLayout layout = MeshVertexLayout::create(MeshVertexFormat::chooseFlags(box, nullptr, 0), false, false, false);
+            Assert::IsTrue(layout.quantisedPositions());
+
+            const std::vector<unsigned char> vertices = MeshVertexFormat::pack(layout, box, (int)positions.size(), positions.data(), nullptr, nullptr, nullptr);
+            Assert::AreEqual((size_t)(layout.stride * positions.size()), vertices.size());
+
+            std::vector<Point3> unpacked(positions.size());
+            MeshVertexFormat::unpackPositions(layout, box, vertices.data(), (int)positions.size(), unpacked.data());
+
+            // The step is the largest axis over the number of unorm16 steps
+            const float step = 8.0f / 65535.0f;
+            for (size_t i = 0; i < positions.size(); ++i)
+            {
+                Assert::AreEqual(positions[i].x, unpacked[i].x, step);
+                Assert::AreEqual(positions[i].y, unpacked[i].y, step);
+                Assert::AreEqual(positions[i].z, unpacked[i].z, step);
+            }
+
+            // The bounds corners are exact
+            Vector3 offset, scale;
+            MeshVertexFormat::positionTransform(layout, box, offset, scale);
+            Assert::AreEqual(box.min().x, offset.x);
+            Assert::AreEqual(box.size().z, scale.z);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "Math/Bounds.h"
+#include "Math/Matrix4x4.h"
+#include "Renderer/OcclusionCuller.h"
+#include "Utils/WorkerPool.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(OcclusionCullerTests)
+    {
+        // A camera at the origin looking along +z
+        static Matrix4x4 camera()
+        {
+            return Matrix4x4::perspective(60.0f, 2.0f, 0.1f, 1000.0f);
+        }
+
+        // Adds a square wall facing the camera, with the given half size and distance
+        static void addWall(OcclusionCuller &culler, float halfSize, float distance)
+        {
+            const Point3 positions[4] =
+            {
+                Point3(-halfSize, -halfSize, distance),
+                Point3(halfSize, -halfSize, distance),
+                Point3(halfSize, halfSize, distance),
+                Point3(-halfSize, halfSize, distance)
+            };
+            const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+            culler.addOccluder(positions, 4, indices, 6, Matrix4x4::identity());
+        }
+
+        // Creates random triangles a few metres across, scattered in front of the camera
+        static void createRandomTriangles(int count, std::vector<Point3> &positions, std::vector<uint32_t> &indices)
+        {
+            std::mt19937 generator(1234);
+            std::uniform_real_distribution<float> position(-40.0f, 40.0f);
+            std::uniform_real_distribution<float> distance(5.0f, 100.0f);
+            std::uniform_real_distribution<float> offset(-3.0f, 3.0f);
+
+            for (int i = 0; i < count; ++i)
+            {
+                const Point3 centre(position(generator), position(generator) * 0.5f, distance(generator));
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    indices.push_back((uint32_t)positions.size());
+                    positions.push_back(centre + Vector3(offset(generator), offset(generator), offset(generator)));
+                }
+            }
+        }
+
+    public:
+
+        TEST_METHOD(EverythingIsVisibleWithoutOccluders)
+        {
+            OcclusionCuller culler;
+            culler.begin(camera());
+            culler.rasterize();
+
+            Assert::IsTrue(culler.isVisible(Bounds(Point3(-1.0f, -1.0f, 50.0f), Point3(1.0f, 1.0f, 52.0f))));
+            Assert::IsTrue(culler.isVisible(Bounds(Point3(-1.0f, -1.0f, 500.0f), Point3(1.0f, 1.0f, 502.0f))));
+        }
+
+        TEST_METHOD(BoxesBehindAWallAreHidden)
+        {
+            OcclusionCuller culler;
+            culler.begin(camera());
+            addWall(culler, 5.0f, 10.0f);
+            culler.rasterize();
+            Assert::AreEqual(2, culler.occluderTriangleCount());
+
+            // Behind the wall
+            Assert::IsFalse(culler.isVisible(Bounds(Point3(-1.0f, -1.0f, 20.0f), Point3(1.0f, 1.0f, 22.0f))));
+
+            // In front of the wall
+            Assert::IsTrue(culler.isVisible(Bounds(Point3(-1.0f, -1.0f, 5.0f), Point3(1.0f, 1.0f, 6.0f))));
+
+            // Behind the wall, but off to the side of it
+            Assert::IsTrue(culler.isVisible(Bounds(Point3(20.0f, -1.0f, 30.0f), Point3(22.0f, 1.0f, 32.0f))));
+
+            // Partly behind the wall, and partly beside it
+            Assert::IsTrue(culler.isVisible(Bounds(Point3(8.0f, -1.0f, 20.0f), Point3(14.0f, 1.0f, 22.0f))));
+
+            // Crossing the near plane
+            Assert::IsTrue(culler.isVisible(Bounds(Point3(-1.0f, -1.0f, -1.0f), Point3(1.0f, 1.0f, 30.0f))));
+        }
+
+        TEST_METHOD(OccludersBehindTheCameraAreSkipped)
+        {
+            OcclusionCuller culler;
+            culler.begin(camera());
+            addWall(culler, 5.0f, -10.0f);
+            culler.rasterize();
+
+            Assert::AreEqual(0, culler.occluderTriangleCount());
+            Assert::IsTrue(culler.isVisible(Bounds(Point3(-1.0f, -1.0f, 20.0f), Point3(1.0f, 1.0f, 22.0f))));
+        }
+
+        TEST_METHOD(WorkerPoolGivesTheSameDepth)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            createRandomTriangles(500, positions, indices);
+
+            OcclusionCuller serial;
+            serial.begin(camera());
+            serial.addOccluder(positions.data(), (int)positions.size(), indices.data(), (int)indices.size(), Matrix4x4::identity());
+            serial.rasterize();
+
+            WorkerPool workerPool(4);
+            OcclusionCuller parallel;
+            parallel.begin(camera());
+            parallel.addOccluder(positions.data(), (int)positions.size(), indices.data(), (int)indices.size(), Matrix4x4::identity());
+            parallel.rasterize(&workerPool);
+
+            for (int y = 0; y < serial.height(); ++y)
+            {
+                for (int x = 0; x < serial.width(); ++x)
+                {
+                    Assert::AreEqual(serial.depth(x, y), parallel.depth(x, y));
+                }
+            }
+        }
+
+        TEST_METHOD(Benchmark)
+        {
+            std::vector<Point3> positions;
+            std::vector<uint32_t> indices;
+            createRandomTriangles(5000, positions, indices);
+
+            WorkerPool workerPool;
+            OcclusionCuller culler;
+            const int iterations = 100;
+
+            // Time drawing the occluders
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                culler.begin(camera());
+                culler.addOccluder(positions.data(), (int)positions.size(), indices.data(), (int)indices.size(), Matrix4x4::identity());
+                culler.rasterize(&workerPool);
+            }
+            const double rasterizeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            // Time testing boxes against them
+            std::mt19937 generator(5678);
+            std::uniform_real_distribution<float> position(-40.0f, 40.0f);
+            std::uniform_real_distribution<float> distance(5.0f, 200.0f);
+            std::vector<Bounds> boxes;
+            for (int i = 0; i < 10000; ++i)
+            {
+                const Point3 min(position(generator), position(generator) * 0.5f, distance(generator));
+                boxes.push_back(Bounds(min, min + Vector3(1.0f, 1.0f, 1.0f)));
+            }
+
+            start = std::chrono::high_resolution_clock::now();
+            int visible = 0;
+            for (const Bounds& box : boxes)
+            {
+                visible += culler.isVisible(box) ? 1 : 0;
+            }
+            const double testMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            Assert::IsTrue(visible < (int)boxes.size());
+            Logger::WriteMessage(("Rasterizing 5000 occluders: " + std::to_string(rasterizeMs / iterations) + "ms, testing " + std::to_string(boxes.size()) + " boxes: " + std::to_string(testMs) + "ms, " + std::to_string(visible) + " visible\n").c_str());
+        }
+    };
+}
\ No newline at end of file
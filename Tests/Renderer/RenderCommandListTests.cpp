@@ -0,0 +1,119 @@
+#include "CppUnitTest.h"
+
+#include "Renderer/RenderCommandList.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(RenderCommandListTests)
+    {
+    public:
+
+        TEST_METHOD(CommandsAreRecordedInOrder)
+        {
+            RenderCommandList list;
+            Shader* shader = (Shader*)0x10;
+            const Mesh* mesh = (const Mesh*)0x20;
+
+            list.bindShader(shader, 5);
+            list.bindMesh(mesh);
+            list.draw(36);
+            list.drawInstanced(12, 4, 8);
+            list.multiDrawIndirect(2, 3);
+
+            const std::vector<RenderCommand>& commands = list.commands();
+            Assert::AreEqual(5, (int)commands.size());
+
+            Assert::IsTrue(commands[0].type == RenderCommandType::BindShader);
+            Assert::IsTrue(commands[0].shader == shader);
+            Assert::AreEqual(5u, commands[0].shaderFeatures);
+
+            Assert::IsTrue(commands[1].type == RenderCommandType::BindMesh);
+            Assert::IsTrue(commands[1].mesh == mesh);
+
+            Assert::IsTrue(commands[2].type == RenderCommandType::Draw);
+            Assert::AreEqual(36, commands[2].elementCount);
+            Assert::AreEqual(0, commands[2].instanceCount);
+
+            Assert::IsTrue(commands[3].type == RenderCommandType::Draw);
+            Assert::AreEqual(12, commands[3].elementCount);
+            Assert::AreEqual(4, commands[3].firstInstance);
+            Assert::AreEqual(8, commands[3].instanceCount);
+
+            Assert::IsTrue(commands[4].type == RenderCommandType::MultiDrawIndirect);
+            Assert::AreEqual(2, commands[4].firstIndirectCommand);
+            Assert::AreEqual(3, commands[4].indirectCommandCount);
+        }
+
+        TEST_METHOD(DataIsCopiedAndAligned)
+        {
+            RenderCommandList list;
+
+            // Record data of awkward sizes, and change the source after recording
+            unsigned char bytes[3] = { 1, 2, 3 };
+            float values[5] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+            list.storageData(2, bytes, sizeof(bytes));
+            list.uniformData(3, values, sizeof(values));
+            list.indirectData(values, 2 * sizeof(float));
+            bytes[0] = 9;
+            values[0] = 9.0f;
+
+            const std::vector<RenderCommand>& commands = list.commands();
+            Assert::AreEqual(3, (int)commands.size());
+            Assert::IsTrue(commands[0].type == RenderCommandType::StorageData);
+            Assert::IsTrue(commands[1].type == RenderCommandType::UniformData);
+            Assert::IsTrue(commands[2].type == RenderCommandType::IndirectData);
+            Assert::AreEqual(2, commands[0].binding);
+            Assert::AreEqual(3, commands[1].binding);
+
+            // Each block starts on a 16 byte boundary
+            for (const RenderCommand& command : commands)
+            {
+                Assert::AreEqual(0u, command.dataOffset % 16);
+            }
+
+            // The list keeps the values from when the data was recorded
+            const unsigned char* recordedBytes = (const unsigned char*)list.data(commands[0]);
+            const float* recordedValues = (const float*)list.data(commands[1]);
+            Assert::AreEqual(3u, commands[0].dataSize);
+            Assert::AreEqual(1, (int)recordedBytes[0]);
+            Assert::AreEqual(3, (int)recordedBytes[2]);
+            Assert::AreEqual((uint32_t)sizeof(values), commands[1].dataSize);
+            Assert::AreEqual(1.0f, recordedValues[0]);
+            Assert::AreEqual(5.0f, recordedValues[4]);
+        }
+
+        TEST_METHOD(TypedUniformDataCopiesTheStruct)
+        {
+            struct Data
+            {
+                float a;
+                int b;
+            };
+
+            RenderCommandList list;
+            const Data data = { 2.5f, 7 };
+            list.uniformData(1, data);
+
+            const RenderCommand& command = list.commands()[0];
+            Assert::AreEqual((uint32_t)sizeof(Data), command.dataSize);
+
+            const Data* recorded = (const Data*)list.data(command);
+            Assert::AreEqual(2.5f, recorded->a);
+            Assert::AreEqual(7, recorded->b);
+        }
+
+        TEST_METHOD(ClearRemovesCommandsAndData)
+        {
+            RenderCommandList list;
+            const float value = 1.0f;
+            list.uniformData(0, value);
+            list.draw(3);
+
+            list.clear();
+            Assert::AreEqual(0, (int)list.commands().size());
+            Assert::AreEqual(0u, list.dataSize());
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "Math/Matrix4x4.h"
+#include "Math/Vector3.h"
+#include "Renderer/InstanceBatcher.h"
+#include "Renderer/NullRenderDevice.h"
+#include "Renderer/RenderCommandList.h"
+#include "Renderer/RenderQueue.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(RenderDeviceTests)
+    {
+        // The null device never dereferences its resources, so tests can use fake pointers.
+        template <typename T>
+        static T* fake(uintptr_t id)
+        {
+            return reinterpret_cast<T*>(id * 16);
+        }
+
+        // Records a render queue into a command list, drawing 36 elements per item
+        struct QueueRecorder
+        {
+            RenderCommandList* commands;
+
+            void bindShader(const RenderQueueItem &item) { commands->bindShader(item.shader, item.shaderFeatures); }
+            void bindMaterial(const RenderQueueItem&) { }
+            void bindMesh(const RenderQueueItem &item) { commands->bindMesh(item.mesh); }
+            void draw(const RenderQueueItem &item) { commands->drawInstanced(36, item.firstInstance, item.instanceCount); }
+        };
+
+        // Records a frame the way the renderer records a view.
+        // Copies of a mesh and material are batched, and the remaining draws go through the render queue.
+        static void recordFrame(int objectCount, InstanceBatcher &batcher, RenderQueue &queue, RenderCommandList &commands)
+        {
+            batcher.clear();
+            for (int i = 0; i < objectCount; ++i)
+            {
+                // Every 10th object uses a unique mesh, so is drawn singly
+                const int mesh = (i % 10 == 0) ? 1000 + i : 1 + i % 50;
+                batcher.add(fake<Shader>(1), 0, fake<Material>(1 + i % 20), fake<Mesh>(mesh), 0, 0, 36, Matrix4x4::translation(Vector3((float)i, 0.0f, 0.0f)));
+            }
+            batcher.build();
+
+            commands.clear();
+            commands.storageData(2, batcher.instances().data(), (uint32_t)(batcher.instances().size() * sizeof(ObjectInstanceData)));
+
+            queue.clear();
+            for (int index : batcher.singles())
+            {
+                const RenderQueueItem& draw = batcher.draw(index);
+                queue.submitInstanced(RenderQueuePass::Geometry, draw.shader, draw.shaderFeatures, draw.material, draw.mesh, draw.firstInstance, draw.instanceCount, (float)index, draw.lod);
+            }
+
+            queue.sort();
+            QueueRecorder recorder = { &commands };
+            queue.execute(recorder);
+
+            commands.indirectData(batcher.commands().data(), (uint32_t)(batcher.commands().size() * sizeof(DrawIndirectCommand)));
+            for (const InstanceBatch& batch : batcher.batches())
+            {
+                commands.bindShader(batch.shader, batch.shaderFeatures);
+                commands.bindMesh(batch.mesh);
+                commands.multiDrawIndirect(batch.firstCommand, batch.commandCount);
+            }
+        }
+
+    public:
+
+        TEST_METHOD(CommandsAreExecutedInOrder)
+        {
+            RenderCommandList list;
+            const float uniform[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+            list.bindShader(fake<Shader>(1), 3);
+            list.bindMesh(fake<Mesh>(2));
+            list.uniformData(3, uniform, sizeof(uniform));
+            list.draw(36, 12);
+
+            NullRenderDevice device;
+            device.execute(list);
+
+            const std::vector<RenderCommand>& executed = device.executed();
+            Assert::AreEqual(4, (int)executed.size());
+            Assert::IsTrue(executed[0].type == RenderCommandType::BindShader);
+            Assert::IsTrue(executed[0].shader == fake<Shader>(1));
+            Assert::IsTrue(executed[1].mesh == fake<Mesh>(2));
+            Assert::IsTrue(executed[2].type == RenderCommandType::UniformData);
+            Assert::AreEqual(3, executed[2].binding);
+            Assert::AreEqual(16u, executed[2].dataSize);
+            Assert::AreEqual(36, executed[3].elementCount);
+            Assert::AreEqual(12, executed[3].firstElement);
+        }
+
+        TEST_METHOD(StatsCountTheSubmittedWork)
+        {
+            RenderCommandList list;
+            list.bindShader(fake<Shader>(1), 0);
+            list.bindMesh(fake<Mesh>(1));
+            list.draw(36);
+            list.drawInstanced(12, 0, 10);
+
+            // Two indirect commands, drawing 5 and 3 instances
+            const DrawIndirectCommand indirect[2] = { { 6, 5, 0, 0, 0 }, { 30, 3, 6, 0, 5 } };
+            list.indirectData(indirect, sizeof(indirect));
+            list.multiDrawIndirect(0, 2);
+
+            NullRenderDevice device;
+            device.execute(list);
+
+            const RenderDeviceStats& stats = device.stats();
+            Assert::AreEqual(6, stats.commands);
+            Assert::AreEqual(1, stats.shaderBinds);
+            Assert::AreEqual(1, stats.meshBinds);
+            Assert::AreEqual(3, stats.draws);
+            Assert::AreEqual(1 + 10 + 5 + 3, stats.instances);
+            Assert::AreEqual((uint64_t)(12 + 4 * 10 + 2 * 5 + 10 * 3), stats.triangles);
+            Assert::AreEqual(1, stats.bufferUploads);
+            Assert::AreEqual((uint64_t)sizeof(indirect), stats.bytesUploaded);
+
+            // Stats add up over several lists until they are reset
+            device.execute(list);
+            Assert::AreEqual(6, device.stats().draws);
+            device.resetStats();
+            Assert::AreEqual(0, device.stats().draws);
+        }
+
+        TEST_METHOD(PassStateAndTexturesAreExecuted)
+        {
+            // Full screen and terrain passes set their own state and textures through the list
+            RenderCommandList list;
+            list.setState({ true, false, RenderBlendMode::MinAlpha });
+            list.clearDepth();
+            list.bindTexture(8, fake<Texture>(1));
+            list.bindTexture(11, fake<ArrayTexture>(2));
+            list.bindStorageBuffer(fake<StorageBufferBase>(3));
+            list.drawPatches(300);
+
+            NullRenderDevice device;
+            device.execute(list);
+
+            const std::vector<RenderCommand>& executed = device.executed();
+            Assert::AreEqual(6, (int)executed.size());
+            Assert::IsTrue(executed[0].type == RenderCommandType::SetState);
+            Assert::IsTrue(executed[0].state.depthGreater);
+            Assert::IsFalse(executed[0].state.depthWrite);
+            Assert::IsTrue(executed[0].state.blend == RenderBlendMode::MinAlpha);
+            Assert::IsTrue(executed[1].type == RenderCommandType::ClearDepth);
+            Assert::AreEqual(8, executed[2].binding);
+            Assert::IsTrue(executed[2].texture == fake<Texture>(1));
+            Assert::IsTrue(executed[3].type == RenderCommandType::BindArrayTexture);
+            Assert::IsTrue(executed[3].arrayTexture == fake<ArrayTexture>(2));
+            Assert::IsTrue(executed[4].storageBuffer == fake<StorageBufferBase>(3));
+            Assert::IsTrue(executed[5].primitive == RenderPrimitive::Patches);
+
+            // Patches are triangles, and are counted as draws like any other
+            Assert::AreEqual(1, device.stats().draws);
+            Assert::AreEqual((uint64_t)100, device.stats().triangles);
+        }
+
+        TEST_METHOD(FramebufferCommandsAreExecuted)
+        {
+            // Passes bind and clear their framebuffers, and the upscale pass copies one into another
+            RenderCommandList list;
+            list.bindFramebuffer(fake<Framebuffer>(1));
+            list.setWireframe(true);
+            list.clearColor(Color(0.0f, 0.0f, 0.0f, 1.0f));
+            list.bindFramebufferDepth(15, fake<Framebuffer>(2));
+            list.blitFramebuffer(fake<Framebuffer>(1), fake<Framebuffer>(2), 640, 360);
+
+            NullRenderDevice device;
+            device.execute(list);
+
+            const std::vector<RenderCommand>& executed = device.executed();
+            Assert::AreEqual(5, (int)executed.size());
+            Assert::IsTrue(executed[0].type == RenderCommandType::BindFramebuffer);
+            Assert::IsTrue(executed[0].framebuffer == fake<Framebuffer>(1));
+            Assert::IsTrue(executed[1].wireframe);
+            Assert::IsTrue(executed[2].type == RenderCommandType::ClearColor);
+            Assert::AreEqual(1.0f, executed[2].color.a);
+            Assert::AreEqual(15, executed[3].binding);
+            Assert::IsTrue(executed[3].framebuffer == fake<Framebuffer>(2));
+            Assert::IsTrue(executed[4].type == RenderCommandType::BlitFramebuffer);
+            Assert::IsTrue(executed[4].destination == fake<Framebuffer>(2));
+            Assert::AreEqual(640, executed[4].sourceWidth);
+            Assert::AreEqual(360, executed[4].sourceHeight);
+
+            // None of them draw or upload anything
+            Assert::AreEqual(5, device.stats().commands);
+            Assert::AreEqual(0, device.stats().draws);
+            Assert::AreEqual(0, device.stats().bufferUploads);
+        }
+
+        TEST_METHOD(DirectUploadsAreCounted)
+        {
+            // Uploads made without a command list are counted separately
+            NullRenderDevice device;
+            device.countUpload(64);
+            device.countUpload(32);
+
+            const RenderDeviceStats& stats = device.stats();
+            Assert::AreEqual(0, stats.commands);
+            Assert::AreEqual(2, stats.bufferUploads);
+            Assert::AreEqual((uint64_t)96, stats.bytesUploaded);
+            Assert::AreEqual(0, stats.draws);
+        }
+
+        TEST_METHOD(RecordedFramesDrawEveryObject)
+        {
+            InstanceBatcher batcher;
+            RenderQueue queue;
+            RenderCommandList commands;
+            recordFrame(1000, batcher, queue, commands);
+
+            NullRenderDevice device;
+            device.execute(commands);
+
+            // Every object is drawn exactly once, whether batched or single
+            Assert::AreEqual(1000, device.stats().instances);
+            Assert::AreEqual((uint64_t)(1000 * 12), device.stats().triangles);
+            Assert::AreEqual(100 + (int)batcher.batches().size(), device.stats().draws);
+        }
+
+        // Recording 100 frames of 10000 objects is too slow for every test run, so the benchmark is opt in.
+        // Remove the ignore attribute locally to measure the cpu cost of recording and submitting.
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark)
+            TEST_METHOD_ATTRIBUTE(L"TestCategory", L"Benchmark")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(Benchmark)
+        {
+            InstanceBatcher batcher;
+            RenderQueue queue;
+            RenderCommandList commands;
+            NullRenderDevice device;
+            device.setRecording(false);
+            const int iterations = 100;
+
+            // Time recording and submitting a frame of 10000 objects, without a gpu
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                recordFrame(10000, batcher, queue, commands);
+                device.execute(commands);
+            }
+            const double frameMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+
+            Assert::AreEqual(10000 * iterations, device.stats().instances);
+            Logger::WriteMessage(("Recording and submitting 10000 objects: " + std::to_string(frameMs) + "ms per frame, " + std::to_string(device.stats().draws / iterations) + " draws, " + std::to_string(commands.commands().size()) + " commands\n").c_str());
+        }
+    };
+}
\ No newline at end of file
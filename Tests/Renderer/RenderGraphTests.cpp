@@ -0,0 +1,161 @@
+#include "CppUnitTest.h"
+
+#include "Renderer/NullRenderGraphBackend.h"
+#include "Renderer/RenderGraph.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(RenderGraphTests)
+    {
+    public:
+
+        TEST_METHOD(PassesWithUnusedResultsAreCulled)
+        {
+            RenderGraph graph;
+            const RenderGraphResource target = graph.importTexture("Target", nullptr);
+            const RenderGraphResource unused = graph.createTexture("Unused", { (TextureFormat)0, 64, 64 });
+            graph.markOutput(target);
+
+            const int drawPass = graph.addPass("Draw", [](const RenderGraph&) {});
+            graph.write(drawPass, target);
+
+            const int unusedPass = graph.addPass("Unused", [](const RenderGraph&) {});
+            graph.write(unusedPass, unused);
+
+            graph.compile();
+
+            Assert::IsFalse(graph.isPassCulled(drawPass));
+            Assert::IsTrue(graph.isPassCulled(unusedPass));
+            Assert::AreEqual(0, graph.physicalTextureCount());
+            Assert::AreEqual(-1, graph.physicalTextureIndex(unused));
+        }
+
+        TEST_METHOD(PassesFeedingKeptPassesAreKept)
+        {
+            RenderGraph graph;
+            const RenderGraphResource target = graph.importTexture("Target", nullptr);
+            const RenderGraphResource shadows = graph.importTexture("Shadows", nullptr);
+            const RenderGraphResource gbuffer = graph.createTexture("GBuffer", { (TextureFormat)0, 64, 64 });
+            graph.markOutput(target);
+
+            const int shadowPass = graph.addPass("Shadows", [](const RenderGraph&) {});
+            graph.write(shadowPass, shadows);
+
+            const int gbufferPass = graph.addPass("GBuffer", [](const RenderGraph&) {});
+            graph.write(gbufferPass, gbuffer);
+
+            const int lightingPass = graph.addPass("Lighting", [](const RenderGraph&) {});
+            graph.read(lightingPass, gbuffer);
+            graph.write(lightingPass, target);
+
+            graph.compile();
+
+            // Nothing reads the shadows, so they are not rendered
+            Assert::IsTrue(graph.isPassCulled(shadowPass));
+            Assert::IsFalse(graph.isPassCulled(gbufferPass));
+            Assert::IsFalse(graph.isPassCulled(lightingPass));
+        }
+
+        TEST_METHOD(TexturesWithSeparateLifetimesAreAliased)
+        {
+            RenderGraph graph;
+            const RenderGraphResource target = graph.importTexture("Target", nullptr);
+            const RenderGraphTextureDesc desc = { (TextureFormat)0, 128, 64 };
+            const RenderGraphResource first = graph.createTexture("First", desc);
+            const RenderGraphResource second = graph.createTexture("Second", desc);
+            graph.markOutput(target);
+
+            // Each eye writes and then reads its own texture
+            const RenderGraphResource resources[] = { first, second };
+            for (RenderGraphResource resource : resources)
+            {
+                const int writePass = graph.addPass("Write", [](const RenderGraph&) {});
+                graph.write(writePass, resource);
+
+                const int readPass = graph.addPass("Read", [](const RenderGraph&) {});
+                graph.read(readPass, resource);
+                graph.write(readPass, target);
+            }
+
+            graph.compile();
+
+            Assert::AreEqual(1, graph.physicalTextureCount());
+            Assert::AreEqual(graph.physicalTextureIndex(first), graph.physicalTextureIndex(second));
+        }
+
+        TEST_METHOD(OverlappingOrDifferentTexturesAreNotAliased)
+        {
+            RenderGraph graph;
+            const RenderGraphResource target = graph.importTexture("Target", nullptr);
+            const RenderGraphResource a = graph.createTexture("A", { (TextureFormat)0, 64, 64 });
+            const RenderGraphResource b = graph.createTexture("B", { (TextureFormat)0, 64, 64 });
+            const RenderGraphResource c = graph.createTexture("C", { (TextureFormat)1, 64, 64 });
+            graph.markOutput(target);
+
+            // A and B are alive at the same time
+            const int writePass = graph.addPass("Write", [](const RenderGraph&) {});
+            graph.write(writePass, a);
+            graph.write(writePass, b);
+
+            const int readPass = graph.addPass("Read", [](const RenderGraph&) {});
+            graph.read(readPass, a);
+            graph.read(readPass, b);
+            graph.write(readPass, target);
+
+            // C starts after A and B end, but has a different format
+            const int laterPass = graph.addPass("Later", [](const RenderGraph&) {});
+            graph.write(laterPass, c);
+
+            const int finalPass = graph.addPass("Final", [](const RenderGraph&) {});
+            graph.read(finalPass, c);
+            graph.write(finalPass, target);
+
+            graph.compile();
+
+            Assert::AreEqual(3, graph.physicalTextureCount());
+            Assert::IsTrue(graph.physicalTextureIndex(a) != graph.physicalTextureIndex(b));
+            Assert::IsTrue(graph.physicalTextureIndex(a) != graph.physicalTextureIndex(c));
+        }
+
+        TEST_METHOD(ExecuteRunsKeptPassesInOrder)
+        {
+            RenderGraph graph;
+            const RenderGraphResource target = graph.importTexture("Target", nullptr);
+            const RenderGraphResource gbuffer = graph.createTexture("GBuffer", { (TextureFormat)0, 64, 64 });
+            graph.markOutput(target);
+
+            std::vector<int> order;
+            Texture* gbufferTexture = nullptr;
+
+            const int gbufferPass = graph.addPass("GBuffer", [&](const RenderGraph &g)
+            {
+                order.push_back(0);
+                gbufferTexture = g.texture(gbuffer);
+            });
+            graph.write(gbufferPass, gbuffer);
+
+            const int culledPass = graph.addPass("Culled", [&](const RenderGraph&) { order.push_back(1); });
+            graph.read(culledPass, gbuffer);
+
+            const int lightingPass = graph.addPass("Lighting", [&](const RenderGraph&) { order.push_back(2); });
+            graph.read(lightingPass, gbuffer);
+            graph.write(lightingPass, target);
+
+            graph.compile();
+
+            NullRenderGraphBackend backend;
+            graph.execute(backend);
+
+            Assert::AreEqual(2, (int)order.size());
+            Assert::AreEqual(0, order[0]);
+            Assert::AreEqual(2, order[1]);
+            Assert::IsTrue(gbufferTexture != nullptr);
+
+            // Every texture is returned once the graph has run
+            Assert::AreEqual(1, backend.acquiredCount());
+            Assert::AreEqual(1, backend.releasedCount());
+        }
+    };
+}
\ No newline at end of file
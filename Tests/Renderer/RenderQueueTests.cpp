@@ -0,0 +1,150 @@
+#include "CppUnitTest.h"
+
+#include <cstdint>
+
+#include "Renderer/RenderQueue.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(RenderQueueTests)
+    {
+        // The queue never dereferences its resources, so tests can use fake pointers.
+        template <typename T>
+        static T* fake(uintptr_t id)
+        {
+            return reinterpret_cast<T*>(id * 16);
+        }
+
+        // Records the calls made while executing a queue
+        struct RecordingExecutor
+        {
+            std::vector<const RenderQueueItem*> draws;
+            int shaderBinds = 0;
+            int materialBinds = 0;
+            int meshBinds = 0;
+
+            void bindShader(const RenderQueueItem&) { shaderBinds++; }
+            void bindMaterial(const RenderQueueItem&) { materialBinds++; }
+            void bindMesh(const RenderQueueItem&) { meshBinds++; }
+            void draw(const RenderQueueItem &item) { draws.push_back(&item); }
+        };
+
+        // Submits every combination of 2 variants, 3 materials and 4 meshes, interleaved
+        static void submitInterleaved(RenderQueue &queue)
+        {
+            for (int i = 0; i < 2 * 3 * 4 * 5; ++i)
+            {
+                queue.submit(RenderQueuePass::Geometry, fake<Shader>(1), i % 2, fake<Material>(1 + i % 3), fake<Mesh>(1 + i % 4), Matrix4x4::identity(), (float)(200 - i));
+            }
+        }
+
+    public:
+
+        TEST_METHOD(SortKeyPriority)
+        {
+            // Each part of the key outweighs every part after it
+            const uint64_t key = RenderQueue::makeSortKey(RenderQueuePass::Geometry, 1, 1, 1, 1.0f);
+            Assert::IsTrue(RenderQueue::makeSortKey(RenderQueuePass::ShadowCascade, 100, 100, 100, 1000.0f) < key);
+            Assert::IsTrue(RenderQueue::makeSortKey(RenderQueuePass::Geometry, 0, 100, 100, 1000.0f) < key);
+            Assert::IsTrue(RenderQueue::makeSortKey(RenderQueuePass::Geometry, 1, 0, 100, 1000.0f) < key);
+            Assert::IsTrue(RenderQueue::makeSortKey(RenderQueuePass::Geometry, 1, 1, 0, 1000.0f) < key);
+            Assert::IsTrue(RenderQueue::makeSortKey(RenderQueuePass::Geometry, 1, 1, 1, 0.5f) < key);
+
+            // Ids that are too large for the key are masked, rather than spilling into other parts
+            Assert::AreEqual(RenderQueue::makeSortKey(RenderQueuePass::Geometry, 1, 1, 0, 1.0f), RenderQueue::makeSortKey(RenderQueuePass::Geometry, 1, 1, 1 << RenderQueue::MESH_BITS, 1.0f));
+        }
+
+        TEST_METHOD(QuantisedDepthOrder)
+        {
+            Assert::AreEqual((int)RenderQueue::quantiseDepth(0.0f), (int)RenderQueue::quantiseDepth(-5.0f));
+
+            uint16_t previous = RenderQueue::quantiseDepth(0.0f);
+            for (float depth = 0.01f; depth < 10000.0f; depth *= 1.1f)
+            {
+                const uint16_t quantised = RenderQueue::quantiseDepth(depth);
+                Assert::IsTrue(quantised > previous);
+                previous = quantised;
+            }
+        }
+
+        TEST_METHOD(SortingMinimisesStateChanges)
+        {
+            RenderQueue queue;
+            submitInterleaved(queue);
+
+            // Unsorted, nearly every draw changes state
+            RecordingExecutor unsorted;
+            const RenderQueueStats unsortedStats = queue.execute(unsorted);
+            Assert::AreEqual(120, unsortedStats.draws);
+            Assert::AreEqual(120, unsortedStats.shaderBinds);
+
+            // Sorted, each variant is bound once, each material once per variant, and each mesh once per material
+            queue.sort();
+            RecordingExecutor sorted;
+            const RenderQueueStats stats = queue.execute(sorted);
+            Assert::AreEqual(120, stats.draws);
+            Assert::AreEqual(120, stats.instances);
+            Assert::AreEqual(2, stats.shaderBinds);
+            Assert::AreEqual(2, sorted.shaderBinds);
+            Assert::AreEqual(6, stats.materialChanges);
+            Assert::AreEqual(6, sorted.materialBinds);
+            Assert::AreEqual(12, stats.meshBinds);
+            Assert::AreEqual(12, sorted.meshBinds);
+            Assert::AreEqual((size_t)120, sorted.draws.size());
+        }
+
+        TEST_METHOD(FrontToBackWithinState)
+        {
+            RenderQueue queue;
+            submitInterleaved(queue);
+            queue.sort();
+
+            // Items sharing all of their state are drawn in order of increasing depth.
+            // Depth was submitted as decreasing, so later submissions come first.
+            const std::vector<RenderQueueItem>& items = queue.items();
+            for (unsigned int i = 1; i < items.size(); ++i)
+            {
+                Assert::IsTrue(items[i - 1].sortKey <= items[i].sortKey);
+                if (items[i - 1].shaderFeatures == items[i].shaderFeatures && items[i - 1].material == items[i].material && items[i - 1].mesh == items[i].mesh)
+                {
+                    Assert::IsTrue((items[i - 1].sortKey & 0xffff) < (items[i].sortKey & 0xffff));
+                }
+            }
+        }
+
+        TEST_METHOD(PassesAreOrdered)
+        {
+            RenderQueue queue;
+            queue.submit(RenderQueuePass::Geometry, fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(1), Matrix4x4::identity(), 1.0f);
+            queue.submitInstanced(RenderQueuePass::ShadowCascade, fake<Shader>(2), 0, fake<Material>(2), fake<Mesh>(2), 10, 20, 5.0f);
+            queue.sort();
+
+            Assert::IsTrue(queue.items()[0].shader == fake<Shader>(2));
+            Assert::AreEqual(10, queue.items()[0].firstInstance);
+            Assert::AreEqual(20, queue.items()[0].instanceCount);
+            Assert::AreEqual(0, queue.items()[1].instanceCount);
+
+            RecordingExecutor executor;
+            Assert::AreEqual(21, queue.execute(executor).instances);
+        }
+
+        TEST_METHOD(StableIDsBetweenFrames)
+        {
+            // Submitting in a different order on the next frame gives the same sorted order
+            RenderQueue queue;
+            queue.submit(RenderQueuePass::Geometry, fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(1), Matrix4x4::identity(), 1.0f);
+            queue.submit(RenderQueuePass::Geometry, fake<Shader>(1), 0, fake<Material>(2), fake<Mesh>(1), Matrix4x4::identity(), 1.0f);
+            queue.sort();
+            const Material* first = queue.items()[0].material;
+
+            queue.clear();
+            Assert::AreEqual((size_t)0, queue.items().size());
+            queue.submit(RenderQueuePass::Geometry, fake<Shader>(1), 0, fake<Material>(2), fake<Mesh>(1), Matrix4x4::identity(), 1.0f);
+            queue.submit(RenderQueuePass::Geometry, fake<Shader>(1), 0, fake<Material>(1), fake<Mesh>(1), Matrix4x4::identity(), 1.0f);
+            queue.sort();
+            Assert::IsTrue(queue.items()[0].material == first);
+        }
+    };
+}
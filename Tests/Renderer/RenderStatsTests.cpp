@@ -0,0 +1,114 @@
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include "Renderer/RenderStats.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(RenderStatsTests)
+    {
+        // Adds a pass with a gpu timing to a frame
+        static void addPass(RenderFrameStats &frame, const std::string &name, int view, int draws, int gpuTiming)
+        {
+            RenderPassStats pass;
+            pass.name = name;
+            pass.view = view;
+            pass.counters.draws = draws;
+            pass.counters.triangles = draws * 100;
+            pass.cpuMilliseconds = 0.5f;
+            pass.gpuMilliseconds = -1.0f;
+            pass.gpuTiming = gpuTiming;
+            frame.passes.push_back(pass);
+        }
+
+    public:
+
+        TEST_METHOD(GpuTimingsCompleteFrames)
+        {
+            RenderStatsHistory history(4);
+            RenderFrameStats& first = history.beginFrame(1, 0);
+            addPass(first, "Shadows", -1, 10, 0);
+            addPass(first, "GBuffer", 0, 20, 1);
+            history.beginFrame(2, 0);
+
+            // Nothing is complete until the timings arrive
+            Assert::IsTrue(history.latest() == nullptr);
+            Assert::AreEqual(0, (int)history.completed().size());
+
+            history.setGpuTimings(1, { 1.5f, 2.5f });
+            Assert::AreEqual(1, (int)history.completed().size());
+            Assert::IsTrue(history.latest() != nullptr);
+            Assert::AreEqual((uint64_t)1, history.latest()->frame);
+            Assert::AreEqual(1.5f, history.latest()->passes[0].gpuMilliseconds);
+            Assert::AreEqual(2.5f, history.latest()->passes[1].gpuMilliseconds);
+            Assert::AreEqual(4.0f, history.latest()->gpuMilliseconds());
+            Assert::AreEqual(1.0f, history.latest()->cpuMilliseconds());
+            Assert::AreEqual(30, history.latest()->total().draws);
+
+            history.clearCompleted();
+            Assert::AreEqual(0, (int)history.completed().size());
+        }
+
+        TEST_METHOD(LateFramesCompleteInOrder)
+        {
+            RenderStatsHistory history(4);
+            for (uint64_t frame = 1; frame <= 5; ++frame)
+            {
+                addPass(history.beginFrame(frame, 0), "GBuffer", 0, 1, 0);
+            }
+
+            // Frames are waited for until they are 4 frames old
+            Assert::AreEqual(0, (int)history.completed().size());
+            addPass(history.beginFrame(6, 0), "GBuffer", 0, 1, 0);
+            Assert::AreEqual(1, (int)history.completed().size());
+            Assert::AreEqual(-1.0f, history.completed()[0].passes[0].gpuMilliseconds);
+
+            // Timings for a later frame complete the frames before it, without their timings
+            history.setGpuTimings(4, { 3.0f });
+            Assert::AreEqual(4, (int)history.completed().size());
+            Assert::AreEqual((uint64_t)2, history.completed()[1].frame);
+            Assert::AreEqual(-1.0f, history.completed()[2].passes[0].gpuMilliseconds);
+            Assert::AreEqual(3.0f, history.completed()[3].passes[0].gpuMilliseconds);
+
+            // Timings for frames that were already completed are ignored
+            history.setGpuTimings(1, { 3.0f });
+            Assert::AreEqual(4, (int)history.completed().size());
+        }
+
+        TEST_METHOD(FramesAreWrittenAsCsvAndJson)
+        {
+            RenderFrameStats frame;
+            frame.frame = 7;
+            frame.renderer = 1;
+            addPass(frame, "Shadows", -1, 10, 0);
+            addPass(frame, "Lighting", 0, 1, 1);
+            frame.passes[0].gpuMilliseconds = 0.25f;
+
+            // Csv has a line per pass, with the same columns as the header
+            std::ostringstream csv;
+            RenderFrameStats::writeCsvHeader(csv);
+            frame.writeCsv(csv);
+            std::istringstream lines(csv.str());
+            std::string header, shadows, lighting;
+            std::getline(lines, header);
+            std::getline(lines, shadows);
+            std::getline(lines, lighting);
+            Assert::AreEqual(std::string("7,1,Shadows,-1,10,0,1000,0,0,0,0,0.5,0.25"), shadows);
+            Assert::AreEqual(std::count(header.begin(), header.end(), ','), std::count(lighting.begin(), lighting.end(), ','));
+
+            // Json has a single line per frame
+            std::ostringstream json;
+            frame.writeJson(json);
+            const std::string text = json.str();
+            Assert::AreEqual((size_t)1, (size_t)std::count(text.begin(), text.end(), '\n'));
+            Assert::IsTrue(text.find("{\"frame\":7,\"renderer\":1,\"passes\":[{\"name\":\"Shadows\",\"view\":-1,\"draws\":10") == 0);
+            Assert::IsTrue(text.find("\"name\":\"Lighting\"") != std::string::npos);
+            Assert::IsTrue(text.find("\"gpuMs\":-1}]}") != std::string::npos);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "CppUnitTest.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "Renderer/ShaderBinaryCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(ShaderBinaryCacheTests)
+    {
+        static ProgramBinary makeBinary(uint32_t format, int size)
+        {
+            ProgramBinary binary;
+            binary.format = format;
+            for (int i = 0; i < size; ++i)
+            {
+                binary.data.push_back((unsigned char)(i * 7));
+            }
+
+            return binary;
+        }
+
+    public:
+
+        TEST_METHOD(KeyDependsOnSourceFeaturesAndDriver)
+        {
+            const ShaderBinaryCache cache("ShaderBinaryCacheTests", "vendor|gpu|1.0");
+            const ShaderBinaryCache otherDriver("ShaderBinaryCacheTests", "vendor|gpu|1.1");
+            const std::vector<std::string> sources = { "vertex", "fragment" };
+
+            const uint64_t key = cache.makeKey(sources, 5);
+            Assert::IsTrue(key == cache.makeKey(sources, 5));
+            Assert::IsTrue(key != cache.makeKey(sources, 6));
+            Assert::IsTrue(key != cache.makeKey({ "vertex", "fragment2" }, 5));
+            Assert::IsTrue(key != cache.makeKey({ "vertexf", "ragment" }, 5));
+            Assert::IsTrue(key != otherDriver.makeKey(sources, 5));
+        }
+
+        TEST_METHOD(SavedBinaryIsLoaded)
+        {
+            ShaderBinaryCache cache("ShaderBinaryCacheTests", "driver");
+            const uint64_t key = cache.makeKey({ "saved" }, 1);
+            const ProgramBinary saved = makeBinary(0x1234, 100);
+            Assert::IsTrue(cache.save(key, saved));
+
+            ProgramBinary loaded;
+            Assert::IsTrue(cache.load(key, loaded));
+            Assert::AreEqual(0x1234u, loaded.format);
+            Assert::IsTrue(saved.data == loaded.data);
+            Assert::AreEqual(1, cache.hits());
+
+            // Removed binaries are no longer found
+            cache.remove(key);
+            Assert::IsFalse(cache.load(key, loaded));
+            Assert::AreEqual(1, cache.misses());
+        }
+
+        TEST_METHOD(TruncatedFileIsIgnored)
+        {
+            ShaderBinaryCache cache("ShaderBinaryCacheTests", "driver");
+            const uint64_t key = cache.makeKey({ "truncated" }, 1);
+            Assert::IsTrue(cache.save(key, makeBinary(1, 64)));
+
+            // Cut the file short, as if writing it was interrupted
+            std::vector<char> contents(40);
+            {
+                std::ifstream file(cache.pathForKey(key), std::ifstream::binary);
+                file.read(contents.data(), contents.size());
+            }
+            {
+                std::ofstream file(cache.pathForKey(key), std::ofstream::binary | std::ofstream::trunc);
+                file.write(contents.data(), contents.size());
+            }
+
+            ProgramBinary loaded;
+            Assert::IsFalse(cache.load(key, loaded));
+            cache.remove(key);
+        }
+
+        TEST_METHOD(DisabledCacheNeverStores)
+        {
+            ShaderBinaryCache cache("ShaderBinaryCacheTests", "driver");
+            cache.setEnabled(false);
+            const uint64_t key = cache.makeKey({ "disabled" }, 1);
+            Assert::IsFalse(cache.save(key, makeBinary(1, 16)));
+
+            cache.setEnabled(true);
+            ProgramBinary loaded;
+            Assert::IsFalse(cache.load(key, loaded));
+        }
+    };
+}
\ No newline at end of file
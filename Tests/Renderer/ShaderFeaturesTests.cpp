@@ -0,0 +1,32 @@
+#include "CppUnitTest.h"
+
+#include "Renderer/ShaderFeatures.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(ShaderFeaturesTests)
+    {
+    public:
+
+        TEST_METHOD(CameraPassesNeverUseDepthOnlyVariants)
+        {
+            // The camera gbuffer pass draws the terrain with every feature, and must get its colour outputs
+            Assert::AreEqual(0u, ALL_SHADER_FEATURES & SF_DepthOnly);
+
+            // The other pass features are chosen per draw, and never come from asking for every feature
+            Assert::AreEqual(0u, ALL_SHADER_FEATURES & SF_Instancing);
+            Assert::AreEqual(0u, ALL_SHADER_FEATURES & SF_InstancedMaterials);
+        }
+
+        TEST_METHOD(AllFeaturesIncludeEveryUserFeature)
+        {
+            const ShaderFeatureList userFeatures = SF_Texture | SF_NormalMap | SF_Specular | SF_Cutout | SF_Fog
+                | SF_HighTessellation | SF_Shadows | SF_SoftShadows | SF_ShadowCascadeBlending | SF_TerrainDetailMeshes
+                | SF_ExtraTerrainDetails | SF_Translucency | SF_AmbientOcclusion | SF_Sky;
+            Assert::AreEqual(userFeatures, ALL_SHADER_FEATURES & userFeatures);
+            Assert::AreEqual(0u, userFeatures & PASS_SHADER_FEATURES);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "CppUnitTest.h"
+
+#include "Math/Matrix4x4.h"
+#include "Math/Quaternion.h"
+#include "Math/Vector3.h"
+#include "Renderer/ShadowCascadeCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(ShadowCascadeCacheTests)
+    {
+        // Updates every cascade with the same camera and signature, and returns a bitmask of the rendered cascades
+        static int updateAll(ShadowCascadeCache &cache, int cascadeCount, const Matrix4x4 &worldToShadow, uint64_t signature)
+        {
+            cache.beginFrame();
+
+            int rendered = 0;
+            for (int i = 0; i < cascadeCount; ++i)
+            {
+                if (cache.update(i, worldToShadow, signature))
+                {
+                    rendered |= (1 << i);
+                }
+            }
+
+            return rendered;
+        }
+
+        // Gets the view space corners of a frustum slice, for a 60 degree 16:9 view
+        static void sliceCorners(float minDistance, float maxDistance, Point3 corners[8])
+        {
+            const float distances[2] = { minDistance, maxDistance };
+            for (int i = 0; i < 2; ++i)
+            {
+                const float halfHeight = distances[i] * tanf(3.14159265f / 6.0f);
+                const float halfWidth = halfHeight * 16.0f / 9.0f;
+                corners[i * 4 + 0] = Point3(-halfWidth, -halfHeight, -distances[i]);
+                corners[i * 4 + 1] = Point3(halfWidth, -halfHeight, -distances[i]);
+                corners[i * 4 + 2] = Point3(-halfWidth, halfHeight, -distances[i]);
+                corners[i * 4 + 3] = Point3(halfWidth, halfHeight, -distances[i]);
+            }
+        }
+
+        // Builds the world to shadow matrix for a placement, with the sun looking down -z
+        static Matrix4x4 worldToShadow(const ShadowCascadePlacement &placement)
+        {
+            const float halfSize = placement.size * 0.5f;
+            return Matrix4x4::orthographic(-halfSize, halfSize, -halfSize, halfSize, -2000.0f, 2000.0f)
+                * Matrix4x4::translation(Point3::origin() - placement.centre);
+        }
+
+        // Checks that the slice of a view is inside the cascade, as seen from the sun
+        static bool covers(const ShadowCascadePlacement &placement, const Point3 &viewPosition, const Quaternion &viewRotation, const Point3 corners[8])
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                const Point3 corner = viewPosition + viewRotation * (corners[i] - Point3::origin());
+                if (fabsf(corner.x - placement.centre.x) > placement.size * 0.5f ||
+                    fabsf(corner.y - placement.centre.y) > placement.size * 0.5f)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+    public:
+
+        TEST_METHOD(StaticSceneSkipsCachedCascades)
+        {
+            ShadowCascadeCache cache(4, 2);
+            cache.setRefreshInterval(0);
+            const Matrix4x4 camera = Matrix4x4::identity();
+
+            // The first frame renders everything, and later frames only render the uncached cascades
+            Assert::AreEqual(0xf, updateAll(cache, 4, camera, 1));
+            for (int frame = 0; frame < 10; ++frame)
+            {
+                Assert::AreEqual(0x3, updateAll(cache, 4, camera, 1));
+            }
+
+            Assert::AreEqual(11, cache.stats(0).renders);
+            Assert::AreEqual(1, cache.stats(3).renders);
+            Assert::AreEqual(10, cache.stats(3).skips);
+            Assert::AreEqual(10, cache.stats(3).framesSinceRender);
+            Assert::IsTrue(cache.stats(3).lastUpdate == ShadowCascadeUpdate::Skipped);
+        }
+
+        TEST_METHOD(MovedCascadesIgnoreBudget)
+        {
+            ShadowCascadeCache cache(4, 2);
+            cache.setRefreshInterval(0);
+            cache.setRenderBudget(0);
+            updateAll(cache, 4, Matrix4x4::identity(), 1);
+
+            // Moving the camera invalidates the contents, so every cascade renders
+            const Matrix4x4 moved = Matrix4x4::translation(Vector3(1.0f, 0.0f, 0.0f));
+            Assert::AreEqual(0xf, updateAll(cache, 4, moved, 1));
+            Assert::IsTrue(cache.stats(2).lastUpdate == ShadowCascadeUpdate::Moved);
+            Assert::AreEqual(0x3, updateAll(cache, 4, moved, 1));
+        }
+
+        TEST_METHOD(CasterChangesAreBudgeted)
+        {
+            ShadowCascadeCache cache(4, 2);
+            cache.setRefreshInterval(0);
+            cache.setRenderBudget(1);
+            const Matrix4x4 camera = Matrix4x4::identity();
+            updateAll(cache, 4, camera, 1);
+
+            // Both cached cascades see a change, but only one fits in the budget each frame
+            Assert::AreEqual(0x7, updateAll(cache, 4, camera, 2));
+            Assert::IsTrue(cache.stats(2).lastUpdate == ShadowCascadeUpdate::CastersChanged);
+            Assert::AreEqual(0xb, updateAll(cache, 4, camera, 2));
+            Assert::IsTrue(cache.stats(3).lastUpdate == ShadowCascadeUpdate::CastersChanged);
+            Assert::AreEqual(0x3, updateAll(cache, 4, camera, 2));
+        }
+
+        TEST_METHOD(RoundRobinRefresh)
+        {
+            ShadowCascadeCache cache(4, 2);
+            cache.setRefreshInterval(5);
+            const Matrix4x4 camera = Matrix4x4::identity();
+            updateAll(cache, 4, camera, 1);
+
+            // Every 5th frame refreshes the next cached cascade in turn
+            int refreshes[4] = { 0, 0, 0, 0 };
+            for (int frame = 2; frame <= 20; ++frame)
+            {
+                const int rendered = updateAll(cache, 4, camera, 1);
+                const int expected = (frame % 5 != 0) ? 0x3 : (0x3 | (1 << (2 + (frame / 5 - 1) % 2)));
+                Assert::AreEqual(expected, rendered);
+
+                for (int i = 0; i < 4; ++i)
+                {
+                    refreshes[i] += (cache.stats(i).lastUpdate == ShadowCascadeUpdate::Refresh) ? 1 : 0;
+                }
+            }
+
+            Assert::AreEqual(0, refreshes[1]);
+            Assert::AreEqual(2, refreshes[2]);
+            Assert::AreEqual(2, refreshes[3]);
+        }
+
+        TEST_METHOD(DisabledRendersEveryCascade)
+        {
+            ShadowCascadeCache cache(4, 2);
+            const Matrix4x4 camera = Matrix4x4::identity();
+            updateAll(cache, 4, camera, 1);
+
+            cache.setEnabled(false);
+            Assert::AreEqual(0xf, updateAll(cache, 4, camera, 1));
+            Assert::IsTrue(cache.stats(3).lastUpdate == ShadowCascadeUpdate::Uncached);
+
+            // Turning caching back on renders the cached cascades once more
+            cache.setEnabled(true);
+            Assert::AreEqual(0xf, updateAll(cache, 4, camera, 1));
+            Assert::IsTrue(cache.stats(3).lastUpdate == ShadowCascadeUpdate::FirstRender);
+        }
+
+        TEST_METHOD(InvalidatingOneCascadeOnlyRendersThatCascade)
+        {
+            ShadowCascadeCache cache(4, 2);
+            cache.setRefreshInterval(0);
+            const Matrix4x4 camera = Matrix4x4::identity();
+            updateAll(cache, 4, camera, 1);
+
+            // Another renderer drew over cascade 3 in the shared atlas
+            cache.invalidate(3);
+            Assert::AreEqual(0xb, updateAll(cache, 4, camera, 1));
+            Assert::IsTrue(cache.stats(2).lastUpdate == ShadowCascadeUpdate::Skipped);
+            Assert::IsTrue(cache.stats(3).lastUpdate == ShadowCascadeUpdate::FirstRender);
+
+            // Its contents are valid again afterwards
+            Assert::AreEqual(0x3, updateAll(cache, 4, camera, 1));
+        }
+
+        TEST_METHOD(RotatingTheViewSkipsCachedCascades)
+        {
+            ShadowCascadeCache cache(4, 2);
+            cache.setRefreshInterval(0);
+
+            Point3 corners[8];
+            sliceCorners(150.0f, 300.0f, corners);
+            const Point3 viewPosition(13.0f, 2.0f, -7.0f);
+
+            // Turn the view all the way around, and tilt it up and down
+            for (int frame = 0; frame < 24; ++frame)
+            {
+                const Quaternion rotation = Quaternion::rotation(frame * 15.0f, Vector3(0.0f, 1.0f, 0.0f))
+                    * Quaternion::rotation(sinf((float)frame) * 30.0f, Vector3(1.0f, 0.0f, 0.0f));
+                const ShadowCascadePlacement placement = ShadowCascadeCache::placeCachedCascade(viewPosition, corners, 8);
+                Assert::IsTrue(covers(placement, viewPosition, rotation, corners));
+
+                // Only the first frame renders the cached cascades
+                const int rendered = updateAll(cache, 4, worldToShadow(placement), 1);
+                Assert::AreEqual(frame == 0 ? 0xf : 0x3, rendered);
+            }
+        }
+
+        TEST_METHOD(CachedCascadesMoveWithTheGrid)
+        {
+            ShadowCascadeCache cache(4, 2);
+            cache.setRefreshInterval(0);
+
+            Point3 corners[8];
+            sliceCorners(150.0f, 300.0f, corners);
+            const ShadowCascadePlacement start = ShadowCascadeCache::placeCachedCascade(Point3::origin(), corners, 8);
+            const float step = start.size / (ShadowCascadeCache::SNAP_DIVISIONS + 2);
+            updateAll(cache, 4, worldToShadow(start), 1);
+
+            // Moving within a grid cell keeps the cascade where it is
+            const Point3 nearby(step * 0.4f, -step * 0.4f, step * 0.4f);
+            const ShadowCascadePlacement moved = ShadowCascadeCache::placeCachedCascade(nearby, corners, 8);
+            Assert::IsTrue(moved.centre == start.centre);
+            Assert::IsTrue(covers(moved, nearby, Quaternion::identity(), corners));
+            Assert::AreEqual(0x3, updateAll(cache, 4, worldToShadow(moved), 1));
+
+            // Moving into the next cell moves the cascade, while still covering the slice
+            const Point3 distant(step * 0.6f, 0.0f, 0.0f);
+            const ShadowCascadePlacement crossed = ShadowCascadeCache::placeCachedCascade(distant, corners, 8);
+            Assert::IsTrue(covers(crossed, distant, Quaternion::rotation(60.0f, Vector3(0.0f, 1.0f, 0.0f)), corners));
+            Assert::AreEqual(0xf, updateAll(cache, 4, worldToShadow(crossed), 1));
+            Assert::IsTrue(cache.stats(2).lastUpdate == ShadowCascadeUpdate::Moved);
+        }
+
+        TEST_METHOD(SignatureDependsOnOrderAndValue)
+        {
+            const uint64_t ab = ShadowCascadeCache::combineSignature(ShadowCascadeCache::combineSignature(ShadowCascadeCache::EMPTY_SIGNATURE, 1), 2);
+            const uint64_t ba = ShadowCascadeCache::combineSignature(ShadowCascadeCache::combineSignature(ShadowCascadeCache::EMPTY_SIGNATURE, 2), 1);
+            const uint64_t ac = ShadowCascadeCache::combineSignature(ShadowCascadeCache::combineSignature(ShadowCascadeCache::EMPTY_SIGNATURE, 1), 3);
+            Assert::IsTrue(ab != ba);
+            Assert::IsTrue(ab != ac);
+            Assert::IsTrue(ShadowCascadeCache::combineSignature(ShadowCascadeCache::EMPTY_SIGNATURE, 0) != ShadowCascadeCache::EMPTY_SIGNATURE);
+        }
+    };
+}
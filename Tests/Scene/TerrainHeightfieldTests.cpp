@@ -0,0 +1,136 @@
+#include "CppUnitTest.h"
+
+#include <algorithm>
+
+#include "Scene/TerrainHeightfield.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(TerrainHeightfieldTests)
+    {
+        // Builds a sloped heightfield with the given number of tiles per side
+        static void build(TerrainHeightfield &heightfield, int tilesPerSide)
+        {
+            const int resolution = tilesPerSide * TerrainHeightfield::TILE_RESOLUTION;
+            std::vector<float> heights(resolution * resolution);
+            for (int z = 0; z < resolution; ++z)
+            {
+                for (int x = 0; x < resolution; ++x)
+                {
+                    heights[x + z * resolution] = (float)(x + z);
+                }
+            }
+
+            heightfield.build(heights, resolution, 1.0f, 1.0f);
+        }
+
+    public:
+
+        TEST_METHOD(StationaryCameraCausesNoEvictions)
+        {
+            TerrainHeightfield heightfield;
+            heightfield.setResidentTileBudget(9);
+            build(heightfield, 5);
+
+            // Ask for more tiles than the budget holds
+            const float centre = 2.5f * TerrainHeightfield::TILE_RESOLUTION;
+            const float radius = 2.0f * TerrainHeightfield::TILE_RESOLUTION;
+            heightfield.updateResidency(centre, centre, radius);
+            const int evictions = heightfield.pageOutCount();
+
+            // Later updates from the same place must not page anything out
+            for (int frame = 0; frame < 10; ++frame)
+            {
+                heightfield.updateResidency(centre, centre, radius);
+            }
+
+            Assert::AreEqual(evictions, heightfield.pageOutCount());
+            Assert::AreEqual(9, heightfield.residentTileCount());
+        }
+
+        TEST_METHOD(ResidencyRadiusFitsTheBudget)
+        {
+            TerrainHeightfield heightfield;
+
+            // A budget of 289 holds a 17x17 square, which is 8 tiles each side of the centre
+            heightfield.setResidentTileBudget(289);
+            Assert::AreEqual(8.0f * TerrainHeightfield::TILE_RESOLUTION, heightfield.maxResidencyRadius());
+
+            // One less tile than that only holds a 15x15 square
+            heightfield.setResidentTileBudget(288);
+            Assert::AreEqual(7.0f * TerrainHeightfield::TILE_RESOLUTION, heightfield.maxResidencyRadius());
+        }
+
+        TEST_METHOD(BuildingFromRowsOnlyHoldsABandAndTheBudget)
+        {
+            TerrainHeightfield heightfield;
+            heightfield.setResidentTileBudget(4);
+
+            // Generate the same slope as build(), recording the largest band and resident tile count
+            const int resolution = 4 * TerrainHeightfield::TILE_RESOLUTION;
+            int largestBand = 0;
+            int mostResidentTiles = 0;
+            heightfield.build(resolution, 1.0f, 1.0f, [&](int firstRow, int rowCount, float* heights)
+            {
+                largestBand = std::max(largestBand, rowCount);
+                mostResidentTiles = std::max(mostResidentTiles, heightfield.residentTileCount());
+                for (int z = firstRow; z < firstRow + rowCount; ++z)
+                {
+                    for (int x = 0; x < resolution; ++x)
+                    {
+                        heights[x + (z - firstRow) * resolution] = (float)(x + z);
+                    }
+                }
+            });
+
+            // Each band covers one row of tiles, its shared edge and the rows either side for the normals
+            Assert::IsTrue(largestBand <= TerrainHeightfield::TILE_STRIDE + 2);
+            Assert::IsTrue(mostResidentTiles <= 4);
+            Assert::IsTrue(heightfield.residentTileCount() <= 4);
+
+            // Every texel still reads back, paging tiles in as needed
+            for (int z = 0; z < resolution; z += 97)
+            {
+                for (int x = 0; x < resolution; x += 89)
+                {
+                    Assert::AreEqual((float)(x + z), heightfield.texel(x, z));
+                }
+            }
+        }
+
+        TEST_METHOD(SlopeMatchesTheTangentCrossBitangent)
+        {
+            // The slope limits were tuned against the cross product of the unit tangent and bitangent
+            const float gradients[3][2] = { { 0.0f, 0.0f }, { 0.7f, -1.3f }, { 2.0f, 2.0f } };
+            for (const float* gradient : gradients)
+            {
+                const Vector3 tangent = Vector3(1.0f, gradient[0], 0.0f).normalized();
+                const Vector3 bitangent = Vector3(0.0f, gradient[1], 1.0f).normalized();
+                const Vector3 normal = Vector3(-gradient[0], 1.0f, -gradient[1]).normalized();
+                Assert::AreEqual(Vector3::cross(bitangent, tangent).y, TerrainHeightfield::slopeNormalY(normal), 0.0001f);
+            }
+
+            // The stored normals give the same slope, with gradients of 2 in x and z
+            TerrainHeightfield heightfield;
+            build(heightfield, 2);
+            Assert::AreEqual(0.2f, TerrainHeightfield::slopeNormalY(heightfield.texelNormal(100, 100)), 0.001f);
+        }
+
+        TEST_METHOD(ResidentTilesStayWithinTheBudget)
+        {
+            TerrainHeightfield heightfield;
+            heightfield.setResidentTileBudget(4);
+            build(heightfield, 4);
+
+            // Move the centre across the heightfield, touching tiles as it goes
+            for (int step = 0; step < 16; ++step)
+            {
+                const float position = step * 0.25f * TerrainHeightfield::TILE_RESOLUTION;
+                heightfield.updateResidency(position, position, 3.0f * TerrainHeightfield::TILE_RESOLUTION);
+                Assert::IsTrue(heightfield.residentTileCount() <= heightfield.residentTileBudget());
+            }
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "CppUnitTest.h"
+
+#include <atomic>
+#include <vector>
+
+#include "Utils/WorkerPool.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace EngineTests
+{
+    TEST_CLASS(WorkerPoolTests)
+    {
+    public:
+
+        TEST_METHOD(EveryTaskRunsOnce)
+        {
+            WorkerPool pool(3);
+            std::vector<std::atomic<int>> runs(100);
+            for (std::atomic<int>& count : runs)
+            {
+                count = 0;
+            }
+
+            pool.run((int)runs.size(), [&](int i) { runs[i]++; });
+
+            for (const std::atomic<int>& count : runs)
+            {
+                Assert::AreEqual(1, count.load());
+            }
+        }
+
+        TEST_METHOD(PoolCanBeReused)
+        {
+            WorkerPool pool(2);
+            std::atomic<int> total(0);
+
+            // Each run must finish before the next starts
+            for (int run = 0; run < 50; ++run)
+            {
+                pool.run(8, [&](int i) { total += i; });
+                Assert::AreEqual((run + 1) * 28, total.load());
+            }
+        }
+
+        TEST_METHOD(PoolWithoutWorkersRunsOnCaller)
+        {
+            WorkerPool pool(0);
+            Assert::AreEqual(0, pool.workerCount());
+
+            std::vector<int> order;
+            pool.run(4, [&](int i) { order.push_back(i); });
+
+            Assert::AreEqual(4, (int)order.size());
+            for (int i = 0; i < 4; ++i)
+            {
+                Assert::AreEqual(i, order[i]);
+            }
+        }
+
+        TEST_METHOD(EmptyRunDoesNothing)
+        {
+            WorkerPool pool(2);
+            bool ran = false;
+            pool.run(0, [&](int) { ran = true; });
+            Assert::IsFalse(ran);
+        }
+    };
+}
\ No newline at end of file